@@ -70,7 +70,7 @@ class SP_EXPORT BaseObject
         /* === Identification === */
         
         //! Sets the objects's name.
-        inline void setName(const io::stringc &Name)
+        virtual void setName(const io::stringc &Name)
         {
             Name_ = Name;
         }
@@ -40,6 +40,7 @@
 #   define SP_COMPILE_WITH_SCENEGRAPH_SIMPLE_STREAM // Simple scene graph with streaming (for multi-threading)
 #   define SP_COMPILE_WITH_SCENEGRAPH_FAMILY_TREE   // Simple scene graph with child tree hierarchy
 #   define SP_COMPILE_WITH_SCENEGRAPH_PORTAL_BASED  // Portal-based scene graph
+#   define SP_COMPILE_WITH_SCENEGRAPH_SPATIAL       // Spatial scene graph with loose octrees
 #endif
 
 #ifdef SP_COMPILE_WITH_SOUNDSYSTEM
@@ -68,6 +69,7 @@
 #   define SP_COMPILE_WITH_INPUTSERVICE             // Input service
 #   define SP_COMPILE_WITH_MATRIXTEXTURE            // Matrix texture
 #   define SP_COMPILE_WITH_STORYBOARD               // Storyboard
+#   define SP_COMPILE_WITH_STATICBATCHER            // Static batcher
 #   define SP_COMPILE_WITH_TOKENSCANNER             // Token scanner
 #   define SP_COMPILE_WITH_COMMANDLINE              // Command line
 #   define SP_COMPILE_WITH_WEBPAGERENDERER          // Web page renderer
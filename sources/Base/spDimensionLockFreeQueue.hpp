@@ -0,0 +1,165 @@
+/*
+ * Lock-free queue header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_DIMENSION_LOCKFREEQUEUE_H__
+#define __SP_DIMENSION_LOCKFREEQUEUE_H__
+
+
+#include "Base/spStandard.hpp"
+
+#if defined(SP_COMPILER_VC)
+#   include <windows.h>
+#endif
+
+#include <vector>
+#include <algorithm>
+
+
+namespace sp
+{
+namespace dim
+{
+
+
+/**
+Lock-free queue for multiple producer threads and one consumer thread. Producers push their elements
+with an atomic compare-and-swap on the list head (no critical section), and the consumer takes all
+elements at once and gets them in the order they were pushed. Since the consumer always takes the whole list,
+the queue is not affected by the ABA problem.
+\since Version 3.3
+*/
+template <class T> class LockFreeQueue
+{
+    
+    public:
+        
+        LockFreeQueue() :
+            Head_(0)
+        {
+        }
+        ~LockFreeQueue()
+        {
+            std::vector<T> Elements;
+            popAll(Elements);
+        }
+        
+        /* === Functions === */
+        
+        //! Pushes the specified element into the queue. This can be called by any count of threads at the same time.
+        void push(const T &Element)
+        {
+            SNode* Node = new SNode(Element);
+            SNode* Head = 0;
+            
+            /* The first exchange only succeeds for an empty queue, otherwise it returns the current head */
+            while (1)
+            {
+                Node->Next = Head;
+                
+                SNode* Prev = compareExchange(&Head_, Head, Node);
+                
+                if (Prev == Head)
+                    break;
+                
+                Head = Prev;
+            }
+        }
+        
+        /**
+        Takes all elements from the queue and appends them to the specified list in the order they were pushed.
+        \note Only one thread may call this function at a time.
+        */
+        void popAll(std::vector<T> &Elements)
+        {
+            /* Take the whole list */
+            SNode* Head = 0;
+            
+            while (1)
+            {
+                SNode* Prev = compareExchange(&Head_, Head, 0);
+                
+                if (Prev == Head)
+                    break;
+                
+                Head = Prev;
+            }
+            
+            if (!Head)
+                return;
+            
+            /* Append the elements (the list is in reverse order) */
+            const size_t First = Elements.size();
+            
+            while (Head)
+            {
+                SNode* Next = Head->Next;
+                Elements.push_back(Head->Element);
+                delete Head;
+                Head = Next;
+            }
+            
+            std::reverse(Elements.begin() + First, Elements.end());
+        }
+        
+        /* === Inline functions === */
+        
+        //! Returns true if the queue is empty. When other threads are pushing, this is only a snapshot.
+        inline bool empty() const
+        {
+            return Head_ == 0;
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SNode
+        {
+            SNode(const T &InitElement) :
+                Element (InitElement),
+                Next    (0          )
+            {
+            }
+            
+            T Element;
+            SNode* Next;
+        };
+        
+        /* === Functions === */
+        
+        LockFreeQueue(const LockFreeQueue<T> &Other);
+        LockFreeQueue<T>& operator = (const LockFreeQueue<T> &Other);
+        
+        //! Atomically stores 'Exchange' if the destination equals 'Comparand' and returns the previous value (full memory barrier).
+        static inline SNode* compareExchange(SNode* volatile* Dest, SNode* Comparand, SNode* Exchange)
+        {
+            #if defined(SP_COMPILER_VC)
+            return static_cast<SNode*>(
+                InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(Dest), Exchange, Comparand)
+            );
+            #else
+            return __sync_val_compare_and_swap(Dest, Comparand, Exchange);
+            #endif
+        }
+        
+        /* === Members === */
+        
+        SNode* volatile Head_;
+        
+};
+
+
+} // /namespace dim
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
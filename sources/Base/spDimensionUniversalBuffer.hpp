@@ -13,6 +13,8 @@
 
 #include <vector>
 #include <cstring>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 
 
 namespace sp
@@ -25,6 +27,11 @@ namespace dim
 Universal buffer class to handle any kind of data in a large container. This is primary used for mesh buffers
 to handle blocks of data (e.g. vertices) easier. Also format conversions (e.g. video::MeshBuffer::setVertexFormat)
 can be handled easier instead of just using an std::vector. Note that this is an array container. Thus adding new data can be slow.
+\note Since version 3.3 the memory is shared between copies (copy-on-write). Copying a buffer only increments a reference counter
+and the memory is cloned when a copy is modified, i.e. when any non-constant function (e.g. "set", "add" or the non-constant "getArray")
+is called while the memory is shared. Thus pointers which have been returned by non-constant functions become invalid when the buffer is copied.
+Each non-constant function also increments the revision number. Therefore use a constant reference for read-only access (e.g. "getArray" or "getContainer"),
+otherwise shared memory is cloned and hardware buffers are uploaded again.
 */
 class UniversalBuffer
 {
@@ -32,12 +39,15 @@ class UniversalBuffer
     public:
         
         UniversalBuffer() :
-            Stride_(1)
+            Stride_     (1                                      ),
+            Buffer_     (boost::make_shared< std::vector<s8> >()),
+            Revision_   (0                                      )
         {
         }
         UniversalBuffer(const UniversalBuffer &Other) :
-            Stride_(Other.Stride_),
-            Buffer_(Other.Buffer_)
+            Stride_     (Other.Stride_  ),
+            Buffer_     (Other.Buffer_  ),
+            Revision_   (Other.Revision_)
         {
         }
         ~UniversalBuffer()
@@ -49,6 +59,7 @@ class UniversalBuffer
         {
             Stride_ = Other.Stride_;
             Buffer_ = Other.Buffer_;
+            ++Revision_;
             return *this;
         }
         
@@ -79,8 +90,9 @@ class UniversalBuffer
         */
         template <typename T> inline T* getRef(size_t Index)
         {
-            if (Index * Stride_ + sizeof(T) <= Buffer_.size())
-                return reinterpret_cast<T*>(&Buffer_[Index * Stride_]);
+            std::vector<s8> &Data = modify();
+            if (Index * Stride_ + sizeof(T) <= Data.size())
+                return reinterpret_cast<T*>(&Data[Index * Stride_]);
             return 0;
         }
         /**
@@ -91,8 +103,8 @@ class UniversalBuffer
         */
         template <typename T> inline const T* getRef(size_t Index) const
         {
-            if (Index * Stride_ + sizeof(T) <= Buffer_.size())
-                return reinterpret_cast<const T*>(&Buffer_[Index * Stride_]);
+            if (Index * Stride_ + sizeof(T) <= Buffer_->size())
+                return reinterpret_cast<const T*>(&(*Buffer_)[Index * Stride_]);
             return 0;
         }
         
@@ -103,13 +115,14 @@ class UniversalBuffer
         */
         template <typename T> inline void set(size_t Offset, const T &Value)
         {
-            if (Offset + sizeof(T) <= Buffer_.size())
-                memcpy(&Buffer_[Offset], &Value, sizeof(T));
+            std::vector<s8> &Data = modify();
+            if (Offset + sizeof(T) <= Data.size())
+                memcpy(&Data[Offset], &Value, sizeof(T));
         }
         template <typename T> inline T get(size_t Offset) const
         {
-            if (Offset + sizeof(T) <= Buffer_.size())
-                return *((T*)&Buffer_[Offset]);
+            if (Offset + sizeof(T) <= Buffer_->size())
+                return *((T*)&(*Buffer_)[Offset]);
             return T(0);
         }
         
@@ -137,17 +150,18 @@ class UniversalBuffer
         */
         template <typename T> inline void set(size_t Index, size_t Offset, size_t MaxSize, const T &Value)
         {
+            std::vector<s8> &Data = modify();
             const size_t Size = (sizeof(T) > MaxSize ? MaxSize : sizeof(T));
             Offset += Index * Stride_;
-            if (Offset + Size <= Buffer_.size())
-                memcpy(&Buffer_[Offset], &Value, Size);
+            if (Offset + Size <= Data.size())
+                memcpy(&Data[Offset], &Value, Size);
         }
         template <typename T> inline T get(size_t Index, size_t Offset, size_t MaxSize) const
         {
             const size_t Size = (sizeof(T) > MaxSize ? MaxSize : sizeof(T));
             Offset += Index * Stride_;
-            if (Offset + Size <= Buffer_.size())
-                return *((T*)&Buffer_[Offset]);
+            if (Offset + Size <= Buffer_->size())
+                return *((T*)&(*Buffer_)[Offset]);
             return T(0);
         }
         
@@ -159,13 +173,14 @@ class UniversalBuffer
         */
         inline void setBuffer(size_t Offset, const void* Buffer, size_t Size)
         {
-            if (Offset + Size <= Buffer_.size())
-                memcpy(&Buffer_[Offset], Buffer, Size);
+            std::vector<s8> &Data = modify();
+            if (Offset + Size <= Data.size())
+                memcpy(&Data[Offset], Buffer, Size);
         }
         inline void getBuffer(size_t Offset, void* Buffer, size_t Size) const
         {
-            if (Offset + Size <= Buffer_.size())
-                memcpy(Buffer, &Buffer_[Offset], Size);
+            if (Offset + Size <= Buffer_->size())
+                memcpy(Buffer, &(*Buffer_)[Offset], Size);
         }
         
         /**
@@ -194,93 +209,103 @@ class UniversalBuffer
         //! Adds the specified memory at the end of the array.
         template <typename T> inline void add(const T &Value)
         {
-            const size_t Offset = Buffer_.size();
-            Buffer_.resize(Buffer_.size() + sizeof(T));
-            set(Offset, Value);
+            std::vector<s8> &Data = modify();
+            const size_t Offset = Data.size();
+            Data.resize(Offset + sizeof(T));
+            memcpy(&Data[Offset], &Value, sizeof(T));
         }
         //! Removes memory in the specified range [Offset .. Offset + Size).
         template <typename T> inline void remove(size_t Index, size_t Offset)
         {
+            std::vector<s8> &Data = modify();
             const size_t FinalOffset = Index * Stride_ + Offset;
-            Buffer_.erase(Buffer_.begin() + FinalOffset, Buffer_.end() + FinalOffset + sizeof(T));
+            Data.erase(Data.begin() + FinalOffset, Data.end() + FinalOffset + sizeof(T));
         }
         
         //! Adds the given buffer to this buffer. This and the given buffer must have the same 'stride' value.
         inline void add(const UniversalBuffer &Other)
         {
-            if (Stride_ == Other.Stride_)
+            if (Stride_ == Other.Stride_ && !Other.empty())
             {
-                const size_t PrevSize = Buffer_.size();
-                Buffer_.resize(PrevSize + Other.Buffer_.size());
-                memcpy(&Buffer_[PrevSize], &Other.Buffer_[0], Other.Buffer_.size());
+                std::vector<s8> &Data = modify();
+                const size_t PrevSize = Data.size();
+                Data.resize(PrevSize + Other.Buffer_->size());
+                memcpy(&Data[PrevSize], &(*Other.Buffer_)[0], Other.Buffer_->size());
             }
         }
         
         inline void removeBuffer(size_t Offset, size_t Size)
         {
-            Buffer_.erase(Buffer_.begin() + Offset, Buffer_.begin() + Offset + Size);
+            std::vector<s8> &Data = modify();
+            Data.erase(Data.begin() + Offset, Data.begin() + Offset + Size);
         }
         inline void removeBuffer(size_t Index, size_t Offset, size_t Size)
         {
+            std::vector<s8> &Data = modify();
             const size_t FinalOffset = Index * Stride_ + Offset;
-            Buffer_.erase(Buffer_.begin() + FinalOffset, Buffer_.begin() + FinalOffset + Size);
+            Data.erase(Data.begin() + FinalOffset, Data.begin() + FinalOffset + Size);
         }
         
         //! Returns the buffer array. This points to the first element in the array.
         inline s8* getArray()
         {
-            return Buffer_.size() ? &Buffer_[0] : 0;
+            std::vector<s8> &Data = modify();
+            return Data.size() ? &Data[0] : 0;
         }
         //! Returns the buffer array. This points to the first element in the array.
         inline const s8* getArray() const
         {
-            return Buffer_.size() ? &Buffer_[0] : 0;
+            return Buffer_->size() ? &(*Buffer_)[0] : 0;
         }
         
         //! Returns the buffer array at the specified position.
         inline s8* getArray(size_t Offset)
         {
-            return Buffer_.size() ? &Buffer_[Offset] : 0;
+            std::vector<s8> &Data = modify();
+            return Data.size() ? &Data[Offset] : 0;
         }
         //! Returns the buffer array at the specified position.
         inline const s8* getArray(size_t Offset) const
         {
-            return Buffer_.size() ? &Buffer_[Offset] : 0;
+            return Buffer_->size() ? &(*Buffer_)[Offset] : 0;
         }
         
         //! Returns the buffer array at the specified position (index * stride + offset).
         inline s8* getArray(size_t Index, size_t Offset)
         {
-            return Buffer_.size() ? &Buffer_[Index * Stride_ + Offset] : 0;
+            std::vector<s8> &Data = modify();
+            return Data.size() ? &Data[Index * Stride_ + Offset] : 0;
         }
         //! Returns the buffer array at the specified position (index * stride + offset).
         inline const s8* getArray(size_t Index, size_t Offset) const
         {
-            return Buffer_.size() ? &Buffer_[Index * Stride_ + Offset] : 0;
+            return Buffer_->size() ? &(*Buffer_)[Index * Stride_ + Offset] : 0;
         }
         
         //! Resizes the buffer (Size in Bytes).
         inline void setSize(size_t Size)
         {
-            Buffer_.resize(Size);
+            std::vector<s8> &Data = modify();
+            Data.resize(Size);
         }
         
         //! Returns the buffer's size (Size in Bytes).
         inline size_t getSize() const
         {
-            return Buffer_.size();
+            return Buffer_->size();
         }
         
         //! Resizes the buffer (Size in stride). This is equivalent to "setSize(Count * getStride())".
         inline void setCount(size_t Count)
         {
-            Buffer_.resize(Count * Stride_);
+            std::vector<s8> &Data = modify();
+            Data.resize(Count * Stride_);
         }
         
         //! Returns the count of elements in the buffer. This is equivalent to "getSize() / getStride()".
         inline size_t getCount() const
         {
-            return Buffer_.size() / Stride_;
+            return Buffer_->size() / Stride_;
         }
         
         /**
@@ -290,39 +315,79 @@ class UniversalBuffer
         */
         inline void fill(size_t Offset, size_t Size)
         {
-            if (Buffer_.size() >= Offset + Size)
-                memset(&Buffer_[Offset], 0, Size);
+            std::vector<s8> &Data = modify();
+            if (Data.size() >= Offset + Size)
+                memset(&Data[Offset], 0, Size);
         }
         
         //! Clears the whole buffer.
         inline void clear()
         {
-            Buffer_.clear();
+            /* Don't clone the memory which is to be cleared */
+            if (Buffer_.unique())
+                Buffer_->clear();
+            else
+                Buffer_ = boost::make_shared< std::vector<s8> >();
+            ++Revision_;
         }
         
         //! Returns true if this universal buffer is empty.
         inline bool empty() const
         {
-            return Buffer_.empty();
+            return Buffer_->empty();
         }
         
         //! Returns a reference to the actual container object (std::vector<s8>).
         inline std::vector<s8>& getContainer()
         {
-            return Buffer_;
+            return modify();
         }
         //! Returns a constant reference to the actual container object (std::vector<s8>).
         inline const std::vector<s8>& getContainer() const
         {
-            return Buffer_;
+            return *Buffer_;
+        }
+        
+        /**
+        Returns true if the memory is shared with other copies of this buffer.
+        \see UniversalBuffer
+        \since Version 3.3
+        */
+        inline bool isShared() const
+        {
+            return !Buffer_.unique();
+        }
+        
+        /**
+        Returns the revision number. This is incremented each time the buffer may have been modified,
+        i.e. on each call of a non-constant function. Copy constructed buffers get the revision number of the source buffer.
+        This can be used to determine whether the data has been changed since a certain point in time
+        (e.g. since the data has been uploaded to a hardware buffer).
+        \since Version 3.3
+        */
+        inline u32 getRevision() const
+        {
+            return Revision_;
         }
         
     private:
         
+        /* Functions */
+        
+        //! Clones the memory if it's shared and returns the container for modification.
+        inline std::vector<s8>& modify()
+        {
+            if (!Buffer_.unique())
+                Buffer_ = boost::make_shared< std::vector<s8> >(*Buffer_);
+            ++Revision_;
+            return *Buffer_;
+        }
+        
         /* Members */
         
         size_t Stride_; // 1 (byte), 2 (short), 4 (int) etc.
-        std::vector<s8> Buffer_;
+        boost::shared_ptr< std::vector<s8> > Buffer_;
+        u32 Revision_;
         
 };
 
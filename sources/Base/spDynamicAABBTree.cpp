@@ -0,0 +1,468 @@
+/*
+ * Dynamic AABB tree file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "Base/spDynamicAABBTree.hpp"
+#include "Base/spMathCore.hpp"
+#include "Base/spInputOutputLog.hpp"
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/*
+ * Internal functions
+ */
+
+static f32 getBoxSurfaceArea(const dim::aabbox3df &Box)
+{
+    const dim::vector3df Size(Box.getSize());
+    return 2.0f * (Size.X*Size.Y + Size.Y*Size.Z + Size.Z*Size.X);
+}
+
+static dim::aabbox3df getBoxUnion(const dim::aabbox3df &BoxA, const dim::aabbox3df &BoxB)
+{
+    return dim::aabbox3df(
+        dim::vector3df(
+            math::Min(BoxA.Min.X, BoxB.Min.X),
+            math::Min(BoxA.Min.Y, BoxB.Min.Y),
+            math::Min(BoxA.Min.Z, BoxB.Min.Z)
+        ),
+        dim::vector3df(
+            math::Max(BoxA.Max.X, BoxB.Max.X),
+            math::Max(BoxA.Max.Y, BoxB.Max.Y),
+            math::Max(BoxA.Max.Z, BoxB.Max.Z)
+        )
+    );
+}
+
+static bool isBoxInsideBox(const dim::aabbox3df &Inner, const dim::aabbox3df &Outer)
+{
+    return
+        Inner.Min.X >= Outer.Min.X && Inner.Min.Y >= Outer.Min.Y && Inner.Min.Z >= Outer.Min.Z &&
+        Inner.Max.X <= Outer.Max.X && Inner.Max.Y <= Outer.Max.Y && Inner.Max.Z <= Outer.Max.Z;
+}
+
+static bool checkBoxOverlap(const dim::aabbox3df &BoxA, const dim::aabbox3df &BoxB)
+{
+    return
+        BoxA.Min.X <= BoxB.Max.X && BoxA.Max.X >= BoxB.Min.X &&
+        BoxA.Min.Y <= BoxB.Max.Y && BoxA.Max.Y >= BoxB.Min.Y &&
+        BoxA.Min.Z <= BoxB.Max.Z && BoxA.Max.Z >= BoxB.Min.Z;
+}
+
+
+/*
+ * DynamicAABBTree class
+ */
+
+DynamicAABBTree::DynamicAABBTree(f32 Margin) :
+    Root_       (-1     ),
+    FreeList_   (-1     ),
+    ProxyCount_ (0      ),
+    Margin_     (Margin )
+{
+}
+DynamicAABBTree::~DynamicAABBTree()
+{
+}
+
+s32 DynamicAABBTree::createProxy(const dim::aabbox3df &Box, void* UserData)
+{
+    const s32 Leaf = allocNode();
+    
+    /* Store fat bounding box */
+    SNode& Node = Nodes_[Leaf];
+    {
+        Node.Box.Min    = Box.Min - Margin_;
+        Node.Box.Max    = Box.Max + Margin_;
+        Node.UserData   = UserData;
+        Node.Height     = 0;
+    }
+    insertLeaf(Leaf);
+    
+    ++ProxyCount_;
+    
+    return Leaf;
+}
+
+void DynamicAABBTree::destroyProxy(s32 ProxyID)
+{
+    /* Free nodes are also leaves, so check the height to prevent a double release */
+    if (!isProxy(ProxyID))
+    {
+        io::Log::warning("Invalid proxy ID for AABB tree destruction");
+        return;
+    }
+    
+    removeLeaf(ProxyID);
+    freeNode(ProxyID);
+    --ProxyCount_;
+}
+
+bool DynamicAABBTree::moveProxy(s32 ProxyID, const dim::aabbox3df &Box)
+{
+    if (!isProxy(ProxyID))
+        return false;
+    
+    /* Check if the new box is still inside the fat box */
+    if (isBoxInsideBox(Box, Nodes_[ProxyID].Box))
+        return false;
+    
+    /* Re-insert the leaf with a new fat box */
+    removeLeaf(ProxyID);
+    
+    Nodes_[ProxyID].Box.Min = Box.Min - Margin_;
+    Nodes_[ProxyID].Box.Max = Box.Max + Margin_;
+    
+    insertLeaf(ProxyID);
+    
+    return true;
+}
+
+void DynamicAABBTree::findOverlaps(const dim::aabbox3df &Box, std::vector<void*> &UserDataList) const
+{
+    if (Root_ == -1)
+        return;
+    
+    /* Traverse the tree with an explicit stack to avoid recursion */
+    Stack_.clear();
+    Stack_.push_back(Root_);
+    
+    while (!Stack_.empty())
+    {
+        const SNode& Node = Nodes_[Stack_.back()];
+        Stack_.pop_back();
+        
+        if (!checkBoxOverlap(Node.Box, Box))
+            continue;
+        
+        if (Node.isLeaf())
+            UserDataList.push_back(Node.UserData);
+        else
+        {
+            Stack_.push_back(Node.ChildA);
+            Stack_.push_back(Node.ChildB);
+        }
+    }
+}
+
+void DynamicAABBTree::clear()
+{
+    Nodes_.clear();
+    Root_       = -1;
+    FreeList_   = -1;
+    ProxyCount_ = 0;
+}
+
+s32 DynamicAABBTree::getHeight() const
+{
+    return Root_ != -1 ? Nodes_[Root_].Height : 0;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+s32 DynamicAABBTree::allocNode()
+{
+    s32 Index = 0;
+    
+    if (FreeList_ != -1)
+    {
+        /* Re-use node from the free list */
+        Index = FreeList_;
+        FreeList_ = Nodes_[Index].Parent;
+    }
+    else
+    {
+        /* Append new node to the node array */
+        Index = static_cast<s32>(Nodes_.size());
+        Nodes_.resize(Nodes_.size() + 1);
+    }
+    
+    SNode& Node = Nodes_[Index];
+    {
+        Node.UserData   = 0;
+        Node.Parent     = -1;
+        Node.ChildA     = -1;
+        Node.ChildB     = -1;
+        Node.Height     = 0;
+    }
+    return Index;
+}
+
+void DynamicAABBTree::freeNode(s32 Index)
+{
+    Nodes_[Index].Parent    = FreeList_;
+    Nodes_[Index].Height    = -1;
+    FreeList_ = Index;
+}
+
+void DynamicAABBTree::insertLeaf(s32 Leaf)
+{
+    if (Root_ == -1)
+    {
+        Root_ = Leaf;
+        Nodes_[Root_].Parent = -1;
+        return;
+    }
+    
+    /* Find the best sibling by the surface area heuristic */
+    const dim::aabbox3df LeafBox(Nodes_[Leaf].Box);
+    s32 Index = Root_;
+    
+    while (!Nodes_[Index].isLeaf())
+    {
+        const SNode& Node = Nodes_[Index];
+        
+        const f32 Area          = getBoxSurfaceArea(Node.Box);
+        const f32 CombinedArea  = getBoxSurfaceArea(getBoxUnion(Node.Box, LeafBox));
+        
+        /* Cost of creating a new parent for this node and the new leaf */
+        const f32 Cost = 2.0f * CombinedArea;
+        
+        /* Minimum cost of pushing the leaf further down the tree */
+        const f32 InheritanceCost = 2.0f * (CombinedArea - Area);
+        
+        f32 CostA = getBoxSurfaceArea(getBoxUnion(LeafBox, Nodes_[Node.ChildA].Box)) + InheritanceCost;
+        f32 CostB = getBoxSurfaceArea(getBoxUnion(LeafBox, Nodes_[Node.ChildB].Box)) + InheritanceCost;
+        
+        if (!Nodes_[Node.ChildA].isLeaf())
+            CostA -= getBoxSurfaceArea(Nodes_[Node.ChildA].Box);
+        if (!Nodes_[Node.ChildB].isLeaf())
+            CostB -= getBoxSurfaceArea(Nodes_[Node.ChildB].Box);
+        
+        /* Descend according to the minimum cost */
+        if (Cost < CostA && Cost < CostB)
+            break;
+        
+        Index = (CostA < CostB ? Node.ChildA : Node.ChildB);
+    }
+    
+    const s32 Sibling = Index;
+    
+    /* Create a new parent for the sibling and the new leaf */
+    const s32 OldParent = Nodes_[Sibling].Parent;
+    const s32 NewParent = allocNode();
+    
+    SNode& ParentNode = Nodes_[NewParent];
+    {
+        ParentNode.Parent   = OldParent;
+        ParentNode.Box      = getBoxUnion(LeafBox, Nodes_[Sibling].Box);
+        ParentNode.Height   = Nodes_[Sibling].Height + 1;
+        ParentNode.ChildA   = Sibling;
+        ParentNode.ChildB   = Leaf;
+    }
+    
+    if (OldParent != -1)
+    {
+        if (Nodes_[OldParent].ChildA == Sibling)
+            Nodes_[OldParent].ChildA = NewParent;
+        else
+            Nodes_[OldParent].ChildB = NewParent;
+    }
+    else
+        Root_ = NewParent;
+    
+    Nodes_[Sibling].Parent  = NewParent;
+    Nodes_[Leaf].Parent     = NewParent;
+    
+    /* Walk back up the tree fixing heights and boxes */
+    refitAncestors(Nodes_[Leaf].Parent);
+}
+
+void DynamicAABBTree::removeLeaf(s32 Leaf)
+{
+    if (Leaf == Root_)
+    {
+        Root_ = -1;
+        return;
+    }
+    
+    const s32 Parent        = Nodes_[Leaf].Parent;
+    const s32 GrandParent   = Nodes_[Parent].Parent;
+    const s32 Sibling       = (Nodes_[Parent].ChildA == Leaf ? Nodes_[Parent].ChildB : Nodes_[Parent].ChildA);
+    
+    if (GrandParent != -1)
+    {
+        /* Destroy parent and connect sibling to grand parent */
+        if (Nodes_[GrandParent].ChildA == Parent)
+            Nodes_[GrandParent].ChildA = Sibling;
+        else
+            Nodes_[GrandParent].ChildB = Sibling;
+        
+        Nodes_[Sibling].Parent = GrandParent;
+        freeNode(Parent);
+        
+        refitAncestors(GrandParent);
+    }
+    else
+    {
+        Root_ = Sibling;
+        Nodes_[Sibling].Parent = -1;
+        freeNode(Parent);
+    }
+}
+
+void DynamicAABBTree::refitAncestors(s32 Index)
+{
+    while (Index != -1)
+    {
+        Index = balance(Index);
+        
+        SNode& Node = Nodes_[Index];
+        
+        const SNode& ChildA = Nodes_[Node.ChildA];
+        const SNode& ChildB = Nodes_[Node.ChildB];
+        
+        Node.Height = 1 + math::Max(ChildA.Height, ChildB.Height);
+        Node.Box    = getBoxUnion(ChildA.Box, ChildB.Box);
+        
+        Index = Node.Parent;
+    }
+}
+
+s32 DynamicAABBTree::balance(s32 IndexA)
+{
+    /*
+    Performs a left or right rotation if node A is imbalanced:
+          A
+        /   \
+       B     C
+      / \   / \
+     D   E F   G
+    */
+    SNode* A = &Nodes_[IndexA];
+    
+    if (A->isLeaf() || A->Height < 2)
+        return IndexA;
+    
+    const s32 IndexB = A->ChildA;
+    const s32 IndexC = A->ChildB;
+    
+    SNode* B = &Nodes_[IndexB];
+    SNode* C = &Nodes_[IndexC];
+    
+    const s32 Balance = C->Height - B->Height;
+    
+    if (Balance > 1)
+    {
+        /* Rotate C up */
+        const s32 IndexF = C->ChildA;
+        const s32 IndexG = C->ChildB;
+        
+        SNode* F = &Nodes_[IndexF];
+        SNode* G = &Nodes_[IndexG];
+        
+        C->ChildA = IndexA;
+        C->Parent = A->Parent;
+        A->Parent = IndexC;
+        
+        if (C->Parent != -1)
+        {
+            if (Nodes_[C->Parent].ChildA == IndexA)
+                Nodes_[C->Parent].ChildA = IndexC;
+            else
+                Nodes_[C->Parent].ChildB = IndexC;
+        }
+        else
+            Root_ = IndexC;
+        
+        if (F->Height > G->Height)
+        {
+            C->ChildB = IndexF;
+            A->ChildB = IndexG;
+            G->Parent = IndexA;
+            
+            A->Box = getBoxUnion(B->Box, G->Box);
+            C->Box = getBoxUnion(A->Box, F->Box);
+            
+            A->Height = 1 + math::Max(B->Height, G->Height);
+            C->Height = 1 + math::Max(A->Height, F->Height);
+        }
+        else
+        {
+            C->ChildB = IndexG;
+            A->ChildB = IndexF;
+            F->Parent = IndexA;
+            
+            A->Box = getBoxUnion(B->Box, F->Box);
+            C->Box = getBoxUnion(A->Box, G->Box);
+            
+            A->Height = 1 + math::Max(B->Height, F->Height);
+            C->Height = 1 + math::Max(A->Height, G->Height);
+        }
+        
+        return IndexC;
+    }
+    
+    if (Balance < -1)
+    {
+        /* Rotate B up */
+        const s32 IndexD = B->ChildA;
+        const s32 IndexE = B->ChildB;
+        
+        SNode* D = &Nodes_[IndexD];
+        SNode* E = &Nodes_[IndexE];
+        
+        B->ChildA = IndexA;
+        B->Parent = A->Parent;
+        A->Parent = IndexB;
+        
+        if (B->Parent != -1)
+        {
+            if (Nodes_[B->Parent].ChildA == IndexA)
+                Nodes_[B->Parent].ChildA = IndexB;
+            else
+                Nodes_[B->Parent].ChildB = IndexB;
+        }
+        else
+            Root_ = IndexB;
+        
+        if (D->Height > E->Height)
+        {
+            B->ChildB = IndexD;
+            A->ChildA = IndexE;
+            E->Parent = IndexA;
+            
+            A->Box = getBoxUnion(C->Box, E->Box);
+            B->Box = getBoxUnion(A->Box, D->Box);
+            
+            A->Height = 1 + math::Max(C->Height, E->Height);
+            B->Height = 1 + math::Max(A->Height, D->Height);
+        }
+        else
+        {
+            B->ChildB = IndexE;
+            A->ChildA = IndexD;
+            D->Parent = IndexA;
+            
+            A->Box = getBoxUnion(C->Box, D->Box);
+            B->Box = getBoxUnion(A->Box, E->Box);
+            
+            A->Height = 1 + math::Max(C->Height, D->Height);
+            B->Height = 1 + math::Max(A->Height, E->Height);
+        }
+        
+        return IndexB;
+    }
+    
+    return IndexA;
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
@@ -0,0 +1,166 @@
+/*
+ * Dynamic AABB tree header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_DYNAMIC_AABB_TREE_H__
+#define __SP_DYNAMIC_AABB_TREE_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimensionAABB.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+static const f32 DEF_AABBTREE_MARGIN = 0.1f;
+
+
+/**
+Dynamic bounding volume hierarchy for incrementally changing objects.
+Each object is stored as a "proxy" with an enlarged ("fat") bounding box. As long as the object's
+bounding box stays inside its fat box the tree will not be modified. Otherwise the proxy is re-inserted.
+The tree is kept balanced by tree rotations and all nodes are stored in one contiguous array.
+\note The object boxes are expected in the same space (e.g. global space) for all proxies.
+\since Version 3.3
+*/
+class SP_EXPORT DynamicAABBTree
+{
+
+    public:
+        
+        DynamicAABBTree(f32 Margin = DEF_AABBTREE_MARGIN);
+        ~DynamicAABBTree();
+        
+        /* === Functions === */
+        
+        /**
+        Creates a new proxy for the specified bounding box.
+        \param[in] Box Specifies the object's bounding box.
+        \param[in] UserData Specifies the user data which will be returned by the queries.
+        \return Proxy ID which is required to move or destroy this proxy.
+        */
+        s32 createProxy(const dim::aabbox3df &Box, void* UserData);
+        
+        /**
+        Destroys the specified proxy. The ID may be re-used for a new proxy afterwards.
+        Invalid IDs and proxies which have already been destroyed are ignored and a warning is printed.
+        */
+        void destroyProxy(s32 ProxyID);
+        
+        /**
+        Moves the specified proxy to the new bounding box.
+        \return True if the proxy has been re-inserted, i.e. the new box was not completely
+        inside the proxy's fat bounding box.
+        */
+        bool moveProxy(s32 ProxyID, const dim::aabbox3df &Box);
+        
+        /**
+        Finds all proxies whose fat bounding boxes overlap the specified box.
+        \param[in] Box Specifies the query box.
+        \param[out] UserDataList Specifies the list where the user data of each proxy will be appended.
+        The list will not be cleared before.
+        */
+        void findOverlaps(const dim::aabbox3df &Box, std::vector<void*> &UserDataList) const;
+        
+        //! Removes all proxies.
+        void clear();
+        
+        //! Returns the height of the tree hierarchy. A tree with a single proxy has height 0.
+        s32 getHeight() const;
+        
+        /* === Inline functions === */
+        
+        //! Returns the user data of the specified proxy.
+        inline void* getUserData(s32 ProxyID) const
+        {
+            return Nodes_[ProxyID].UserData;
+        }
+        //! Returns the fat bounding box of the specified proxy.
+        inline const dim::aabbox3df& getFatBox(s32 ProxyID) const
+        {
+            return Nodes_[ProxyID].Box;
+        }
+        
+        //! Returns the count of proxies inside this tree.
+        inline u32 getProxyCount() const
+        {
+            return ProxyCount_;
+        }
+        
+        //! Returns the margin which is used to enlarge each proxy's bounding box.
+        inline f32 getMargin() const
+        {
+            return Margin_;
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SNode
+        {
+            inline bool isLeaf() const
+            {
+                return ChildA == -1;
+            }
+            
+            /* Members */
+            dim::aabbox3df Box;
+            void* UserData;
+            s32 Parent;     //!< Parent node index or next free node index.
+            s32 ChildA;
+            s32 ChildB;
+            s32 Height;     //!< Leaf nodes have height 0, free nodes have height -1.
+        };
+        
+        /* === Functions === */
+        
+        s32 allocNode();
+        void freeNode(s32 Index);
+        
+        //! Returns true if the specified ID refers to a live proxy, i.e. an allocated leaf node.
+        inline bool isProxy(s32 ProxyID) const
+        {
+            return ProxyID >= 0 && ProxyID < static_cast<s32>(Nodes_.size()) && Nodes_[ProxyID].Height == 0;
+        }
+        
+        void insertLeaf(s32 Leaf);
+        void removeLeaf(s32 Leaf);
+        
+        s32 balance(s32 Index);
+        void refitAncestors(s32 Index);
+        
+        /* === Members === */
+        
+        std::vector<SNode> Nodes_;
+        
+        s32 Root_;
+        s32 FreeList_;
+        u32 ProxyCount_;
+        
+        f32 Margin_;
+        
+        mutable std::vector<s32> Stack_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
@@ -0,0 +1,783 @@
+/*
+ * Linear kd-Tree file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "Base/spLinearKDTree.hpp"
+#include "Base/spMathCore.hpp"
+#include "Base/spInputOutputLog.hpp"
+#include "SceneGraph/Collision/spCollisionMesh.hpp"
+
+#include <boost/foreach.hpp>
+#include <algorithm>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/*
+ * Internal structures
+ */
+
+//! Traversal stack for a packet of lines (each line has its own parametric range).
+struct SLinearKDTreeStack
+{
+    u32 Node    [LINEARKDTREE_MAX_DEPTH + 2];
+    u32 Mask    [LINEARKDTREE_MAX_DEPTH + 2];
+    f32 TMin    [LINEARKDTREE_MAX_DEPTH + 2][COLLISION_RAYPACKET_SIZE];
+    f32 TMax    [LINEARKDTREE_MAX_DEPTH + 2][COLLISION_RAYPACKET_SIZE];
+    u32 Size;
+};
+
+//! Line in parametric form: Origin + Direction * t with t in [0.0 .. 1.0].
+struct SLinearKDTreeRay
+{
+    dim::vector3df Origin;
+    dim::vector3df Direction;
+    dim::vector3df InvDirection;
+};
+
+
+/*
+ * Internal functions
+ */
+
+static bool clipRayToBox(const SLinearKDTreeRay &Ray, const dim::aabbox3df &Box, f32 &TMin, f32 &TMax)
+{
+    for (s32 i = 0; i < 3; ++i)
+    {
+        if (Ray.Direction[i] == 0.0f)
+        {
+            if (Ray.Origin[i] < Box.Min[i] || Ray.Origin[i] > Box.Max[i])
+                return false;
+            continue;
+        }
+        
+        f32 TNear   = (Box.Min[i] - Ray.Origin[i]) * Ray.InvDirection[i];
+        f32 TFar    = (Box.Max[i] - Ray.Origin[i]) * Ray.InvDirection[i];
+        
+        if (TNear > TFar)
+            std::swap(TNear, TFar);
+        
+        TMin = math::Max(TMin, TNear);
+        TMax = math::Min(TMax, TFar);
+        
+        if (TMin > TMax)
+            return false;
+    }
+    return true;
+}
+
+//! Returns true if intersection A is in front of intersection B (sorted by distance and triangle index).
+static inline bool cmpLinearKDTreeIntersections(const SLinearKDTreeIntersection &A, const SLinearKDTreeIntersection &B)
+{
+    return A.Distance < B.Distance || ( A.Distance == B.Distance && A.Triangle < B.Triangle );
+}
+
+//! Inserts the intersection into the sorted array. Only the nearest "MaxCount" intersections are kept.
+static void insertLinearKDTreeIntersection(
+    SLinearKDTreeIntersection* Intersections, u32 &Count, u32 MaxCount, const SLinearKDTreeIntersection &Intersection)
+{
+    /* Triangles can be referenced by several leaf nodes */
+    for (u32 i = 0; i < Count; ++i)
+    {
+        if (Intersections[i].Triangle == Intersection.Triangle)
+            return;
+    }
+    
+    /* Drop the farthest intersection if the array is full */
+    if (Count == MaxCount)
+    {
+        if (!cmpLinearKDTreeIntersections(Intersection, Intersections[Count - 1]))
+            return;
+        --Count;
+    }
+    
+    /* Insertion sort */
+    u32 i = Count++;
+    
+    for (; i > 0 && cmpLinearKDTreeIntersections(Intersection, Intersections[i - 1]); --i)
+        Intersections[i] = Intersections[i - 1];
+    
+    Intersections[i] = Intersection;
+}
+
+static void setupRay(SLinearKDTreeRay &Ray, const dim::line3df &Line)
+{
+    Ray.Origin      = Line.Start;
+    Ray.Direction   = Line.End - Line.Start;
+    
+    for (s32 i = 0; i < 3; ++i)
+        Ray.InvDirection[i] = (Ray.Direction[i] != 0.0f ? 1.0f / Ray.Direction[i] : 0.0f);
+}
+
+/**
+Splits the parametric ranges of all lines in the mask for the children of the specified inner node and
+pushes them onto the stack. The child which is nearer for the first line will be traversed first.
+*/
+static void pushChildNodes(
+    const LinearKDTree::SNode &Node, u32 NodeIndex, const SLinearKDTreeRay* Rays, u32 Count, u32 Mask,
+    const f32* TMin, const f32* TMax, SLinearKDTreeStack &Stack)
+{
+    const EKDTreeAxles Axis = Node.getAxis();
+    const u32 ChildNear     = NodeIndex + 1;
+    const u32 ChildFar      = Node.getChildFar();
+    
+    bool LeadBelowFirst = true;
+    bool HasLead = false;
+    
+    /* Reserve stack entries for both children (the upper entry will be popped first) */
+    u32 NearEntry = Stack.Size + 1, FarEntry = Stack.Size;
+    
+    u32 MaskNear = 0, MaskFar = 0;
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        if (!(Mask & (1u << i)))
+            continue;
+        
+        const SLinearKDTreeRay& Ray = Rays[i];
+        
+        const f32 Origin    = Ray.Origin[Axis];
+        const f32 Direction = Ray.Direction[Axis];
+        
+        const bool BelowFirst = (Origin < Node.Distance || ( Origin == Node.Distance && Direction <= 0.0f ));
+        
+        if (!HasLead)
+        {
+            /* The first line determines the traversal order */
+            LeadBelowFirst  = BelowFirst;
+            HasLead         = true;
+            
+            if (!LeadBelowFirst)
+                std::swap(NearEntry, FarEntry);
+        }
+        
+        const u32 FirstEntry    = (BelowFirst ? NearEntry : FarEntry);
+        const u32 SecondEntry   = (BelowFirst ? FarEntry : NearEntry);
+        u32& FirstMask          = (BelowFirst ? MaskNear : MaskFar);
+        u32& SecondMask         = (BelowFirst ? MaskFar : MaskNear);
+        
+        if (Direction == 0.0f)
+        {
+            /* Line is parallel to the splitting plane */
+            Stack.TMin[FirstEntry][i] = TMin[i];
+            Stack.TMax[FirstEntry][i] = TMax[i];
+            FirstMask |= (1u << i);
+            continue;
+        }
+        
+        const f32 TSplit = (Node.Distance - Origin) * Ray.InvDirection[Axis];
+        
+        if (TSplit > TMax[i] || TSplit <= 0.0f)
+        {
+            /* Only the first child is traversed */
+            Stack.TMin[FirstEntry][i] = TMin[i];
+            Stack.TMax[FirstEntry][i] = TMax[i];
+            FirstMask |= (1u << i);
+        }
+        else if (TSplit < TMin[i])
+        {
+            /* Only the second child is traversed */
+            Stack.TMin[SecondEntry][i] = TMin[i];
+            Stack.TMax[SecondEntry][i] = TMax[i];
+            SecondMask |= (1u << i);
+        }
+        else
+        {
+            /* Both children are traversed */
+            Stack.TMin[FirstEntry][i] = TMin[i];
+            Stack.TMax[FirstEntry][i] = TSplit;
+            FirstMask |= (1u << i);
+            
+            Stack.TMin[SecondEntry][i] = TSplit;
+            Stack.TMax[SecondEntry][i] = TMax[i];
+            SecondMask |= (1u << i);
+        }
+    }
+    
+    Stack.Node[NearEntry]   = ChildNear;
+    Stack.Mask[NearEntry]   = MaskNear;
+    Stack.Node[FarEntry]    = ChildFar;
+    Stack.Mask[FarEntry]    = MaskFar;
+    
+    Stack.Size += 2;
+}
+
+
+/*
+ * LinearKDTree class
+ */
+
+LinearKDTree::LinearKDTree() :
+    Depth_(0)
+{
+}
+LinearKDTree::~LinearKDTree()
+{
+}
+
+bool LinearKDTree::build(const KDTreeNode* RootNode)
+{
+    clear();
+    
+    if (!RootNode)
+        return false;
+    
+    /* Flatten the tree hierarchy in depth-first order */
+    std::map<SCollisionFace*, u32> TriangleMap;
+    
+    Box_ = RootNode->getBox();
+    buildNode(RootNode, 0, TriangleMap);
+    
+    if (Depth_ > LINEARKDTREE_MAX_DEPTH)
+    {
+        io::Log::error("kd-Tree is too deep for linear kd-Tree");
+        clear();
+        return false;
+    }
+    
+    return true;
+}
+
+void LinearKDTree::clear()
+{
+    Nodes_.clear();
+    TriangleIndices_.clear();
+    Triangles_.clear();
+    Blocks_.clear();
+    
+    Box_    = dim::aabbox3df();
+    Depth_  = 0;
+}
+
+void LinearKDTree::findNearestIntersections(
+    const dim::line3df* Lines, u32 Count, SLinearKDTreeIntersection* Intersections,
+    bool FrontFaces, bool BackFaces) const
+{
+    if (Nodes_.empty() || !Lines || !Intersections || !Count)
+        return;
+    
+    Count = math::Min(Count, COLLISION_RAYPACKET_SIZE);
+    
+    SLinearKDTreeRay Rays[COLLISION_RAYPACKET_SIZE];
+    SLinearKDTreeStack Stack;
+    
+    /* Clip the lines against the tree's bounding box */
+    Stack.Node[0]   = 0;
+    Stack.Mask[0]   = 0;
+    Stack.Size      = 1;
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        setupRay(Rays[i], Lines[i]);
+        
+        Stack.TMin[0][i] = 0.0f;
+        Stack.TMax[0][i] = Intersections[i].Distance;
+        
+        if (clipRayToBox(Rays[i], Box_, Stack.TMin[0][i], Stack.TMax[0][i]))
+            Stack.Mask[0] |= (1u << i);
+    }
+    
+    f32 TMin[COLLISION_RAYPACKET_SIZE], TMax[COLLISION_RAYPACKET_SIZE];
+    f32 Distances[4];
+    s32 BackFaceMask = 0;
+    
+    while (Stack.Size > 0)
+    {
+        const u32 Entry = --Stack.Size;
+        const u32 NodeIndex = Stack.Node[Entry];
+        
+        /* Skip the lines which already have a nearer intersection */
+        u32 Mask = Stack.Mask[Entry];
+        
+        for (u32 i = 0; i < Count; ++i)
+        {
+            if (Mask & (1u << i))
+            {
+                if (Intersections[i].Distance < Stack.TMin[Entry][i])
+                    Mask &= ~(1u << i);
+                else
+                {
+                    TMin[i] = Stack.TMin[Entry][i];
+                    TMax[i] = Stack.TMax[Entry][i];
+                }
+            }
+        }
+        
+        if (!Mask)
+            continue;
+        
+        const SNode& Node = Nodes_[NodeIndex];
+        
+        if (!Node.isLeaf())
+        {
+            pushChildNodes(Node, NodeIndex, Rays, Count, Mask, TMin, TMax, Stack);
+            continue;
+        }
+        
+        /* Test all triangle blocks of the leaf node */
+        for (u32 j = Node.TriangleStart / 4, n = j + (Node.getTriangleCount() + 3) / 4; j < n; ++j)
+        {
+            const math::CollisionLibrary::STriangleBlock4& Block = Blocks_[j];
+            
+            for (u32 i = 0; i < Count; ++i)
+            {
+                if (!(Mask & (1u << i)))
+                    continue;
+                
+                const s32 HitMask = math::CollisionLibrary::checkLineTriangleBlockIntersection(
+                    Block, Rays[i].Origin, Rays[i].Direction, Distances, BackFaceMask, FrontFaces, BackFaces
+                );
+                
+                for (u32 k = 0; k < 4; ++k)
+                {
+                    if ( ( HitMask & (1 << k) ) && Distances[k] < Intersections[i].Distance )
+                    {
+                        Intersections[i].Triangle   = TriangleIndices_[j*4 + k];
+                        Intersections[i].Distance   = Distances[k];
+                        Intersections[i].BackFace   = ( ( BackFaceMask & (1 << k) ) != 0 );
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LinearKDTree::checkIntersections(
+    const dim::line3df* Lines, u32 Count, bool* Results,
+    bool FrontFaces, bool BackFaces, bool ExcludeCorners) const
+{
+    if (Nodes_.empty() || !Lines || !Results || !Count)
+        return;
+    
+    Count = math::Min(Count, COLLISION_RAYPACKET_SIZE);
+    
+    SLinearKDTreeRay Rays[COLLISION_RAYPACKET_SIZE];
+    SLinearKDTreeStack Stack;
+    
+    /* Clip the lines against the tree's bounding box and skip the lines which already have an intersection */
+    Stack.Node[0]   = 0;
+    Stack.Mask[0]   = 0;
+    Stack.Size      = 1;
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        if (Results[i])
+            continue;
+        
+        setupRay(Rays[i], Lines[i]);
+        
+        Stack.TMin[0][i] = 0.0f;
+        Stack.TMax[0][i] = 1.0f;
+        
+        if (clipRayToBox(Rays[i], Box_, Stack.TMin[0][i], Stack.TMax[0][i]))
+            Stack.Mask[0] |= (1u << i);
+    }
+    
+    u32 ActiveMask = Stack.Mask[0];
+    
+    f32 TMin[COLLISION_RAYPACKET_SIZE], TMax[COLLISION_RAYPACKET_SIZE];
+    f32 Distances[4];
+    s32 BackFaceMask = 0;
+    
+    while (Stack.Size > 0 && ActiveMask)
+    {
+        const u32 Entry = --Stack.Size;
+        const u32 NodeIndex = Stack.Node[Entry];
+        
+        u32 Mask = (Stack.Mask[Entry] & ActiveMask);
+        
+        if (!Mask)
+            continue;
+        
+        for (u32 i = 0; i < Count; ++i)
+        {
+            if (Mask & (1u << i))
+            {
+                TMin[i] = Stack.TMin[Entry][i];
+                TMax[i] = Stack.TMax[Entry][i];
+            }
+        }
+        
+        const SNode& Node = Nodes_[NodeIndex];
+        
+        if (!Node.isLeaf())
+        {
+            pushChildNodes(Node, NodeIndex, Rays, Count, Mask, TMin, TMax, Stack);
+            continue;
+        }
+        
+        /* Test all triangle blocks of the leaf node until each line has an intersection */
+        for (u32 j = Node.TriangleStart / 4, n = j + (Node.getTriangleCount() + 3) / 4; j < n && Mask; ++j)
+        {
+            const math::CollisionLibrary::STriangleBlock4& Block = Blocks_[j];
+            
+            for (u32 i = 0; i < Count; ++i)
+            {
+                if (!(Mask & (1u << i)))
+                    continue;
+                
+                s32 HitMask = math::CollisionLibrary::checkLineTriangleBlockIntersection(
+                    Block, Rays[i].Origin, Rays[i].Direction, Distances, BackFaceMask, FrontFaces, BackFaces
+                );
+                
+                if (ExcludeCorners)
+                {
+                    for (u32 k = 0; k < 4; ++k)
+                    {
+                        if (!(HitMask & (1 << k)))
+                            continue;
+                        
+                        const dim::vector3df Point(Rays[i].Origin + Rays[i].Direction * Distances[k]);
+                        
+                        if ( math::getDistanceSq(Lines[i].Start, Point) <= math::ROUNDING_ERROR ||
+                             math::getDistanceSq(Lines[i].End, Point) <= math::ROUNDING_ERROR )
+                        {
+                            HitMask &= ~(1 << k);
+                        }
+                    }
+                }
+                
+                if (HitMask)
+                {
+                    Results[i]  = true;
+                    Mask        &= ~(1u << i);
+                    ActiveMask  &= ~(1u << i);
+                }
+            }
+        }
+    }
+}
+
+u32 LinearKDTree::findIntersections(
+    const dim::line3df &Line, SLinearKDTreeIntersection* Intersections, u32 MaxCount,
+    bool FrontFaces, bool BackFaces, const SLinearKDTreeIntersection* Previous) const
+{
+    if (Nodes_.empty() || !Intersections || !MaxCount)
+        return 0;
+    
+    SLinearKDTreeRay Ray;
+    SLinearKDTreeStack Stack;
+    
+    /* Clip the line against the tree's bounding box (and the previous search) */
+    setupRay(Ray, Line);
+    
+    Stack.Node[0]       = 0;
+    Stack.Mask[0]       = 1;
+    Stack.TMin[0][0]    = (Previous ? Previous->Distance : 0.0f);
+    Stack.TMax[0][0]    = 1.0f;
+    Stack.Size          = 1;
+    
+    if (!clipRayToBox(Ray, Box_, Stack.TMin[0][0], Stack.TMax[0][0]))
+        return 0;
+    
+    u32 Count = 0;
+    f32 TMin = 0.0f, TMax = 0.0f;
+    f32 Distances[4];
+    s32 BackFaceMask = 0;
+    
+    SLinearKDTreeIntersection Intersection;
+    
+    while (Stack.Size > 0)
+    {
+        const u32 Entry = --Stack.Size;
+        const u32 NodeIndex = Stack.Node[Entry];
+        
+        TMin = Stack.TMin[Entry][0];
+        TMax = Stack.TMax[Entry][0];
+        
+        /* Skip the nodes behind the farthest intersection when the array is full */
+        if (Count == MaxCount && Intersections[Count - 1].Distance < TMin)
+            continue;
+        
+        const SNode& Node = Nodes_[NodeIndex];
+        
+        if (!Node.isLeaf())
+        {
+            pushChildNodes(Node, NodeIndex, &Ray, 1, 1, &TMin, &TMax, Stack);
+            continue;
+        }
+        
+        /* Test all triangle blocks of the leaf node */
+        for (u32 j = Node.TriangleStart / 4, n = j + (Node.getTriangleCount() + 3) / 4; j < n; ++j)
+        {
+            const s32 HitMask = math::CollisionLibrary::checkLineTriangleBlockIntersection(
+                Blocks_[j], Ray.Origin, Ray.Direction, Distances, BackFaceMask, FrontFaces, BackFaces
+            );
+            
+            for (u32 k = 0; k < 4; ++k)
+            {
+                if (!(HitMask & (1 << k)))
+                    continue;
+                
+                Intersection.Triangle = TriangleIndices_[j*4 + k];
+                Intersection.Distance = Distances[k];
+                Intersection.BackFace = ( ( BackFaceMask & (1 << k) ) != 0 );
+                
+                if (!Previous || cmpLinearKDTreeIntersections(*Previous, Intersection))
+                    insertLinearKDTreeIntersection(Intersections, Count, MaxCount, Intersection);
+            }
+        }
+    }
+    
+    return Count;
+}
+
+void LinearKDTree::findTriangles(const dim::vector3df &Point, f32 Radius, std::vector<u32> &TriangleList) const
+{
+    TriangleList.clear();
+    
+    if (Nodes_.empty())
+        return;
+    
+    /* Traverse the tree with the node boxes which are computed on the fly */
+    u32 NodeStack[LINEARKDTREE_MAX_DEPTH + 2];
+    dim::aabbox3df BoxStack[LINEARKDTREE_MAX_DEPTH + 2];
+    u32 StackSize = 1;
+    
+    NodeStack[0]    = 0;
+    BoxStack[0]     = Box_;
+    
+    const f32 RadiusSq = math::pow2(Radius);
+    
+    while (StackSize > 0)
+    {
+        --StackSize;
+        
+        const u32 NodeIndex = NodeStack[StackSize];
+        const dim::aabbox3df Box(BoxStack[StackSize]);
+        
+        /* Compute the squared distance between the sphere's center and the box */
+        f32 DistanceSq = 0.0f;
+        
+        for (s32 i = 0; i < 3; ++i)
+        {
+            if (Point[i] < Box.Min[i])
+                DistanceSq += math::pow2(Box.Min[i] - Point[i]);
+            else if (Point[i] > Box.Max[i])
+                DistanceSq += math::pow2(Point[i] - Box.Max[i]);
+        }
+        
+        if (DistanceSq > RadiusSq)
+            continue;
+        
+        const SNode& Node = Nodes_[NodeIndex];
+        
+        if (Node.isLeaf())
+        {
+            TriangleList.insert(
+                TriangleList.end(),
+                TriangleIndices_.begin() + Node.TriangleStart,
+                TriangleIndices_.begin() + Node.TriangleStart + Node.getTriangleCount()
+            );
+        }
+        else
+        {
+            const EKDTreeAxles Axis = Node.getAxis();
+            
+            NodeStack[StackSize]            = Node.getChildFar();
+            BoxStack[StackSize]             = Box;
+            BoxStack[StackSize].Min[Axis]   = Node.Distance;
+            ++StackSize;
+            
+            NodeStack[StackSize]            = NodeIndex + 1;
+            BoxStack[StackSize]             = Box;
+            BoxStack[StackSize].Max[Axis]   = Node.Distance;
+            ++StackSize;
+        }
+    }
+    
+    /* Remove the triangles which are referenced by several leaf nodes */
+    std::sort(TriangleList.begin(), TriangleList.end());
+    TriangleList.erase(std::unique(TriangleList.begin(), TriangleList.end()), TriangleList.end());
+}
+
+bool LinearKDTree::checkSphereIntersection(
+    const dim::vector3df &Point, f32 Radius, const video::EFaceTypes CollFace) const
+{
+    if (Nodes_.empty())
+        return false;
+    
+    /* Traverse the tree with the node boxes which are computed on the fly */
+    u32 NodeStack[LINEARKDTREE_MAX_DEPTH + 2];
+    dim::aabbox3df BoxStack[LINEARKDTREE_MAX_DEPTH + 2];
+    u32 StackSize = 1;
+    
+    NodeStack[0]    = 0;
+    BoxStack[0]     = Box_;
+    
+    const f32 RadiusSq = math::pow2(Radius);
+    
+    dim::vector3df ClosestPoints[4];
+    f32 DistancesSq[4];
+    
+    while (StackSize > 0)
+    {
+        --StackSize;
+        
+        const u32 NodeIndex = NodeStack[StackSize];
+        const dim::aabbox3df Box(BoxStack[StackSize]);
+        
+        /* Compute the squared distance between the sphere's center and the box */
+        f32 DistanceSq = 0.0f;
+        
+        for (s32 i = 0; i < 3; ++i)
+        {
+            if (Point[i] < Box.Min[i])
+                DistanceSq += math::pow2(Box.Min[i] - Point[i]);
+            else if (Point[i] > Box.Max[i])
+                DistanceSq += math::pow2(Point[i] - Box.Max[i]);
+        }
+        
+        if (DistanceSq > RadiusSq)
+            continue;
+        
+        const SNode& Node = Nodes_[NodeIndex];
+        
+        if (Node.isLeaf())
+        {
+            /* Test all triangle blocks of the leaf node */
+            for (u32 j = Node.TriangleStart / 4, n = j + (Node.getTriangleCount() + 3) / 4; j < n; ++j)
+            {
+                const s32 ValidMask = math::CollisionLibrary::getClosestPointsOnTriangleBlock(
+                    Blocks_[j], Point, ClosestPoints, DistancesSq
+                );
+                
+                for (u32 k = 0; k < 4; ++k)
+                {
+                    /* Face culling is only checked for the triangles inside the sphere */
+                    if ( ( ValidMask & (1 << k) ) && DistancesSq[k] < RadiusSq &&
+                         !getFace(TriangleIndices_[j*4 + k])->isBackFaceCulling(CollFace, Point) )
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        else
+        {
+            const EKDTreeAxles Axis = Node.getAxis();
+            
+            NodeStack[StackSize]            = Node.getChildFar();
+            BoxStack[StackSize]             = Box;
+            BoxStack[StackSize].Min[Axis]   = Node.Distance;
+            ++StackSize;
+            
+            NodeStack[StackSize]            = NodeIndex + 1;
+            BoxStack[StackSize]             = Box;
+            BoxStack[StackSize].Max[Axis]   = Node.Distance;
+            ++StackSize;
+        }
+    }
+    
+    return false;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void LinearKDTree::buildNode(const KDTreeNode* Node, u32 Depth, std::map<SCollisionFace*, u32> &TriangleMap)
+{
+    Depth_ = math::Max(Depth_, Depth);
+    
+    const u32 NodeIndex = Nodes_.size();
+    Nodes_.push_back(SNode());
+    
+    const KDTreeNode* ChildNear = static_cast<const KDTreeNode*>(Node->getChildNear());
+    const KDTreeNode* ChildFar = static_cast<const KDTreeNode*>(Node->getChildFar());
+    
+    if (ChildNear && ChildFar)
+    {
+        /* Store inner node and build the near child directly after it */
+        Nodes_[NodeIndex].Distance = Node->getDistance();
+        
+        buildNode(ChildNear, Depth + 1, TriangleMap);
+        
+        Nodes_[NodeIndex].Flags = (static_cast<u32>(Nodes_.size()) << 2) | static_cast<u32>(Node->getAxis());
+        
+        buildNode(ChildFar, Depth + 1, TriangleMap);
+        return;
+    }
+    
+    /* Store leaf node with its triangle index range */
+    Nodes_[NodeIndex].TriangleStart = TriangleIndices_.size();
+    Nodes_[NodeIndex].Flags         = 0x03;
+    
+    const CollisionMesh::TreeNodeDataType* TreeNodeData = static_cast<const CollisionMesh::TreeNodeDataType*>(Node->getUserData());
+    
+    if (!TreeNodeData)
+        return;
+    
+    #ifndef _DEB_NEW_KDTREE_
+    foreach (SCollisionFace* Face, *TreeNodeData)
+    #else
+    foreach (const SCollisionFace &NodeFace, *TreeNodeData)
+    #endif
+    {
+        #ifdef _DEB_NEW_KDTREE_
+        SCollisionFace* Face = const_cast<SCollisionFace*>(&NodeFace);
+        #endif
+        
+        /* Find unique triangle index or create a new triangle */
+        std::map<SCollisionFace*, u32>::iterator it = TriangleMap.find(Face);
+        
+        u32 TriangleIndex = 0;
+        
+        if (it == TriangleMap.end())
+        {
+            STriangle Triangle;
+            {
+                Triangle.PointA = Face->Triangle.PointA;
+                Triangle.EdgeB  = Face->Triangle.PointB - Face->Triangle.PointA;
+                Triangle.EdgeC  = Face->Triangle.PointC - Face->Triangle.PointA;
+                Triangle.Face   = Face;
+            }
+            TriangleIndex = Triangles_.size();
+            Triangles_.push_back(Triangle);
+            TriangleMap[Face] = TriangleIndex;
+        }
+        else
+            TriangleIndex = it->second;
+        
+        TriangleIndices_.push_back(TriangleIndex);
+    }
+    
+    const u32 NumTriangles = TreeNodeData->size();
+    Nodes_[NodeIndex].Flags = (NumTriangles << 2) | 0x03;
+    
+    /* Store the triangles in blocks of 4 for the batched tests */
+    const u32 TriangleStart = Nodes_[NodeIndex].TriangleStart;
+    
+    for (u32 i = 0; i < NumTriangles; i += 4)
+    {
+        math::CollisionLibrary::STriangleBlock4 Block;
+        
+        Block.Count = math::Min(NumTriangles - i, 4u);
+        
+        for (u32 j = 0; j < Block.Count; ++j)
+            Block.setTriangle(j, getFace(TriangleIndices_[TriangleStart + i + j])->Triangle);
+        
+        Blocks_.push_back(Block);
+    }
+    
+    /* Align the next leaf node's triangle index range (the unused entries are never tested) */
+    while (TriangleIndices_.size() % 4)
+        TriangleIndices_.push_back(TriangleIndices_.back());
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
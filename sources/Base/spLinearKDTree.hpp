@@ -0,0 +1,294 @@
+/*
+ * Linear kd-Tree header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_LINEAR_KDTREE_H__
+#define __SP_LINEAR_KDTREE_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimensionAABB.hpp"
+#include "Base/spDimensionLine3D.hpp"
+#include "Base/spTreeNodeKD.hpp"
+#include "Base/spMathCollisionLibrary.hpp"
+#include "Base/spMaterialConfigTypes.hpp"
+
+#include <vector>
+#include <map>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/*
+ * Pre-declerations
+ */
+
+struct SCollisionFace;
+
+
+//! Invalid index for linear kd-Tree nodes and triangles.
+static const u32 LINEARKDTREE_INVALID_INDEX = ~0u;
+
+//! Maximal tree depth for linear kd-Trees (limited by the fixed size traversal stack).
+static const u32 LINEARKDTREE_MAX_DEPTH = 255;
+
+
+//! Linear kd-Tree intersection result.
+struct SLinearKDTreeIntersection
+{
+    SLinearKDTreeIntersection() :
+        Triangle(LINEARKDTREE_INVALID_INDEX ),
+        Distance(1.0f                       ),
+        BackFace(false                      )
+    {
+    }
+    ~SLinearKDTreeIntersection()
+    {
+    }
+    
+    /* Members */
+    u32 Triangle;   //!< Triangle index or LINEARKDTREE_INVALID_INDEX if no intersection has been detected.
+    f32 Distance;   //!< Interpolation factor on the line [0.0 .. 1.0]. Only intersections which are nearer will be searched.
+    bool BackFace;  //!< True if the intersected triangle is back facing.
+};
+
+
+/**
+Linear (or rather flattened) kd-Tree with a cache friendly memory layout.
+All nodes are stored in one contiguous array in depth-first order, i.e. the near child of an inner node
+always directly follows its parent. Each node has a size of only 8 bytes. The triangle indices of all leaf nodes
+are stored in one contiguous array and the triangles themselves are stored with precomputed intersection data.
+Additionally the triangles of each leaf node are stored in blocks of 4 triangles (structure-of-arrays layout)
+for the batched tests of the collision library, i.e. the triangle index range of each leaf node is aligned to 4.
+This tree is built out of a kd-Tree hierarchy which has been built with "TreeBuilder::buildKdTree".
+\see TreeBuilder::buildKdTree
+\see CollisionMesh
+\since Version 3.3
+*/
+class SP_EXPORT LinearKDTree
+{
+
+    public:
+        
+        /* === Structures === */
+        
+        //! Linear kd-Tree node (8 bytes).
+        struct SNode
+        {
+            SNode() :
+                Distance(0.0f   ),
+                Flags   (0      )
+            {
+            }
+            
+            /* Functions */
+            inline bool isLeaf() const
+            {
+                return (Flags & 0x03) == 0x03;
+            }
+            //! Returns the splitting axis. Only valid for inner nodes.
+            inline EKDTreeAxles getAxis() const
+            {
+                return static_cast<EKDTreeAxles>(Flags & 0x03);
+            }
+            //! Returns the far child index. Only valid for inner nodes. The near child index is the own index plus one.
+            inline u32 getChildFar() const
+            {
+                return Flags >> 2;
+            }
+            //! Returns the count of triangles. Only valid for leaf nodes.
+            inline u32 getTriangleCount() const
+            {
+                return Flags >> 2;
+            }
+            
+            /* Members */
+            union
+            {
+                f32 Distance;       //!< Splitting distance (inner nodes).
+                u32 TriangleStart;  //!< Start index in the triangle index list (leaf nodes).
+            };
+            u32 Flags;              //!< Bits [0..1] hold the axis (3 for leaf nodes), bits [2..31] hold the far child index or the triangle count.
+        };
+        
+        //! Linear kd-Tree triangle with precomputed intersection data.
+        struct STriangle
+        {
+            STriangle() :
+                Face(0)
+            {
+            }
+            
+            /* Members */
+            dim::vector3df PointA;
+            dim::vector3df EdgeB;   //!< PointB - PointA.
+            dim::vector3df EdgeC;   //!< PointC - PointA.
+            SCollisionFace* Face;   //!< Collision face from the source kd-Tree.
+        };
+        
+        LinearKDTree();
+        ~LinearKDTree();
+        
+        /* === Functions === */
+        
+        /**
+        Builds the linear kd-Tree out of the specified kd-Tree hierarchy.
+        \param[in] RootNode Constant pointer to the root node. The leaf nodes must hold
+        the "CollisionMesh::TreeNodeDataType" user data which is created by "TreeBuilder::buildKdTree".
+        \return True on success. Otherwise the tree is empty, i.e. when the root node is null or the
+        tree depth is greater than LINEARKDTREE_MAX_DEPTH.
+        */
+        bool build(const KDTreeNode* RootNode);
+        
+        //! Removes all nodes and triangles.
+        void clear();
+        
+        /**
+        Finds the nearest intersections for a packet of lines.
+        \param[in] Lines Pointer to the first line of the packet. The lines must be in the same space as the tree.
+        \param[in] Count Specifies the count of lines. This is clamped to COLLISION_RAYPACKET_SIZE.
+        \param[in,out] Intersections Pointer to the first intersection result. Only intersections
+        which are nearer than the initial "Distance" member will be searched.
+        \param[in] FrontFaces Specifies whether front facing triangles are to be tested.
+        \param[in] BackFaces Specifies whether back facing triangles are to be tested.
+        */
+        void findNearestIntersections(
+            const dim::line3df* Lines, u32 Count, SLinearKDTreeIntersection* Intersections,
+            bool FrontFaces = true, bool BackFaces = false
+        ) const;
+        
+        /**
+        Checks a packet of lines for any intersection.
+        \param[in,out] Results Pointer to the first result. Lines whose result is already true will be skipped.
+        \param[in] ExcludeCorners Specifies whether intersections with the line's corners are to be ignored.
+        \see findNearestIntersections
+        */
+        void checkIntersections(
+            const dim::line3df* Lines, u32 Count, bool* Results,
+            bool FrontFaces = true, bool BackFaces = false, bool ExcludeCorners = false
+        ) const;
+        
+        /**
+        Finds the nearest intersections of a single line without any memory allocation.
+        \param[in] Line Specifies the line. The line must be in the same space as the tree.
+        \param[out] Intersections Pointer to the array where the intersections are to be stored.
+        The intersections are sorted by their distance (and triangle index for equal distances).
+        \param[in] MaxCount Specifies the count of elements in the array. Only the nearest intersections will be stored.
+        \param[in] FrontFaces Specifies whether front facing triangles are to be tested.
+        \param[in] BackFaces Specifies whether back facing triangles are to be tested.
+        \param[in] Previous Optional pointer to the last intersection of a previous search. If this is not null
+        only the intersections behind this one will be searched. Use this to continue a search whose result array was full.
+        \return Count of intersections which have been stored.
+        \since Version 3.3
+        */
+        u32 findIntersections(
+            const dim::line3df &Line, SLinearKDTreeIntersection* Intersections, u32 MaxCount,
+            bool FrontFaces = true, bool BackFaces = false, const SLinearKDTreeIntersection* Previous = 0
+        ) const;
+        
+        /**
+        Finds all triangles whose leaf nodes overlap the specified sphere.
+        \param[in] Point Specifies the sphere's center point.
+        \param[in] Radius Specifies the sphere's radius.
+        \param[out] TriangleList Specifies the list where the unique triangle indices are to be stored.
+        The list will be cleared before.
+        */
+        void findTriangles(const dim::vector3df &Point, f32 Radius, std::vector<u32> &TriangleList) const;
+        
+        /**
+        Checks if the specified sphere intersects any triangle.
+        \param[in] Point Specifies the sphere's center point. The point must be in the same space as the tree.
+        \param[in] Radius Specifies the sphere's radius.
+        \param[in] CollFace Specifies which triangle faces are to be tested. Triangles which are
+        culled for the sphere's center point (see SCollisionFace::isBackFaceCulling) are ignored.
+        \return True if the distance between the sphere's center and any triangle is less than the radius.
+        \since Version 3.3
+        */
+        bool checkSphereIntersection(
+            const dim::vector3df &Point, f32 Radius, const video::EFaceTypes CollFace = video::FACE_BOTH
+        ) const;
+        
+        /* === Inline functions === */
+        
+        inline const std::vector<SNode>& getNodeList() const
+        {
+            return Nodes_;
+        }
+        inline const std::vector<u32>& getTriangleIndexList() const
+        {
+            return TriangleIndices_;
+        }
+        inline const std::vector<STriangle>& getTriangleList() const
+        {
+            return Triangles_;
+        }
+        
+        /**
+        Returns the triangle block list. Block i holds the triangles of the indices [4*i .. 4*i + 3]
+        in the triangle index list, i.e. the first block of a leaf node is "TriangleStart / 4".
+        \since Version 3.3
+        */
+        inline const std::vector<math::CollisionLibrary::STriangleBlock4>& getBlockList() const
+        {
+            return Blocks_;
+        }
+        
+        //! Returns the collision face of the specified triangle.
+        inline SCollisionFace* getFace(u32 Index) const
+        {
+            return Triangles_[Index].Face;
+        }
+        
+        //! Returns the bounding box of the whole tree.
+        inline const dim::aabbox3df& getBox() const
+        {
+            return Box_;
+        }
+        
+        //! Returns the tree depth. A tree with only one leaf node has depth 0.
+        inline u32 getDepth() const
+        {
+            return Depth_;
+        }
+        
+        inline bool empty() const
+        {
+            return Nodes_.empty();
+        }
+        
+    private:
+        
+        /* === Functions === */
+        
+        void buildNode(const KDTreeNode* Node, u32 Depth, std::map<SCollisionFace*, u32> &TriangleMap);
+        
+        /* === Members === */
+        
+        std::vector<SNode> Nodes_;
+        std::vector<u32> TriangleIndices_;
+        std::vector<STriangle> Triangles_;
+        std::vector<math::CollisionLibrary::STriangleBlock4> Blocks_;
+        
+        dim::aabbox3df Box_;
+        u32 Depth_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
@@ -8,6 +8,7 @@
 #include "Base/spMathCollisionLibrary.hpp"
 #include "Base/spViewFrustum.hpp"
 #include "Base/spInputOutputLog.hpp"
+#include "Base/spMathSIMD.hpp"
 
 
 namespace sp
@@ -49,6 +50,284 @@ static bool checkRayAABBOverlap1D(f32 start, f32 dir, f32 min, f32 max, f32 &ent
 }
 
 
+/*
+Swept test helpers: "Time" holds the nearest time of impact found so far and
+is only overwritten (together with "Normal") if a nearer contact has been found.
+*/
+
+static bool checkInitialSweepContact(
+    const dim::vector3df &Separation, const dim::vector3df &Direction, f32 &Time, dim::vector3df &Normal)
+{
+    /* Only report the contact if the object moves towards the rival */
+    if (Separation.dot(Direction) >= 0.0f)
+        return false;
+    
+    const f32 Length = Separation.getLength();
+    
+    if (Length > ROUNDING_ERROR)
+        Normal = Separation / Length;
+    else
+        Normal = (-Direction).normalize();
+    
+    Time = 0.0f;
+    
+    return true;
+}
+
+static bool checkMovingPointSphere(
+    const dim::vector3df &Point, const dim::vector3df &Direction,
+    const dim::vector3df &Center, f32 Radius, f32 &Time, dim::vector3df &Normal)
+{
+    const dim::vector3df m(Point - Center);
+    
+    const f32 b = m.dot(Direction);
+    
+    /* Exit if the point moves away from the sphere */
+    if (b >= 0.0f)
+        return false;
+    
+    const f32 a = Direction.dot(Direction);
+    const f32 c = m.dot(m) - Radius*Radius;
+    
+    const f32 Discr = b*b - a*c;
+    
+    if (Discr < 0.0f)
+        return false;
+    
+    const f32 t = (-b - sqrt(Discr)) / a;
+    
+    if (t < 0.0f || t > Time)
+        return false;
+    
+    Time    = t;
+    Normal  = (m + Direction * t) / Radius;
+    
+    return true;
+}
+
+static bool checkMovingPointCapsule(
+    const dim::vector3df &Point, const dim::vector3df &Direction,
+    const dim::line3df &Line, f32 Radius, f32 &Time, dim::vector3df &Normal)
+{
+    bool Result = false;
+    
+    /* Check intersection with the capsule's cylinder */
+    const dim::vector3df d(Line.getDirection());
+    const dim::vector3df m(Point - Line.Start);
+    
+    const f32 dd = d.dot(d);
+    const f32 md = m.dot(d);
+    const f32 nd = Direction.dot(d);
+    const f32 a = dd * Direction.dot(Direction) - nd*nd;
+    
+    if (dd > ROUNDING_ERROR && a > ROUNDING_ERROR)
+    {
+        const f32 b = dd * m.dot(Direction) - nd*md;
+        const f32 c = dd * (m.dot(m) - Radius*Radius) - md*md;
+        
+        const f32 Discr = b*b - a*c;
+        
+        if (b < 0.0f && Discr >= 0.0f)
+        {
+            const f32 t = (-b - sqrt(Discr)) / a;
+            const f32 s = md + t*nd;
+            
+            if (t >= 0.0f && t <= Time && s > 0.0f && s < dd)
+            {
+                Time    = t;
+                Normal  = ((m + Direction * t) - d * (s / dd)).normalize();
+                Result  = true;
+            }
+        }
+    }
+    
+    /* Check intersection with the capsule's hemispheres */
+    if (checkMovingPointSphere(Point, Direction, Line.Start, Radius, Time, Normal))
+        Result = true;
+    if (checkMovingPointSphere(Point, Direction, Line.End, Radius, Time, Normal))
+        Result = true;
+    
+    return Result;
+}
+
+//! Only checks the contact between the inner parts of both lines. The end points must be checked separately.
+static bool checkMovingLineLine(
+    const dim::line3df &Line, const dim::vector3df &Direction,
+    const dim::line3df &Rival, f32 Radius, f32 &Time, dim::vector3df &Normal)
+{
+    const dim::vector3df u(Line.getDirection());
+    const dim::vector3df v(Rival.getDirection());
+    
+    dim::vector3df n(u.cross(v));
+    
+    /* Parallel lines are covered by the end points */
+    const f32 LenSq = n.getLengthSq();
+    
+    if (LenSq <= ROUNDING_ERROR * u.getLengthSq() * v.getLengthSq())
+        return false;
+    
+    n *= (1.0f / sqrt(LenSq));
+    
+    /* Compute the time where the distance between both (infinite) lines equals the radius */
+    f32 h = n.dot(Line.Start - Rival.Start);
+    
+    if (h < 0.0f)
+    {
+        n = -n;
+        h = -h;
+    }
+    
+    const f32 hd = n.dot(Direction);
+    
+    if (hd >= 0.0f)
+        return false;
+    
+    const f32 t = (h - Radius) / (-hd);
+    
+    if (t < 0.0f || t > Time)
+        return false;
+    
+    /* Check if the closest points lie inside both lines */
+    const dim::vector3df r(Line.Start + Direction * t - Rival.Start);
+    
+    const f32 a = u.dot(u);
+    const f32 b = u.dot(v);
+    const f32 c = u.dot(r);
+    const f32 e = v.dot(v);
+    const f32 f = v.dot(r);
+    
+    const f32 Denom = a*e - b*b;
+    
+    const f32 s = (b*f - c*e) / Denom;
+    const f32 w = (a*f - b*c) / Denom;
+    
+    if (s <= 0.0f || s >= 1.0f || w <= 0.0f || w >= 1.0f)
+        return false;
+    
+    Time    = t;
+    Normal  = n;
+    
+    return true;
+}
+
+//! The sphere must not overlap the triangle at the start.
+static bool checkMovingSphereTriangle(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::triangle3df &Triangle, f32 &Time, dim::vector3df &Normal)
+{
+    /* Check contact with the triangle's face */
+    dim::vector3df n(Triangle.getNormalSq());
+    const f32 LenSq = n.getLengthSq();
+    
+    if (LenSq > ROUNDING_ERROR64)
+    {
+        n *= (1.0f / sqrt(LenSq));
+        
+        f32 h = n.dot(SpherePosition - Triangle.PointA);
+        
+        if (h < 0.0f)
+        {
+            n = -n;
+            h = -h;
+        }
+        
+        const f32 hd = n.dot(Direction);
+        
+        if (hd < 0.0f)
+        {
+            const f32 t = (h - SphereRadius) / (-hd);
+            
+            if (t >= 0.0f && t <= Time && Triangle.isPointInside(SpherePosition + Direction * t - n * SphereRadius))
+            {
+                /* A contact with the face is always the first one */
+                Time    = t;
+                Normal  = n;
+                return true;
+            }
+        }
+    }
+    
+    /* Check contact with the triangle's edges and corners */
+    bool Result = false;
+    
+    if (checkMovingPointCapsule(SpherePosition, Direction, dim::line3df(Triangle.PointA, Triangle.PointB), SphereRadius, Time, Normal))
+        Result = true;
+    if (checkMovingPointCapsule(SpherePosition, Direction, dim::line3df(Triangle.PointB, Triangle.PointC), SphereRadius, Time, Normal))
+        Result = true;
+    if (checkMovingPointCapsule(SpherePosition, Direction, dim::line3df(Triangle.PointC, Triangle.PointA), SphereRadius, Time, Normal))
+        Result = true;
+    
+    return Result;
+}
+
+//! The capsule must not overlap the triangle at the start.
+static bool checkMovingCapsuleTriangle(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::triangle3df &Triangle, f32 &Time, dim::vector3df &Normal)
+{
+    bool Result = false;
+    
+    /* Check contact between the capsule's hemispheres and the triangle */
+    if (checkMovingSphereTriangle(CapsuleLine.Start, CapsuleRadius, Direction, Triangle, Time, Normal))
+        Result = true;
+    if (checkMovingSphereTriangle(CapsuleLine.End, CapsuleRadius, Direction, Triangle, Time, Normal))
+        Result = true;
+    
+    /* Check contact between the triangle's corners and the capsule (in the opposite direction) */
+    const dim::vector3df* Corners[3] = { &Triangle.PointA, &Triangle.PointB, &Triangle.PointC };
+    dim::vector3df CornerNormal;
+    
+    for (u32 i = 0; i < 3; ++i)
+    {
+        if (checkMovingPointCapsule(*Corners[i], -Direction, CapsuleLine, CapsuleRadius, Time, CornerNormal))
+        {
+            Normal = -CornerNormal;
+            Result = true;
+        }
+    }
+    
+    /* Check contact between the capsule's line and the triangle's edges */
+    for (u32 i = 0; i < 3; ++i)
+    {
+        if (checkMovingLineLine(CapsuleLine, Direction, dim::line3df(*Corners[i], *Corners[(i + 1) % 3]), CapsuleRadius, Time, Normal))
+            Result = true;
+    }
+    
+    return Result;
+}
+
+static void getBoxTriangles(const dim::aabbox3df &Box, dim::triangle3df (&Triangles)[12])
+{
+    const dim::vector3df& a = Box.Min;
+    const dim::vector3df& b = Box.Max;
+    
+    const dim::vector3df Corners[8] =
+    {
+        dim::vector3df(a.X, a.Y, a.Z), dim::vector3df(b.X, a.Y, a.Z),
+        dim::vector3df(a.X, b.Y, a.Z), dim::vector3df(b.X, b.Y, a.Z),
+        dim::vector3df(a.X, a.Y, b.Z), dim::vector3df(b.X, a.Y, b.Z),
+        dim::vector3df(a.X, b.Y, b.Z), dim::vector3df(b.X, b.Y, b.Z)
+    };
+    
+    static const u32 Indices[12][3] =
+    {
+        { 0, 2, 3 }, { 0, 3, 1 }, // -Z
+        { 4, 5, 7 }, { 4, 7, 6 }, // +Z
+        { 0, 4, 6 }, { 0, 6, 2 }, // -X
+        { 1, 3, 7 }, { 1, 7, 5 }, // +X
+        { 0, 1, 5 }, { 0, 5, 4 }, // -Y
+        { 2, 6, 7 }, { 2, 7, 3 }  // +Y
+    };
+    
+    for (u32 i = 0; i < 12; ++i)
+    {
+        Triangles[i] = dim::triangle3df(
+            Corners[Indices[i][0]], Corners[Indices[i][1]], Corners[Indices[i][2]]
+        );
+    }
+}
+
+
 /* === Closest point on triangle === */
 
 SP_EXPORT dim::vector3df getClosestPoint(
@@ -799,6 +1078,155 @@ SP_EXPORT bool checkTriangleTriangleIntersection(
 }
 
 
+/* === Swept sphere and capsule tests === */
+
+SP_EXPORT bool checkSweptSphereSphereIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::vector3df &RivalPosition, f32 RivalRadius, f32 &Time, dim::vector3df &Normal)
+{
+    const f32 Radius = SphereRadius + RivalRadius;
+    const dim::vector3df Separation(SpherePosition - RivalPosition);
+    
+    if (Separation.getLengthSq() <= Radius*Radius)
+        return checkInitialSweepContact(Separation, Direction, Time, Normal);
+    
+    Time = 1.0f;
+    return checkMovingPointSphere(SpherePosition, Direction, RivalPosition, Radius, Time, Normal);
+}
+
+SP_EXPORT bool checkSweptSphereCapsuleIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::line3df &RivalLine, f32 RivalRadius, f32 &Time, dim::vector3df &Normal)
+{
+    const f32 Radius = SphereRadius + RivalRadius;
+    const dim::vector3df Separation(SpherePosition - RivalLine.getClosestPoint(SpherePosition));
+    
+    if (Separation.getLengthSq() <= Radius*Radius)
+        return checkInitialSweepContact(Separation, Direction, Time, Normal);
+    
+    Time = 1.0f;
+    return checkMovingPointCapsule(SpherePosition, Direction, RivalLine, Radius, Time, Normal);
+}
+
+SP_EXPORT bool checkSweptSphereTriangleIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::triangle3df &Triangle, f32 &Time, dim::vector3df &Normal)
+{
+    const dim::vector3df Separation(SpherePosition - getClosestPoint(Triangle, SpherePosition));
+    
+    if (Separation.getLengthSq() <= SphereRadius*SphereRadius)
+        return checkInitialSweepContact(Separation, Direction, Time, Normal);
+    
+    Time = 1.0f;
+    return checkMovingSphereTriangle(SpherePosition, SphereRadius, Direction, Triangle, Time, Normal);
+}
+
+SP_EXPORT bool checkSweptSphereBoxIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::aabbox3df &Box, f32 &Time, dim::vector3df &Normal)
+{
+    const dim::vector3df Separation(SpherePosition - getClosestPoint(Box, SpherePosition));
+    
+    if (Separation.getLengthSq() <= SphereRadius*SphereRadius)
+        return checkInitialSweepContact(Separation, Direction, Time, Normal);
+    
+    /* Check contact with each box side */
+    dim::triangle3df Triangles[12];
+    getBoxTriangles(Box, Triangles);
+    
+    Time = 1.0f;
+    bool Result = false;
+    
+    for (u32 i = 0; i < 12; ++i)
+    {
+        if (checkMovingSphereTriangle(SpherePosition, SphereRadius, Direction, Triangles[i], Time, Normal))
+            Result = true;
+    }
+    
+    return Result;
+}
+
+SP_EXPORT bool checkSweptCapsuleCapsuleIntersection(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::line3df &RivalLine, f32 RivalRadius, f32 &Time, dim::vector3df &Normal)
+{
+    const f32 Radius = CapsuleRadius + RivalRadius;
+    
+    dim::vector3df PointP, PointQ;
+    
+    if (getLineLineDistanceSq(CapsuleLine, RivalLine, PointP, PointQ) <= Radius*Radius)
+        return checkInitialSweepContact(PointP - PointQ, Direction, Time, Normal);
+    
+    Time = 1.0f;
+    bool Result = false;
+    
+    /* Check contact between the end points and the opposite capsule */
+    if (checkMovingPointCapsule(CapsuleLine.Start, Direction, RivalLine, Radius, Time, Normal))
+        Result = true;
+    if (checkMovingPointCapsule(CapsuleLine.End, Direction, RivalLine, Radius, Time, Normal))
+        Result = true;
+    
+    dim::vector3df RivalNormal;
+    
+    if (checkMovingPointCapsule(RivalLine.Start, -Direction, CapsuleLine, Radius, Time, RivalNormal))
+    {
+        Normal = -RivalNormal;
+        Result = true;
+    }
+    if (checkMovingPointCapsule(RivalLine.End, -Direction, CapsuleLine, Radius, Time, RivalNormal))
+    {
+        Normal = -RivalNormal;
+        Result = true;
+    }
+    
+    /* Check contact between the inner parts of both lines */
+    if (checkMovingLineLine(CapsuleLine, Direction, RivalLine, Radius, Time, Normal))
+        Result = true;
+    
+    return Result;
+}
+
+SP_EXPORT bool checkSweptCapsuleTriangleIntersection(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::triangle3df &Triangle, f32 &Time, dim::vector3df &Normal)
+{
+    const dim::line3df ClosestLine(getClosestLine(Triangle, CapsuleLine));
+    const dim::vector3df Separation(ClosestLine.End - ClosestLine.Start);
+    
+    if (Separation.getLengthSq() <= CapsuleRadius*CapsuleRadius)
+        return checkInitialSweepContact(Separation, Direction, Time, Normal);
+    
+    Time = 1.0f;
+    return checkMovingCapsuleTriangle(CapsuleLine, CapsuleRadius, Direction, Triangle, Time, Normal);
+}
+
+SP_EXPORT bool checkSweptCapsuleBoxIntersection(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::aabbox3df &Box, f32 &Time, dim::vector3df &Normal)
+{
+    const dim::line3df ClosestLine(getClosestLine(Box, CapsuleLine));
+    const dim::vector3df Separation(ClosestLine.End - ClosestLine.Start);
+    
+    if (Separation.getLengthSq() <= CapsuleRadius*CapsuleRadius)
+        return checkInitialSweepContact(Separation, Direction, Time, Normal);
+    
+    /* Check contact with each box side */
+    dim::triangle3df Triangles[12];
+    getBoxTriangles(Box, Triangles);
+    
+    Time = 1.0f;
+    bool Result = false;
+    
+    for (u32 i = 0; i < 12; ++i)
+    {
+        if (checkMovingCapsuleTriangle(CapsuleLine, CapsuleRadius, Direction, Triangles[i], Time, Normal))
+            Result = true;
+    }
+    
+    return Result;
+}
+
+
 /* === Line-/ plane-/ triangle- box overlap tests === */
 
 SP_EXPORT bool checkLineBoxOverlap(
@@ -998,6 +1426,303 @@ bool checkPyramidPyramidOverlap(
     );
 }
 
+
+/* === Batched tests === */
+
+//! Vector of 4 points in structure-of-arrays layout.
+struct SVector3x4
+{
+    SVector3x4()
+    {
+    }
+    SVector3x4(const float4 &InitX, const float4 &InitY, const float4 &InitZ) :
+        X(InitX),
+        Y(InitY),
+        Z(InitZ)
+    {
+    }
+    SVector3x4(const dim::vector3df &Vec) :
+        X(Vec.X),
+        Y(Vec.Y),
+        Z(Vec.Z)
+    {
+    }
+    SVector3x4(const f32 (&Array)[3][4]) :
+        X(float4::load(Array[0])),
+        Y(float4::load(Array[1])),
+        Z(float4::load(Array[2]))
+    {
+    }
+    
+    /* Operators */
+    inline SVector3x4 operator + (const SVector3x4 &Other) const
+    {
+        return SVector3x4(X + Other.X, Y + Other.Y, Z + Other.Z);
+    }
+    inline SVector3x4 operator - (const SVector3x4 &Other) const
+    {
+        return SVector3x4(X - Other.X, Y - Other.Y, Z - Other.Z);
+    }
+    inline SVector3x4 operator * (const float4 &Factor) const
+    {
+        return SVector3x4(X * Factor, Y * Factor, Z * Factor);
+    }
+    
+    /* Functions */
+    inline float4 dot(const SVector3x4 &Other) const
+    {
+        return X * Other.X + Y * Other.Y + Z * Other.Z;
+    }
+    inline SVector3x4 cross(const SVector3x4 &Other) const
+    {
+        return SVector3x4(
+            Y * Other.Z - Z * Other.Y,
+            Z * Other.X - X * Other.Z,
+            X * Other.Y - Y * Other.X
+        );
+    }
+    
+    static inline SVector3x4 select(const float4 &Mask, const SVector3x4 &A, const SVector3x4 &B)
+    {
+        return SVector3x4(
+            float4::select(Mask, A.X, B.X),
+            float4::select(Mask, A.Y, B.Y),
+            float4::select(Mask, A.Z, B.Z)
+        );
+    }
+    
+    inline void store(u32 Index, dim::vector3df &Vec) const
+    {
+        f32 Tmp[3][4];
+        
+        X.store(Tmp[0]);
+        Y.store(Tmp[1]);
+        Z.store(Tmp[2]);
+        
+        Vec.X = Tmp[0][Index];
+        Vec.Y = Tmp[1][Index];
+        Vec.Z = Tmp[2][Index];
+    }
+    
+    /* Members */
+    float4 X, Y, Z;
+};
+
+//! Returns the bit mask of the valid triangles in the block.
+static inline s32 getTriangleBlockMask(const STriangleBlock4 &Block)
+{
+    return (1 << math::Min(Block.Count, 4u)) - 1;
+}
+
+//! Returns a mask where each component is true if the projections of the triangles onto the axis are separated from the box.
+static inline float4 checkTriangleBlockBoxSeparation(
+    const SVector3x4 &V0, const SVector3x4 &V1, const SVector3x4 &V2, const SVector3x4 &Axis, const dim::vector3df &HalfSize)
+{
+    const float4 P0(V0.dot(Axis));
+    const float4 P1(V1.dot(Axis));
+    const float4 P2(V2.dot(Axis));
+    
+    const float4 R(
+        float4::abs(Axis.X) * float4(HalfSize.X) +
+        float4::abs(Axis.Y) * float4(HalfSize.Y) +
+        float4::abs(Axis.Z) * float4(HalfSize.Z)
+    );
+    
+    return (float4::min(P0, float4::min(P1, P2)) > R) | (float4::max(P0, float4::max(P1, P2)) < -R);
+}
+
+STriangleBlock4::STriangleBlock4() :
+    Count(0)
+{
+    for (u32 i = 0; i < 3; ++i)
+    {
+        for (u32 j = 0; j < 4; ++j)
+            PointA[i][j] = EdgeB[i][j] = EdgeC[i][j] = 0.0f;
+    }
+}
+STriangleBlock4::~STriangleBlock4()
+{
+}
+
+void STriangleBlock4::setTriangle(u32 Index, const dim::triangle3df &Triangle)
+{
+    if (Index < 4)
+    {
+        for (u32 i = 0; i < 3; ++i)
+        {
+            PointA[i][Index]    = Triangle.PointA[i];
+            EdgeB[i][Index]     = Triangle.PointB[i] - Triangle.PointA[i];
+            EdgeC[i][Index]     = Triangle.PointC[i] - Triangle.PointA[i];
+        }
+    }
+}
+
+dim::triangle3df STriangleBlock4::getTriangle(u32 Index) const
+{
+    dim::triangle3df Triangle;
+    
+    if (Index < 4)
+    {
+        for (u32 i = 0; i < 3; ++i)
+        {
+            Triangle.PointA[i] = PointA[i][Index];
+            Triangle.PointB[i] = PointA[i][Index] + EdgeB[i][Index];
+            Triangle.PointC[i] = PointA[i][Index] + EdgeC[i][Index];
+        }
+    }
+    
+    return Triangle;
+}
+
+SP_EXPORT s32 checkLineTriangleBlockIntersection(
+    const STriangleBlock4 &Block, const dim::vector3df &Origin, const dim::vector3df &Direction,
+    f32* Distances, s32 &BackFaceMask, bool FrontFaces, bool BackFaces)
+{
+    /* Moeller-Trumbore line/triangle intersection test for 4 triangles at once */
+    const SVector3x4 A(Block.PointA);
+    const SVector3x4 EdgeB(Block.EdgeB);
+    const SVector3x4 EdgeC(Block.EdgeC);
+    const SVector3x4 Dir(Direction);
+    
+    const SVector3x4 P(Dir.cross(EdgeC));
+    const float4 Det(EdgeB.dot(P));
+    
+    const float4 Zero(0.0f), One(1.0f);
+    
+    /* The determinant is positive when the line points against the triangle's normal (front face) */
+    float4 FaceMask(Det != Zero);
+    
+    if (!FrontFaces)
+        FaceMask = FaceMask & (Det < Zero);
+    if (!BackFaces)
+        FaceMask = FaceMask & (Det > Zero);
+    
+    const float4 InvDet(One / Det);
+    const SVector3x4 S(SVector3x4(Origin) - A);
+    
+    const float4 U(S.dot(P) * InvDet);
+    const SVector3x4 Q(S.cross(EdgeB));
+    const float4 V(Dir.dot(Q) * InvDet);
+    const float4 T(EdgeC.dot(Q) * InvDet);
+    
+    const float4 HitMask(
+        FaceMask & (U >= Zero) & (U <= One) & (V >= Zero) & (U + V <= One) & (T >= Zero) & (T <= One)
+    );
+    
+    const s32 Mask = HitMask.getMask() & getTriangleBlockMask(Block);
+    
+    T.store(Distances);
+    BackFaceMask = (Det < Zero).getMask() & Mask;
+    
+    return Mask;
+}
+
+SP_EXPORT s32 getClosestPointsOnTriangleBlock(
+    const STriangleBlock4 &Block, const dim::vector3df &Point, dim::vector3df* ClosestPoints, f32* DistancesSq)
+{
+    /*
+    Closest point on triangle for 4 triangles at once (see "getClosestPoint").
+    All voronoi regions are computed and selected in reverse order, so that the first matching region wins.
+    */
+    const SVector3x4 A(Block.PointA);
+    const SVector3x4 AB(Block.EdgeB);
+    const SVector3x4 AC(Block.EdgeC);
+    const SVector3x4 B(A + AB);
+    const SVector3x4 C(A + AC);
+    const SVector3x4 P(Point);
+    
+    const float4 Zero(0.0f);
+    
+    const SVector3x4 AP(P - A);
+    const float4 d1(AB.dot(AP));
+    const float4 d2(AC.dot(AP));
+    
+    const SVector3x4 BP(P - B);
+    const float4 d3(AB.dot(BP));
+    const float4 d4(AC.dot(BP));
+    
+    const SVector3x4 CP(P - C);
+    const float4 d5(AB.dot(CP));
+    const float4 d6(AC.dot(CP));
+    
+    const float4 vc(d1*d4 - d3*d2);
+    const float4 vb(d5*d2 - d1*d6);
+    const float4 va(d3*d6 - d5*d4);
+    
+    /* Point inside face region */
+    const float4 Denom(float4(1.0f) / (va + vb + vc));
+    SVector3x4 Result(A + AB * (vb * Denom) + AC * (vc * Denom));
+    
+    /* Point in edge region BC */
+    Result = SVector3x4::select(
+        (va <= Zero) & (d4 - d3 >= Zero) & (d5 - d6 >= Zero),
+        B + (C - B) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))), Result
+    );
+    
+    /* Point in edge region AC */
+    Result = SVector3x4::select((vb <= Zero) & (d2 >= Zero) & (d6 <= Zero), A + AC * (d2 / (d2 - d6)), Result);
+    
+    /* Point in vertex region C */
+    Result = SVector3x4::select((d6 >= Zero) & (d5 <= d6), C, Result);
+    
+    /* Point in edge region AB */
+    Result = SVector3x4::select((vc <= Zero) & (d1 >= Zero) & (d3 <= Zero), A + AB * (d1 / (d1 - d3)), Result);
+    
+    /* Point in vertex region B */
+    Result = SVector3x4::select((d3 >= Zero) & (d4 <= d3), B, Result);
+    
+    /* Point in vertex region A */
+    Result = SVector3x4::select((d1 <= Zero) & (d2 <= Zero), A, Result);
+    
+    /* Store results */
+    const SVector3x4 Diff(P - Result);
+    Diff.dot(Diff).store(DistancesSq);
+    
+    for (u32 i = 0, n = math::Min(Block.Count, 4u); i < n; ++i)
+        Result.store(i, ClosestPoints[i]);
+    
+    return getTriangleBlockMask(Block);
+}
+
+SP_EXPORT s32 checkTriangleBlockBoxOverlap(const STriangleBlock4 &Block, const dim::aabbox3df &Box)
+{
+    /* Move the triangles into the box's center */
+    const dim::vector3df Center(Box.getCenter());
+    const dim::vector3df HalfSize(Box.getSize() * 0.5f);
+    
+    const SVector3x4 V0(SVector3x4(Block.PointA) - SVector3x4(Center));
+    const SVector3x4 F0(Block.EdgeB);
+    const SVector3x4 EdgeC(Block.EdgeC);
+    const SVector3x4 V1(V0 + F0);
+    const SVector3x4 V2(V0 + EdgeC);
+    const SVector3x4 F1(EdgeC - F0);
+    const SVector3x4 F2(SVector3x4(float4(0.0f), float4(0.0f), float4(0.0f)) - EdgeC);
+    
+    const float4 Zero(0.0f), One(1.0f);
+    
+    /* Test the box axes */
+    float4 Separated(checkTriangleBlockBoxSeparation(V0, V1, V2, SVector3x4(One, Zero, Zero), HalfSize));
+    Separated = Separated | checkTriangleBlockBoxSeparation(V0, V1, V2, SVector3x4(Zero, One, Zero), HalfSize);
+    Separated = Separated | checkTriangleBlockBoxSeparation(V0, V1, V2, SVector3x4(Zero, Zero, One), HalfSize);
+    
+    /* Test the triangle normals */
+    Separated = Separated | checkTriangleBlockBoxSeparation(V0, V1, V2, F0.cross(EdgeC), HalfSize);
+    
+    /* Test the cross products of the box axes and the triangle edges */
+    const SVector3x4 Edges[3] = { F0, F1, F2 };
+    
+    for (u32 i = 0; i < 3; ++i)
+    {
+        const SVector3x4& F = Edges[i];
+        
+        Separated = Separated | checkTriangleBlockBoxSeparation(V0, V1, V2, SVector3x4(Zero, -F.Z, F.Y), HalfSize);
+        Separated = Separated | checkTriangleBlockBoxSeparation(V0, V1, V2, SVector3x4(F.Z, Zero, -F.X), HalfSize);
+        Separated = Separated | checkTriangleBlockBoxSeparation(V0, V1, V2, SVector3x4(-F.Y, F.X, Zero), HalfSize);
+    }
+    
+    return ~Separated.getMask() & getTriangleBlockMask(Block);
+}
+
 } // /namespace CollisionLibrary
 
 
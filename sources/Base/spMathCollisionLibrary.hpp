@@ -219,6 +219,87 @@ SP_EXPORT bool checkTriangleTriangleIntersection(
     const dim::triangle3df &TriangleA, const dim::triangle3df &TriangleB, dim::line3df &Intersection
 );
 
+/* === Swept tests === */
+
+/**
+Computes the first contact between a moving sphere and a static sphere (continuous collision detection).
+\param[in] SpherePosition Specifies the start position of the moving sphere.
+\param[in] SphereRadius Specifies the radius of the moving sphere.
+\param[in] Direction Specifies the movement of the sphere, i.e. the sphere moves from "SpherePosition" to "SpherePosition + Direction".
+\param[in] RivalPosition Specifies the position of the static sphere.
+\param[in] RivalRadius Specifies the radius of the static sphere.
+\param[out] Time Resulting time of impact. This is an interpolation factor on the movement in the range [0.0 .. 1.0].
+\param[out] Normal Resulting contact normal (from the rival object to the moving object).
+\return True if a contact occurs during the movement. If both objects already overlap at the start,
+a contact with time 0.0 is only returned if the sphere moves towards the rival object.
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptSphereSphereIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::vector3df &RivalPosition, f32 RivalRadius, f32 &Time, dim::vector3df &Normal
+);
+
+/**
+Computes the first contact between a moving sphere and a static capsule.
+\see checkSweptSphereSphereIntersection
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptSphereCapsuleIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::line3df &RivalLine, f32 RivalRadius, f32 &Time, dim::vector3df &Normal
+);
+
+/**
+Computes the first contact between a moving sphere and a static triangle. Both triangle sides are tested.
+\see checkSweptSphereSphereIntersection
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptSphereTriangleIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::triangle3df &Triangle, f32 &Time, dim::vector3df &Normal
+);
+
+/**
+Computes the first contact between a moving sphere and a static axis aligned bounding box.
+\see checkSweptSphereSphereIntersection
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptSphereBoxIntersection(
+    const dim::vector3df &SpherePosition, f32 SphereRadius, const dim::vector3df &Direction,
+    const dim::aabbox3df &Box, f32 &Time, dim::vector3df &Normal
+);
+
+/**
+Computes the first contact between a moving capsule and a static capsule.
+\param[in] CapsuleLine Specifies the start line (between the two hemisphere centers) of the moving capsule.
+\see checkSweptSphereSphereIntersection
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptCapsuleCapsuleIntersection(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::line3df &RivalLine, f32 RivalRadius, f32 &Time, dim::vector3df &Normal
+);
+
+/**
+Computes the first contact between a moving capsule and a static triangle. Both triangle sides are tested.
+\see checkSweptCapsuleCapsuleIntersection
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptCapsuleTriangleIntersection(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::triangle3df &Triangle, f32 &Time, dim::vector3df &Normal
+);
+
+/**
+Computes the first contact between a moving capsule and a static axis aligned bounding box.
+\see checkSweptCapsuleCapsuleIntersection
+\since Version 3.3
+*/
+SP_EXPORT bool checkSweptCapsuleBoxIntersection(
+    const dim::line3df &CapsuleLine, f32 CapsuleRadius, const dim::vector3df &Direction,
+    const dim::aabbox3df &Box, f32 &Time, dim::vector3df &Normal
+);
+
 /* === Overlap tests === */
 
 //! Returns true if an intersection between "Line" and "Box" has been detected.
@@ -255,6 +336,77 @@ bool checkPyramidPyramidOverlap(
     const dim::vector3df &OriginB, const scene::ViewFrustum &FrustumB
 );
 
+/* === Batched tests === */
+
+/**
+Block of (up to) 4 triangles in structure-of-arrays layout for the batched tests.
+Each component array holds the respective coordinate of all 4 triangles, e.g. "PointA[1][2]" is the Y coordinate
+of the first point of the third triangle. Unused entries must have "Count" less than 4 and are ignored by the batched tests.
+\see math::float4
+\since Version 3.3
+*/
+struct SP_EXPORT STriangleBlock4
+{
+    STriangleBlock4();
+    ~STriangleBlock4();
+    
+    /* === Functions === */
+    
+    //! Stores the specified triangle at the specified block index [0 .. 3].
+    void setTriangle(u32 Index, const dim::triangle3df &Triangle);
+    //! Returns the triangle at the specified block index [0 .. 3].
+    dim::triangle3df getTriangle(u32 Index) const;
+    
+    /* === Members === */
+    
+    f32 PointA[3][4];   //!< First points (X, Y, Z components).
+    f32 EdgeB[3][4];    //!< Edges from the first to the second points.
+    f32 EdgeC[3][4];    //!< Edges from the first to the third points.
+    u32 Count;          //!< Count of valid triangles in this block [0 .. 4].
+};
+
+/**
+Makes an intersection test between a line and all triangles of the specified block at once.
+This is the batched version of "checkLineTriangleIntersection" and uses SSE if available.
+\param[in] Block Specifies the triangle block.
+\param[in] Origin Specifies the line's start point.
+\param[in] Direction Specifies the line's direction (end point minus start point).
+\param[out] Distances Pointer to an array of 4 elements where the interpolation factors [0.0 .. 1.0]
+on the line are to be stored. Only the entries of intersected triangles are valid.
+\param[out] BackFaceMask Bit mask of the intersected triangles which are back facing.
+\param[in] FrontFaces Specifies whether front facing triangles are to be tested.
+\param[in] BackFaces Specifies whether back facing triangles are to be tested.
+\return Bit mask of the intersected triangles, i.e. bit i is set if triangle i is intersected.
+\since Version 3.3
+*/
+SP_EXPORT s32 checkLineTriangleBlockIntersection(
+    const STriangleBlock4 &Block, const dim::vector3df &Origin, const dim::vector3df &Direction,
+    f32* Distances, s32 &BackFaceMask, bool FrontFaces = true, bool BackFaces = true
+);
+
+/**
+Computes the closest points onto all triangles of the specified block at once.
+This is the batched version of "getClosestPoint" for triangles and uses SSE if available.
+\param[in] Block Specifies the triangle block.
+\param[in] Point Specifies the point to which the closest points are to be computed.
+\param[out] ClosestPoints Pointer to an array of 4 elements where the closest points are to be stored.
+\param[out] DistancesSq Pointer to an array of 4 elements where the squared distances
+between "Point" and the closest points are to be stored.
+\return Bit mask of the valid triangles (see STriangleBlock4::Count).
+\since Version 3.3
+*/
+SP_EXPORT s32 getClosestPointsOnTriangleBlock(
+    const STriangleBlock4 &Block, const dim::vector3df &Point, dim::vector3df* ClosestPoints, f32* DistancesSq
+);
+
+/**
+Makes an exact overlap test (separating axis test) between a box and all triangles of the specified block at once.
+This is the batched version of "checkTriangleBoxOverlap" and uses SSE if available.
+\return Bit mask of the triangles which overlap the box.
+\since Version 3.3
+*/
+SP_EXPORT s32 checkTriangleBlockBoxOverlap(const STriangleBlock4 &Block, const dim::aabbox3df &Box);
+
 /* === Polygon clippint === */
 
 template <typename T, typename C> bool getLinePlaneIntersection(
@@ -111,11 +111,15 @@ the function renders nothing. Use this to draw a pixel onto a screen or image bu
 \param[in] VertexB Second vertex for the triangle.
 \param[in] VertexC Third vertex for the triangle.
 \param[in] UserData Any user data which will be passed to the render callback.
+\param[in] ClipRect Optional pointer to a clipping rectangle. If specified only the pixels inside this rectangle
+(excluding the right and bottom border) are rendered, so the callback does not need to test the coordinates.
+This should be used for large triangles which are mostly outside the screen. By default null.
 \see RasterizerVertex
 */
 template <class VtxT> void rasterizeTriangle(
     const boost::function<void (s32 x, s32 y, const VtxT &Vertex, void* UserData)> &RenderPixelCallback,
-    const VtxT &VertexA, const VtxT &VertexB, const VtxT &VertexC, void* UserData = 0)
+    const VtxT &VertexA, const VtxT &VertexB, const VtxT &VertexC, void* UserData = 0,
+    const dim::rect2di* ClipRect = 0)
 {
     /* Store vertices as pointers in array */
     const VtxT* v[3] = { &VertexA, &VertexB, &VertexC };
@@ -147,8 +151,17 @@ template <class VtxT> void rasterizeTriangle(
     s32 x, y, xStart, xEnd;
     VtxT lside, rside, step, cur;
     
+    /* Clip the scanlines */
+    s32 yFirst = yStart, yLast = yEnd;
+    
+    if (ClipRect)
+    {
+        yFirst  = math::Max(yStart, ClipRect->Top);
+        yLast   = math::Min(yEnd, ClipRect->Bottom);
+    }
+    
     /* Rater each scanline from top to bottom */
-    for (y = yStart; y < yEnd; ++y)
+    for (y = yFirst; y < yLast; ++y)
     {
         /* Compute the scanline dimension */
         if (y < yMiddle)
@@ -178,6 +191,19 @@ template <class VtxT> void rasterizeTriangle(
         
         cur = lside;
         
+        if (ClipRect)
+        {
+            /* Skip the pixels left of the clipping rectangle */
+            if (xStart < ClipRect->Left)
+            {
+                VtxT skip(step);
+                skip *= static_cast<f32>(ClipRect->Left - xStart);
+                cur += skip;
+                xStart = ClipRect->Left;
+            }
+            xEnd = math::Min(xEnd, ClipRect->Right);
+        }
+        
         /* Render each pixel in scanline */
         for (x = xStart; x < xEnd; ++x)
         {
@@ -0,0 +1,197 @@
+/*
+ * Math SIMD header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_MATH_SIMD_H__
+#define __SP_MATH_SIMD_H__
+
+
+#include "Base/spStandard.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+#   define SP_USE_SSE
+#   include <xmmintrin.h>
+#endif
+
+
+namespace sp
+{
+namespace math
+{
+
+
+/**
+Four component float vector for SIMD (single-instruction-multiple-data) computations.
+This is used for the batched collision tests which process 4 primitives at once in structure-of-arrays layout.
+When SSE is available (SP_USE_SSE is defined) each operation is a single SSE instruction, otherwise a scalar fallback is used.
+Comparisons return a mask vector where each component has either all bits set (true) or no bit set (false).
+\see CollisionLibrary::STriangleBlock4
+\since Version 3.3
+*/
+class float4
+{
+
+    public:
+        
+        #ifdef SP_USE_SSE
+        
+        inline float4()
+        {
+        }
+        inline float4(f32 Scalar) :
+            V(_mm_set1_ps(Scalar))
+        {
+        }
+        inline float4(const __m128 &Vec) :
+            V(Vec)
+        {
+        }
+        
+        /* === Operators === */
+        
+        inline float4 operator + (const float4 &Other) const { return _mm_add_ps(V, Other.V); }
+        inline float4 operator - (const float4 &Other) const { return _mm_sub_ps(V, Other.V); }
+        inline float4 operator * (const float4 &Other) const { return _mm_mul_ps(V, Other.V); }
+        inline float4 operator / (const float4 &Other) const { return _mm_div_ps(V, Other.V); }
+        
+        inline float4 operator - () const { return _mm_sub_ps(_mm_setzero_ps(), V); }
+        
+        inline float4 operator & (const float4 &Other) const { return _mm_and_ps(V, Other.V); }
+        inline float4 operator | (const float4 &Other) const { return _mm_or_ps(V, Other.V); }
+        
+        inline float4 operator <  (const float4 &Other) const { return _mm_cmplt_ps(V, Other.V); }
+        inline float4 operator <= (const float4 &Other) const { return _mm_cmple_ps(V, Other.V); }
+        inline float4 operator >  (const float4 &Other) const { return _mm_cmpgt_ps(V, Other.V); }
+        inline float4 operator >= (const float4 &Other) const { return _mm_cmpge_ps(V, Other.V); }
+        inline float4 operator != (const float4 &Other) const { return _mm_cmpneq_ps(V, Other.V); }
+        
+        /* === Functions === */
+        
+        //! Loads four components from an unaligned array.
+        static inline float4 load(const f32* Array)
+        {
+            return _mm_loadu_ps(Array);
+        }
+        //! Stores the four components into an unaligned array.
+        inline void store(f32* Array) const
+        {
+            _mm_storeu_ps(Array, V);
+        }
+        
+        //! Returns a bit mask where bit i is set if the mask component i is true.
+        inline s32 getMask() const
+        {
+            return _mm_movemask_ps(V);
+        }
+        
+        static inline float4 min(const float4 &A, const float4 &B) { return _mm_min_ps(A.V, B.V); }
+        static inline float4 max(const float4 &A, const float4 &B) { return _mm_max_ps(A.V, B.V); }
+        
+        static inline float4 abs(const float4 &A)
+        {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), A.V);
+        }
+        
+        //! Returns (Mask ? A : B) for each component.
+        static inline float4 select(const float4 &Mask, const float4 &A, const float4 &B)
+        {
+            return _mm_or_ps(_mm_and_ps(Mask.V, A.V), _mm_andnot_ps(Mask.V, B.V));
+        }
+        
+        /* === Members === */
+        
+        __m128 V;
+        
+        #else
+        
+        inline float4()
+        {
+        }
+        inline float4(f32 Scalar)
+        {
+            V[0] = V[1] = V[2] = V[3] = Scalar;
+        }
+        
+        /* === Operators === */
+        
+        inline float4 operator + (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = V[i] + Other.V[i]; return R; }
+        inline float4 operator - (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = V[i] - Other.V[i]; return R; }
+        inline float4 operator * (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = V[i] * Other.V[i]; return R; }
+        inline float4 operator / (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = V[i] / Other.V[i]; return R; }
+        
+        inline float4 operator - () const { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = -V[i]; return R; }
+        
+        inline float4 operator & (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = U[i] & Other.U[i]; return R; }
+        inline float4 operator | (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = U[i] | Other.U[i]; return R; }
+        
+        inline float4 operator <  (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = (V[i] <  Other.V[i] ? ~0u : 0u); return R; }
+        inline float4 operator <= (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = (V[i] <= Other.V[i] ? ~0u : 0u); return R; }
+        inline float4 operator >  (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = (V[i] >  Other.V[i] ? ~0u : 0u); return R; }
+        inline float4 operator >= (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = (V[i] >= Other.V[i] ? ~0u : 0u); return R; }
+        inline float4 operator != (const float4 &Other) const { float4 R; for (s32 i = 0; i < 4; ++i) R.U[i] = (V[i] != Other.V[i] ? ~0u : 0u); return R; }
+        
+        /* === Functions === */
+        
+        static inline float4 load(const f32* Array)
+        {
+            float4 R;
+            for (s32 i = 0; i < 4; ++i)
+                R.V[i] = Array[i];
+            return R;
+        }
+        inline void store(f32* Array) const
+        {
+            for (s32 i = 0; i < 4; ++i)
+                Array[i] = V[i];
+        }
+        
+        inline s32 getMask() const
+        {
+            return ((U[0] >> 31) & 1) | ((U[1] >> 30) & 2) | ((U[2] >> 29) & 4) | ((U[3] >> 28) & 8);
+        }
+        
+        static inline float4 min(const float4 &A, const float4 &B) { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = (A.V[i] < B.V[i] ? A.V[i] : B.V[i]); return R; }
+        static inline float4 max(const float4 &A, const float4 &B) { float4 R; for (s32 i = 0; i < 4; ++i) R.V[i] = (A.V[i] > B.V[i] ? A.V[i] : B.V[i]); return R; }
+        
+        static inline float4 abs(const float4 &A)
+        {
+            float4 R;
+            for (s32 i = 0; i < 4; ++i)
+                R.U[i] = A.U[i] & 0x7FFFFFFF;
+            return R;
+        }
+        
+        static inline float4 select(const float4 &Mask, const float4 &A, const float4 &B)
+        {
+            float4 R;
+            for (s32 i = 0; i < 4; ++i)
+                R.U[i] = (Mask.U[i] & A.U[i]) | (~Mask.U[i] & B.U[i]);
+            return R;
+        }
+        
+        /* === Members === */
+        
+        union
+        {
+            f32 V[4];
+            u32 U[4];
+        };
+        
+        #endif
+        
+};
+
+
+} // /namespace math
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
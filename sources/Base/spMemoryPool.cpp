@@ -0,0 +1,160 @@
+/*
+ * Memory pool file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "Base/spMemoryPool.hpp"
+#include "Base/spInputOutputLog.hpp"
+#include "Base/spMathCore.hpp"
+
+#include <new>
+#include <boost/foreach.hpp>
+
+
+namespace sp
+{
+
+
+/*
+ * Internal constants
+ */
+
+//! Alignment of each slot. This is sufficient for all scalar and SIMD types.
+static const size_t MEMPOOL_SLOT_ALIGNMENT = 16;
+
+
+/*
+ * MemoryPool class
+ */
+
+MemoryPool::MemoryPool(const io::stringc &Name, size_t ObjectSize, u32 SlabSize) :
+    Name_       (Name                   ),
+    ObjectSize_ (ObjectSize             ),
+    SlotSize_   (0                      ),
+    SlabSize_   (math::Max(1u, SlabSize)),
+    FreeList_   (0                      )
+{
+    /* Each slot must be able to hold the free list link */
+    SlotSize_ = math::Max(ObjectSize, sizeof(SFreeSlot));
+    SlotSize_ = (SlotSize_ + MEMPOOL_SLOT_ALIGNMENT - 1) & ~(MEMPOOL_SLOT_ALIGNMENT - 1);
+    
+    Stats_.ObjectSize   = static_cast<u32>(SlotSize_);
+    Stats_.SlabSize     = SlabSize_;
+}
+MemoryPool::~MemoryPool()
+{
+    /*
+    Objects which are still alive (e.g. static objects which are deleted after this pool) keep their slabs,
+    so only release the slabs when the pool is empty
+    */
+    if (Stats_.NumObjects == 0)
+    {
+        foreach (c8* Slab, Slabs_)
+            ::operator delete(Slab);
+    }
+}
+
+void* MemoryPool::allocate(size_t Size)
+{
+    /* Objects of derived classes don't fit into the slots */
+    if (Size != ObjectSize_)
+    {
+        Mutex_.lock();
+        ++Stats_.NumHeapFallbacks;
+        Mutex_.unlock();
+        return ::operator new(Size);
+    }
+    
+    Mutex_.lock();
+    
+    if (!FreeList_)
+    {
+        try
+        {
+            allocateSlab();
+        }
+        catch (const std::bad_alloc &Err)
+        {
+            Mutex_.unlock();
+            io::Log::error("< Bad Allocation > exception thrown for \"" + Name_ + "\" memory pool");
+            throw Err;
+        }
+    }
+    
+    /* Pop the first free slot */
+    SFreeSlot* Slot = FreeList_;
+    FreeList_ = Slot->Next;
+    
+    ++Stats_.NumAllocations;
+    ++Stats_.NumObjects;
+    Stats_.PeakObjects = math::Max(Stats_.PeakObjects, Stats_.NumObjects);
+    
+    Mutex_.unlock();
+    
+    return Slot;
+}
+
+void MemoryPool::release(void* Ptr, size_t Size)
+{
+    if (!Ptr)
+        return;
+    
+    if (Size != ObjectSize_)
+    {
+        ::operator delete(Ptr);
+        return;
+    }
+    
+    Mutex_.lock();
+    
+    /* Push the slot to the front of the free list, so it is reused while it is still in the cache */
+    SFreeSlot* Slot = static_cast<SFreeSlot*>(Ptr);
+    Slot->Next = FreeList_;
+    FreeList_ = Slot;
+    
+    --Stats_.NumObjects;
+    
+    Mutex_.unlock();
+}
+
+SMemoryPoolStats MemoryPool::getStats() const
+{
+    Mutex_.lock();
+    SMemoryPoolStats Stats = Stats_;
+    Mutex_.unlock();
+    return Stats;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void MemoryPool::allocateSlab()
+{
+    /* Allocate new slab (operator new returns memory which is aligned for all fundamental types) */
+    Slabs_.push_back(0);
+    Slabs_.back() = static_cast<c8*>(::operator new(SlotSize_ * SlabSize_));
+    
+    c8* Slab = Slabs_.back();
+    
+    /* Link all slots in their address order */
+    for (u32 i = SlabSize_; i > 0; --i)
+    {
+        SFreeSlot* Slot = reinterpret_cast<SFreeSlot*>(Slab + SlotSize_ * (i - 1));
+        Slot->Next = FreeList_;
+        FreeList_ = Slot;
+    }
+    
+    ++Stats_.NumSlabs;
+    Stats_.Capacity += SlabSize_;
+}
+
+
+} // /namespace sp
+
+
+
+// ================================================================================
@@ -0,0 +1,158 @@
+/*
+ * Memory pool header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_MEMORY_POOL_H__
+#define __SP_MEMORY_POOL_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spInputOutputString.hpp"
+#include "Base/spCriticalSection.hpp"
+
+#include <vector>
+#include <cstddef>
+
+
+namespace sp
+{
+
+
+//! Occupancy statistics of a memory pool.
+struct SMemoryPoolStats
+{
+    SMemoryPoolStats() :
+        ObjectSize      (0),
+        SlabSize        (0),
+        NumSlabs        (0),
+        Capacity        (0),
+        NumObjects      (0),
+        PeakObjects     (0),
+        NumAllocations  (0),
+        NumHeapFallbacks(0)
+    {
+    }
+    ~SMemoryPoolStats()
+    {
+    }
+    
+    /* === Functions === */
+    
+    //! Returns the ratio of used slots in the range [0.0 .. 1.0].
+    inline f32 getOccupancy() const
+    {
+        return Capacity > 0 ? static_cast<f32>(NumObjects) / Capacity : 0.0f;
+    }
+    
+    /* === Members === */
+    
+    u32 ObjectSize;         //!< Size of each slot (in bytes).
+    u32 SlabSize;           //!< Count of slots in each slab.
+    u32 NumSlabs;           //!< Count of allocated slabs.
+    u32 Capacity;           //!< Count of slots in all slabs.
+    u32 NumObjects;         //!< Count of used slots.
+    u32 PeakObjects;        //!< Maximal count of used slots since the pool has been created.
+    u32 NumAllocations;     //!< Count of all slot allocations since the pool has been created.
+    u32 NumHeapFallbacks;   //!< Count of allocations which did not fit into a slot and were forwarded to the heap.
+};
+
+
+/**
+Slab based memory pool for objects of a fixed size. The memory is allocated in slabs of several slots at once
+and released slots are linked in a free list, so allocating and releasing an object is O(1) and spawning and
+despawning many objects does not fragment the heap. The slabs are only released when the pool is destroyed.
+This class is used by the class specific "operator new" and "operator delete" of the scene nodes (SceneNode, Mesh,
+Light, Billboard, Camera) and the mesh buffers, so it is also used when these objects are created or deleted directly.
+\note Objects of derived classes whose size differs from the slot size are forwarded to the heap.
+All functions are thread safe.
+\since Version 3.3
+*/
+class SP_EXPORT MemoryPool
+{
+    
+    public:
+        
+        /**
+        Memory pool constructor.
+        \param[in] Name Specifies the pool name for the log output.
+        \param[in] ObjectSize Specifies the size of each object (in bytes).
+        \param[in] SlabSize Specifies the count of slots which are allocated at once. By default 64.
+        */
+        MemoryPool(const io::stringc &Name, size_t ObjectSize, u32 SlabSize = 64);
+        ~MemoryPool();
+        
+        /* === Functions === */
+        
+        /**
+        Allocates the memory for a new object.
+        \param[in] Size Specifies the size of the object. If this differs from the slot size,
+        the memory is allocated from the heap (e.g. for objects of derived classes).
+        \return Pointer to the uninitialized memory.
+        \throw std::bad_alloc If no memory could be allocated.
+        */
+        void* allocate(size_t Size);
+        
+        /**
+        Releases the memory of an object. The slot is reused by the next allocation.
+        \param[in] Ptr Specifies the memory which has been allocated with "allocate". May also be null.
+        \param[in] Size Specifies the size of the object. This must be the same size which was used for the allocation.
+        */
+        void release(void* Ptr, size_t Size);
+        
+        //! Returns the current occupancy statistics.
+        SMemoryPoolStats getStats() const;
+        
+        /* === Inline functions === */
+        
+        inline const io::stringc& getName() const
+        {
+            return Name_;
+        }
+        
+        inline size_t getObjectSize() const
+        {
+            return ObjectSize_;
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SFreeSlot
+        {
+            SFreeSlot* Next;
+        };
+        
+        /* === Functions === */
+        
+        void allocateSlab();
+        
+        /* === Members === */
+        
+        io::stringc Name_;
+        
+        size_t ObjectSize_;
+        size_t SlotSize_;
+        u32 SlabSize_;
+        
+        std::vector<c8*> Slabs_;
+        SFreeSlot* FreeList_;
+        
+        SMemoryPoolStats Stats_;
+        
+        mutable CriticalSection Mutex_;
+        
+};
+
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
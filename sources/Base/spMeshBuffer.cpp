@@ -13,6 +13,7 @@
 #include "RenderSystem/spTextureLayerRelief.hpp"
 
 #include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
 
 
 namespace sp
@@ -115,6 +116,10 @@ MeshBuffer::MeshBuffer(const MeshBuffer &Other, bool isCreateMeshBuffer) :
     
     if (isCreateMeshBuffer)
     {
+        /* Share the hardware buffers which already contain the shared data */
+        shareHWBuffer(VertexBuffer_, Other.VertexBuffer_);
+        shareHWBuffer(IndexBuffer_, Other.IndexBuffer_);
+        
         createMeshBuffer();
         updateMeshBuffer();
     }
@@ -129,6 +134,26 @@ MeshBuffer::~MeshBuffer()
     clearBackup();
 }
 
+static MemoryPool& getMeshBufferPool()
+{
+    static MemoryPool Pool("video::MeshBuffer", sizeof(MeshBuffer));
+    return Pool;
+}
+
+void* MeshBuffer::operator new(size_t Size)
+{
+    return getMeshBufferPool().allocate(Size);
+}
+void MeshBuffer::operator delete(void* Ptr, size_t Size)
+{
+    getMeshBufferPool().release(Ptr, Size);
+}
+
+SMemoryPoolStats MeshBuffer::getMemoryPoolStats()
+{
+    return getMeshBufferPool().getStats();
+}
+
 
 /* === Buffer functions === */
 
@@ -426,12 +451,18 @@ void MeshBuffer::clearBackup()
 void MeshBuffer::createVertexBuffer()
 {
     if (!VertexBuffer_.Reference)
+    {
         GlbRenderSys->createVertexBuffer(VertexBuffer_.Reference);
+        VertexBuffer_.SharedReference = boost::make_shared<void*>(VertexBuffer_.Reference);
+    }
 }
 void MeshBuffer::createIndexBuffer()
 {
     if (!IndexBuffer_.Reference)
+    {
         GlbRenderSys->createIndexBuffer(IndexBuffer_.Reference);
+        IndexBuffer_.SharedReference = boost::make_shared<void*>(IndexBuffer_.Reference);
+    }
 }
 void MeshBuffer::createMeshBuffer()
 {
@@ -443,7 +474,8 @@ void MeshBuffer::deleteVertexBuffer()
 {
     if (VertexBuffer_.Reference)
     {
-        GlbRenderSys->deleteVertexBuffer(VertexBuffer_.Reference);
+        if (releaseHWBuffer(VertexBuffer_))
+            GlbRenderSys->deleteVertexBuffer(VertexBuffer_.Reference);
         VertexBuffer_.Validated = false;
     }
 }
@@ -451,7 +483,8 @@ void MeshBuffer::deleteIndexBuffer()
 {
     if (IndexBuffer_.Reference)
     {
-        GlbRenderSys->deleteIndexBuffer(IndexBuffer_.Reference);
+        if (releaseHWBuffer(IndexBuffer_))
+            GlbRenderSys->deleteIndexBuffer(IndexBuffer_.Reference);
         IndexBuffer_.Validated = false;
     }
 }
@@ -465,20 +498,42 @@ void MeshBuffer::updateVertexBuffer()
 {
     if (VertexBuffer_.Reference)
     {
+        if (VertexBuffer_.isHWBufferShared())
+        {
+            /* Shared hardware buffers are only uploaded once */
+            if (VertexBuffer_.isHWBufferValid())
+                return;
+            
+            /* Don't overwrite the hardware buffer of the other mesh buffers */
+            releaseHWBuffer(VertexBuffer_);
+            createVertexBuffer();
+        }
+        
         GlbRenderSys->updateVertexBuffer(
             VertexBuffer_.Reference, VertexBuffer_.RawBuffer, VertexFormat_, VertexBuffer_.Usage
         );
-        VertexBuffer_.Validated = true;
+        VertexBuffer_.Validated     = true;
+        VertexBuffer_.ValidRevision = VertexBuffer_.RawBuffer.getRevision();
     }
 }
 void MeshBuffer::updateIndexBuffer()
 {
     if (VertexBuffer_.Reference)
     {
+        if (IndexBuffer_.isHWBufferShared())
+        {
+            if (IndexBuffer_.isHWBufferValid())
+                return;
+            
+            releaseHWBuffer(IndexBuffer_);
+            createIndexBuffer();
+        }
+        
         GlbRenderSys->updateIndexBuffer(
             IndexBuffer_.Reference, IndexBuffer_.RawBuffer, &IndexFormat_, IndexBuffer_.Usage
         );
-        IndexBuffer_.Validated = true;
+        IndexBuffer_.Validated      = true;
+        IndexBuffer_.ValidRevision  = IndexBuffer_.RawBuffer.getRevision();
     }
 }
 void MeshBuffer::updateMeshBuffer()
@@ -489,11 +544,18 @@ void MeshBuffer::updateMeshBuffer()
 
 void MeshBuffer::updateVertexBufferElement(u32 Index)
 {
-    GlbRenderSys->updateVertexBufferElement(VertexBuffer_.Reference, VertexBuffer_.RawBuffer, Index);
+    /* A shared hardware buffer must be detached with a complete update */
+    if (VertexBuffer_.isHWBufferShared())
+        updateVertexBuffer();
+    else
+        GlbRenderSys->updateVertexBufferElement(VertexBuffer_.Reference, VertexBuffer_.RawBuffer, Index);
 }
 void MeshBuffer::updateIndexBufferElement(u32 Index)
 {
-    GlbRenderSys->updateIndexBufferElement(IndexBuffer_.Reference, IndexBuffer_.RawBuffer, Index);
+    if (IndexBuffer_.isHWBufferShared())
+        updateIndexBuffer();
+    else
+        GlbRenderSys->updateIndexBufferElement(IndexBuffer_.Reference, IndexBuffer_.RawBuffer, Index);
 }
 
 void MeshBuffer::setPrimitiveType(const ERenderPrimitives Type)
@@ -1020,6 +1082,39 @@ bool MeshBuffer::insertMeshBuffer(const MeshBuffer &Other)
     return true;
 }
 
+s32 MeshBuffer::appendVertices(const MeshBuffer &Other)
+{
+    if (VertexFormat_ != Other.VertexFormat_)
+        return -1;
+    
+    const u32 PrevVertexCount = getVertexCount();
+    
+    if (Other.getVertexCount())
+        VertexBuffer_.RawBuffer.add(Other.VertexBuffer_.RawBuffer);
+    
+    return static_cast<s32>(PrevVertexCount);
+}
+
+s32 MeshBuffer::appendVertices(const MeshBuffer &Other, const std::vector<u32> &Indices)
+{
+    if (VertexFormat_ != Other.VertexFormat_)
+        return -1;
+    
+    const u32 PrevVertexCount = getVertexCount();
+    const u32 VertexSize = VertexBuffer_.RawBuffer.getStride();
+    
+    VertexBuffer_.RawBuffer.setCount(PrevVertexCount + Indices.size());
+    
+    for (u32 i = 0; i < Indices.size(); ++i)
+    {
+        VertexBuffer_.RawBuffer.setBuffer(
+            PrevVertexCount + i, 0, Other.VertexBuffer_.RawBuffer.getArray(Indices[i], 0), VertexSize
+        );
+    }
+    
+    return static_cast<s32>(PrevVertexCount);
+}
+
 void MeshBuffer::setTriangleIndices(const u32 Index, const u32 (&Indices)[3])
 {
     if (Indices)
@@ -1225,7 +1320,7 @@ void MeshBuffer::setVertexAttribute(const u32 Index, const SVertexAttribute &Att
         Index, Attrib.Offset, AttribData, math::Min(Attrib.Size * VertexFormat::getDataTypeSize(Attrib.Type), static_cast<s32>(Size))
     );
 }
-void MeshBuffer::getVertexAttribute(const u32 Index, const SVertexAttribute &Attrib, void* AttribData, u32 Size)
+void MeshBuffer::getVertexAttribute(const u32 Index, const SVertexAttribute &Attrib, void* AttribData, u32 Size) const
 {
     VertexBuffer_.RawBuffer.getBuffer(
         Index, Attrib.Offset, AttribData, math::Min(Attrib.Size * VertexFormat::getDataTypeSize(Attrib.Type), static_cast<s32>(Size))
@@ -1517,7 +1612,8 @@ void MeshBuffer::seperateTriangles()
     const u32 TriangleCount = getTriangleCount();
     u32 Indices[3];
     
-    dim::UniversalBuffer OldVertexBuffer = VertexBuffer_.RawBuffer;
+    /* Keep the old buffer constant, otherwise its shared memory would be cloned */
+    const dim::UniversalBuffer OldVertexBuffer(VertexBuffer_.RawBuffer);
     VertexBuffer_.RawBuffer.setSize(BufferStride * TriangleCount * 3);
     
     s8* DestBuffer      = VertexBuffer_.RawBuffer.getArray();
@@ -2174,6 +2270,33 @@ void MeshBuffer::checkIndexFormat(ERendererDataTypes &Format)
     }
 }
 
+void MeshBuffer::shareHWBuffer(SBuffer &Buffer, const SBuffer &Other)
+{
+    if (!Buffer.Reference && Other.Reference && Other.SharedReference && Other.isHWBufferValid())
+    {
+        Buffer.Reference        = Other.Reference;
+        Buffer.SharedReference  = Other.SharedReference;
+        Buffer.Validated        = true;
+        Buffer.ValidRevision    = Other.ValidRevision;
+    }
+}
+
+bool MeshBuffer::releaseHWBuffer(SBuffer &Buffer)
+{
+    /* Only the last mesh buffer which uses the hardware buffer may delete it */
+    const bool IsShared = Buffer.isHWBufferShared();
+    
+    Buffer.SharedReference.reset();
+    
+    if (IsShared)
+    {
+        Buffer.Reference = 0;
+        return false;
+    }
+    
+    return true;
+}
+
 TextureLayerListType::iterator MeshBuffer::getTextureLayerIteration(const u8 Layer, bool SearchLayerIndex)
 {
     if (SearchLayerIndex)
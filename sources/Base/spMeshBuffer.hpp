@@ -16,9 +16,11 @@
 #include "Base/spVertexFormat.hpp"
 #include "Base/spIndexFormat.hpp"
 #include "Base/spMathTriangleCutter.hpp"
+#include "Base/spMemoryPool.hpp"
 #include "RenderSystem/spTextureLayer.hpp"
 
 #include <vector>
+#include <boost/shared_ptr.hpp>
 
 
 namespace sp
@@ -39,6 +41,14 @@ class SP_EXPORT MeshBuffer
     public:
         
         MeshBuffer(const VertexFormat* VertexFormat = 0, ERendererDataTypes IndexFormat = DATATYPE_UNSIGNED_INT);
+        /**
+        Copy constructor. The vertex- and index data is not cloned but shared with the other mesh buffer
+        until one of them is modified (see dim::UniversalBuffer). If the hardware buffers of the other mesh buffer
+        are up to date, they are also shared, so heavily duplicated meshes are only uploaded once.
+        \param[in] Other Specifies the mesh buffer which is to be copied.
+        \param[in] isCreateMeshBuffer Specifies whether the hardware buffers are to be created (or shared) and updated.
+        \see hasSharedGeometry
+        */
         MeshBuffer(const MeshBuffer &Other, bool isCreateMeshBuffer = true);
         virtual ~MeshBuffer();
         
@@ -282,6 +292,20 @@ class SP_EXPORT MeshBuffer
         */
         bool insertMeshBuffer(const MeshBuffer &Other);
         
+        /**
+        Appends all vertices of the given mesh buffer to this mesh buffer. In contrast to "insertMeshBuffer"
+        no indices are copied and only the vertex formats must be equal.
+        \return Index of the first appended vertex or -1 if the vertex formats are not equal.
+        \since Version 3.3
+        */
+        s32 appendVertices(const MeshBuffer &Other);
+        /**
+        Appends the specified vertices of the given mesh buffer to this mesh buffer (in the order of the index list).
+        \return Index of the first appended vertex or -1 if the vertex formats are not equal.
+        \since Version 3.3
+        */
+        s32 appendVertices(const MeshBuffer &Other, const std::vector<u32> &Indices);
+        
         /**
         Sets the indices of the specified triangle.
         \param Index: Specifies the triangle index (position for the index buffer multiplied by 3).
@@ -364,7 +388,7 @@ class SP_EXPORT MeshBuffer
         \param AttribData: Pointer to the buffer where the vertex attribute data is to be stored.
         \param Size: Data size in bytes of the "AttribData" buffer.
         */
-        void getVertexAttribute(const u32 Index, const SVertexAttribute &Attrib, void* AttribData, u32 Size);
+        void getVertexAttribute(const u32 Index, const SVertexAttribute &Attrib, void* AttribData, u32 Size) const;
         
         /**
         Sets the specified vertex coordinate.
@@ -695,6 +719,20 @@ class SP_EXPORT MeshBuffer
         */
         void setTexturesReference(TextureLayerListType* Reference);
         
+        /* === Static functions === */
+        
+        /**
+        Allocates the memory for a new mesh buffer from the mesh buffer memory pool.
+        Only the object itself is pooled, the vertex- and index buffers are still allocated separately.
+        \see MemoryPool
+        \since Version 3.3
+        */
+        static void* operator new(size_t Size);
+        static void operator delete(void* Ptr, size_t Size);
+        
+        //! Returns the occupancy statistics of the mesh buffer memory pool.
+        static SMemoryPoolStats getMemoryPoolStats();
+        
         /* === Inline functions === */
         
         //! Sets a reference. Use this for mesh buffer instancing. By default 0 to disable instancing.
@@ -751,6 +789,17 @@ class SP_EXPORT MeshBuffer
             return IndexBuffer_.RawBuffer;
         }
         
+        /**
+        Returns true if the vertex- or index data is shared with a copy of this mesh buffer (or with its backup).
+        The data is cloned when this mesh buffer or the copy is modified, and the hardware buffers
+        are shared until a modified mesh buffer is updated.
+        \since Version 3.3
+        */
+        inline bool hasSharedGeometry() const
+        {
+            return VertexBuffer_.RawBuffer.isShared() || IndexBuffer_.RawBuffer.isShared();
+        }
+        
         //! Returns the vertex format.
         inline const VertexFormat* getVertexFormat() const
         {
@@ -916,27 +965,43 @@ class SP_EXPORT MeshBuffer
         struct SBuffer
         {
             SBuffer() :
-                Reference   (0              ),
-                Validated   (false          ),
-                Usage       (HWBUFFER_STATIC)
+                Reference       (0              ),
+                Validated       (false          ),
+                Usage           (HWBUFFER_STATIC),
+                ValidRevision   (0              )
             {
             }
             SBuffer(const SBuffer &Other) :
-                Reference   (0              ),
-                RawBuffer   (Other.RawBuffer),
-                Validated   (false          ),
-                Usage       (Other.Usage    )
+                Reference       (0              ),
+                RawBuffer       (Other.RawBuffer),
+                Validated       (false          ),
+                Usage           (Other.Usage    ),
+                ValidRevision   (0              )
             {
             }
             ~SBuffer()
             {
             }
             
+            /* Functions */
+            inline bool isHWBufferShared() const
+            {
+                return SharedReference.use_count() > 1;
+            }
+            //! Returns true if the hardware buffer contains the current raw buffer.
+            inline bool isHWBufferValid() const
+            {
+                return Validated && ValidRevision == RawBuffer.getRevision();
+            }
+            
             /* Members */
             void* Reference;
             dim::UniversalBuffer RawBuffer;
             bool Validated;
             EHWBufferUsage Usage;
+            
+            boost::shared_ptr<void*> SharedReference;   //!< Hardware buffer reference which is shared between mesh buffer copies.
+            u32 ValidRevision;                          //!< Raw buffer revision of the last upload.
         };
         
         /* === Functions === */
@@ -957,6 +1022,9 @@ class SP_EXPORT MeshBuffer
         
         void checkIndexFormat(ERendererDataTypes &Format);
         
+        static void shareHWBuffer(SBuffer &Buffer, const SBuffer &Other);
+        static bool releaseHWBuffer(SBuffer &Buffer);
+        
         TextureLayerListType::iterator MeshBuffer::getTextureLayerIteration(const u8 Layer, bool SearchLayerIndex);
         
         /* === Inline functions === */
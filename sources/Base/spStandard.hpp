@@ -201,6 +201,7 @@
 #   define SP_COMPILE_WITH_SCENEGRAPH_SIMPLE
 #   define SP_COMPILE_WITH_SCENEGRAPH_SIMPLE_STREAM
 #   define SP_COMPILE_WITH_SCENEGRAPH_FAMILY_TREE
+#   define SP_COMPILE_WITH_SCENEGRAPH_SPATIAL
 
 #   define SP_COMPILE_WITH_WINMM
 #   define SP_COMPILE_WITH_OPENAL
@@ -221,6 +222,7 @@
 #   define SP_COMPILE_WITH_INPUTSERVICE
 #   define SP_COMPILE_WITH_MATRIXTEXTURE
 #   define SP_COMPILE_WITH_STORYBOARD
+#   define SP_COMPILE_WITH_STATICBATCHER
 #   define SP_COMPILE_WITH_TOKENSCANNER
 #   define SP_COMPILE_WITH_COMMANDLINE
 #   define SP_COMPILE_WITH_WEBPAGERENDERER
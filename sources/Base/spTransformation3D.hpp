@@ -38,7 +38,8 @@ template <typename T> class Transformation3D
         
         Transformation3D() :
             Scale_      (T(1)),
-            HasChanged_ (true)
+            HasChanged_ (true),
+            Revision_   (0   )
         {
         }
         Transformation3D(const dim::matrix4<T> &Matrix) :
@@ -46,7 +47,8 @@ template <typename T> class Transformation3D
             Rotation_   (Matrix.getRotationMatrix() ),
             Scale_      (Matrix.getScale()          ),
             Matrix_     (Matrix                     ),
-            HasChanged_ (false                      )
+            HasChanged_ (false                      ),
+            Revision_   (0                          )
         {
         }
         Transformation3D(
@@ -54,7 +56,8 @@ template <typename T> class Transformation3D
             Position_   (Position   ),
             Rotation_   (Rotation   ),
             Scale_      (Scale      ),
-            HasChanged_ (true       )
+            HasChanged_ (true       ),
+            Revision_   (0          )
         {
         }
         Transformation3D(const Transformation3D<T> &Other) :
@@ -62,7 +65,8 @@ template <typename T> class Transformation3D
             Rotation_   (Other.Rotation_    ),
             Scale_      (Other.Scale_       ),
             Matrix_     (Other.Matrix_      ),
-            HasChanged_ (Other.HasChanged_  )
+            HasChanged_ (Other.HasChanged_  ),
+            Revision_   (0                  )
         {
         }
         ~Transformation3D()
@@ -78,6 +82,7 @@ template <typename T> class Transformation3D
             Scale_      = Other.Scale_;
             Matrix_     = Other.Matrix_;
             HasChanged_ = Other.HasChanged_;
+            ++Revision_;
             return *this;
         }
         
@@ -128,6 +133,7 @@ template <typename T> class Transformation3D
             math::lerp(Scale_,      From.Scale_,    To.Scale_,      Interpolation);
             Rotation_.slerp(From.Rotation_, To.Rotation_, Interpolation);
             HasChanged_ = true;
+            ++Revision_;
         }
         
         //! Moves the transformation into the specified direction. This depends on the current rotation.
@@ -135,6 +141,7 @@ template <typename T> class Transformation3D
         {
             Position_ += (Rotation_.getMatrixTransposed() * Direction);
             HasChanged_ = true;
+            ++Revision_;
         }
         
         /**
@@ -148,6 +155,7 @@ template <typename T> class Transformation3D
             Mat.setRotation(RelativeRotation);
             Rotation_ *= dim::quaternion4<T>(Mat);
             HasChanged_ = true;
+            ++Revision_;
         }
         
         /**
@@ -167,6 +175,7 @@ template <typename T> class Transformation3D
             Rotation_ = RelativeRotation * Rotation_;
             
             HasChanged_ = true;
+            ++Revision_;
         }
         
         /* === Inline functions === */
@@ -176,6 +185,7 @@ template <typename T> class Transformation3D
         {
             Position_ = Position;
             HasChanged_ = true;
+            ++Revision_;
         }
         //! Returns the position vector.
         inline const dim::vector3d<T>& getPosition() const
@@ -188,6 +198,7 @@ template <typename T> class Transformation3D
         {
             Rotation_ = Rotation;
             HasChanged_ = true;
+            ++Revision_;
         }
         //! Returns the absolute rotation quaternion.
         inline const dim::quaternion4<T>& getRotation() const
@@ -205,6 +216,7 @@ template <typename T> class Transformation3D
         {
             Scale_ = Scale;
             HasChanged_ = true;
+            ++Revision_;
         }
         //! Returns the scaling vector. By default ( 1 | 1 | 1 ).
         inline const dim::vector3d<T>& getScale() const
@@ -217,12 +229,14 @@ template <typename T> class Transformation3D
         {
             Position_ += Direction;
             HasChanged_ = true;
+            ++Revision_;
         }
         //! Adds the specified size to the scaling vector.
         inline void transform(const dim::vector3d<T> &Size)
         {
             Scale_ += Size;
             HasChanged_ = true;
+            ++Revision_;
         }
         
         //! Transforms the given matrix by the current transformation.
@@ -247,10 +261,12 @@ template <typename T> class Transformation3D
         inline void setMatrixDirect(const dim::matrix4<T> &Matrix)
         {
             Matrix_ = Matrix;
+            ++Revision_;
         }
-        //! Returns a reference of the matrix transformation.
+        //! Returns a reference of the matrix transformation. The revision is incremented because the matrix may be modified.
         inline dim::matrix4<T>& getMatrixDirect()
         {
+            ++Revision_;
             return Matrix_;
         }
         //! Returns the matrix transformation directly.
@@ -265,6 +281,17 @@ template <typename T> class Transformation3D
             return Rotation_.getInverse() * upVector;
         }
         
+        /**
+        Returns the revision number of this transformation. It is incremented every time the transformation
+        is modified, so a cached world matrix only needs to be recomputed when this number has changed.
+        Copies of a transformation start with their own revision counter.
+        \since Version 3.3
+        */
+        inline u32 getRevision() const
+        {
+            return Revision_;
+        }
+        
     private:
         
         /* === Members === */
@@ -276,6 +303,8 @@ template <typename T> class Transformation3D
         mutable dim::matrix4<T> Matrix_;
         mutable bool HasChanged_;
         
+        u32 Revision_;
+        
 };
 
 
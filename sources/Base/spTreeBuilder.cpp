@@ -7,12 +7,26 @@
 
 #include "Base/spTreeBuilder.hpp"
 #include "SceneGraph/Collision/spCollisionMesh.hpp"
+#include "Base/spThreadManager.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spTimer.hpp"
 
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 
 
 namespace sp
 {
+
+
+/*
+ * Internal members
+ */
+
+extern io::OSInformator* GlbPlatformInfo;
+
 namespace scene
 {
 
@@ -20,13 +34,56 @@ namespace scene
 namespace TreeBuilder
 {
 
+/*
+ * Internal members
+ */
+
+//! Minimal count of triangles for a tree to be built with several threads.
+static const u32 PARALLEL_BUILD_MIN_TRIANGLES = 4096;
+
+//! Count of sub trees for each thread (more sub trees than threads balance the workload).
+static const u32 PARALLEL_BUILD_TASKS_PER_THREAD = 4;
+
+//! Global count of build threads (see "TreeBuilder::setThreadCount").
+static u32 BuildThreadCount = 0;
+
+
+/*
+ * Internal structures
+ */
+
+struct SKdTreeBuildTask
+{
+    SKdTreeBuildTask() :
+        Node        (0),
+        ForkLevel   (0)
+    {
+    }
+    
+    /* Members */
+    KDTreeNode* Node;
+    std::list<SCollisionFace*> Triangles;
+    s32 ForkLevel;
+};
+
+struct SKdTreeBuildThreadData
+{
+    std::vector<SKdTreeBuildTask>* Tasks;
+    u32* NextTask;
+    EKDTreeBuildingConcepts Concept;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+
 /*
  * Internal functions
  */
 
 static void buildKdTreeNode(
     KDTreeNode* Node, std::list<SCollisionFace*> &Triangles,
-    s32 ForkLevel, const EKDTreeBuildingConcepts Concept
+    s32 ForkLevel, const EKDTreeBuildingConcepts Concept,
+    std::vector<SKdTreeBuildTask>* TaskList = 0, s32 TaskLevel = 0
 );
 
 static void buildKdTreeNode_ALT(
@@ -66,17 +123,228 @@ static KDTreeNode* buildKdTree_ALT(
     const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept, bool PreTransform
 );
 
+static void processKdTreeBuildTasks(
+    std::vector<SKdTreeBuildTask> &Tasks, u32 &NextTask, const EKDTreeBuildingConcepts Concept, CriticalSection &Mutex)
+{
+    while (1)
+    {
+        /* Get next unprocessed sub tree */
+        Mutex.lock();
+        const u32 Index = NextTask++;
+        Mutex.unlock();
+        
+        if (Index >= Tasks.size())
+            break;
+        
+        /* Build the whole sub tree in this thread */
+        SKdTreeBuildTask& Task = Tasks[Index];
+        buildKdTreeNode(Task.Node, Task.Triangles, Task.ForkLevel, Concept);
+    }
+}
+
+THREAD_PROC(KdTreeBuildThreadProc)
+{
+    SKdTreeBuildThreadData* ThreadData = reinterpret_cast<SKdTreeBuildThreadData*>(Arguments);
+    
+    processKdTreeBuildTasks(*ThreadData->Tasks, *ThreadData->NextTask, ThreadData->Concept, *ThreadData->Mutex);
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+/**
+Builds the kd-Tree hierarchy for the specified root node. If several threads are used, the top levels
+are built in the calling thread and the remaining sub trees are distributed over all threads.
+*/
+static void buildKdTreeRootNode(
+    KDTreeNode* RootNode, std::list<SCollisionFace*> &Triangles, s32 ForkLevel, const EKDTreeBuildingConcepts Concept)
+{
+    /* Determine the count of threads */
+    u32 ThreadCount = BuildThreadCount;
+    
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    if (ThreadCount <= 1 || Triangles.size() < PARALLEL_BUILD_MIN_TRIANGLES)
+    {
+        buildKdTreeNode(RootNode, Triangles, ForkLevel, Concept);
+        return;
+    }
+    
+    /* Build the top levels and collect the remaining sub trees */
+    s32 TaskLevel = 0;
+    while ((1u << TaskLevel) < ThreadCount * PARALLEL_BUILD_TASKS_PER_THREAD)
+        ++TaskLevel;
+    
+    std::vector<SKdTreeBuildTask> Tasks;
+    Tasks.reserve(1u << TaskLevel);
+    
+    buildKdTreeNode(RootNode, Triangles, ForkLevel, Concept, &Tasks, TaskLevel);
+    
+    ThreadCount = math::Min(ThreadCount, static_cast<u32>(Tasks.size()));
+    
+    /* Start worker threads */
+    u32 NextTask = 0;
+    s32 NumRunningThreads = 0;
+    CriticalSection Mutex;
+    
+    std::vector<SKdTreeBuildThreadData> ThreadDataList(ThreadCount > 0 ? ThreadCount - 1 : 0);
+    
+    typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+    std::vector<ThreadManagerPtr> Threads;
+    
+    foreach (SKdTreeBuildThreadData &ThreadData, ThreadDataList)
+    {
+        ThreadData.Tasks                = (&Tasks);
+        ThreadData.NextTask             = (&NextTask);
+        ThreadData.Concept              = Concept;
+        ThreadData.NumRunningThreads    = (&NumRunningThreads);
+        ThreadData.Mutex                = (&Mutex);
+        
+        Mutex.lock();
+        ++NumRunningThreads;
+        Mutex.unlock();
+        
+        Threads.push_back(boost::make_shared<ThreadManager>(KdTreeBuildThreadProc, &ThreadData));
+    }
+    
+    /* Build sub trees in the calling thread as well */
+    processKdTreeBuildTasks(Tasks, NextTask, Concept, Mutex);
+    
+    /* Wait until all threads are finished */
+    while (1)
+    {
+        Mutex.lock();
+        const bool Finished = (NumRunningThreads <= 0);
+        Mutex.unlock();
+        
+        if (Finished)
+            break;
+        
+        io::Timer::yield();
+    }
+}
+
+static void finishBuildTime(u64 StartTime, const io::stringc &ProcName, u64* BuildTime = 0)
+{
+    const u64 Duration = io::Timer::millisecs() - StartTime;
+    
+    if (BuildTime)
+        *BuildTime = Duration;
+    
+    #ifdef SP_DEBUGMODE
+    io::Log::debug(ProcName, "Tree built in " + io::stringc(Duration) + " ms");
+    #endif
+}
+
+static inline const dim::triangle3df& getFaceTriangle(const SCollisionFace* Face)
+{
+    return Face->Triangle;
+}
+static inline const dim::triangle3df& getFaceTriangle(const SCollisionFace &Face)
+{
+    return Face.Triangle;
+}
+
+/**
+Searches the splitting plane with the lowest cost for the surface area heuristic (SAH).
+The candidate planes are distributed uniformly (binned SAH) and a triangle is assigned to a side
+in the same way as the kd-Tree builder does: near if any vertex is below the plane, far if any vertex is above or on the plane.
+\return False if splitting the node does not reduce the estimated cost, i.e. the node should be a leaf.
+\note This is used for both kd-Tree builders, so the face container is either a list of face pointers or a vector of faces.
+*/
+template <typename T> static bool findSAHSplit(
+    const dim::aabbox3df &BoundBox, const T &Triangles, EKDTreeAxles &Axis, f32 &Distance)
+{
+    static const s32 NUM_BINS           = 32;
+    static const f32 COST_TRAVERSAL     = 1.0f;
+    static const f32 COST_INTERSECTION  = 1.5f;
+    
+    const dim::vector3df BoxSize(BoundBox.getSize());
+    const f32 BoxArea = 2.0f * (BoxSize.X*BoxSize.Y + BoxSize.Y*BoxSize.Z + BoxSize.Z*BoxSize.X);
+    
+    if (BoxArea <= math::ROUNDING_ERROR)
+        return false;
+    
+    const f32 TriangleCount = static_cast<f32>(Triangles.size());
+    f32 BestCost = COST_INTERSECTION * TriangleCount;
+    bool Found = false;
+    
+    for (s32 i = 0; i < 3; ++i)
+    {
+        if (BoxSize[i] <= math::ROUNDING_ERROR)
+            continue;
+        
+        /* Fill bins with the triangle's minimal and maximal coordinates */
+        u32 MinBins[NUM_BINS] = { 0 }, MaxBins[NUM_BINS] = { 0 };
+        
+        const f32 BinFactor = static_cast<f32>(NUM_BINS) / BoxSize[i];
+        
+        for (typename T::const_iterator it = Triangles.begin(); it != Triangles.end(); ++it)
+        {
+            const dim::triangle3df& Tri = getFaceTriangle(*it);
+            
+            const f32 Min = math::Min(Tri.PointA[i], Tri.PointB[i], Tri.PointC[i]);
+            const f32 Max = math::Max(Tri.PointA[i], Tri.PointB[i], Tri.PointC[i]);
+            
+            ++MinBins[math::MinMax(static_cast<s32>((Min - BoundBox.Min[i]) * BinFactor), 0, NUM_BINS - 1)];
+            ++MaxBins[math::MinMax(static_cast<s32>((Max - BoundBox.Min[i]) * BinFactor), 0, NUM_BINS - 1)];
+        }
+        
+        /* Evaluate each plane between two bins */
+        const f32 AreaOrtho = BoxSize[(i + 1) % 3] * BoxSize[(i + 2) % 3];
+        const f32 AreaSide  = BoxSize[(i + 1) % 3] + BoxSize[(i + 2) % 3];
+        
+        u32 CountNear = 0, CountFar = static_cast<u32>(Triangles.size());
+        
+        for (s32 j = 1; j < NUM_BINS; ++j)
+        {
+            CountNear   += MinBins[j - 1];
+            CountFar    -= MaxBins[j - 1];
+            
+            const f32 SizeNear  = BoxSize[i] * static_cast<f32>(j) / static_cast<f32>(NUM_BINS);
+            const f32 SizeFar   = BoxSize[i] - SizeNear;
+            
+            const f32 AreaNear  = 2.0f * (AreaOrtho + SizeNear * AreaSide);
+            const f32 AreaFar   = 2.0f * (AreaOrtho + SizeFar * AreaSide);
+            
+            const f32 Cost = COST_TRAVERSAL + COST_INTERSECTION * (
+                AreaNear * static_cast<f32>(CountNear) + AreaFar * static_cast<f32>(CountFar)
+            ) / BoxArea;
+            
+            if (Cost < BestCost)
+            {
+                BestCost    = Cost;
+                Axis        = static_cast<EKDTreeAxles>(i);
+                Distance    = BoundBox.Min[i] + SizeNear;
+                Found       = true;
+            }
+        }
+    }
+    
+    return Found;
+}
+
 
 /*
  * Global functions
  */
 
 SP_EXPORT KDTreeNode* buildKdTree(
-    const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept, bool PreTransform)
+    const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept, bool PreTransform, u64* BuildTime)
 {
     #ifdef _DEB_NEW_KDTREE_
     
-    return buildKdTree_ALT(MeshList, MaxTreeLevel, Concept, PreTransform);
+    const u64 StartTime = io::Timer::millisecs();
+    KDTreeNode* RootNode = buildKdTree_ALT(MeshList, MaxTreeLevel, Concept, PreTransform);
+    
+    finishBuildTime(StartTime, "TreeBuilder::buildKdTree", BuildTime);
+    
+    return RootNode;
     
     #else
     
@@ -88,6 +356,8 @@ SP_EXPORT KDTreeNode* buildKdTree(
         return 0;
     }
     
+    const u64 StartTime = io::Timer::millisecs();
+    
     /* Get whole count of triangles and construct bounding box */
     u32 TriangleCount = 0;
     dim::aabbox3df BoundBox(dim::aabbox3df::OMEGA);
@@ -142,7 +412,9 @@ SP_EXPORT KDTreeNode* buildKdTree(
     foreach (SCollisionFace &Face, *TriangleList)
         SubTriangleList.push_back(&Face);
     
-    buildKdTreeNode(RootNode, SubTriangleList, MaxTreeLevel, Concept);
+    buildKdTreeRootNode(RootNode, SubTriangleList, MaxTreeLevel, Concept);
+    
+    finishBuildTime(StartTime, "TreeBuilder::buildKdTree", BuildTime);
     
     return RootNode;
     
@@ -243,25 +515,54 @@ SP_EXPORT OBBTreeNode* buildOBBTree(const std::list<dim::obbox3df> &BoxList)
     if (BoxList.empty())
         return 0;
     
+    const u64 StartTime = io::Timer::millisecs();
+    
     OBBTreeNode* RootNode = new OBBTreeNode(0, dim::obbox3df(-math::OMEGA, math::OMEGA));
     
     foreach (const dim::obbox3df &Box, BoxList)
         RootNode->insertBoundingBox(Box);
     
+    finishBuildTime(StartTime, "TreeBuilder::buildOBBTree");
+    
     return RootNode;
 }
 
+SP_EXPORT void setThreadCount(u32 Count)
+{
+    BuildThreadCount = Count;
+}
+
+SP_EXPORT u32 getThreadCount()
+{
+    return BuildThreadCount;
+}
+
 
 /*
  * Internal functions
  */
 
 static void buildKdTreeNode(
-    KDTreeNode* Node, std::list<SCollisionFace*> &Triangles, s32 ForkLevel, const EKDTreeBuildingConcepts Concept)
+    KDTreeNode* Node, std::list<SCollisionFace*> &Triangles, s32 ForkLevel, const EKDTreeBuildingConcepts Concept,
+    std::vector<SKdTreeBuildTask>* TaskList, s32 TaskLevel)
 {
     if (!Node || Triangles.empty())
         return;
     
+    /* Defer this sub tree to be built by one of the threads */
+    if (TaskList && TaskLevel <= 0 && ForkLevel > 0)
+    {
+        TaskList->push_back(SKdTreeBuildTask());
+        
+        SKdTreeBuildTask& Task = TaskList->back();
+        
+        Task.Node       = Node;
+        Task.ForkLevel  = ForkLevel;
+        Task.Triangles.swap(Triangles);
+        
+        return;
+    }
+    
     /* Check if tree node is a leaf */
     if (ForkLevel <= 0)
     {
@@ -283,6 +584,7 @@ static void buildKdTreeNode(
     
     /* Compute average vertex position */
     dim::vector3df AvgVertPos;
+    EKDTreeAxles Axis = KDTREE_XAXIS;
     
     switch (Concept)
     {
@@ -300,6 +602,22 @@ static void buildKdTreeNode(
             AvgVertPos /= dim::vector3df(static_cast<f32>(Triangles.size()));
         }
         break;
+        
+        case KDTREECONCEPT_SAH:
+        {
+            /* Make this node a leaf if splitting does not reduce the cost */
+            f32 Distance = 0.0f;
+            
+            if (!findSAHSplit(BoundBox, Triangles, Axis, Distance))
+            {
+                buildKdTreeNode(Node, Triangles, 0, Concept);
+                return;
+            }
+            
+            AvgVertPos = BoundBox.getCenter();
+            AvgVertPos[Axis] = Distance;
+        }
+        break;
     }
     
     /* Fill potentially sub triangle lists */
@@ -342,8 +660,6 @@ static void buildKdTreeNode(
     }
     
     /* Search for optimal tree partitioning */
-    EKDTreeAxles Axis = KDTREE_XAXIS;
-    
     switch (Concept)
     {
         case KDTREECONCEPT_CENTER:
@@ -359,6 +675,10 @@ static void buildKdTreeNode(
         }
         break;
         
+        case KDTREECONCEPT_SAH:
+            // Axis has already been determined
+            break;
+        
         case KDTREECONCEPT_AVERAGE:
         {
             const u32 ListSize[3] =
@@ -409,8 +729,8 @@ static void buildKdTreeNode(
     KDTreeNode* TreeNodeFar = static_cast<KDTreeNode*>(Node->getChildFar());
     
     /* Build next fork level */
-    buildKdTreeNode(TreeNodeNear, PotSubTrianglesNear[Axis], ForkLevel - 1, Concept);
-    buildKdTreeNode(TreeNodeFar, PotSubTrianglesFar[Axis], ForkLevel - 1, Concept);
+    buildKdTreeNode(TreeNodeNear, PotSubTrianglesNear[Axis], ForkLevel - 1, Concept, TaskList, TaskLevel - 1);
+    buildKdTreeNode(TreeNodeFar, PotSubTrianglesFar[Axis], ForkLevel - 1, Concept, TaskList, TaskLevel - 1);
 }
 
 static void buildKdTreeNodeLeaf_ALT(KDTreeNode* Node, const std::vector<SCollisionFace> &Faces)
@@ -446,6 +766,7 @@ static void buildKdTreeNode_ALT(
     
     /* Compute average vertex position */
     dim::vector3df AvgVertPos;
+    EKDTreeAxles Axis = KDTREE_XAXIS;
     
     switch (Concept)
     {
@@ -455,6 +776,22 @@ static void buildKdTreeNode_ALT(
         }
         break;
         
+        case KDTREECONCEPT_SAH:
+        {
+            /* Make this node a leaf if splitting does not reduce the cost */
+            f32 Distance = 0.0f;
+            
+            if (!findSAHSplit(BoundBox, Faces, Axis, Distance))
+            {
+                buildKdTreeNodeLeaf_ALT(Node, Faces);
+                return;
+            }
+            
+            AvgVertPos = BoundBox.getCenter();
+            AvgVertPos[Axis] = Distance;
+        }
+        break;
+        
         case KDTREECONCEPT_AVERAGE:
         {
             #if 0
@@ -510,10 +847,12 @@ static void buildKdTreeNode_ALT(
     }
     
     /* Search for optimal tree partitioning */
-    EKDTreeAxles Axis = KDTREE_XAXIS;
-    
     switch (Concept)
     {
+        case KDTREECONCEPT_SAH:
+            // Axis has already been determined
+            break;
+        
         case KDTREECONCEPT_CENTER:
         {
             const dim::vector3df BoxSize(BoundBox.getSize());
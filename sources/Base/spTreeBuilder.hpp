@@ -33,6 +33,7 @@ enum EKDTreeBuildingConcepts
 {
     KDTREECONCEPT_CENTER,   //!< Center will be used. This is similar to an OcTree.
     KDTREECONCEPT_AVERAGE,  //!< The average vertex position will be used to determine the next kd-Tree node construction.
+    KDTREECONCEPT_SAH,      //!< Surface area heuristic. The splitting plane with the lowest estimated intersection cost will be used. \since Version 3.3
 };
 
 
@@ -52,11 +53,13 @@ Builds a kd-Tree with scene::SCollisionFace data packets as user data.
 \param Concept: Specifies the concept of building the kd-Tree.
 \param PreTransform: Specifies whether the triangles are to be pre-transformed or not. i.e. the triangles
 will be transformed by the mesh matrices.
+\param BuildTime: Optional pointer which receives the time (in milliseconds) the tree building took.
+This time is also printed as debug message when the engine is compiled in debug mode. This parameter has been added in version 3.3.
 \return Pointer to the root tree node or 0 if the given meshes have no triangles.
 */
 SP_EXPORT KDTreeNode* buildKdTree(
     const std::list<Mesh*> &MeshList, u8 MaxTreeLevel = 12,
-    const EKDTreeBuildingConcepts Concept = KDTREECONCEPT_CENTER, bool PreTransform = true
+    const EKDTreeBuildingConcepts Concept = KDTREECONCEPT_CENTER, bool PreTransform = true, u64* BuildTime = 0
 );
 
 //! Builds a kd-Tree only for one mesh object.
@@ -69,6 +72,25 @@ SP_EXPORT QuadTreeNode* buildQuadTree(Mesh* Object, u8 MaxTreeLevel = 6);
 SP_EXPORT BSPTreeNode* buildBSPTree(Mesh* Object, u8 MaxTreeLevel = 12);
 SP_EXPORT OBBTreeNode* buildOBBTree(const std::list<dim::obbox3df> &BoxList);
 
+/**
+Sets the count of threads which are used to build the sub trees of a kd-Tree in parallel.
+The top levels of the tree are always built in the calling thread. The resulting tree
+is identical to the one of a single-threaded build. By default 0.
+\param[in] Count Specifies the count of threads. If 0 the count of processors will be used.
+If 1 the trees will be built single-threaded.
+\note This is a global setting for all trees and it is not thread-safe.
+Don't change it while a tree is being built in another thread.
+\since Version 3.3
+*/
+SP_EXPORT void setThreadCount(u32 Count);
+
+/**
+Returns the count of threads which are used to build the trees.
+\see setThreadCount
+\since Version 3.3
+*/
+SP_EXPORT u32 getThreadCount();
+
 } // /namespace TreeBuilder
 
 
@@ -73,6 +73,14 @@ void TreeNode::findLeafList(std::list<const TreeNode*> &TreeNodeList, const dim:
 {
     // do nothing
 }
+u32 TreeNode::findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line) const
+{
+    return 0; // do nothing
+}
+u32 TreeNode::findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line, f32 Radius) const
+{
+    return 0; // do nothing
+}
 
 const TreeNode* TreeNode::findLeafSub(const dim::vector3df &Point) const
 {
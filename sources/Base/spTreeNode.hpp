@@ -136,6 +136,24 @@ class SP_EXPORT TreeNode : public BaseObject
         */
         virtual void findLeafList(std::list<const TreeNode*> &TreeNodeList, const dim::line3df &Line, f32 Radius) const;
         
+        /**
+        Searches all leaf TreeNode objects which the specified line intersects without any memory allocation.
+        \param[out] TreeNodes Pointer to the array where the result will be stored.
+        \param[in] MaxCount Specifies the count of elements in the array.
+        \param[in] Line Specifies the line which is to be used for intersection tests.
+        \return Count of leaf nodes which have been found. If this is greater than "MaxCount"
+        only the first "MaxCount" leaf nodes have been stored.
+        \since Version 3.3
+        */
+        virtual u32 findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line) const;
+        
+        /**
+        Searches all leaf TreeNode objects which the specified volumetric line intersects without any memory allocation.
+        \see findLeafList(const TreeNode**, u32, const dim::line3df&)
+        \since Version 3.3
+        */
+        virtual u32 findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line, f32 Radius) const;
+        
         /**
         Used internally.
         \see findLeaf
@@ -100,6 +100,45 @@ void KDTreeNode::findLeafList(std::list<const TreeNode*> &TreeNodeList, const di
     }
 }
 
+u32 KDTreeNode::findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line) const
+{
+    if (!math::CollisionLibrary::checkLineBoxOverlap(Line, Box_))
+        return 0;
+    
+    if (ChildNear_)
+    {
+        const u32 Count = ChildNear_->findLeafList(TreeNodes, MaxCount, Line);
+        const u32 Stored = math::Min(Count, MaxCount);
+        return Count + ChildFar_->findLeafList(TreeNodes + Stored, MaxCount - Stored, Line);
+    }
+    
+    if (MaxCount > 0)
+        *TreeNodes = this;
+    
+    return 1;
+}
+
+u32 KDTreeNode::findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line, f32 Radius) const
+{
+    const dim::obbox3df ThisBox(Box_.Min, Box_.Max);
+    const dim::obbox3df LineBox(CollisionCapsule::getBoundBoxFromLine(Line, Radius));
+    
+    if (!math::CollisionLibrary::checkOBBoxOBBoxOverlap(ThisBox, LineBox))
+        return 0;
+    
+    if (ChildNear_)
+    {
+        const u32 Count = ChildNear_->findLeafList(TreeNodes, MaxCount, Line, Radius);
+        const u32 Stored = math::Min(Count, MaxCount);
+        return Count + ChildFar_->findLeafList(TreeNodes + Stored, MaxCount - Stored, Line, Radius);
+    }
+    
+    if (MaxCount > 0)
+        *TreeNodes = this;
+    
+    return 1;
+}
+
 const TreeNode* KDTreeNode::findLeafSub(const dim::vector3df &Point) const
 {
     if (ChildNear_)
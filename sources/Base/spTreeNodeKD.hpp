@@ -52,6 +52,8 @@ class SP_EXPORT KDTreeNode : public TreeNode
         void findLeafList(std::list<const TreeNode*> &TreeNodeList, const dim::vector3df &Point, f32 Radius) const;
         void findLeafList(std::list<const TreeNode*> &TreeNodeList, const dim::line3df &Line) const;
         void findLeafList(std::list<const TreeNode*> &TreeNodeList, const dim::line3df &Line, f32 Radius) const;
+        u32 findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line) const;
+        u32 findLeafList(const TreeNode** TreeNodes, u32 MaxCount, const dim::line3df &Line, f32 Radius) const;
         
         const TreeNode* findLeafSub(const dim::vector3df &Point) const;
         void findLeafListSub(std::list<const TreeNode*> &TreeNodeList, const dim::vector3df &Point, f32 Radius) const;
@@ -12,6 +12,12 @@
 
 #include "Platform/spSoftPixelDeviceOS.hpp"
 
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <map>
+
 
 namespace sp
 {
@@ -24,8 +30,12 @@ namespace scene
 
 
 s32 SceneLoaderBSP3::Tessellation_ = DEF_MESH_TESSELLATION;
+bool SceneLoaderBSP3::ClusterCulling_ = true;
 
-SceneLoaderBSP3::SceneLoaderBSP3() : SceneLoader()
+SceneLoaderBSP3::SceneLoaderBSP3() :
+    SceneLoader         (   ),
+    NumClusters_        (0  ),
+    ClusterVectorSize_  (0  )
 {
 }
 SceneLoaderBSP3::~SceneLoaderBSP3()
@@ -75,6 +85,15 @@ void SceneLoaderBSP3::setTessellation(s32 Tessellation)
     Tessellation_ = Tessellation;
 }
 
+void SceneLoaderBSP3::setClusterCulling(bool Enable)
+{
+    ClusterCulling_ = Enable;
+}
+bool SceneLoaderBSP3::getClusterCulling()
+{
+    return ClusterCulling_;
+}
+
 
 /*
  * ======= Private: ========
@@ -263,7 +282,8 @@ void SceneLoaderBSP3::readLumpNodes()
         /* Read the node data */
         File_->readBuffer(&ChunkData, sizeof(ChunkData));
         
-        /* ... */
+        /* Add the node to the list */
+        NodesList_.push_back(ChunkData);
         
     } // next chunk
     
@@ -288,7 +308,8 @@ void SceneLoaderBSP3::readLumpLeafs()
         /* Read the leaf data */
         File_->readBuffer(&ChunkData, sizeof(ChunkData));
         
-        /* ... */
+        /* Add the leaf to the list */
+        LeafsList_.push_back(ChunkData);
         
     } // next chunk
     
@@ -313,7 +334,8 @@ void SceneLoaderBSP3::readLumpLeafFaces()
         /* Read the leaf face data */
         Face = File_->readValue<s32>();
         
-        /* ... */
+        /* Add the leaf face to the list */
+        LeafFacesList_.push_back(Face);
         
     } // next chunk
     
@@ -655,6 +677,10 @@ void SceneLoaderBSP3::readLumpVisData()
     SVisDataBSP ChunkData;
     s32 VisDataSize;
     
+    /* Check if the map has visibility data */
+    if (Header_.DirEntries[BSP_LUMP_VISDATA].Length < static_cast<s32>(2 * sizeof(s32)))
+        return;
+    
     /* Set the offset */
     File_->setSeek(Header_.DirEntries[BSP_LUMP_VISDATA].Offset);
     
@@ -667,16 +693,19 @@ void SceneLoaderBSP3::readLumpVisData()
     /* Compute the visbility data size */
     VisDataSize = ChunkData.CountVectors * ChunkData.VectorSize;
     
-    /* Allocate enough visibility memory */
-    ChunkData.VisibilityData = new u8[VisDataSize];
-    
-    /* Read the visibility data */
-    File_->readBuffer(ChunkData.VisibilityData, VisDataSize);
+    if ( ChunkData.CountVectors <= 0 || ChunkData.VectorSize <= 0 ||
+         VisDataSize > Header_.DirEntries[BSP_LUMP_VISDATA].Length - static_cast<s32>(2 * sizeof(s32)) )
+    {
+        io::Log::warning("BSP (Quake III Arena) file has invalid visibility data");
+        return;
+    }
     
-    /* ... */
+    /* Read the visibility data and keep it for the cluster culling */
+    VisDataList_.resize(VisDataSize);
+    File_->readBuffer(&VisDataList_[0], VisDataSize);
     
-    /* Delete the visibility data */
-    delete [] ChunkData.VisibilityData;
+    NumClusters_        = ChunkData.CountVectors;
+    ClusterVectorSize_  = ChunkData.VectorSize;
     
 }
 
@@ -712,8 +741,15 @@ void SceneLoaderBSP3::buildModel()
         /* Determine which mesh must be used */
         Mesh_ = (TextureList_[it->Texture]->getFormat() == video::PIXELFORMAT_RGBA ? MeshTrans_ : MeshBase_);
         
-        /* Create a new surface */
-        Surface_= Mesh_->createMeshBuffer();
+        /* Create a new surface (with cluster culling the faces are merged in "buildClusterTree") */
+        if (ClusterCulling_)
+        {
+            Surface_ = new video::MeshBuffer(0, video::DATATYPE_UNSIGNED_INT);
+            FaceMeshList_.push_back(Mesh_);
+            FaceSurfaceList_.push_back(Surface_);
+        }
+        else
+            Surface_ = Mesh_->createMeshBuffer();
         
         /* Add the texture */
         Surface_->addTexture( TextureList_[it->Texture] );
@@ -868,8 +904,13 @@ void SceneLoaderBSP3::buildModel()
     } // next face
     
     /* Optimize the surfaces */
-    MeshBase_->mergeMeshBuffers();
-    MeshTrans_->mergeMeshBuffers();
+    if (ClusterCulling_)
+        buildClusterTree();
+    else
+    {
+        MeshBase_->mergeMeshBuffers();
+        MeshTrans_->mergeMeshBuffers();
+    }
     
     /* Update the model and build it finally */
     MeshBase_->updateMeshBuffer();
@@ -877,6 +918,107 @@ void SceneLoaderBSP3::buildModel()
     
 }
 
+void SceneLoaderBSP3::buildClusterTree()
+{
+    
+    /* Temporary variables */
+    typedef std::pair<video::Texture*, video::Texture*> TextureKey;
+    typedef std::pair<Mesh*, TextureKey> SurfaceKey;
+    
+    std::map<SurfaceKey, u32> SurfaceMap;
+    std::vector<video::MeshBuffer*> SurfaceList;
+    
+    const u32 FaceCount = FaceSurfaceList_.size();
+    
+    std::vector<u32> FaceSurface(FaceCount), FaceFirstIndex(FaceCount), FaceIndexCount(FaceCount);
+    
+    /* Merge the faces into one surface for each mesh, texture and light map (in the order of the faces) */
+    for (u32 i = 0; i < FaceCount; ++i)
+    {
+        video::MeshBuffer* Face = FaceSurfaceList_[i];
+        
+        const SurfaceKey Key(
+            FaceMeshList_[i], TextureKey(Face->getTexture(0), Face->getTextureCount() > 1 ? Face->getTexture(1) : 0)
+        );
+        
+        std::map<SurfaceKey, u32>::iterator it = SurfaceMap.find(Key);
+        
+        if (it == SurfaceMap.end())
+        {
+            /* Create a new surface for this group */
+            video::MeshBuffer* Surface = FaceMeshList_[i]->createMeshBuffer(0, video::DATATYPE_UNSIGNED_INT);
+            Surface->setTextureLayerList(Face->getTextureLayerList());
+            
+            it = SurfaceMap.insert(std::make_pair(Key, SurfaceList.size())).first;
+            SurfaceList.push_back(Surface);
+        }
+        
+        /* Append the face and store its index range */
+        video::MeshBuffer* Surface = SurfaceList[it->second];
+        
+        FaceSurface[i]      = it->second;
+        FaceFirstIndex[i]   = Surface->getIndexCount();
+        
+        Surface->insertMeshBuffer(*Face);
+        
+        FaceIndexCount[i]   = Surface->getIndexCount() - FaceFirstIndex[i];
+    }
+    
+    /* Delete the temporary face surfaces */
+    MemoryManager::deleteList(FaceSurfaceList_);
+    FaceMeshList_.clear();
+    
+    /* Create the cluster tree with the merged surfaces and the face ranges */
+    boost::shared_ptr<BSPClusterTree> ClusterTree = boost::make_shared<BSPClusterTree>();
+    
+    foreach (video::MeshBuffer* Surface, SurfaceList)
+        ClusterTree->addSurface(Surface);
+    
+    for (u32 i = 0; i < FaceCount; ++i)
+        ClusterTree->addFace(FaceSurface[i], FaceFirstIndex[i], FaceIndexCount[i]);
+    
+    /* Add the nodes with their planes transformed into the coordinate system of the mesh (Y and Z swapped, 1/64 scale) */
+    foreach (const SNodeBSP &Node, NodesList_)
+    {
+        dim::plane3df Plane;
+        
+        if (Node.Plane >= 0 && static_cast<u32>(Node.Plane) < PlaneList_.size())
+        {
+            const dim::plane3df& OrigPlane = PlaneList_[Node.Plane];
+            
+            Plane.Normal    = dim::vector3df(OrigPlane.Normal.X, OrigPlane.Normal.Z, OrigPlane.Normal.Y);
+            Plane.Distance  = OrigPlane.Distance / 64;
+        }
+        
+        ClusterTree->addNode(Plane, Node.Children[0], Node.Children[1]);
+    }
+    
+    /* Add the leafs */
+    std::vector<u32> LeafFaces;
+    
+    foreach (const SLeafBSP &Leaf, LeafsList_)
+    {
+        LeafFaces.clear();
+        
+        for (s32 i = 0; i < Leaf.CountLeafFaces; ++i)
+        {
+            const s32 Index = Leaf.LeafFace + i;
+            
+            if (Index >= 0 && static_cast<u32>(Index) < LeafFacesList_.size() && LeafFacesList_[Index] >= 0)
+                LeafFaces.push_back(static_cast<u32>(LeafFacesList_[Index]));
+        }
+        
+        ClusterTree->addLeaf(Leaf.Cluster, LeafFaces.empty() ? 0 : &LeafFaces[0], LeafFaces.size());
+    }
+    
+    ClusterTree->setVisibility(NumClusters_, ClusterVectorSize_, VisDataList_);
+    
+    /* Draw both meshes with the cluster tree (the callbacks keep the tree alive) */
+    MeshBase_->setRenderCallback(boost::bind(&BSPClusterTree::render, ClusterTree, _1, _2, _3));
+    MeshTrans_->setRenderCallback(boost::bind(&BSPClusterTree::render, ClusterTree, _1, _2, _3));
+    
+}
+
 void SceneLoaderBSP3::examineScript(std::vector<io::stringc> &ScriptData)
 {
     
@@ -19,6 +19,7 @@
 #include "Base/spDimension.hpp"
 #include "RenderSystem/spTextureBase.hpp"
 #include "FileFormats/Mesh/spMeshLoader.hpp"
+#include "SceneGraph/spSceneBSPClusterTree.hpp"
 
 #include <vector>
 
@@ -47,6 +48,16 @@ class SP_EXPORT SceneLoaderBSP3 : public SceneLoader
         */
         static void setTessellation(s32 Tessellation);
         
+        /**
+        Enables or disables the cluster culling for the loaded maps. If enabled, the leaf and cluster structure
+        and the visibility data are kept after loading (see "BSPClusterTree"), and only the faces of the clusters
+        which are visible from the camera's cluster are drawn. The faces are merged into one mesh buffer for each
+        texture and light map. By default enabled.
+        \since Version 3.3
+        */
+        static void setClusterCulling(bool Enable);
+        static bool getClusterCulling();
+        
     private:
         
         /* ===== Enumerations ===== */
@@ -268,6 +279,7 @@ class SP_EXPORT SceneLoaderBSP3 : public SceneLoader
         void createNewVertex(SVertexBSP &Vertex, SFaceBSP &Face);
         
         void buildModel();
+        void buildClusterTree();
         
         void examineScript(std::vector<io::stringc> &ScriptData);
         
@@ -287,7 +299,20 @@ class SP_EXPORT SceneLoaderBSP3 : public SceneLoader
         std::vector<SFaceBSP> FacesList_;
         std::vector<s32> MeshVertOffsetList_;
         
+        /* Lists for cluster culling */
+        std::vector<SNodeBSP> NodesList_;
+        std::vector<SLeafBSP> LeafsList_;
+        std::vector<s32> LeafFacesList_;
+        
+        s32 NumClusters_;
+        s32 ClusterVectorSize_;
+        std::vector<u8> VisDataList_;
+        
+        std::vector<Mesh*> FaceMeshList_;
+        std::vector<video::MeshBuffer*> FaceSurfaceList_;
+        
         static s32 Tessellation_;
+        static bool ClusterCulling_;
         
 };
 
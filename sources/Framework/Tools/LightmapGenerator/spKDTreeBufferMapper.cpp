@@ -30,11 +30,6 @@ namespace KDTreeBufferMapper
 {
 
 
-#ifdef _DEB_NEW_KDTREE_
-#   error 'KDTreeBufferMapper' currently incompatible with new kd-Tree data type
-#endif
-
-
 /*
  * Structures
  */
@@ -221,113 +216,74 @@ static bool copyTriangleList(
     return BufferTriangleList->setupBuffer<STriangleSR>(NumTriangles, &LocalBuffer[0]);
 }
 
-static bool copyTreeNodeListSub(
-    const scene::KDTreeNode* Node, std::vector<SKDTreeNodeSR> &NodeBuffer,
-    std::vector<u32> &IdBuffer, u32 &NodeIndex, u32 &IdIndex, const IdOffsetMapType &IdOffsetMap)
+static bool copyTreeNodeList(
+    const scene::CollisionMesh* CollisionObject, video::ShaderResource* BufferNodeList,
+    video::ShaderResource* BufferTriangleIdList, const IdOffsetMapType &IdOffsetMap)
 {
-    typedef scene::CollisionMesh::TreeNodeDataType* NodeDataPtr;
-    
     static const u32 ID_NONE = 0xFFFFFFFF;
     
-    /* Store tree node information in node buffer */
-    SKDTreeNodeSR& NodeEntry = NodeBuffer[NodeIndex];
+    /* Get linear kd-Tree which already has the final node layout */
+    const scene::LinearKDTree& LinearTree = CollisionObject->getLinearTree();
     
-    NodeEntry.Axis = static_cast<s32>(Node->getAxis());
-    NodeEntry.Distance = Node->getDistance();
+    const std::vector<scene::LinearKDTree::SNode>& Nodes = LinearTree.getNodeList();
+    const std::vector<u32>& TriangleIndices = LinearTree.getTriangleIndexList();
     
-    /* Increment node index for further buffer access */
-    ++NodeIndex;
+    /* Map each linear kd-Tree triangle to its triangle ID */
+    std::vector<u32> TriangleIdMap(LinearTree.getTriangleList().size());
     
-    if (Node->isLeaf())
+    for (u32 i = 0; i < TriangleIdMap.size(); ++i)
     {
-        /* Initialize children node IDs */
-        NodeEntry.ChildIds[0] = ID_NONE;
-        NodeEntry.ChildIds[1] = ID_NONE;
+        const scene::SCollisionFace* Face = LinearTree.getFace(i);
         
-        /* Get triangle information from tree node */
-        NodeDataPtr TriangleList = reinterpret_cast<NodeDataPtr>(Node->getUserData());
+        /* Find ID in offset map */
+        IdOffsetMapType::const_iterator it = IdOffsetMap.find(SIdOffsetKey(Face->Mesh, Face->Surface));
         
-        if (!TriangleList)
+        if (it == IdOffsetMap.end())
         {
-            /* Initialize triangle information */
-            NodeEntry.TriangleStart = 0;
-            NodeEntry.NumTriangles = 0;
-            return true;
+            /* Exit with error */
+            io::Log::error("ID offset map corrupted during kd-Tree insertion for shader resource");
+            return false;
         }
         
-        /* Store triangle information */
-        NodeEntry.TriangleStart = IdIndex;
-        NodeEntry.NumTriangles = TriangleList->size();
-        
-        /* Resize ID buffer for following triangle IDs */
-        IdBuffer.resize(IdBuffer.size() + TriangleList->size());
-        
-        /* Store ID for each triangle in the current tree node */
-        foreach (scene::SCollisionFace* Face, *TriangleList)
-        {
-            /* Find ID in offset map */
-            const SIdOffsetKey Key(Face->Mesh, Face->Surface);
-            IdOffsetMapType::const_iterator it = IdOffsetMap.find(Key);
-            
-            if (it == IdOffsetMap.end())
-            {
-                /* Exit with error */
-                io::Log::error("ID offset map corrupted during kd-Tree insertion for shader resource");
-                return false;
-            }
-            
-            /* Store triangle ID: start offset plus triangle index */
-            IdBuffer[IdIndex++] = it->second + Face->Index;
-        }
+        /* Store triangle ID: start offset plus triangle index */
+        TriangleIdMap[i] = it->second + Face->Index;
     }
-    else
+    
+    /* Create CPU buffers */
+    const u32 NumNodes = Nodes.size();
+    
+    std::vector<SKDTreeNodeSR> LocalNodeBuffer(NumNodes);
+    std::vector<u32> LocalIdBuffer(TriangleIndices.size());
+    
+    for (u32 i = 0; i < NumNodes; ++i)
     {
-        /* Initialize triangle information */
-        NodeEntry.TriangleStart = 0;
-        NodeEntry.NumTriangles = 0;
+        const scene::LinearKDTree::SNode& Node = Nodes[i];
+        SKDTreeNodeSR& NodeEntry = LocalNodeBuffer[i];
         
-        /* Traverse child nodes */
-        const scene::KDTreeNode* Children[2] =
+        if (Node.isLeaf())
         {
-            dynamic_cast<const scene::KDTreeNode*>(Node->getChildNear()),
-            dynamic_cast<const scene::KDTreeNode*>(Node->getChildFar())
-        };
-        
-        if (Children[0] != 0 && Children[1] != 0)
+            /* Store triangle information */
+            NodeEntry.Axis          = 0;
+            NodeEntry.Distance      = 0.0f;
+            NodeEntry.TriangleStart = Node.TriangleStart;
+            NodeEntry.NumTriangles  = Node.getTriangleCount();
+            NodeEntry.ChildIds[0]   = ID_NONE;
+            NodeEntry.ChildIds[1]   = ID_NONE;
+        }
+        else
         {
-            /* Store chilren node IDs */
-            NodeEntry.ChildIds[0] = NodeIndex;
-            if (!copyTreeNodeListSub(Children[0], NodeBuffer, IdBuffer, NodeIndex, IdIndex, IdOffsetMap))
-                return false;
-            
-            NodeEntry.ChildIds[1] = NodeIndex;
-            if (!copyTreeNodeListSub(Children[1], NodeBuffer, IdBuffer, NodeIndex, IdIndex, IdOffsetMap))
-                return false;
+            /* Store children node IDs (the near child always follows its parent) */
+            NodeEntry.Axis          = static_cast<s32>(Node.getAxis());
+            NodeEntry.Distance      = Node.Distance;
+            NodeEntry.TriangleStart = 0;
+            NodeEntry.NumTriangles  = 0;
+            NodeEntry.ChildIds[0]   = i + 1;
+            NodeEntry.ChildIds[1]   = Node.getChildFar();
         }
     }
     
-    return true;
-}
-
-static bool KDTreeBufferMapper::copyTreeNodeList(
-    const scene::CollisionMesh* CollisionObject, video::ShaderResource* BufferNodeList,
-    video::ShaderResource* BufferTriangleIdList, const IdOffsetMapType &IdOffsetMap)
-{
-    /* Get kd-Tree root node */
-    const scene::KDTreeNode* RootTreeNode = CollisionObject->getRootTreeNode();
-    
-    /* Create CPU buffers */
-    const u32 NumNodes = RootTreeNode->getNumChildren() + 1;
-    
-    std::vector<SKDTreeNodeSR> LocalNodeBuffer(NumNodes);
-    std::vector<u32> LocalIdBuffer;
-    
-    /* Fill the buffer recursive */
-    u32 NodeIndex = 0;
-    u32 IdIndex = 0;
-    
-    if (!copyTreeNodeListSub(RootTreeNode, LocalNodeBuffer, LocalIdBuffer, NodeIndex, IdIndex, IdOffsetMap))
-        return false;
+    for (u32 i = 0; i < TriangleIndices.size(); ++i)
+        LocalIdBuffer[i] = TriangleIdMap[TriangleIndices[i]];
     
     /* Commit buffers to GPU */
     if (LocalIdBuffer.empty())
@@ -311,60 +311,45 @@ void LightmapGenerator::createFacesLightmaps(SModel* Model)
 void LightmapGenerator::generateLightTexelsSingleThreaded(SLight* Light)
 {
     // kd-Tree relevant variables
-    std::list<const scene::TreeNode*> TreeNodeList;
-    scene::CollisionMesh::TreeNodeDataType* TreeNodeData = 0;
+    std::vector<u32> TriangleIndexList;
     
     std::map<STriangle*, bool> UsedTriangles;
     SModel* Obj = 0;
     
-    // Find each triangle using the kd-Tree
-    CollMesh_->getRootTreeNode()->findLeafList(
-        TreeNodeList, Light->Position, Light->FixedVolumetricRadius
-    );
+    // Find each triangle using the linear kd-Tree
+    const scene::LinearKDTree& LinearTree = CollMesh_->getLinearTree();
+    
+    LinearTree.findTriangles(Light->Position, Light->FixedVolumetricRadius, TriangleIndexList);
     
-    foreach (const scene::TreeNode* Node, TreeNodeList)
+    // Loop each triangle inside the light's volume
+    foreach (u32 TriangleIndex, TriangleIndexList)
     {
-        if (!Node->getUserData())
+        scene::SCollisionFace* Face = LinearTree.getFace(TriangleIndex);
+        
+        // Get model object
+        std::map<scene::Mesh*, SModel*>::iterator it = ModelMap_.find(Face->Mesh);
+        
+        if (it == ModelMap_.end())
             continue;
         
-        TreeNodeData = static_cast<scene::CollisionMesh::TreeNodeDataType*>(Node->getUserData());
+        Obj = it->second;
         
-        // Loop each tree-node's triangle
-        #ifndef _DEB_NEW_KDTREE_
-        foreach (scene::SCollisionFace* Face, *TreeNodeData)
-        #else
-        foreach (scene::SCollisionFace &NodeFace, *TreeNodeData)
-        #endif
+        // Get triangle object
+        STriangle* Triangle = (Obj->Triangles[Face->Surface])[Face->Index];
+        
+        if (UsedTriangles.find(Triangle) != UsedTriangles.end())
         {
-            #ifdef _DEB_NEW_KDTREE_
-            scene::SCollisionFace* Face = &NodeFace;
-            #endif
-            
-            // Get model object
-            std::map<scene::Mesh*, SModel*>::iterator it = ModelMap_.find(Face->Mesh);
-            
-            if (it == ModelMap_.end())
-                continue;
-            
-            Obj = it->second;
-            
-            // Get triangle object
-            STriangle* Triangle = (Obj->Triangles[Face->Surface])[Face->Index];
-            
-            if (UsedTriangles.find(Triangle) != UsedTriangles.end())
-            {
-                if (!LightmapGenerator::processRunning(0))
-                    throw std::exception();
-                continue;
-            }
-            UsedTriangles[Triangle] = true;
-            
-            if (!LightmapGenerator::processRunning())
+            if (!LightmapGenerator::processRunning(0))
                 throw std::exception();
-            
-            // Rasterize triangle
-            rasterizeTriangle(Light, *Triangle);
+            continue;
         }
+        UsedTriangles[Triangle] = true;
+        
+        if (!LightmapGenerator::processRunning())
+            throw std::exception();
+        
+        // Rasterize triangle
+        rasterizeTriangle(Light, *Triangle);
     }
     
     /*
@@ -426,52 +411,37 @@ THREAD_PROC(RasterizerThreadProc)
 void LightmapGenerator::generateLightTexelsMultiThreaded(SLight* Light)
 {
     // Find surrounding faces
-    std::list<const scene::TreeNode*> TreeNodeList;
-    scene::CollisionMesh::TreeNodeDataType* TreeNodeData = 0;
+    std::vector<u32> TriangleIndexList;
     
     std::map<STriangle*, bool> UsedTriangles;
     SModel* Obj = 0;
     
     std::list<STriangle*> SurroundingTriangleList;
     
-    // Find each triangle using the kd-Tree
-    CollMesh_->getRootTreeNode()->findLeafList(
-        TreeNodeList, Light->Position, Light->FixedVolumetricRadius
-    );
+    // Find each triangle using the linear kd-Tree
+    const scene::LinearKDTree& LinearTree = CollMesh_->getLinearTree();
     
-    foreach (const scene::TreeNode* Node, TreeNodeList)
+    LinearTree.findTriangles(Light->Position, Light->FixedVolumetricRadius, TriangleIndexList);
+    
+    foreach (u32 TriangleIndex, TriangleIndexList)
     {
-        if (!Node->getUserData())
+        scene::SCollisionFace* Face = LinearTree.getFace(TriangleIndex);
+        
+        // Get model object
+        std::map<scene::Mesh*, SModel*>::iterator it = ModelMap_.find(Face->Mesh);
+        
+        if (it == ModelMap_.end())
             continue;
         
-        TreeNodeData = static_cast<scene::CollisionMesh::TreeNodeDataType*>(Node->getUserData());
+        Obj = it->second;
         
-        #ifndef _DEB_NEW_KDTREE_
-        foreach (scene::SCollisionFace* Face, *TreeNodeData)
-        #else
-        foreach (scene::SCollisionFace &NodeFace, *TreeNodeData)
-        #endif
+        // Get triangle object
+        STriangle* Triangle = (Obj->Triangles[Face->Surface])[Face->Index];
+        
+        if (UsedTriangles.find(Triangle) == UsedTriangles.end())
         {
-            #ifdef _DEB_NEW_KDTREE_
-            scene::SCollisionFace* Face = &NodeFace;
-            #endif
-            
-            // Get model object
-            std::map<scene::Mesh*, SModel*>::iterator it = ModelMap_.find(Face->Mesh);
-            
-            if (it == ModelMap_.end())
-                continue;
-            
-            Obj = it->second;
-            
-            // Get triangle object
-            STriangle* Triangle = (Obj->Triangles[Face->Surface])[Face->Index];
-            
-            if (UsedTriangles.find(Triangle) == UsedTriangles.end())
-            {
-                SurroundingTriangleList.push_back(Triangle);
-                UsedTriangles[Triangle] = true;
-            }
+            SurroundingTriangleList.push_back(Triangle);
+            UsedTriangles[Triangle] = true;
         }
     }
     
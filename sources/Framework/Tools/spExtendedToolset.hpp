@@ -18,6 +18,7 @@
 #include "Framework/Tools/spToolTextureManipulator.hpp"
 #include "Framework/Tools/spToolParticleAnimator.hpp"
 #include "Framework/Tools/spToolPathFinder.hpp"
+#include "Framework/Tools/spToolStaticBatcher.hpp"
 #include "Framework/Tools/spUtilityDebugging.hpp"
 #include "Framework/Tools/spUtilityInputService.hpp"
 #include "Framework/Tools/spUtilityCommandLine.hpp"
@@ -0,0 +1,429 @@
+/*
+ * Static batcher file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "Framework/Tools/spToolStaticBatcher.hpp"
+
+#ifdef SP_COMPILE_WITH_STATICBATCHER
+
+
+#include "SceneGraph/spSceneGraph.hpp"
+#include "SceneGraph/spSceneMesh.hpp"
+
+#include <boost/foreach.hpp>
+
+
+namespace sp
+{
+
+extern scene::SceneGraph* GlbSceneGraph;
+
+namespace tool
+{
+
+
+/*
+ * SCellKey structure
+ */
+
+StaticBatcher::SCellKey::SCellKey(const dim::vector3di &Cell) :
+    X(Cell.X),
+    Y(Cell.Y),
+    Z(Cell.Z)
+{
+}
+
+bool StaticBatcher::SCellKey::operator < (const SCellKey &Other) const
+{
+    if (X != Other.X)
+        return X < Other.X;
+    if (Y != Other.Y)
+        return Y < Other.Y;
+    return Z < Other.Z;
+}
+
+
+/*
+ * StaticBatcher class
+ */
+
+StaticBatcher::StaticBatcher(f32 CellSize) :
+    CellSize_(CellSize)
+{
+}
+StaticBatcher::~StaticBatcher()
+{
+}
+
+bool StaticBatcher::addMesh(scene::Mesh* Obj)
+{
+    if (!Obj || !Obj->getMeshBufferCount() || SourceMap_.find(Obj) != SourceMap_.end())
+        return false;
+    
+    /* Only triangle lists can be merged */
+    foreach (video::MeshBuffer* Surface, Obj->getMeshBufferList())
+    {
+        if (Surface->getPrimitiveType() != video::PRIMITIVE_TRIANGLES)
+            return false;
+    }
+    
+    /* Add the new source mesh */
+    SSource Source;
+    {
+        Source.Mesh         = Obj;
+        Source.OrigVisible  = Obj->getVisible();
+        Source.Visible      = true;
+        Source.Removed      = false;
+        Source.Batched      = false;
+        Source.FirstRange   = 0;
+        Source.NumRanges    = 0;
+    }
+    SourceMap_[Obj] = Sources_.size();
+    Sources_.push_back(Source);
+    
+    return true;
+}
+
+void StaticBatcher::removeMesh(scene::Mesh* Obj)
+{
+    std::map<scene::Mesh*, u32>::iterator it = SourceMap_.find(Obj);
+    
+    if (it == SourceMap_.end())
+        return;
+    
+    SSource& Source = Sources_[it->second];
+    
+    /* Remove the index ranges with the next update and restore the mesh's visibility */
+    Source.Removed = true;
+    markDirty(Source);
+    
+    Obj->setVisible(Source.OrigVisible);
+    
+    SourceMap_.erase(it);
+}
+
+void StaticBatcher::build()
+{
+    if (CellSize_ <= 0.0f)
+    {
+        io::Log::error("Cell size for static batching must be greater than zero");
+        return;
+    }
+    
+    for (u32 i = 0; i < Sources_.size(); ++i)
+    {
+        SSource& Source = Sources_[i];
+        
+        if (Source.Batched || Source.Removed)
+            continue;
+        
+        scene::Mesh* Obj = Source.Mesh;
+        
+        /* Get the cell by the center of the global bounding box */
+        const dim::vector3df Center(Obj->getMeshBoundingBox(true).getCenter() / CellSize_);
+        
+        const SCellKey Key(dim::vector3di(
+            static_cast<s32>(floor(Center.X)),
+            static_cast<s32>(floor(Center.Y)),
+            static_cast<s32>(floor(Center.Z))
+        ));
+        
+        const u32 Batch = getBatch(Key, Obj);
+        
+        /* Merge the mesh buffers into the batch */
+        const dim::matrix4f Matrix(Obj->getTransformMatrix(true));
+        
+        Source.FirstRange = Ranges_.size();
+        
+        foreach (video::MeshBuffer* Surface, Obj->getMeshBufferList())
+        {
+            if (Surface->getVertexCount())
+                addSourceSurface(i, getSurface(Batch, Surface), Surface, Matrix);
+        }
+        
+        Source.NumRanges    = Ranges_.size() - Source.FirstRange;
+        Source.Batched      = true;
+        
+        /* The source mesh is now drawn by its batch */
+        Obj->setVisible(false);
+    }
+    
+    /* Upload all batch mesh buffers which received new vertices (including the previously built ones) */
+    foreach (SSurface &Surface, Surfaces_)
+    {
+        if (Surface.Modified)
+        {
+            /* Upload the vertex buffer and rebuild and upload the index buffer */
+            Surface.Surface->updateVertexBuffer();
+            rebuildSurface(Surface);
+            Surface.Modified = false;
+        }
+    }
+    
+    /* Update the bounding boxes of all batches for the frustum culling */
+    foreach (scene::Mesh* Batch, Batches_)
+    {
+        Batch->getBoundingVolume().setType(scene::BOUNDING_BOX);
+        Batch->getBoundingVolume().setBox(Batch->getMeshBoundingBox());
+    }
+    
+    update();
+}
+
+void StaticBatcher::setMeshVisible(scene::Mesh* Obj, bool Visible)
+{
+    std::map<scene::Mesh*, u32>::iterator it = SourceMap_.find(Obj);
+    
+    if (it != SourceMap_.end())
+    {
+        SSource& Source = Sources_[it->second];
+        
+        if (Source.Visible != Visible)
+        {
+            Source.Visible = Visible;
+            markDirty(Source);
+        }
+    }
+}
+
+bool StaticBatcher::getMeshVisible(scene::Mesh* Obj) const
+{
+    std::map<scene::Mesh*, u32>::const_iterator it = SourceMap_.find(Obj);
+    return it != SourceMap_.end() && Sources_[it->second].Visible;
+}
+
+void StaticBatcher::update()
+{
+    foreach (SSurface &Surface, Surfaces_)
+    {
+        if (Surface.Dirty)
+            rebuildSurface(Surface);
+    }
+}
+
+void StaticBatcher::clear()
+{
+    /* Delete the batch meshes */
+    foreach (scene::Mesh* Batch, Batches_)
+        GlbSceneGraph->deleteNode(Batch);
+    
+    /* Restore the visibility of the source meshes */
+    foreach (SSource &Source, Sources_)
+    {
+        if (Source.Batched && !Source.Removed)
+            Source.Mesh->setVisible(Source.OrigVisible);
+    }
+    
+    Batches_.clear();
+    BatchSurfaces_.clear();
+    BatchMap_.clear();
+    Sources_.clear();
+    SourceMap_.clear();
+    Ranges_.clear();
+    Surfaces_.clear();
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+u32 StaticBatcher::getBatch(const SCellKey &Key, scene::Mesh* Obj)
+{
+    /* Search a batch in this cell with the same material and shader */
+    std::pair<std::multimap<SCellKey, u32>::iterator, std::multimap<SCellKey, u32>::iterator> Range = BatchMap_.equal_range(Key);
+    
+    for (std::multimap<SCellKey, u32>::iterator it = Range.first; it != Range.second; ++it)
+    {
+        scene::Mesh* Batch = Batches_[it->second];
+        
+        if ( Batch->getShaderClass() == Obj->getShaderClass() &&
+             Batch->getMaterial()->compare(Obj->getMaterial()) )
+        {
+            return it->second;
+        }
+    }
+    
+    /* Create a new batch mesh */
+    scene::Mesh* Batch = GlbSceneGraph->createMesh();
+    
+    Batch->setName("Static Batch");
+    Batch->setMaterial(Obj->getMaterial());
+    Batch->setShaderClass(Obj->getShaderClass());
+    Batch->setOrder(Obj->getOrder());
+    
+    const u32 Index = Batches_.size();
+    
+    Batches_.push_back(Batch);
+    BatchSurfaces_.resize(Batches_.size());
+    BatchMap_.insert(std::make_pair(Key, Index));
+    
+    return Index;
+}
+
+u32 StaticBatcher::getSurface(u32 Batch, video::MeshBuffer* Source)
+{
+    /* Search a mesh buffer of this batch with the same vertex format and textures */
+    foreach (u32 i, BatchSurfaces_[Batch])
+    {
+        const SSurface& Surface = Surfaces_[i];
+        
+        if ( Surface.Surface->getVertexFormat() == Source->getVertexFormat() &&
+             compareTextures(Surface.Surface, Source) )
+        {
+            return i;
+        }
+    }
+    
+    /* Create a new mesh buffer with 32 bit indices */
+    video::MeshBuffer* NewSurface = Batches_[Batch]->createMeshBuffer(
+        Source->getVertexFormat(), video::DATATYPE_UNSIGNED_INT
+    );
+    
+    foreach (video::Texture* Tex, Source->getTextureList())
+        NewSurface->addTexture(Tex);
+    
+    SSurface Surface;
+    {
+        Surface.Surface = NewSurface;
+        Surface.Batch       = Batch;
+        Surface.Dirty       = true;
+        Surface.Modified    = false;
+    }
+    Surfaces_.push_back(Surface);
+    BatchSurfaces_[Batch].push_back(Surfaces_.size() - 1);
+    
+    return Surfaces_.size() - 1;
+}
+
+void StaticBatcher::addSourceSurface(u32 SourceIndex, u32 SurfaceIndex, video::MeshBuffer* Source, const dim::matrix4f &Matrix)
+{
+    SSurface& Surface = Surfaces_[SurfaceIndex];
+    video::MeshBuffer* Dest = Surface.Surface;
+    
+    /* Copy the vertices and transform them into world space */
+    const s32 FirstVertex = Dest->appendVertices(*Source);
+    
+    if (FirstVertex < 0)
+        return;
+    
+    const u32 NumVertices   = Source->getVertexCount();
+    const s32 Flags         = Dest->getVertexFormat()->getFlags();
+    
+    const dim::matrix4f NormalMatrix(Matrix.getInverse().getTransposed());
+    
+    for (u32 i = FirstVertex, n = FirstVertex + NumVertices; i < n; ++i)
+    {
+        Dest->setVertexCoord(i, Matrix * Dest->getVertexCoord(i));
+        
+        if (Flags & video::VERTEXFORMAT_NORMAL)
+            Dest->setVertexNormal(i, (NormalMatrix.getRotationMatrix() * Dest->getVertexNormal(i)).normalize());
+        if (Flags & video::VERTEXFORMAT_TANGENT)
+            Dest->setVertexTangent(i, (Matrix.getRotationMatrix() * Dest->getVertexTangent(i)).normalize());
+        if (Flags & video::VERTEXFORMAT_BINORMAL)
+            Dest->setVertexBinormal(i, (Matrix.getRotationMatrix() * Dest->getVertexBinormal(i)).normalize());
+    }
+    
+    /* Copy the indices (mirroring transformations flip the triangle winding) */
+    SRange Range;
+    {
+        Range.Surface       = SurfaceIndex;
+        Range.Source        = SourceIndex;
+        Range.FirstIndex    = Surface.Indices.size();
+        Range.NumIndices    = 0;
+    }
+    
+    const bool FlipWinding = (Matrix.determinant() < 0.0f);
+    
+    const u32 NumIndices = (Source->getIndexBufferEnable() ? Source->getIndexCount() : NumVertices);
+    
+    for (u32 i = 0; i + 2 < NumIndices; i += 3)
+    {
+        u32 Indices[3];
+        
+        for (u32 j = 0; j < 3; ++j)
+            Indices[j] = FirstVertex + (Source->getIndexBufferEnable() ? Source->getPrimitiveIndex(i + j) : i + j);
+        
+        if (FlipWinding)
+            std::swap(Indices[1], Indices[2]);
+        
+        Surface.Indices.push_back(Indices[0]);
+        Surface.Indices.push_back(Indices[1]);
+        Surface.Indices.push_back(Indices[2]);
+        
+        Range.NumIndices += 3;
+    }
+    
+    Surface.Ranges.push_back(Ranges_.size());
+    Surface.Dirty       = true;
+    Surface.Modified    = true;
+    
+    Ranges_.push_back(Range);
+}
+
+void StaticBatcher::markDirty(const SSource &Source)
+{
+    for (u32 i = 0; i < Source.NumRanges; ++i)
+        Surfaces_[Ranges_[Source.FirstRange + i].Surface].Dirty = true;
+}
+
+void StaticBatcher::rebuildSurface(SSurface &Surface)
+{
+    /* Count the indices of the visible source meshes */
+    u32 NumIndices = 0;
+    
+    foreach (u32 RangeIndex, Surface.Ranges)
+    {
+        const SRange& Range = Ranges_[RangeIndex];
+        const SSource& Source = Sources_[Range.Source];
+        
+        if (Source.Visible && !Source.Removed)
+            NumIndices += Range.NumIndices;
+    }
+    
+    /* Copy the indices of the visible source meshes into the index buffer */
+    Surface.Surface->clearIndices();
+    
+    if (NumIndices > 0)
+    {
+        Surface.Surface->addIndices(NumIndices);
+        
+        u32 Index = 0;
+        
+        foreach (u32 RangeIndex, Surface.Ranges)
+        {
+            const SRange& Range = Ranges_[RangeIndex];
+            const SSource& Source = Sources_[Range.Source];
+            
+            if (Source.Visible && !Source.Removed)
+            {
+                for (u32 i = 0; i < Range.NumIndices; ++i)
+                    Surface.Surface->setPrimitiveIndex(Index++, Surface.Indices[Range.FirstIndex + i]);
+            }
+        }
+        
+        Surface.Surface->updateIndexBuffer();
+    }
+    
+    Surface.Dirty = false;
+}
+
+bool StaticBatcher::compareTextures(const video::MeshBuffer* SurfaceA, const video::MeshBuffer* SurfaceB)
+{
+    return SurfaceA->getTextureList() == SurfaceB->getTextureList();
+}
+
+
+} // /namespace tool
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
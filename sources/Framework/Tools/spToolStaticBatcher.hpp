@@ -0,0 +1,213 @@
+/*
+ * Static batcher header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_TOOL_STATICBATCHER_H__
+#define __SP_TOOL_STATICBATCHER_H__
+
+
+#include "Base/spStandard.hpp"
+
+#ifdef SP_COMPILE_WITH_STATICBATCHER
+
+
+#include "Base/spDimension.hpp"
+
+#include <vector>
+#include <map>
+
+
+namespace sp
+{
+namespace video
+{
+    class MeshBuffer;
+}
+namespace scene
+{
+    class Mesh;
+}
+namespace tool
+{
+
+
+/**
+The static batcher merges static meshes into large pre-transformed meshes. The world is divided into cubic cells
+and all meshes of a cell which share the same material states and shader class are merged into one batch mesh,
+with one mesh buffer for each texture set and vertex format. So each cell needs only one draw call per material
+instead of one draw call per mesh. The meshes are assigned to the cells by the center of their global bounding box.
+Each batch keeps the index range of each source mesh, so single meshes can still be hidden or removed:
+only the index buffers of the affected batch mesh buffers are rebuilt (see "update").
+\code
+tool::StaticBatcher Batcher(25.0f);
+
+foreach (scene::Mesh* Prop, PropList)
+    Batcher.addMesh(Prop);
+
+Batcher.build();
+
+// Hide a single prop later
+Batcher.setMeshVisible(PropList.front(), false);
+Batcher.update();
+\endcode
+\note The source meshes are hidden after building the batches and must not be moved anymore.
+Only meshes whose mesh buffers consist of triangle lists can be batched.
+\since Version 3.3
+*/
+class SP_EXPORT StaticBatcher
+{
+    
+    public:
+        
+        StaticBatcher(f32 CellSize = 50.0f);
+        ~StaticBatcher();
+        
+        /* === Functions === */
+        
+        /**
+        Adds the specified mesh to the list of meshes which are to be batched with the next "build" call.
+        \return False if the mesh can not be batched (e.g. it has been added before or it contains mesh buffers
+        which are no triangle lists).
+        */
+        bool addMesh(scene::Mesh* Obj);
+        
+        /**
+        Removes the specified mesh from its batches and restores its previous visibility.
+        The batches are not rebuilt, only the mesh's indices are removed with the next "update" call.
+        */
+        void removeMesh(scene::Mesh* Obj);
+        
+        /**
+        Builds the batch meshes for all added meshes which are not yet batched and hides these source meshes.
+        Meshes which have been batched previously are not touched.
+        */
+        void build();
+        
+        /**
+        Shows or hides the specified mesh inside its batches. Call "update" to rebuild the affected index buffers.
+        \param[in] Obj Specifies the source mesh.
+        \param[in] Visible Specifies whether the mesh is to be visible or not.
+        */
+        void setMeshVisible(scene::Mesh* Obj, bool Visible);
+        //! Returns true if the specified mesh is visible inside its batches.
+        bool getMeshVisible(scene::Mesh* Obj) const;
+        
+        //! Rebuilds the index buffers of all batch mesh buffers whose source meshes have been hidden, shown or removed.
+        void update();
+        
+        //! Deletes all batch meshes and restores the visibility of all source meshes.
+        void clear();
+        
+        /* === Inline functions === */
+        
+        /**
+        Sets the size of the cubic cells. This is only used for the meshes which are batched with the next "build" call.
+        \param[in] CellSize Specifies the edge length of each cell. By default 50.0.
+        */
+        inline void setCellSize(f32 CellSize)
+        {
+            CellSize_ = CellSize;
+        }
+        inline f32 getCellSize() const
+        {
+            return CellSize_;
+        }
+        
+        //! Returns the list of all batch meshes.
+        inline const std::vector<scene::Mesh*>& getBatchList() const
+        {
+            return Batches_;
+        }
+        
+        //! Returns the count of source meshes (including the meshes which are not yet batched).
+        inline u32 getMeshCount() const
+        {
+            return SourceMap_.size();
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SCellKey
+        {
+            SCellKey(const dim::vector3di &Cell);
+            
+            bool operator < (const SCellKey &Other) const;
+            
+            s32 X, Y, Z;
+        };
+        
+        struct SSource
+        {
+            scene::Mesh* Mesh;
+            bool OrigVisible;       //!< Visibility of the source mesh before it was added.
+            bool Visible;           //!< Visibility inside the batches.
+            bool Removed;
+            bool Batched;
+            u32 FirstRange;
+            u32 NumRanges;
+        };
+        
+        struct SRange
+        {
+            u32 Surface;            //!< Index of the batch mesh buffer.
+            u32 Source;
+            u32 FirstIndex;         //!< First index in the complete index list of the batch mesh buffer.
+            u32 NumIndices;
+        };
+        
+        struct SSurface
+        {
+            video::MeshBuffer* Surface;
+            u32 Batch;
+            std::vector<u32> Indices;   //!< Complete index list of all source meshes.
+            std::vector<u32> Ranges;
+            bool Dirty;                 //!< The index buffer must be rebuilt.
+            bool Modified;              //!< Vertices have been appended since the last "build" call.
+        };
+        
+        /* === Functions === */
+        
+        u32 getBatch(const SCellKey &Key, scene::Mesh* Obj);
+        u32 getSurface(u32 Batch, video::MeshBuffer* Source);
+        
+        void addSourceSurface(u32 SourceIndex, u32 Surface, video::MeshBuffer* Source, const dim::matrix4f &Matrix);
+        
+        void markDirty(const SSource &Source);
+        void rebuildSurface(SSurface &Surface);
+        
+        static bool compareTextures(const video::MeshBuffer* SurfaceA, const video::MeshBuffer* SurfaceB);
+        
+        /* === Members === */
+        
+        f32 CellSize_;
+        
+        std::vector<scene::Mesh*> Batches_;
+        std::vector< std::vector<u32> > BatchSurfaces_;
+        std::multimap<SCellKey, u32> BatchMap_;
+        
+        std::vector<SSource> Sources_;
+        std::map<scene::Mesh*, u32> SourceMap_;
+        
+        std::vector<SRange> Ranges_;
+        std::vector<SSurface> Surfaces_;
+        
+};
+
+
+} // /namespace tool
+
+} // /namespace sp
+
+
+#endif
+
+#endif
+
+
+
+// ================================================================================
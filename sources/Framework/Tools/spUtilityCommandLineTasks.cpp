@@ -262,6 +262,14 @@ SP_EXPORT void cmdDrawCalls(CommandLineUI &Cmd)
     Cmd.confirm("Mesh Buffer Bindings: "    + io::stringc(video::RenderSystem::getNumMeshBufferBindings     ()));
     Cmd.confirm("Texture Layer Bindings: "  + io::stringc(video::RenderSystem::getNumTextureLayerBindings   ()));
     Cmd.confirm("Material Updates: "        + io::stringc(video::RenderSystem::getNumMaterialUpdates        ()));
+    
+    if (GlbSceneGraph && GlbSceneGraph->getInstancing())
+    {
+        const scene::InstanceBatcher& Batcher = GlbSceneGraph->getInstanceBatcher();
+        Cmd.confirm("Instanced Draw Calls: "        + io::stringc(Batcher.getNumDrawCalls       ()));
+        Cmd.confirm("Draw Calls Saved: "            + io::stringc(Batcher.getNumDrawCallsSaved  ()));
+        Cmd.confirm("Instanced Nodes: "             + io::stringc(Batcher.getNumInstancedNodes  ()));
+    }
     #else
     Cmd.error("Engine was not compiled with render-system queries");
     #endif
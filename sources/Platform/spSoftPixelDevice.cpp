@@ -185,6 +185,12 @@ scene::SceneGraph* SoftPixelDevice::createSceneGraph(const scene::ESceneGraphs T
             break;
         #endif
         
+        #ifdef SP_COMPILE_WITH_SCENEGRAPH_SPATIAL
+        case scene::SCENEGRAPH_SPATIAL:
+            NewSceneGraph = new scene::SceneGraphSpatial();
+            break;
+        #endif
+        
         default:
             io::Log::error("Specified scene graph is not supported or the engine was not compiled with it");
             return 0;
@@ -19,6 +19,7 @@
 #include "SceneGraph/spSceneGraphSimple.hpp"
 #include "SceneGraph/spSceneGraphSimpleStream.hpp"
 #include "SceneGraph/spSceneGraphFamilyTree.hpp"
+#include "SceneGraph/spSceneGraphSpatial.hpp"
 #include "SoundSystem/spSoundDevice.hpp"
 #include "Platform/spSoftPixelDeviceFlags.hpp"
 #include "Framework/Physics/spPhysicsSimulator.hpp"
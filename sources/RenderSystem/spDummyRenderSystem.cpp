@@ -21,7 +21,8 @@ namespace video
 
 
 DummyRenderSystem::DummyRenderSystem() :
-    RenderSystem(RENDERER_DUMMY)
+    RenderSystem        (RENDERER_DUMMY ),
+    InstancingSupport_  (false          )
 {
 }
 DummyRenderSystem::~DummyRenderSystem()
@@ -62,7 +63,8 @@ io::stringc DummyRenderSystem::getShaderVersion() const
 
 bool DummyRenderSystem::queryVideoSupport(const EVideoFeatureSupport Query) const
 {
-    return false;
+    /* Instancing is only "supported" on demand to profile the instance batching without a graphics device */
+    return Query == VIDEOSUPPORT_HARDWARE_INSTANCING && InstancingSupport_;
 }
 
 s32 DummyRenderSystem::getMultitexCount() const
@@ -155,11 +157,19 @@ void DummyRenderSystem::unbindMeshBuffer()
 }
 void DummyRenderSystem::drawMeshBufferPart(const MeshBuffer* Buffer, u32 StartOffset, u32 NumVertices)
 {
-    // dummy
+    /* Only count the draw calls */
+    #ifdef SP_COMPILE_WITH_RENDERSYS_QUERIES
+    if (Buffer && NumVertices > 0)
+        ++RenderSystem::NumDrawCalls_;
+    #endif
 }
 void DummyRenderSystem::drawMeshBuffer(const MeshBuffer* MeshBuffer)
 {
-    // dummy
+    /* Only count the draw calls */
+    #ifdef SP_COMPILE_WITH_RENDERSYS_QUERIES
+    if (MeshBuffer)
+        ++RenderSystem::NumDrawCalls_;
+    #endif
 }
 
 void DummyRenderSystem::setRenderState(const video::ERenderStates Type, s32 State)
@@ -94,11 +94,27 @@ class SP_EXPORT DummyRenderSystem : public RenderSystem
         
         void updateModelviewMatrix();
         
+        /* === Inline functions === */
+        
+        /**
+        Enables or disables the reported hardware instancing support. By default disabled.
+        Enable it to profile the instance batching ("SceneGraph::setInstancing") without a graphics device.
+        */
+        inline void setInstancingSupport(bool Enable)
+        {
+            InstancingSupport_ = Enable;
+        }
+        inline bool getInstancingSupport() const
+        {
+            return InstancingSupport_;
+        }
+        
     private:
         
         /* Members */
         
         s32 RenderStates_[16];
+        bool InstancingSupport_;
         
 };
 
@@ -69,20 +69,12 @@ CharacterController::~CharacterController()
 
 void CharacterController::update()
 {
-    /* Apply physics integration */
-    integrate(&CollModel_);
-    
-    if (StayOnGround_)
-        applyFriction();
-    
-    StayOnGround_ = false;
+    beginUpdate();
     
     /* Update collisions */
     CollModel_.updateCollisions();
     
-    /* Update movement change */
-    PrevPos_ = CurPos_;
-    CurPos_ = CollModel_.getPosition();
+    endUpdate();
 }
 
 void CharacterController::move(const dim::vector3df &Direction)
@@ -119,6 +111,29 @@ void CharacterController::setMaxStepHeight(f32 MaxHeight)
 }
 
 
+/*
+ * ======= Protected: =======
+ */
+
+void CharacterController::beginUpdate()
+{
+    /* Apply physics integration */
+    integrate(&CollModel_);
+    
+    if (StayOnGround_)
+        applyFriction();
+    
+    StayOnGround_ = false;
+}
+
+void CharacterController::endUpdate()
+{
+    /* Update movement change */
+    PrevPos_ = CurPos_;
+    CurPos_ = CollModel_.getPosition();
+}
+
+
 } // /namespace scene
 
 } // /namespace sp
@@ -52,6 +52,8 @@ class SP_EXPORT CharacterController : public BaseCollisionPhysicsObject, public
         
         /**
         Updates the character controller behaviour. This includes: gravity appliance.
+        To update many character controllers at once use "CollisionGraph::updateCharacterControllers".
+        \see CollisionGraph::updateCharacterControllers
         */
         virtual void update();
         
@@ -203,6 +205,8 @@ class SP_EXPORT CharacterController : public BaseCollisionPhysicsObject, public
         
         /* === Functions === */
         
+        void beginUpdate();
+        void endUpdate();
         
         /* === Members === */
         
@@ -215,6 +219,7 @@ class SP_EXPORT CharacterController : public BaseCollisionPhysicsObject, public
         
     private:
         
+        friend class CollisionGraph;
         friend bool ChCtrlCollisionMaterial(
             CollisionMaterial* Material, CollisionNode* Node,
             const CollisionNode* Rival, const SCollisionContact &Contact
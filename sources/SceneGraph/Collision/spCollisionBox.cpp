@@ -37,6 +37,12 @@ f32 CollisionBox::getMaxMovement() const
     return getBox().getMaxRadius().getMax();
 }
 
+bool CollisionBox::getBoundingBox(dim::aabbox3df &Box) const
+{
+    Box = CollisionNode::getTransformedBox(getTransformation(), Box_);
+    return true;
+}
+
 bool CollisionBox::checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const
 {
     /* Store transformations */
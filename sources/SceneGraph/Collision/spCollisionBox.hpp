@@ -37,6 +37,8 @@ class SP_EXPORT CollisionBox : public CollisionNode
         s32 getSupportFlags() const;
         f32 getMaxMovement() const;
         
+        bool getBoundingBox(dim::aabbox3df &Box) const;
+        
         bool checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const;
         bool checkIntersection(const dim::line3df &Line, bool ExcludeCorners = false) const;
         
@@ -34,6 +34,11 @@ s32 CollisionCapsule::getSupportFlags() const
     return COLLISIONSUPPORT_SPHERE | COLLISIONSUPPORT_CAPSULE | COLLISIONSUPPORT_BOX | COLLISIONSUPPORT_PLANE | COLLISIONSUPPORT_MESH;
 }
 
+s32 CollisionCapsule::getSweepSupportFlags() const
+{
+    return COLLISIONSUPPORT_SPHERE | COLLISIONSUPPORT_CAPSULE | COLLISIONSUPPORT_BOX | COLLISIONSUPPORT_PLANE | COLLISIONSUPPORT_MESH;
+}
+
 bool CollisionCapsule::checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const
 {
     dim::vector3df PointP, PointQ;
@@ -569,6 +574,195 @@ void CollisionCapsule::performCollisionResolvingToMesh(const CollisionMesh* Riva
     }
 }
 
+bool CollisionCapsule::sweepCollisionToSphere(const CollisionSphere* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::line3df CapsuleLine(getLine());
+    const dim::vector3df RivalPos(Rival->getPosition());
+    
+    /* Move the sphere in the opposite direction against this capsule */
+    if (math::CollisionLibrary::checkSweptSphereCapsuleIntersection(
+            RivalPos, Rival->getRadius(), -Direction, CapsuleLine, getRadius(), Contact.Time, Contact.Normal))
+    {
+        Contact.Normal  = -Contact.Normal;
+        Contact.Point   = RivalPos + Contact.Normal * Rival->getRadius();
+        return true;
+    }
+    
+    return false;
+}
+
+bool CollisionCapsule::sweepCollisionToCapsule(const CollisionCapsule* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::line3df CapsuleLine(getLine());
+    const dim::line3df RivalLine(Rival->getLine());
+    
+    /* Check if this object hits the other one during the movement */
+    if (math::CollisionLibrary::checkSweptCapsuleCapsuleIntersection(
+            CapsuleLine, getRadius(), Direction, RivalLine, Rival->getRadius(), Contact.Time, Contact.Normal))
+    {
+        const dim::vector3df Offset(Direction * Contact.Time);
+        dim::vector3df PointP, PointQ;
+        
+        math::CollisionLibrary::getLineLineDistanceSq(
+            dim::line3df(CapsuleLine.Start + Offset, CapsuleLine.End + Offset), RivalLine, PointP, PointQ
+        );
+        
+        Contact.Point = PointQ + Contact.Normal * Rival->getRadius();
+        
+        return true;
+    }
+    
+    return false;
+}
+
+bool CollisionCapsule::sweepCollisionToBox(const CollisionBox* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::matrix4f Mat(Rival->getTransformation().getPositionRotationMatrix());
+    const dim::matrix4f InvMat(Mat.getInverse());
+    
+    const dim::aabbox3df Box(Rival->getBox().getScaled(Rival->getScale()));
+    const dim::line3df CapsuleLine(getLine());
+    const dim::line3df CapsuleLineInv(
+        InvMat * CapsuleLine.Start, InvMat * CapsuleLine.End
+    );
+    
+    if (Box.isPointInside(CapsuleLineInv.Start) || Box.isPointInside(CapsuleLineInv.End))
+        return false;
+    
+    /* Check if this object hits the box during the movement (in the box's object space) */
+    const dim::vector3df DirectionInv(Mat.vecRotateInverse(Direction));
+    
+    if (math::CollisionLibrary::checkSweptCapsuleBoxIntersection(
+            CapsuleLineInv, getRadius(), DirectionInv, Box, Contact.Time, Contact.Normal))
+    {
+        const dim::vector3df Offset(DirectionInv * Contact.Time);
+        
+        const dim::line3df ClosestLine(math::CollisionLibrary::getClosestLine(
+            Box, dim::line3df(CapsuleLineInv.Start + Offset, CapsuleLineInv.End + Offset)
+        ));
+        
+        Contact.Normal  = Mat.vecRotate(Contact.Normal);
+        Contact.Point   = Mat * ClosestLine.Start;
+        
+        return true;
+    }
+    
+    return false;
+}
+
+bool CollisionCapsule::sweepCollisionToPlane(const CollisionPlane* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::line3df CapsuleLine(getLine());
+    const dim::plane3df RivalPlane(
+        Rival->getTransformation().getPositionRotationMatrix() * Rival->getPlane()
+    );
+    
+    /* Only the plane's front side is collidable */
+    const f32 DistA = RivalPlane.getPointDistance(CapsuleLine.Start);
+    const f32 DistB = RivalPlane.getPointDistance(CapsuleLine.End);
+    const f32 Movement = RivalPlane.Normal.dot(Direction);
+    
+    if (DistA <= 0.0f || DistB <= 0.0f || Movement >= 0.0f)
+        return false;
+    
+    /* Compute the time where the capsule's nearest end point touches the plane */
+    const dim::vector3df& NearestPoint = (DistA <= DistB ? CapsuleLine.Start : CapsuleLine.End);
+    
+    Contact.Time = math::Max(0.0f, (math::Min(DistA, DistB) - getRadius()) / (-Movement));
+    
+    if (Contact.Time > 1.0f)
+        return false;
+    
+    Contact.Normal  = RivalPlane.Normal;
+    Contact.Point   = NearestPoint + Direction * Contact.Time - Contact.Normal * getRadius();
+    
+    return true;
+}
+
+bool CollisionCapsule::sweepCollisionToMesh(const CollisionMesh* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Check if rival mesh has a tree-hierarchy */
+    KDTreeNode* RootTreeNode = Rival->getRootTreeNode();
+    
+    if (!RootTreeNode)
+        return false;
+    
+    /* Store transformation */
+    const video::EFaceTypes CollFace(Rival->getCollFace());
+    
+    const dim::matrix4f RivalMat(Rival->getTransformation());
+    const dim::matrix4f RivalMatInv(RivalMat.getInverse());
+    
+    const dim::line3df CapsuleLine(getLine());
+    const dim::line3df CapsuleLineInv(
+        RivalMatInv * CapsuleLine.Start, RivalMatInv * CapsuleLine.End
+    );
+    
+    /* The swept capsule is enclosed by a capsule around the movement of its center */
+    const dim::vector3df Center(CapsuleLine.getCenter());
+    const dim::line3df SweepLineInv(RivalMatInv * Center, RivalMatInv * (Center + Direction));
+    
+    const f32 SweepRadius = (
+        RivalMatInv.getScale() * (getRadius() + CapsuleLine.getDirection().getLength() * 0.5f)
+    ).getMax();
+    
+    bool Result = false;
+    f32 Time = 1.0f;
+    dim::vector3df Normal;
+    
+    /* Check swept collision with each unique triangle along the movement */
+    foreach (SCollisionFace* Face, gatherSweepFaces(RootTreeNode, SweepLineInv, SweepRadius))
+    {
+        /* Check for face-culling at the start position */
+        if (Face->isBackFaceCulling(CollFace, CapsuleLineInv))
+            continue;
+        
+        /* Make swept capsule-triangle collision test */
+        const dim::triangle3df Triangle(RivalMat * Face->Triangle);
+        
+        if (math::CollisionLibrary::checkSweptCapsuleTriangleIntersection(CapsuleLine, getRadius(), Direction, Triangle, Time, Normal) &&
+            Time < Contact.Time)
+        {
+            /* Store new first contact */
+            Contact.Time        = Time;
+            Contact.Normal      = Normal;
+            Contact.Triangle    = Triangle;
+            Contact.Face        = Face;
+            Result              = true;
+        }
+    }
+    
+    if (Result)
+    {
+        const dim::vector3df Offset(Direction * Contact.Time);
+        
+        Contact.Point = math::CollisionLibrary::getClosestLine(
+            Contact.Triangle, dim::line3df(CapsuleLine.Start + Offset, CapsuleLine.End + Offset)
+        ).Start;
+    }
+    
+    return Result;
+}
+
 bool CollisionCapsule::setupCollisionContact(
     const dim::vector3df &PointP, const dim::vector3df &PointQ,
     f32 MaxRadius, f32 RivalRadius, SCollisionContact &Contact) const
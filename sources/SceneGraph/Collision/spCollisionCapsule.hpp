@@ -35,6 +35,7 @@ class SP_EXPORT CollisionCapsule : public CollisionLineBased
         /* Functions */
         
         s32 getSupportFlags() const;
+        s32 getSweepSupportFlags() const;
         
         bool checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const;
         bool checkIntersection(const dim::line3df &Line, bool ExcludeCorners = false) const;
@@ -57,6 +58,12 @@ class SP_EXPORT CollisionCapsule : public CollisionLineBased
         void performCollisionResolvingToPlane   (const CollisionPlane*      Rival);
         void performCollisionResolvingToMesh    (const CollisionMesh*       Rival);
         
+        bool sweepCollisionToSphere (const CollisionSphere*     Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToCapsule(const CollisionCapsule*    Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToBox    (const CollisionBox*        Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToPlane  (const CollisionPlane*      Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToMesh   (const CollisionMesh*       Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        
         bool setupCollisionContact(
             const dim::vector3df &PointP, const dim::vector3df &PointQ,
             f32 MaxRadius, f32 RivalRadius, SCollisionContact &Contact
@@ -13,6 +13,8 @@
 #include "Base/spMeshBuffer.hpp"
 #include "SceneGraph/spSceneMesh.hpp"
 
+#include <boost/function.hpp>
+
 
 namespace sp
 {
@@ -35,6 +37,17 @@ class CollisionPlane;
 class CollisionMesh;
 
 
+/*
+ * Constants
+ */
+
+//! Maximal count of lines in a ray packet for batched intersection tests.
+static const u32 COLLISION_RAYPACKET_SIZE = 8;
+
+//! Default count of frames without any transformation change until a collision node falls asleep.
+static const u32 COLLISION_DEFAULT_SLEEP_FRAMES = 60;
+
+
 /*
  * Enumerations
  */
@@ -69,6 +82,13 @@ enum ECollisionFlags
         COLLISIONFLAG_PERMANENT_UPDATE,
 };
 
+//! Broadphase types for the collision graph.
+enum ECollisionBroadphases
+{
+    COLLISIONBROADPHASE_NONE,       //!< No broadphase. Each collision node is tested against all nodes of its rival materials.
+    COLLISIONBROADPHASE_AABBTREE,   //!< Dynamic AABB trees (separated for static and dynamic collision nodes). Only overlapping nodes are tested.
+};
+
 //! Flags for collision detection support to rival collision nodes.
 enum ECollisionSupportFlags
 {
@@ -195,6 +215,14 @@ struct SIntersectionContact : public SContactBase
     f32 DistanceSq;                 //!< Squared distance used for internal sorting.
 };
 
+/**
+The intersection visitor callback is used to process intersections without storing them in a container.
+\param[in] Contact Specifies the intersection contact.
+\return True if the search is to be continued. Otherwise false.
+\since Version 3.3
+*/
+typedef boost::function<bool (const SIntersectionContact &Contact)> IntersectionVisitorCallback;
+
 struct SCollisionContact : public SContactBase
 {
     SCollisionContact() :
@@ -212,6 +240,22 @@ struct SCollisionContact : public SContactBase
     }
 };
 
+//! Swept collision contact. \since Version 3.3
+struct SSweepContact : public SContactBase
+{
+    SSweepContact() :
+        SContactBase(       ),
+        Time        (1.0f   )
+    {
+    }
+    ~SSweepContact()
+    {
+    }
+    
+    /* Members */
+    f32 Time; //!< Time of impact. This is an interpolation factor on the movement in the range [0.0 .. 1.0].
+};
+
 
 } // /namespace scene
 
@@ -7,23 +7,162 @@
 
 #include "SceneGraph/Collision/spCollisionGraph.hpp"
 #include "Base/spMemoryManagement.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spTimer.hpp"
 
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/ref.hpp>
+#include <algorithm>
 
 
 namespace sp
 {
+
+
+/*
+ * Internal members
+ */
+
+extern io::OSInformator* GlbPlatformInfo;
+
 namespace scene
 {
 
 
+/*
+ * Internal structures
+ */
+
+//! Minimal count of lines for each thread in a batched intersection test.
+static const u32 RAYQUERY_MIN_BLOCK_SIZE = 256;
+
+struct SRayQueryThreadData
+{
+    const CollisionGraph* Graph;
+    const void* Query;
+    u32 Begin, End;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+//! Minimal count of character controllers for each thread in a batched update.
+static const u32 CHARACTER_MIN_BLOCK_SIZE = 16;
+
+struct SCharacterThreadData
+{
+    CollisionGraph* Graph;
+    const void* Batch;
+    u32 Begin, End;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+//! Entry for the sweep-and-prune test between character controllers.
+struct SCharacterSweepEntry
+{
+    f32 MinX;
+    u32 Index;
+};
+
+
+/*
+ * Internal functions
+ */
+
+THREAD_PROC(CollisionRayQueryThreadProc)
+{
+    SRayQueryThreadData* ThreadData = reinterpret_cast<SRayQueryThreadData*>(Arguments);
+    
+    /* Process the block of lines given to this thread */
+    ThreadData->Graph->processRayQueryBlock(
+        *static_cast<const CollisionGraph::SRayQuery*>(ThreadData->Query), ThreadData->Begin, ThreadData->End
+    );
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+THREAD_PROC(CollisionCharacterThreadProc)
+{
+    SCharacterThreadData* ThreadData = reinterpret_cast<SCharacterThreadData*>(Arguments);
+    
+    /* Process the block of character controllers given to this thread */
+    ThreadData->Graph->updateCharacterBlock(
+        *static_cast<const CollisionGraph::SCharacterBatch*>(ThreadData->Batch), ThreadData->Begin, ThreadData->End
+    );
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+static bool cmpCharacterSweepEntries(const SCharacterSweepEntry &EntryA, const SCharacterSweepEntry &EntryB)
+{
+    return EntryA.MinX < EntryB.MinX || ( EntryA.MinX == EntryB.MinX && EntryA.Index < EntryB.Index );
+}
+
+//! Inserts the intersection contacts of a collision node into a bounded and sorted contact array.
+struct SIntersectionInserter
+{
+    SIntersectionInserter(SIntersectionContact* InitContacts, u32 InitMaxCount) :
+        Contacts(InitContacts   ),
+        Count   (0              ),
+        MaxCount(InitMaxCount   )
+    {
+    }
+    
+    /* Operators */
+    bool operator () (const SIntersectionContact &Contact)
+    {
+        if (Count == MaxCount)
+        {
+            /* The contacts of a collision node are visited in sorted order, so all others are farther away */
+            if (Contact.DistanceSq >= Contacts[Count - 1].DistanceSq)
+                return false;
+            --Count;
+        }
+        
+        /* Insertion sort */
+        u32 i = Count++;
+        
+        for (; i > 0 && Contact.DistanceSq < Contacts[i - 1].DistanceSq; --i)
+            Contacts[i] = Contacts[i - 1];
+        
+        Contacts[i] = Contact;
+        
+        return true;
+    }
+    
+    /* Members */
+    SIntersectionContact* Contacts;
+    u32 Count;
+    u32 MaxCount;
+};
+
 static bool cmpIntersectionContacts(SIntersectionContact &ContactA, SIntersectionContact &ContactB)
 {
     return ContactA.DistanceSq < ContactB.DistanceSq;
 }
 
 CollisionGraph::CollisionGraph() :
-    RootTreeNode_(0)
+    RootTreeNode_           (0                              ),
+    Broadphase_             (COLLISIONBROADPHASE_AABBTREE   ),
+    RayQueryThreadCount_    (0                              ),
+    CharacterThreadCount_   (0                              ),
+    SleepFrameCount_        (COLLISION_DEFAULT_SLEEP_FRAMES ),
+    AwakeNodeCount_         (0                              ),
+    SleepingNodeCount_      (0                              ),
+    ResolvedNodeCount_      (0                              )
 {
 }
 CollisionGraph::~CollisionGraph()
@@ -49,7 +188,8 @@ void CollisionGraph::addCollisionNode(CollisionNode* Node)
 }
 void CollisionGraph::removeCollisionNode(CollisionNode* Node)
 {
-    MemoryManager::removeElement(CollNodes_, Node);
+    if (MemoryManager::removeElement(CollNodes_, Node))
+        removeBroadphaseProxy(Node);
 }
 
 CollisionSphere* CollisionGraph::createSphere(CollisionMaterial* Material, scene::SceneNode* Node, f32 Radius)
@@ -130,11 +270,12 @@ CollisionPlane* CollisionGraph::createPlane(CollisionMaterial* Material, scene::
     return 0;
 }
 
-CollisionMesh* CollisionGraph::createMesh(CollisionMaterial* Material, scene::Mesh* Mesh, u8 MaxTreeLevel)
+CollisionMesh* CollisionGraph::createMesh(
+    CollisionMaterial* Material, scene::Mesh* Mesh, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept)
 {
     try
     {
-        return addCollNode(new CollisionMesh(Material, Mesh, MaxTreeLevel));
+        return addCollNode(new CollisionMesh(Material, Mesh, MaxTreeLevel, Concept));
     }
     catch (const io::stringc &ErrorStr)
     {
@@ -143,11 +284,12 @@ CollisionMesh* CollisionGraph::createMesh(CollisionMaterial* Material, scene::Me
     return 0;
 }
 
-CollisionMesh* CollisionGraph::createMeshList(CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel)
+CollisionMesh* CollisionGraph::createMeshList(
+    CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept)
 {
     try
     {
-        return addCollNode(new CollisionMesh(Material, MeshList, MaxTreeLevel));
+        return addCollNode(new CollisionMesh(Material, MeshList, MaxTreeLevel, Concept));
     }
     catch (const io::stringc &ErrorStr)
     {
@@ -237,6 +379,93 @@ void CollisionGraph::findIntersections(
     CollisionGraph::sortContactList(Line.Start, ContactList);
 }
 
+u32 CollisionGraph::findIntersections(
+    const dim::line3df &Line, SIntersectionContact* Contacts, u32 MaxCount,
+    const IntersectionCriteriaCallback &CriteriaCallback) const
+{
+    if (!Contacts || !MaxCount)
+        return 0;
+    
+    /* The visitor only holds a reference to the inserter, so no memory will be allocated */
+    SIntersectionInserter Inserter(Contacts, MaxCount);
+    const IntersectionVisitorCallback Visitor(boost::ref(Inserter));
+    
+    dim::line3df ClippedLine(Line);
+    dim::aabbox3df Box;
+    
+    foreach (const CollisionNode* Node, CollNodes_)
+    {
+        if ( !( Node->getFlags() & COLLISIONFLAG_INTERSECTION ) || ( CriteriaCallback && !CriteriaCallback(Node) ) ||
+             ( Node->getBoundingBox(Box) && !math::CollisionLibrary::checkLineBoxOverlap(ClippedLine, Box) ) )
+        {
+            continue;
+        }
+        
+        Node->findIntersections(ClippedLine, Visitor);
+        
+        /* Clip the line at the farthest intersection when the array is full */
+        if (Inserter.Count == MaxCount)
+            ClippedLine.End = Contacts[MaxCount - 1].Point;
+    }
+    
+    return Inserter.Count;
+}
+
+void CollisionGraph::findIntersections(
+    const dim::line3df &Line, const IntersectionVisitorCallback &Visitor,
+    const IntersectionCriteriaCallback &CriteriaCallback) const
+{
+    if (!Visitor)
+        return;
+    
+    foreach (const CollisionNode* Node, CollNodes_)
+    {
+        if ( ( Node->getFlags() & COLLISIONFLAG_INTERSECTION ) && ( !CriteriaCallback || CriteriaCallback(Node) ) &&
+             !Node->findIntersections(Line, Visitor) )
+        {
+            break;
+        }
+    }
+}
+
+void CollisionGraph::findNearestIntersections(
+    const dim::line3df* Lines, u32 Count, SIntersectionContact* Contacts,
+    const IntersectionCriteriaCallback &CriteriaCallback) const
+{
+    if (!Lines || !Contacts || !Count)
+        return;
+    
+    SRayQuery Query;
+    {
+        Query.Lines             = Lines;
+        Query.Contacts          = Contacts;
+        Query.Results           = 0;
+        Query.ExcludeCorners    = false;
+    }
+    setupRayQuery(Query, CriteriaCallback);
+    
+    processRayQuery(Query, Count);
+}
+
+void CollisionGraph::checkIntersections(
+    const dim::line3df* Lines, u32 Count, bool* Results, bool ExcludeCorners,
+    const IntersectionCriteriaCallback &CriteriaCallback) const
+{
+    if (!Lines || !Results || !Count)
+        return;
+    
+    SRayQuery Query;
+    {
+        Query.Lines             = Lines;
+        Query.Contacts          = 0;
+        Query.Results           = Results;
+        Query.ExcludeCorners    = ExcludeCorners;
+    }
+    setupRayQuery(Query, CriteriaCallback);
+    
+    processRayQuery(Query, Count);
+}
+
 void CollisionGraph::updateScene()
 {
     if (RootTreeNode_)
@@ -253,17 +482,160 @@ void CollisionGraph::updateScene()
         }
         #endif
     }
+    else if (Broadphase_ == COLLISIONBROADPHASE_AABBTREE)
+        updateSceneBroadphase();
     else
     {
-        //!TODO! -> optimize for-loop againts none-resolving objects
-        //!TODO! -> distinguish between static and dynamic objects
-        
         /* Check all collision nodes for resolving */
+        ResolvedNodeCount_ = 0;
+        
         foreach (CollisionNode* Node, CollNodes_)
-            Node->updateCollisions();
+        {
+            if (Node->requireCollisionUpdate())
+            {
+                Node->performCollisionUpdate(0);
+                ++ResolvedNodeCount_;
+            }
+        }
+        
+        AwakeNodeCount_     = CollNodes_.size();
+        SleepingNodeCount_  = 0;
     }
 }
 
+void CollisionGraph::updateCharacterControllers()
+{
+    if (CharacterControllers_.empty())
+        return;
+    
+    /* Setup batch and defer the contact callbacks */
+    SCharacterBatch Batch;
+    
+    Batch.Controllers.assign(CharacterControllers_.begin(), CharacterControllers_.end());
+    Batch.Models.reserve(Batch.Controllers.size());
+    
+    foreach (CharacterController* Object, Batch.Controllers)
+    {
+        Object->getCollisionModel()->DeferContacts_ = true;
+        Batch.Models.push_back(Object->getCollisionModel());
+    }
+    
+    std::sort(Batch.Models.begin(), Batch.Models.end());
+    
+    /* Integrate each character controller and find its rivals on the calling thread (the broadphase is not thread safe) */
+    const u32 Count = Batch.Controllers.size();
+    
+    Batch.Rivals.resize(Count);
+    Batch.RequireUpdate.resize(Count, false);
+    
+    if (!RootTreeNode_ && Broadphase_ == COLLISIONBROADPHASE_AABBTREE)
+        updateBroadphaseProxies();
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        CharacterController* Object = Batch.Controllers[i];
+        CollisionCapsule* Model = Object->getCollisionModel();
+        
+        Object->beginUpdate();
+        
+        if (Model->requireCollisionUpdate())
+        {
+            findCharacterRivals(Model, Batch, Batch.Rivals[i]);
+            Batch.RequireUpdate[i] = true;
+        }
+    }
+    
+    /* Determine the count of threads */
+    u32 ThreadCount = CharacterThreadCount_;
+    
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Min(ThreadCount, (Count + CHARACTER_MIN_BLOCK_SIZE - 1) / CHARACTER_MIN_BLOCK_SIZE);
+    
+    if (ThreadCount <= 1)
+        updateCharacterBlock(Batch, 0, Count);
+    else
+    {
+        const u32 BlockSize = (Count + ThreadCount - 1) / ThreadCount;
+        
+        s32 NumRunningThreads = 0;
+        CriticalSection Mutex;
+        
+        std::vector<SCharacterThreadData> ThreadDataList(ThreadCount - 1);
+        
+        typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+        std::vector<ThreadManagerPtr> Threads;
+        
+        /* Start worker threads for all blocks except the first one */
+        for (u32 i = 0, Begin = BlockSize; i + 1 < ThreadCount && Begin < Count; ++i, Begin += BlockSize)
+        {
+            SCharacterThreadData& ThreadData = ThreadDataList[i];
+            
+            ThreadData.Graph                = this;
+            ThreadData.Batch                = (&Batch);
+            ThreadData.Begin                = Begin;
+            ThreadData.End                  = math::Min(Begin + BlockSize, Count);
+            ThreadData.NumRunningThreads    = (&NumRunningThreads);
+            ThreadData.Mutex                = (&Mutex);
+            
+            Mutex.lock();
+            ++NumRunningThreads;
+            Mutex.unlock();
+            
+            Threads.push_back(boost::make_shared<ThreadManager>(CollisionCharacterThreadProc, &ThreadData));
+        }
+        
+        /* Process the first block in the calling thread */
+        updateCharacterBlock(Batch, 0, BlockSize);
+        
+        /* Wait until all threads are finished */
+        while (1)
+        {
+            Mutex.lock();
+            const bool Finished = (NumRunningThreads <= 0);
+            Mutex.unlock();
+            
+            if (Finished)
+                break;
+            
+            io::Timer::yield();
+        }
+    }
+    
+    /* Resolve the character controllers against each other */
+    resolveCharacterControllers(Batch);
+    
+    /* Deliver the contact callbacks on the calling thread */
+    foreach (CharacterController* Object, Batch.Controllers)
+    {
+        Object->getCollisionModel()->DeferContacts_ = false;
+        Object->getCollisionModel()->flushContacts();
+    }
+}
+
+void CollisionGraph::setBroadphase(const ECollisionBroadphases Type)
+{
+    if (Broadphase_ != Type)
+    {
+        Broadphase_ = Type;
+        clearBroadphase();
+    }
+}
+
+void CollisionGraph::setSleepFrameCount(u32 Count)
+{
+    SleepFrameCount_ = Count;
+    if (!SleepFrameCount_)
+        wakeUpNodes();
+}
+
+void CollisionGraph::wakeUpNodes()
+{
+    foreach (CollisionNode* Node, CollNodes_)
+        Node->wakeUp();
+}
+
 void CollisionGraph::sortContactList(const dim::vector3df &LineStart, std::list<SIntersectionContact> &ContactList)
 {
     /* Store squared distance for each contact */
@@ -310,6 +682,486 @@ void CollisionGraph::findIntersectionsUnidirectional(
     }
 }
 
+void CollisionGraph::updateSceneBroadphase()
+{
+    updateBroadphaseProxies();
+    
+    /* Perform collision resolving only with the rival candidates */
+    dim::aabbox3df Box;
+    
+    AwakeNodeCount_     = 0;
+    SleepingNodeCount_  = 0;
+    ResolvedNodeCount_  = 0;
+    
+    foreach (CollisionNode* Node, CollNodes_)
+    {
+        if (Node->isSleeping())
+        {
+            ++SleepingNodeCount_;
+            continue;
+        }
+        
+        ++AwakeNodeCount_;
+        
+        if (Node->requireCollisionUpdate())
+        {
+            ++ResolvedNodeCount_;
+            
+            if (Node->ProxyTree_)
+            {
+                findRivalCandidates(Node, RivalCandidates_);
+                Node->performCollisionUpdate(&RivalCandidates_);
+                
+                /* Refit proxy after the node has been resolved */
+                if (Node->getBoundingBox(Box))
+                    Node->ProxyTree_->moveProxy(Node->ProxyID_, Box);
+            }
+            else
+                Node->performCollisionUpdate(0);
+        }
+        else if (Node->HasMoved_ && Node->ProxyTree_)
+        {
+            /* Wake up all dynamic nodes this node has been moved into */
+            getSweptBoundingBox(Node, Box);
+            
+            BroadphaseQuery_.clear();
+            DynamicTree_.findOverlaps(Box, BroadphaseQuery_);
+            
+            wakeUpDynamicNodes(Node, 0);
+        }
+        
+        Node->updateSleepState(SleepFrameCount_);
+    }
+}
+
+void CollisionGraph::updateBroadphaseProxies()
+{
+    /* Update the broadphase proxies of all collision nodes (the proxies of sleeping nodes have not been changed) */
+    UnboundedNodes_.clear();
+    
+    foreach (CollisionNode* Node, CollNodes_)
+    {
+        if (!Node->isSleeping() || !Node->ProxyTree_)
+            updateBroadphaseProxy(Node);
+    }
+    foreach (CharacterController* Object, CharacterControllers_)
+        updateBroadphaseProxy(Object->getCollisionModel());
+}
+
+void CollisionGraph::updateBroadphaseProxy(CollisionNode* Node)
+{
+    dim::aabbox3df Box;
+    
+    if (!Node->getBoundingBox(Box))
+    {
+        /* Unbounded nodes are always passed to the narrow phase */
+        removeBroadphaseProxy(Node);
+        UnboundedNodes_.push_back(Node);
+        return;
+    }
+    
+    /* Nodes which perform collision detection themselves are dynamic */
+    const bool isDynamic = (
+        (Node->getFlags() & COLLISIONFLAG_DETECTION) != 0 && Node->getSupportFlags() != COLLISIONSUPPORT_NONE
+    );
+    
+    DynamicAABBTree* Tree = (isDynamic ? &DynamicTree_ : &StaticTree_);
+    
+    if (Node->ProxyTree_ != Tree)
+    {
+        /* Create new proxy (or move it to the other tree) */
+        removeBroadphaseProxy(Node);
+        Node->ProxyID_      = Tree->createProxy(Box, Node);
+        Node->ProxyTree_    = Tree;
+    }
+    else
+        Tree->moveProxy(Node->ProxyID_, Box);
+}
+
+void CollisionGraph::removeBroadphaseProxy(CollisionNode* Node)
+{
+    if (Node->ProxyTree_)
+    {
+        Node->ProxyTree_->destroyProxy(Node->ProxyID_);
+        Node->ProxyTree_    = 0;
+        Node->ProxyID_      = -1;
+    }
+}
+
+void CollisionGraph::clearBroadphase()
+{
+    wakeUpNodes();
+    
+    foreach (CollisionNode* Node, CollNodes_)
+        removeBroadphaseProxy(Node);
+    foreach (CharacterController* Object, CharacterControllers_)
+        removeBroadphaseProxy(Object->getCollisionModel());
+    
+    StaticTree_.clear();
+    DynamicTree_.clear();
+    UnboundedNodes_.clear();
+}
+
+void CollisionGraph::findRivalCandidates(CollisionNode* Node, std::vector<CollisionNode*> &RivalList)
+{
+    RivalList.clear();
+    
+    /* Get the swept bounding box from the previous to the current position */
+    dim::aabbox3df Box;
+    getSweptBoundingBox(Node, Box);
+    
+    /* Find all overlapping proxies */
+    BroadphaseQuery_.clear();
+    
+    StaticTree_.findOverlaps(Box, BroadphaseQuery_);
+    
+    const u32 FirstDynamicIndex = BroadphaseQuery_.size();
+    DynamicTree_.findOverlaps(Box, BroadphaseQuery_);
+    
+    /* Wake up all dynamic nodes this node has been moved into */
+    if (Node->HasMoved_)
+        wakeUpDynamicNodes(Node, FirstDynamicIndex);
+    
+    /* Keep the candidates in the order of the rival materials */
+    foreach (CollisionMaterial* RivalMaterial, Node->getMaterial()->getRivalList())
+    {
+        foreach (void* UserData, BroadphaseQuery_)
+        {
+            CollisionNode* Rival = static_cast<CollisionNode*>(UserData);
+            if (Rival != Node && Rival->getMaterial() == RivalMaterial)
+                RivalList.push_back(Rival);
+        }
+        foreach (CollisionNode* Rival, UnboundedNodes_)
+        {
+            if (Rival != Node && Rival->getMaterial() == RivalMaterial)
+                RivalList.push_back(Rival);
+        }
+    }
+}
+
+void CollisionGraph::getSweptBoundingBox(const CollisionNode* Node, dim::aabbox3df &Box) const
+{
+    Node->getBoundingBox(Box);
+    
+    const dim::vector3df Movement(Node->getPrevPosition() - Node->getNodePosition());
+    Box.insertBox(dim::aabbox3df(Box.Min + Movement, Box.Max + Movement));
+}
+
+void CollisionGraph::wakeUpDynamicNodes(const CollisionNode* Node, u32 FirstQueryIndex)
+{
+    for (u32 i = FirstQueryIndex; i < BroadphaseQuery_.size(); ++i)
+    {
+        CollisionNode* Other = static_cast<CollisionNode*>(BroadphaseQuery_[i]);
+        if (Other != Node)
+            Other->wakeUp();
+    }
+}
+
+
+void CollisionGraph::setupRayQuery(SRayQuery &Query, const IntersectionCriteriaCallback &CriteriaCallback) const
+{
+    /* Store all collision nodes which are to be tested, so that the worker threads don't need the criteria callback */
+    Query.Nodes.reserve(CollNodes_.size());
+    
+    SRayQueryNode QueryNode;
+    
+    foreach (const CollisionNode* Node, CollNodes_)
+    {
+        if ( !( Node->getFlags() & COLLISIONFLAG_INTERSECTION ) || ( CriteriaCallback && !CriteriaCallback(Node) ) )
+            continue;
+        
+        QueryNode.Node      = Node;
+        QueryNode.Mesh      = (Node->getType() == COLLISION_MESH ? static_cast<const CollisionMesh*>(Node) : 0);
+        QueryNode.IsBounded = Node->getBoundingBox(QueryNode.Box);
+        
+        Query.Nodes.push_back(QueryNode);
+    }
+}
+
+void CollisionGraph::processRayQuery(const SRayQuery &Query, u32 Count) const
+{
+    /* Determine the count of threads */
+    u32 ThreadCount = RayQueryThreadCount_;
+    
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Min(ThreadCount, (Count + RAYQUERY_MIN_BLOCK_SIZE - 1) / RAYQUERY_MIN_BLOCK_SIZE);
+    
+    if (ThreadCount <= 1 || Query.Nodes.empty())
+    {
+        processRayQueryBlock(Query, 0, Count);
+        return;
+    }
+    
+    /* Split the batch into blocks of whole ray packets */
+    u32 BlockSize = (Count + ThreadCount - 1) / ThreadCount;
+    BlockSize = ((BlockSize + COLLISION_RAYPACKET_SIZE - 1) / COLLISION_RAYPACKET_SIZE) * COLLISION_RAYPACKET_SIZE;
+    
+    s32 NumRunningThreads = 0;
+    CriticalSection Mutex;
+    
+    std::vector<SRayQueryThreadData> ThreadDataList(ThreadCount - 1);
+    
+    typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+    std::vector<ThreadManagerPtr> Threads;
+    
+    /* Start worker threads for all blocks except the first one */
+    for (u32 i = 0, Begin = BlockSize; i + 1 < ThreadCount && Begin < Count; ++i, Begin += BlockSize)
+    {
+        SRayQueryThreadData& ThreadData = ThreadDataList[i];
+        
+        ThreadData.Graph                = this;
+        ThreadData.Query                = (&Query);
+        ThreadData.Begin                = Begin;
+        ThreadData.End                  = math::Min(Begin + BlockSize, Count);
+        ThreadData.NumRunningThreads    = (&NumRunningThreads);
+        ThreadData.Mutex                = (&Mutex);
+        
+        Mutex.lock();
+        ++NumRunningThreads;
+        Mutex.unlock();
+        
+        Threads.push_back(boost::make_shared<ThreadManager>(CollisionRayQueryThreadProc, &ThreadData));
+    }
+    
+    /* Process the first block in the calling thread */
+    processRayQueryBlock(Query, 0, math::Min(BlockSize, Count));
+    
+    /* Wait until all threads are finished */
+    while (1)
+    {
+        Mutex.lock();
+        const bool Finished = (NumRunningThreads <= 0);
+        Mutex.unlock();
+        
+        if (Finished)
+            break;
+        
+        io::Timer::yield();
+    }
+}
+
+void CollisionGraph::processRayQueryBlock(const SRayQuery &Query, u32 Begin, u32 End) const
+{
+    dim::line3df PacketLines[COLLISION_RAYPACKET_SIZE];
+    dim::aabbox3df PacketBox;
+    SIntersectionContact Contact;
+    
+    for (u32 i = Begin; i < End; i += COLLISION_RAYPACKET_SIZE)
+    {
+        const u32 Count = math::Min(End - i, COLLISION_RAYPACKET_SIZE);
+        
+        /* Setup ray packet */
+        PacketBox.Min = PacketBox.Max = Query.Lines[i].Start;
+        
+        for (u32 j = 0; j < Count; ++j)
+        {
+            PacketLines[j] = Query.Lines[i + j];
+            
+            PacketBox.insertPoint(PacketLines[j].Start);
+            PacketBox.insertPoint(PacketLines[j].End);
+            
+            if (Query.Contacts)
+                Query.Contacts[i + j] = SIntersectionContact();
+            else
+                Query.Results[i + j] = false;
+        }
+        
+        /* Test ray packet against all collision nodes */
+        foreach (const SRayQueryNode &QueryNode, Query.Nodes)
+        {
+            if (QueryNode.IsBounded && !QueryNode.Box.checkBoxBoxIntersection(PacketBox))
+                continue;
+            
+            if (Query.Contacts)
+            {
+                /* Find nearest intersections and clip the lines */
+                SIntersectionContact* Contacts = Query.Contacts + i;
+                
+                if (QueryNode.Mesh)
+                    QueryNode.Mesh->findNearestIntersections(PacketLines, Count, Contacts);
+                else
+                {
+                    for (u32 j = 0; j < Count; ++j)
+                    {
+                        if ( ( QueryNode.IsBounded && !math::CollisionLibrary::checkLineBoxOverlap(PacketLines[j], QueryNode.Box) ) ||
+                             !QueryNode.Node->checkIntersection(PacketLines[j], Contact) )
+                        {
+                            continue;
+                        }
+                        
+                        Contact.Object      = QueryNode.Node;
+                        Contact.DistanceSq  = math::getDistanceSq(PacketLines[j].Start, Contact.Point);
+                        
+                        if (!Contacts[j].Object || Contact.DistanceSq < Contacts[j].DistanceSq)
+                            Contacts[j] = Contact;
+                    }
+                }
+                
+                for (u32 j = 0; j < Count; ++j)
+                {
+                    if (Contacts[j].Object)
+                        PacketLines[j].End = Contacts[j].Point;
+                }
+            }
+            else
+            {
+                /* Check for any intersection */
+                bool* Results = Query.Results + i;
+                
+                if (QueryNode.Mesh)
+                    QueryNode.Mesh->checkIntersections(PacketLines, Count, Results, Query.ExcludeCorners);
+                else
+                {
+                    for (u32 j = 0; j < Count; ++j)
+                    {
+                        if ( !Results[j] &&
+                             ( !QueryNode.IsBounded || math::CollisionLibrary::checkLineBoxOverlap(PacketLines[j], QueryNode.Box) ) &&
+                             QueryNode.Node->checkIntersection(PacketLines[j], Query.ExcludeCorners) )
+                        {
+                            Results[j] = true;
+                        }
+                    }
+                }
+                
+                /* Stop if each line of the packet has an intersection */
+                u32 j = 0;
+                while (j < Count && Results[j])
+                    ++j;
+                
+                if (j == Count)
+                    break;
+            }
+        }
+    }
+}
+
+void CollisionGraph::findCharacterRivals(
+    CollisionNode* Model, const SCharacterBatch &Batch, std::vector<CollisionNode*> &RivalList)
+{
+    if (!RootTreeNode_ && Broadphase_ == COLLISIONBROADPHASE_AABBTREE)
+    {
+        /* Get the candidates from the broadphase and remove the other character controllers */
+        findRivalCandidates(Model, RivalList);
+        
+        u32 Count = 0;
+        
+        foreach (CollisionNode* Rival, RivalList)
+        {
+            if (!std::binary_search(Batch.Models.begin(), Batch.Models.end(), Rival))
+                RivalList[Count++] = Rival;
+        }
+        
+        RivalList.resize(Count);
+    }
+    else
+    {
+        /* Use all nodes of each rival material which are not moved by the other threads */
+        RivalList.clear();
+        
+        foreach (CollisionMaterial* RivalMaterial, Model->getMaterial()->getRivalList())
+        {
+            foreach (CollisionNode* Rival, RivalMaterial->getNodeList())
+            {
+                if (Rival != Model && !std::binary_search(Batch.Models.begin(), Batch.Models.end(), Rival))
+                    RivalList.push_back(Rival);
+            }
+        }
+    }
+}
+
+void CollisionGraph::updateCharacterBlock(const SCharacterBatch &Batch, u32 Begin, u32 End)
+{
+    /* Only perform the narrow phase, since the rivals have already been found on the calling thread */
+    for (u32 i = Begin; i < End; ++i)
+    {
+        if (Batch.RequireUpdate[i])
+            Batch.Controllers[i]->getCollisionModel()->performCollisionUpdate(&Batch.Rivals[i]);
+    }
+}
+
+void CollisionGraph::resolveCharacterControllers(const SCharacterBatch &Batch)
+{
+    const u32 Count = Batch.Controllers.size();
+    
+    /* Sort the bounding boxes along the X axis */
+    std::vector<dim::aabbox3df> Boxes(Count);
+    std::vector<SCharacterSweepEntry> SweepList(Count);
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        Batch.Controllers[i]->getCollisionModel()->getBoundingBox(Boxes[i]);
+        SweepList[i].MinX   = Boxes[i].Min.X;
+        SweepList[i].Index  = i;
+    }
+    
+    std::sort(SweepList.begin(), SweepList.end(), cmpCharacterSweepEntries);
+    
+    /* Find all overlapping pairs */
+    std::vector< std::vector<u32> > Candidates(Count);
+    
+    for (u32 a = 0; a < Count; ++a)
+    {
+        const u32 i = SweepList[a].Index;
+        
+        for (u32 b = a + 1; b < Count && SweepList[b].MinX <= Boxes[i].Max.X; ++b)
+        {
+            const u32 j = SweepList[b].Index;
+            
+            if (Boxes[i].checkBoxBoxIntersection(Boxes[j]))
+            {
+                Candidates[i].push_back(j);
+                Candidates[j].push_back(i);
+            }
+        }
+    }
+    
+    /* Resolve each character controller in the order of creation (and its rivals in the same order) */
+    std::vector<CollisionNode*> RivalList;
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        CharacterController* Object = Batch.Controllers[i];
+        CollisionCapsule* Model = Object->getCollisionModel();
+        
+        if (!Candidates[i].empty() && (Model->getFlags() & COLLISIONFLAG_DETECTION))
+        {
+            const std::vector<CollisionMaterial*>& RivalMaterials = Model->getMaterial()->getRivalList();
+            
+            std::sort(Candidates[i].begin(), Candidates[i].end());
+            
+            RivalList.clear();
+            
+            foreach (u32 j, Candidates[i])
+            {
+                CollisionNode* Rival = Batch.Controllers[j]->getCollisionModel();
+                
+                if (std::find(RivalMaterials.begin(), RivalMaterials.end(), Rival->getMaterial()) != RivalMaterials.end())
+                    RivalList.push_back(Rival);
+            }
+            
+            if (!RivalList.empty())
+            {
+                Model->performRivalResolving(&RivalList);
+                Model->updatePrevPosition();
+                
+                /* Resolve against the other collision nodes again, so the pushed controller does not end up inside a wall */
+                findCharacterRivals(Model, Batch, RivalList);
+                
+                if (!RivalList.empty())
+                {
+                    Model->performRivalResolving(&RivalList);
+                    Model->updatePrevPosition();
+                }
+            }
+        }
+        
+        Object->endUpdate();
+    }
+}
+
+
 
 } // /namespace scene
 
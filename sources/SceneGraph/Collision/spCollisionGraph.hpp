@@ -19,6 +19,7 @@
 #include "SceneGraph/Collision/spCollisionMesh.hpp"
 #include "SceneGraph/Collision/spCollisionMaterial.hpp"
 #include "SceneGraph/Collision/spCharacterController.hpp"
+#include "Base/spThreadManager.hpp"
 
 #include <boost/function.hpp>
 
@@ -86,6 +87,14 @@ The following models for collision- detection and resolving are supported:
 \li \c Capsule-to-Plane
 \li \c Capsule-to-Mesh
 \li \c Box-to-Plane
+
+By default the collision graph uses a broadphase (COLLISIONBROADPHASE_AABBTREE) to find the potentially colliding nodes.
+Static nodes (e.g. meshes and planes) and dynamic nodes (all nodes which perform collision detection themselves) are
+stored in separated dynamic AABB trees. Only the collision nodes and character controllers of this collision graph are
+inserted into the broadphase. Use "setBroadphase(COLLISIONBROADPHASE_NONE)" to test each node against all nodes of its rival materials.
+
+When the broadphase is used, collision nodes whose transformation has not been changed for several frames fall asleep
+(see setSleepFrameCount). Sleeping nodes are skipped until they are moved or another collision node moves into their bounding box.
 \since Version 3.2
 \ingroup group_collision
 */
@@ -147,15 +156,22 @@ class SP_EXPORT CollisionGraph
         Creates a new collision mesh.
         \param Mesh: Specifies the mesh which is to be used for the collision.
         \param MaxTreeLevel: Specifies the maximal tree hierarchy level.
+        \param Concept: Specifies the kd-Tree building concept. Use KDTREECONCEPT_SAH for faster intersection tests.
         \return Pointer to the new CollisionMesh object.
         \see createSphere
         */
-        virtual CollisionMesh* createMesh(CollisionMaterial* Material, scene::Mesh* Mesh, u8 MaxTreeLevel = DEF_KDTREE_LEVEL);
+        virtual CollisionMesh* createMesh(
+            CollisionMaterial* Material, scene::Mesh* Mesh, u8 MaxTreeLevel = DEF_KDTREE_LEVEL,
+            const EKDTreeBuildingConcepts Concept = KDTREECONCEPT_CENTER
+        );
         /**
         Creates a new collision mesh out of several meshes.
         \see createMesh
         */
-        virtual CollisionMesh* createMeshList(CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel = DEF_KDTREE_LEVEL);
+        virtual CollisionMesh* createMeshList(
+            CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel = DEF_KDTREE_LEVEL,
+            const EKDTreeBuildingConcepts Concept = KDTREECONCEPT_CENTER
+        );
         
         //! Deletes the given collision node and returns true on succeed.
         virtual bool deleteNode(CollisionNode* Node);
@@ -206,9 +222,107 @@ class SP_EXPORT CollisionGraph
             bool SearchBidirectional = false, const IntersectionCriteriaCallback &CriteriaCallback = 0
         ) const;
         
+        /**
+        Finds the nearest intersections with the whole collision graph without any memory allocation.
+        When the array is full, the line is clipped at the farthest stored intersection, so the remaining
+        collision nodes are only tested in front of it. Use a "MaxCount" of 1 for a closest-hit query.
+        \param[in] Line Specifies the line which is to be tested for intersection.
+        \param[out] Contacts Pointer to the array where the intersection results are to be stored.
+        The contacts are sorted by their distance to the line's start point.
+        \param[in] MaxCount Specifies the count of elements in the array. Only the nearest intersections will be stored.
+        \param[in] CriteriaCallback Specifies the intersection criteria callback.
+        \return Count of intersections which have been stored.
+        \see IntersectionCriteriaCallback
+        \since Version 3.3
+        */
+        virtual u32 findIntersections(
+            const dim::line3df &Line, SIntersectionContact* Contacts, u32 MaxCount,
+            const IntersectionCriteriaCallback &CriteriaCallback = 0
+        ) const;
+        
+        /**
+        Passes each intersection with the whole collision graph to the specified visitor without any memory allocation.
+        The intersections of each collision node are visited in the order of their distance to the line's start point
+        but the collision nodes are visited in an arbitrary order.
+        \param[in] Line Specifies the line which is to be tested for intersection.
+        \param[in] Visitor Specifies the visitor callback. Return false in this callback to stop the search.
+        \param[in] CriteriaCallback Specifies the intersection criteria callback.
+        \see IntersectionVisitorCallback
+        \since Version 3.3
+        */
+        virtual void findIntersections(
+            const dim::line3df &Line, const IntersectionVisitorCallback &Visitor,
+            const IntersectionCriteriaCallback &CriteriaCallback = 0
+        ) const;
+        
+        /**
+        Finds the nearest intersection for each line of the specified array (batched closest-hit query).
+        The lines are processed in packets (see COLLISION_RAYPACKET_SIZE) and the batch will be
+        spread across several threads (see setRayQueryThreadCount).
+        \param[in] Lines Pointer to the array of lines which are to be tested for intersection.
+        \param[in] Count Specifies the count of lines.
+        \param[out] Contacts Pointer to the array where the nearest intersection of each line is to be stored.
+        This array must have at least "Count" elements. The "Object" member of a contact is null if the
+        respective line has no intersection.
+        \param[in] CriteriaCallback Specifies the intersection criteria callback. For batched queries
+        this will be called only once for each collision node.
+        \see checkIntersections
+        \since Version 3.3
+        */
+        virtual void findNearestIntersections(
+            const dim::line3df* Lines, u32 Count, SIntersectionContact* Contacts,
+            const IntersectionCriteriaCallback &CriteriaCallback = 0
+        ) const;
+        
+        /**
+        Checks each line of the specified array for any intersection (batched any-hit query).
+        \param[out] Results Pointer to the array where the result of each line is to be stored.
+        This array must have at least "Count" elements.
+        \see findNearestIntersections
+        \see checkIntersection
+        \since Version 3.3
+        */
+        virtual void checkIntersections(
+            const dim::line3df* Lines, u32 Count, bool* Results, bool ExcludeCorners = false,
+            const IntersectionCriteriaCallback &CriteriaCallback = 0
+        ) const;
+        
         //! Performs all collision resolving for the whole collision graph.
         virtual void updateScene();
         
+        /**
+        Updates all character controllers at once (batched version of "CharacterController::update").
+        First each character controller is resolved against all collision nodes which do not belong to a character
+        controller. The rival candidates are found with the broadphase on the calling thread and the collision resolving
+        is spread across several threads (see setCharacterThreadCount). Afterwards the character controllers are resolved
+        against each other in the order of their creation (so the result is deterministic). Each pushed character controller
+        is resolved against the other collision nodes once again.
+        The contact callbacks of the collision materials and the character controllers (see CharacterController::setContactCallback)
+        are delivered at the end on the calling thread. Thus their return values are ignored, i.e. the contacts are always resolved.
+        \note The collision nodes must not be modified during this call, e.g. within a collision material's contact callback.
+        \see CharacterController::update
+        \since Version 3.3
+        */
+        virtual void updateCharacterControllers();
+        
+        /**
+        Sets the broadphase type. By default COLLISIONBROADPHASE_AABBTREE.
+        \see ECollisionBroadphases
+        */
+        virtual void setBroadphase(const ECollisionBroadphases Type);
+        
+        /**
+        Sets the count of frames without any transformation change until a collision node falls asleep.
+        By default COLLISION_DEFAULT_SLEEP_FRAMES. Set this to 0 to disable sleeping.
+        Collision nodes only fall asleep when the broadphase is used.
+        \see CollisionNode::isSleeping
+        \since Version 3.3
+        */
+        virtual void setSleepFrameCount(u32 Count);
+        
+        //! Wakes up all collision nodes. \since Version 3.3
+        virtual void wakeUpNodes();
+        
         /* === Static functions === */
         
         static void sortContactList(
@@ -232,6 +346,85 @@ class SP_EXPORT CollisionGraph
             return RootTreeNode_;
         }
         
+        //! Returns the broadphase type. By default COLLISIONBROADPHASE_AABBTREE.
+        inline ECollisionBroadphases getBroadphase() const
+        {
+            return Broadphase_;
+        }
+        
+        //! Returns the broadphase tree for static collision nodes.
+        inline const DynamicAABBTree& getStaticTree() const
+        {
+            return StaticTree_;
+        }
+        //! Returns the broadphase tree for dynamic collision nodes.
+        inline const DynamicAABBTree& getDynamicTree() const
+        {
+            return DynamicTree_;
+        }
+        
+        /**
+        Sets the count of threads which are to be used for batched intersection tests.
+        By default 0 which means that the count of processors will be used. Set this to 1 to disable multi-threading.
+        \see findNearestIntersections
+        \see checkIntersections
+        */
+        inline void setRayQueryThreadCount(u32 Count)
+        {
+            RayQueryThreadCount_ = Count;
+        }
+        inline u32 getRayQueryThreadCount() const
+        {
+            return RayQueryThreadCount_;
+        }
+        
+        /**
+        Sets the count of threads which are to be used for batched character controller updates.
+        By default 0 which means that the count of processors will be used. Set this to 1 to disable multi-threading.
+        \see updateCharacterControllers
+        \since Version 3.3
+        */
+        inline void setCharacterThreadCount(u32 Count)
+        {
+            CharacterThreadCount_ = Count;
+        }
+        inline u32 getCharacterThreadCount() const
+        {
+            return CharacterThreadCount_;
+        }
+        
+        //! Returns the count of frames until a collision node falls asleep. By default COLLISION_DEFAULT_SLEEP_FRAMES.
+        inline u32 getSleepFrameCount() const
+        {
+            return SleepFrameCount_;
+        }
+        
+        /**
+        Returns the count of collision nodes which were awake during the last "updateScene" call.
+        \since Version 3.3
+        */
+        inline u32 getAwakeNodeCount() const
+        {
+            return AwakeNodeCount_;
+        }
+        /**
+        Returns the count of collision nodes which were sleeping during the last "updateScene" call.
+        \since Version 3.3
+        */
+        inline u32 getSleepingNodeCount() const
+        {
+            return SleepingNodeCount_;
+        }
+        /**
+        Returns the count of collision nodes which have been resolved during the last "updateScene" call,
+        i.e. the awake nodes which have been moved since their previous resolving.
+        \since Version 3.3
+        */
+        inline u32 getResolvedNodeCount() const
+        {
+            return ResolvedNodeCount_;
+        }
+        
         //! Makes intersection tests with the whole collision graph.
         inline std::list<SIntersectionContact> findIntersections(
             const dim::line3df &Line, bool SearchBidirectional = false,
@@ -244,6 +437,36 @@ class SP_EXPORT CollisionGraph
         
     protected:
         
+        friend THREAD_PROC(CollisionRayQueryThreadProc);
+        friend THREAD_PROC(CollisionCharacterThreadProc);
+        
+        /* === Structures === */
+        
+        struct SRayQueryNode
+        {
+            const CollisionNode* Node;
+            const CollisionMesh* Mesh;  //!< Non-null if the node is a collision mesh (uses packet traversal).
+            dim::aabbox3df Box;         //!< Global bounding box.
+            bool IsBounded;
+        };
+        
+        struct SRayQuery
+        {
+            const dim::line3df* Lines;
+            SIntersectionContact* Contacts; //!< Non-null for closest-hit queries.
+            bool* Results;                  //!< Non-null for any-hit queries.
+            bool ExcludeCorners;
+            std::vector<SRayQueryNode> Nodes;
+        };
+        
+        struct SCharacterBatch
+        {
+            std::vector<CharacterController*> Controllers;
+            std::vector<const CollisionNode*> Models;               //!< Sorted collision models of all character controllers.
+            std::vector< std::vector<CollisionNode*> > Rivals;      //!< Rival candidates of each character controller (without other character controllers).
+            std::vector<bool> RequireUpdate;                        //!< Specifies whether each character controller requires a collision update.
+        };
+        
         /* === Functions === */
         
         virtual void findIntersectionsUnidirectional(
@@ -251,6 +474,26 @@ class SP_EXPORT CollisionGraph
             const IntersectionCriteriaCallback &CriteriaCallback
         ) const;
         
+        void updateSceneBroadphase();
+        
+        void updateBroadphaseProxies();
+        void updateBroadphaseProxy(CollisionNode* Node);
+        void removeBroadphaseProxy(CollisionNode* Node);
+        void clearBroadphase();
+        
+        void findRivalCandidates(CollisionNode* Node, std::vector<CollisionNode*> &RivalList);
+        
+        void getSweptBoundingBox(const CollisionNode* Node, dim::aabbox3df &Box) const;
+        void wakeUpDynamicNodes(const CollisionNode* Node, u32 FirstQueryIndex);
+        
+        void setupRayQuery(SRayQuery &Query, const IntersectionCriteriaCallback &CriteriaCallback) const;
+        void processRayQuery(const SRayQuery &Query, u32 Count) const;
+        void processRayQueryBlock(const SRayQuery &Query, u32 Begin, u32 End) const;
+        
+        void findCharacterRivals(CollisionNode* Model, const SCharacterBatch &Batch, std::vector<CollisionNode*> &RivalList);
+        void updateCharacterBlock(const SCharacterBatch &Batch, u32 Begin, u32 End);
+        void resolveCharacterControllers(const SCharacterBatch &Batch);
+        
         /* === Templates === */
         
         template <class T> T* addCollNode(T* Node)
@@ -267,6 +510,23 @@ class SP_EXPORT CollisionGraph
         
         TreeNode* RootTreeNode_;
         
+        ECollisionBroadphases Broadphase_;
+        
+        DynamicAABBTree StaticTree_;
+        DynamicAABBTree DynamicTree_;
+        
+        std::vector<CollisionNode*> UnboundedNodes_;
+        std::vector<CollisionNode*> RivalCandidates_;
+        std::vector<void*> BroadphaseQuery_;
+        
+        u32 RayQueryThreadCount_;
+        u32 CharacterThreadCount_;
+        
+        u32 SleepFrameCount_;
+        u32 AwakeNodeCount_;
+        u32 SleepingNodeCount_;
+        u32 ResolvedNodeCount_;
+        
 };
 
 
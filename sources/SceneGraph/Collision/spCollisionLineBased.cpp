@@ -32,6 +32,20 @@ f32 CollisionLineBased::getMaxMovement() const
     return getRadius() * 0.8f;
 }
 
+bool CollisionLineBased::getBoundingBox(dim::aabbox3df &Box) const
+{
+    const dim::line3df Line(getLine());
+    
+    Box.Min = Line.Start;
+    Box.Max = Line.Start;
+    Box.insertPoint(Line.End);
+    
+    Box.Min -= getRadius();
+    Box.Max += getRadius();
+    
+    return true;
+}
+
 dim::line3df CollisionLineBased::getLine() const
 {
     const dim::matrix4f Mat(getTransformation());
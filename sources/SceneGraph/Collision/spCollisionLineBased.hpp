@@ -31,6 +31,8 @@ class SP_EXPORT CollisionLineBased : public CollisionNode
         virtual s32 getSupportFlags() const = 0;
         virtual f32 getMaxMovement() const;
         
+        virtual bool getBoundingBox(dim::aabbox3df &Box) const;
+        
         /**
         Returns the line representing the capsule, cylinder or cone.
         This line is transformed by the last updated collision-node transformation
@@ -23,24 +23,34 @@ namespace scene
 {
 
 
+/*
+ * Internal members
+ */
+
+//! Count of linear kd-Tree intersections which are searched at once in the allocation-free intersection tests.
+static const u32 MESH_INTERSECTION_BUFFER_SIZE = 16;
+
+
 CollisionMesh::CollisionMesh(
-    CollisionMaterial* Material, Mesh* MeshObj, u8 MaxTreeLevel) :
+    CollisionMaterial* Material, Mesh* MeshObj, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept) :
     CollisionNode   (Material, MeshObj, COLLISION_MESH ),
     RootTreeNode_   (0                              ),
+    BuildTime_      (0                              ),
     CollFace_       (video::FACE_FRONT              ),
     MeshList_       (1, MeshObj                     )
 {
     std::list<scene::Mesh*> MeshList(1, MeshObj);
-    createCollisionModel(MeshList, MaxTreeLevel, false);
+    createCollisionModel(MeshList, MaxTreeLevel, Concept, false);
 }
 CollisionMesh::CollisionMesh(
-    CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel) :
+    CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept) :
     CollisionNode   (Material, GlbSceneGraph->createNode(), COLLISION_MESH  ),
     RootTreeNode_   (0                                                      ),
+    BuildTime_      (0                                                      ),
     CollFace_       (video::FACE_FRONT                                      ),
     MeshList_       (MeshList.begin(), MeshList.end()                       )
 {
-    createCollisionModel(MeshList, MaxTreeLevel, true);
+    createCollisionModel(MeshList, MaxTreeLevel, Concept, true);
 }
 CollisionMesh::~CollisionMesh()
 {
@@ -57,6 +67,15 @@ f32 CollisionMesh::getMaxMovement() const
     return 0.0f;
 }
 
+bool CollisionMesh::getBoundingBox(dim::aabbox3df &Box) const
+{
+    if (RootTreeNode_)
+        Box = CollisionNode::getTransformedBox(getTransformation(), RootTreeNode_->getBox());
+    else
+        Box.Min = Box.Max = getPosition();
+    return true;
+}
+
 void CollisionMesh::findIntersections(const dim::line3df &Line, std::list<SIntersectionContact> &ContactList) const
 {
     if (!RootTreeNode_)
@@ -132,22 +151,90 @@ void CollisionMesh::findIntersections(const dim::line3df &Line, std::list<SInter
     }
 }
 
-bool CollisionMesh::checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const
-{   
-    /* Find all intersections and return the nearest one */
-    std::list<SIntersectionContact> ContactList;
-    findIntersections(Line, ContactList);
+u32 CollisionMesh::findIntersections(const dim::line3df &Line, SIntersectionContact* Contacts, u32 MaxCount) const
+{
+    if (LinearTree_.empty() || !Contacts || !MaxCount)
+        return 0;
+    
+    const bool useFront = (CollFace_ == video::FACE_FRONT || CollFace_ == video::FACE_BOTH);
+    const bool useBack = (CollFace_ == video::FACE_BACK || CollFace_ == video::FACE_BOTH);
     
-    if (!ContactList.empty())
+    const dim::line3df InvLine(getInverseTransformation() * Line);
+    
+    SLinearKDTreeIntersection Intersections[MESH_INTERSECTION_BUFFER_SIZE];
+    SLinearKDTreeIntersection Previous;
+    
+    u32 Count = 0;
+    
+    /* Search the intersections piece by piece with a fixed size buffer */
+    while (Count < MaxCount)
     {
-        /* Compute squared distance */
-        foreach (SIntersectionContact &CurContact, ContactList)
-            CurContact.DistanceSq = math::getDistanceSq(Line.Start, CurContact.Point);
+        const u32 Num = math::Min(MaxCount - Count, MESH_INTERSECTION_BUFFER_SIZE);
+        const u32 NumFound = LinearTree_.findIntersections(
+            InvLine, Intersections, Num, useFront, useBack, (Count > 0 ? &Previous : 0)
+        );
+        
+        for (u32 i = 0; i < NumFound; ++i)
+            setupIntersectionContact(Line, InvLine, Intersections[i], Contacts[Count++]);
         
-        /* Sort contact list and store first element in the resulting contact */
-        CollisionGraph::sortContactList(Line.Start, ContactList);
-        Contact = *ContactList.begin();
+        if (NumFound < Num)
+            break;
         
+        Previous = Intersections[NumFound - 1];
+    }
+    
+    return Count;
+}
+
+bool CollisionMesh::findIntersections(const dim::line3df &Line, const IntersectionVisitorCallback &Visitor) const
+{
+    if (LinearTree_.empty() || !Visitor)
+        return true;
+    
+    const bool useFront = (CollFace_ == video::FACE_FRONT || CollFace_ == video::FACE_BOTH);
+    const bool useBack = (CollFace_ == video::FACE_BACK || CollFace_ == video::FACE_BOTH);
+    
+    const dim::line3df InvLine(getInverseTransformation() * Line);
+    
+    SLinearKDTreeIntersection Intersections[MESH_INTERSECTION_BUFFER_SIZE];
+    SLinearKDTreeIntersection Previous;
+    SIntersectionContact Contact;
+    
+    bool HasPrevious = false;
+    
+    /* Visit the intersections piece by piece with a fixed size buffer */
+    while (1)
+    {
+        const u32 NumFound = LinearTree_.findIntersections(
+            InvLine, Intersections, MESH_INTERSECTION_BUFFER_SIZE, useFront, useBack, (HasPrevious ? &Previous : 0)
+        );
+        
+        for (u32 i = 0; i < NumFound; ++i)
+        {
+            setupIntersectionContact(Line, InvLine, Intersections[i], Contact);
+            if (!Visitor(Contact))
+                return false;
+        }
+        
+        if (NumFound < MESH_INTERSECTION_BUFFER_SIZE)
+            break;
+        
+        Previous    = Intersections[NumFound - 1];
+        HasPrevious = true;
+    }
+    
+    return true;
+}
+
+bool CollisionMesh::checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const
+{
+    /* Find the nearest intersection with a single line packet */
+    SIntersectionContact NearestContact;
+    findNearestIntersections(&Line, 1, &NearestContact);
+    
+    if (NearestContact.Object)
+    {
+        Contact = NearestContact;
         return true;
     }
     
@@ -156,65 +243,69 @@ bool CollisionMesh::checkIntersection(const dim::line3df &Line, SIntersectionCon
 
 bool CollisionMesh::checkIntersection(const dim::line3df &Line, bool ExcludeCorners) const
 {
-    if (!RootTreeNode_)
-        return false;
+    bool Result = false;
+    checkIntersections(&Line, 1, &Result, ExcludeCorners);
+    return Result;
+}
+
+void CollisionMesh::findNearestIntersections(
+    const dim::line3df* Lines, u32 Count, SIntersectionContact* Contacts) const
+{
+    if (LinearTree_.empty() || !Lines || !Contacts || !Count)
+        return;
     
-    /* Store transformation and a 'vice-versa' variant of the line */
-    const dim::matrix4f InvMatrix(getInverseTransformation());
-    const dim::line3df InvLine(InvMatrix * Line);
-    const dim::line3df InvLineVV(InvMatrix * Line.getViceVersa());
+    Count = math::Min(Count, COLLISION_RAYPACKET_SIZE);
     
     const bool useFront = (CollFace_ == video::FACE_FRONT || CollFace_ == video::FACE_BOTH);
     const bool useBack = (CollFace_ == video::FACE_BACK || CollFace_ == video::FACE_BOTH);
     
-    dim::vector3df Point;
+    /* Transform the lines into object space */
+    const dim::matrix4f& Matrix(getTransformation());
+    const dim::matrix4f& InvMatrix(getInverseTransformation());
     
-    /* Search tree node leafs */
-    std::list<const TreeNode*> TreeNodeList;
-    RootTreeNode_->findLeafList(TreeNodeList, InvLine);
+    dim::line3df InvLines[COLLISION_RAYPACKET_SIZE];
+    SLinearKDTreeIntersection Intersections[COLLISION_RAYPACKET_SIZE];
     
-    foreach (const TreeNode* Node, TreeNodeList)
+    for (u32 i = 0; i < Count; ++i)
+        InvLines[i] = InvMatrix * Lines[i];
+    
+    /* Traverse the linear kd-Tree for the whole packet */
+    LinearTree_.findNearestIntersections(InvLines, Count, Intersections, useFront, useBack);
+    
+    /* Store the nearest intersections */
+    for (u32 i = 0; i < Count; ++i)
     {
-        if (!Node->getUserData())
+        if (Intersections[i].Triangle == LINEARKDTREE_INVALID_INDEX)
             continue;
         
-        TreeNodeDataType* TreeNodeData = static_cast<TreeNodeDataType*>(Node->getUserData());
+        const dim::vector3df Point(Matrix * (InvLines[i].Start + InvLines[i].getDirection() * Intersections[i].Distance));
         
-        #ifndef _DEB_NEW_KDTREE_
-        foreach (SCollisionFace* Face, *TreeNodeData)
-        #else
-        foreach (SCollisionFace &NodeFace, *TreeNodeData)
-        #endif
-        {
-            #ifdef _DEB_NEW_KDTREE_
-            SCollisionFace* Face = &NodeFace;
-            #endif
-            
-            /* Check if an intersection between the line and the current triangle exists */
-            if (useFront && math::CollisionLibrary::checkLineTriangleIntersection(Face->Triangle, InvLine, Point))
-            {
-                if (ExcludeCorners)
-                {
-                    if (checkCornerExlusion(InvLine, Point))
-                        return true;
-                }
-                else
-                    return true;
-            }
-            if (useBack && math::CollisionLibrary::checkLineTriangleIntersection(Face->Triangle, InvLineVV, Point))
-            {
-                if (ExcludeCorners)
-                {
-                    if (checkCornerExlusion(InvLine, Point))
-                        return true;
-                }
-                else
-                    return true;
-            }
-        }
+        if (!Contacts[i].Object || math::getDistanceSq(Lines[i].Start, Point) < Contacts[i].DistanceSq)
+            setupIntersectionContact(Lines[i], InvLines[i], Intersections[i], Contacts[i]);
     }
+}
+
+void CollisionMesh::checkIntersections(
+    const dim::line3df* Lines, u32 Count, bool* Results, bool ExcludeCorners) const
+{
+    if (LinearTree_.empty() || !Lines || !Results || !Count)
+        return;
     
-    return false;
+    Count = math::Min(Count, COLLISION_RAYPACKET_SIZE);
+    
+    const bool useFront = (CollFace_ == video::FACE_FRONT || CollFace_ == video::FACE_BOTH);
+    const bool useBack = (CollFace_ == video::FACE_BACK || CollFace_ == video::FACE_BOTH);
+    
+    /* Transform the lines into object space */
+    const dim::matrix4f& InvMatrix(getInverseTransformation());
+    
+    dim::line3df InvLines[COLLISION_RAYPACKET_SIZE];
+    
+    for (u32 i = 0; i < Count; ++i)
+        InvLines[i] = InvMatrix * Lines[i];
+    
+    /* Traverse the linear kd-Tree for the whole packet until each line has an intersection */
+    LinearTree_.checkIntersections(InvLines, Count, Results, useFront, useBack, ExcludeCorners);
 }
 
 
@@ -223,11 +314,30 @@ bool CollisionMesh::checkIntersection(const dim::line3df &Line, bool ExcludeCorn
  */
 
 void CollisionMesh::createCollisionModel(
-    const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, bool PreTransform)
+    const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept, bool PreTransform)
 {
     RootTreeNode_ = TreeBuilder::buildKdTree(
-        MeshList, MaxTreeLevel, KDTREECONCEPT_CENTER, PreTransform
+        MeshList, MaxTreeLevel, Concept, PreTransform, &BuildTime_
     );
+    LinearTree_.build(RootTreeNode_);
+}
+
+void CollisionMesh::setupIntersectionContact(
+    const dim::line3df &Line, const dim::line3df &InvLine,
+    const SLinearKDTreeIntersection &Intersection, SIntersectionContact &Contact) const
+{
+    const dim::matrix4f& Matrix(getTransformation());
+    SCollisionFace* Face = LinearTree_.getFace(Intersection.Triangle);
+    
+    Contact.Point       = Matrix * (InvLine.Start + InvLine.getDirection() * Intersection.Distance);
+    Contact.Triangle    = Matrix * Face->Triangle;
+    Contact.Normal      = Contact.Triangle.getNormal();
+    Contact.Face        = Face;
+    Contact.Object      = this;
+    Contact.DistanceSq  = math::getDistanceSq(Line.Start, Contact.Point);
+    
+    if (Intersection.BackFace)
+        Contact.Normal = -Contact.Normal;
 }
 
 
@@ -11,6 +11,7 @@
 
 #include "Base/spStandard.hpp"
 #include "Base/spTreeBuilder.hpp"
+#include "Base/spLinearKDTree.hpp"
 #include "SceneGraph/spSceneMesh.hpp"
 #include "SceneGraph/Collision/spCollisionNode.hpp"
 
@@ -25,6 +26,7 @@ namespace scene
 CollisionMesh is one of the collision models and represents a complete mesh and has its own kd-Tree for fast collision detection.
 Each kd-Tree node leaf stores a list of SCollisionFace instances. Thus modifying your mesh does not effect the collision model
 after it has been already created.
+Line intersection tests use a linear kd-Tree (see LinearKDTree) which is built out of the kd-Tree hierarchy.
 \ingroup group_collision
 */
 class SP_EXPORT CollisionMesh : public CollisionNode
@@ -32,8 +34,14 @@ class SP_EXPORT CollisionMesh : public CollisionNode
     
     public:
         
-        CollisionMesh(CollisionMaterial* Material, Mesh* MeshObj, u8 MaxTreeLevel = DEF_KDTREE_LEVEL);
-        CollisionMesh(CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel = DEF_KDTREE_LEVEL);
+        CollisionMesh(
+            CollisionMaterial* Material, Mesh* MeshObj, u8 MaxTreeLevel = DEF_KDTREE_LEVEL,
+            const EKDTreeBuildingConcepts Concept = KDTREECONCEPT_CENTER
+        );
+        CollisionMesh(
+            CollisionMaterial* Material, const std::list<Mesh*> &MeshList, u8 MaxTreeLevel = DEF_KDTREE_LEVEL,
+            const EKDTreeBuildingConcepts Concept = KDTREECONCEPT_CENTER
+        );
         ~CollisionMesh();
         
         /* === Functions === */
@@ -41,10 +49,37 @@ class SP_EXPORT CollisionMesh : public CollisionNode
         s32 getSupportFlags() const;
         f32 getMaxMovement() const;
         
+        bool getBoundingBox(dim::aabbox3df &Box) const;
+        
         void findIntersections(const dim::line3df &Line, std::list<SIntersectionContact> &ContactList) const;
+        u32 findIntersections(const dim::line3df &Line, SIntersectionContact* Contacts, u32 MaxCount) const;
+        bool findIntersections(const dim::line3df &Line, const IntersectionVisitorCallback &Visitor) const;
         bool checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const;
         bool checkIntersection(const dim::line3df &Line, bool ExcludeCorners = false) const;
         
+        /**
+        Finds the nearest intersections for a packet of lines. The linear kd-Tree is traversed only once for the whole
+        packet and each line is clipped at its nearest intersection found so far.
+        \param[in] Lines Pointer to the first line of the packet (in global space).
+        \param[in] Count Specifies the count of lines. This is clamped to COLLISION_RAYPACKET_SIZE.
+        \param[in,out] Contacts Pointer to the first contact. A contact will only be overwritten if its "Object"
+        member is null or the new intersection is nearer than its "DistanceSq" member.
+        \see COLLISION_RAYPACKET_SIZE
+        \since Version 3.3
+        */
+        void findNearestIntersections(const dim::line3df* Lines, u32 Count, SIntersectionContact* Contacts) const;
+        
+        /**
+        Checks a packet of lines for any intersection.
+        \param[in] Lines Pointer to the first line of the packet (in global space).
+        \param[in] Count Specifies the count of lines. This is clamped to COLLISION_RAYPACKET_SIZE.
+        \param[in,out] Results Pointer to the first result. Lines whose result is already true will be skipped.
+        \param[in] ExcludeCorners Specifies whether the line's corners should be ingored.
+        \see findNearestIntersections
+        \since Version 3.3
+        */
+        void checkIntersections(const dim::line3df* Lines, u32 Count, bool* Results, bool ExcludeCorners = false) const;
+        
         /* === Inline functions === */
         
         //! Returns a pointer to the kd-Tree root node. This will never be null.
@@ -53,6 +88,25 @@ class SP_EXPORT CollisionMesh : public CollisionNode
             return RootTreeNode_;
         }
         
+        /**
+        Returns the linear kd-Tree which is used for line intersection tests.
+        \since Version 3.3
+        */
+        inline const LinearKDTree& getLinearTree() const
+        {
+            return LinearTree_;
+        }
+        
+        /**
+        Returns the time (in milliseconds) the building of the kd-Tree took.
+        \see TreeBuilder::buildKdTree
+        \since Version 3.3
+        */
+        inline u64 getBuildTime() const
+        {
+            return BuildTime_;
+        }
+        
         //! Sets the collidable face side. By default video::FACE_FRONT.
         inline void setCollFace(const video::EFaceTypes Type)
         {
@@ -84,11 +138,20 @@ class SP_EXPORT CollisionMesh : public CollisionNode
         
         /* === Functions === */
         
-        void createCollisionModel(const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, bool PreTransform);
+        void createCollisionModel(
+            const std::list<Mesh*> &MeshList, u8 MaxTreeLevel, const EKDTreeBuildingConcepts Concept, bool PreTransform
+        );
+        
+        void setupIntersectionContact(
+            const dim::line3df &Line, const dim::line3df &InvLine,
+            const SLinearKDTreeIntersection &Intersection, SIntersectionContact &Contact
+        ) const;
         
         /* === Members === */
         
         KDTreeNode* RootTreeNode_;
+        LinearKDTree LinearTree_;
+        u64 BuildTime_;
         video::EFaceTypes CollFace_;
         
         std::vector<Mesh*> MeshList_;
@@ -16,6 +16,7 @@
 #include "SceneGraph/Collision/spCollisionMaterial.hpp"
 
 #include <boost/foreach.hpp>
+#include <algorithm>
 
 
 namespace sp
@@ -24,6 +25,36 @@ namespace scene
 {
 
 
+/*
+ * Internal members
+ */
+
+//! Maximal count of contacts (and sliding movements) for a single swept movement.
+static const u32 COLLISION_MAX_SWEEP_ITERATIONS = 4;
+
+
+/*
+ * Internal functions
+ */
+
+static s32 getCollisionSupportFlag(const ECollisionModels Type)
+{
+    switch (Type)
+    {
+        case COLLISION_SPHERE:      return COLLISIONSUPPORT_SPHERE;
+        case COLLISION_CAPSULE:     return COLLISIONSUPPORT_CAPSULE;
+        case COLLISION_CYLINDER:    return COLLISIONSUPPORT_CYLINDER;
+        case COLLISION_CONE:        return COLLISIONSUPPORT_CONE;
+        case COLLISION_BOX:         return COLLISIONSUPPORT_BOX;
+        case COLLISION_PLANE:       return COLLISIONSUPPORT_PLANE;
+        case COLLISION_MESH:        return COLLISIONSUPPORT_MESH;
+        default:
+            break;
+    }
+    return COLLISIONSUPPORT_NONE;
+}
+
+
 CollisionNode::CollisionNode(
     CollisionMaterial* Material, SceneNode* Node, const ECollisionModels Type) :
     BaseObject      (                   ),
@@ -31,7 +62,13 @@ CollisionNode::CollisionNode(
     Flags_          (COLLISIONFLAG_FULL ),
     Node_           (Node               ),
     Material_       (Material           ),
-    UseOffsetTrans_ (false              )
+    UseOffsetTrans_ (false              ),
+    QuietFrames_    (0                  ),
+    IsSleeping_     (false              ),
+    HasMoved_       (true               ),
+    ProxyTree_      (0                  ),
+    ProxyID_        (-1                 ),
+    DeferContacts_  (false              )
 {
     if (!Node_)
         throw io::stringc("Collision node must be linked to a valid scene node");
@@ -44,6 +81,8 @@ CollisionNode::CollisionNode(
 }
 CollisionNode::~CollisionNode()
 {
+    if (ProxyTree_)
+        ProxyTree_->destroyProxy(ProxyID_);
     if (Material_)
         Material_->removeCollisionNode(this);
 }
@@ -62,6 +101,11 @@ void CollisionNode::setMaterial(CollisionMaterial* Material)
     }
 }
 
+bool CollisionNode::getBoundingBox(dim::aabbox3df &Box) const
+{
+    return false; // unbounded by default
+}
+
 void CollisionNode::findIntersections(const dim::line3df &Line, std::list<SIntersectionContact> &ContactList) const
 {
     SIntersectionContact Contact;
@@ -69,6 +113,25 @@ void CollisionNode::findIntersections(const dim::line3df &Line, std::list<SInter
         ContactList.push_back(Contact);
 }
 
+u32 CollisionNode::findIntersections(const dim::line3df &Line, SIntersectionContact* Contacts, u32 MaxCount) const
+{
+    if (Contacts && MaxCount > 0 && checkIntersection(Line, *Contacts))
+    {
+        Contacts->Object        = this;
+        Contacts->DistanceSq    = math::getDistanceSq(Line.Start, Contacts->Point);
+        return 1;
+    }
+    return 0;
+}
+
+bool CollisionNode::findIntersections(const dim::line3df &Line, const IntersectionVisitorCallback &Visitor) const
+{
+    SIntersectionContact Contact;
+    if (Visitor && findIntersections(Line, &Contact, 1) > 0)
+        return Visitor(Contact);
+    return true;
+}
+
 bool CollisionNode::checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const
 {
     return false; // do nothing
@@ -137,8 +200,35 @@ void CollisionNode::performCollisionResolving(const CollisionNode* Rival)
     }
 }
 
+bool CollisionNode::sweepCollision(const CollisionNode* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (Rival)
+    {
+        switch (Rival->getType())
+        {
+            case COLLISION_SPHERE:      return sweepCollisionToSphere   (static_cast<const CollisionSphere*     >(Rival), Direction, Contact);
+            case COLLISION_CAPSULE:     return sweepCollisionToCapsule  (static_cast<const CollisionCapsule*    >(Rival), Direction, Contact);
+            case COLLISION_CYLINDER:    return sweepCollisionToCylinder (static_cast<const CollisionCylinder*   >(Rival), Direction, Contact);
+            case COLLISION_CONE:        return sweepCollisionToCone     (static_cast<const CollisionCone*       >(Rival), Direction, Contact);
+            case COLLISION_BOX:         return sweepCollisionToBox      (static_cast<const CollisionBox*        >(Rival), Direction, Contact);
+            case COLLISION_PLANE:       return sweepCollisionToPlane    (static_cast<const CollisionPlane*      >(Rival), Direction, Contact);
+            case COLLISION_MESH:        return sweepCollisionToMesh     (static_cast<const CollisionMesh*       >(Rival), Direction, Contact);
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+s32 CollisionNode::getSweepSupportFlags() const
+{
+    return COLLISIONSUPPORT_NONE;
+}
+
 void CollisionNode::setupTransformation(const dim::matrix4f &Matrix)
 {
+    const dim::matrix4f PrevTrans(Trans_);
+    
     /* Update collision-node's global transformation */
     Trans_ = Matrix;
     NodePosition_ = Trans_.getPosition();
@@ -149,6 +239,13 @@ void CollisionNode::setupTransformation(const dim::matrix4f &Matrix)
     
     /* Store inverse transformation */
     Trans_.getInverse(InvTrans_);
+    
+    /* Wake up when the transformation has changed */
+    if (Trans_ != PrevTrans)
+    {
+        HasMoved_ = true;
+        wakeUp();
+    }
 }
 
 void CollisionNode::updateTransformation()
@@ -161,6 +258,7 @@ void CollisionNode::setPosition(const dim::vector3df &Position, bool UpdatePrevP
 {
     Node_->setPosition(Position, true);
     updateTransformation();
+    wakeUp();
     if (UpdatePrevPosition)
         updatePrevPosition();
 }
@@ -176,60 +274,14 @@ void CollisionNode::setOffset(const dim::matrix4f &Matrix, bool Enable)
 
 void CollisionNode::updateCollisions()
 {
-    if (!(getFlags() & COLLISIONFLAG_DETECTION) || getSupportFlags() == COLLISIONSUPPORT_NONE || !Material_)
-        return;
-    
-    /* Check for movement tolerance */
-    dim::vector3df MoveDir(getNodePosition());
-    MoveDir -= getPrevPosition();
-    
-    f32 Movement = MoveDir.getLengthSq();
-    
-    if (!(getFlags() & COLLISIONFLAG_PERMANENT_UPDATE) && Movement <= math::ROUNDING_ERROR)
-        return;
-    
-    const f32 MaxMovement = getMaxMovement();
-    
-    if (Movement > math::pow2(MaxMovement))
-    {
-        /* Adjust movement and direction */
-        Movement = sqrt(Movement);
-        
-        MoveDir /= Movement;
-        MoveDir *= MaxMovement;
-        
-        setPosition(getPrevPosition(), false);
-        
-        /* Perform collision resolving in several steps */
-        do
-        {
-            translate(MoveDir);
-            
-            /* Perform simple collision resolving */
-            foreach (const CollisionMaterial* RivalMaterial, Material_->RivalCollMaterials_)
-            {
-                foreach (const CollisionNode* Rival, RivalMaterial->CollNodes_)
-                    performCollisionResolving(Rival);
-            }
-            
-            /* Boost movement */
-            Movement -= MaxMovement;
-            if (Movement < MaxMovement)
-                MoveDir.setLength(MaxMovement - Movement);
-        }
-        while (Movement > -math::ROUNDING_ERROR);
-    }
-    else
-    {
-        /* Perform simple collision resolving */
-        foreach (const CollisionMaterial* RivalMaterial, Material_->RivalCollMaterials_)
-        {
-            foreach (const CollisionNode* Rival, RivalMaterial->CollNodes_)
-                performCollisionResolving(Rival);
-        }
-    }
-    
-    updatePrevPosition();
+    if (requireCollisionUpdate())
+        performCollisionUpdate(0);
+}
+
+void CollisionNode::wakeUp()
+{
+    QuietFrames_    = 0;
+    IsSleeping_     = false;
 }
 
 
@@ -331,11 +383,54 @@ void CollisionNode::performCollisionResolvingToMesh(const CollisionMesh* Rival)
     // do nothing
 }
 
+bool CollisionNode::sweepCollisionToSphere(const CollisionSphere* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+bool CollisionNode::sweepCollisionToCapsule(const CollisionCapsule* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+bool CollisionNode::sweepCollisionToCylinder(const CollisionCylinder* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+bool CollisionNode::sweepCollisionToCone(const CollisionCone* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+bool CollisionNode::sweepCollisionToBox(const CollisionBox* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+bool CollisionNode::sweepCollisionToPlane(const CollisionPlane* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+bool CollisionNode::sweepCollisionToMesh(const CollisionMesh* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    return false; // do nothing
+}
+
 bool CollisionNode::notifyCollisionContact(const CollisionNode* Rival, const SCollisionContact &Contact)
 {
     /* Collision contact callback */
     if (Material_ && Material_->CollContactCallback_)
+    {
+        /* Batched updates deliver the callbacks afterwards on the calling thread */
+        if (DeferContacts_)
+        {
+            SDeferredContact DeferredContact;
+            {
+                DeferredContact.Rival   = Rival;
+                DeferredContact.Contact = Contact;
+            }
+            DeferredContacts_.push_back(DeferredContact);
+            return true;
+        }
+        
         return Material_->CollContactCallback_(Material_, this, Rival, Contact);
+    }
     return true;
 }
 
@@ -368,6 +463,307 @@ void CollisionNode::updatePrevPosition()
     PrevPosition_ = Node_->getPosition(true);
 }
 
+void CollisionNode::flushContacts()
+{
+    /* Deliver the contacts of the last batched update (the return values are ignored) */
+    if (Material_ && Material_->CollContactCallback_)
+    {
+        foreach (const SDeferredContact &DeferredContact, DeferredContacts_)
+            Material_->CollContactCallback_(Material_, this, DeferredContact.Rival, DeferredContact.Contact);
+    }
+    DeferredContacts_.clear();
+}
+
+bool CollisionNode::requireCollisionUpdate() const
+{
+    if (!(getFlags() & COLLISIONFLAG_DETECTION) || getSupportFlags() == COLLISIONSUPPORT_NONE || !Material_)
+        return false;
+    
+    /* Check for movement tolerance */
+    if (!(getFlags() & COLLISIONFLAG_PERMANENT_UPDATE) &&
+        math::getDistanceSq(getNodePosition(), getPrevPosition()) <= math::ROUNDING_ERROR)
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+void CollisionNode::performCollisionUpdate(const std::vector<CollisionNode*>* RivalList)
+{
+    /* Check for movement tolerance */
+    dim::vector3df MoveDir(getNodePosition());
+    MoveDir -= getPrevPosition();
+    
+    f32 Movement = MoveDir.getLengthSq();
+    
+    const f32 MaxMovement = getMaxMovement();
+    
+    if (Movement > math::pow2(MaxMovement))
+    {
+        /* Move until the first contact and resolve the collisions only once */
+        if (performSweptMovement(RivalList, MoveDir))
+        {
+            performRivalResolving(RivalList);
+            updatePrevPosition();
+            return;
+        }
+        
+        /* Adjust movement and direction */
+        Movement = sqrt(Movement);
+        
+        MoveDir /= Movement;
+        MoveDir *= MaxMovement;
+        
+        setPosition(getPrevPosition(), false);
+        
+        /* Perform collision resolving in several steps */
+        do
+        {
+            translate(MoveDir);
+            
+            /* Perform simple collision resolving */
+            performRivalResolving(RivalList);
+            
+            /* Boost movement */
+            Movement -= MaxMovement;
+            if (Movement < MaxMovement)
+                MoveDir.setLength(MaxMovement - Movement);
+        }
+        while (Movement > -math::ROUNDING_ERROR);
+    }
+    else
+    {
+        /* Perform simple collision resolving */
+        performRivalResolving(RivalList);
+    }
+    
+    updatePrevPosition();
+}
+
+void CollisionNode::performRivalResolving(const std::vector<CollisionNode*>* RivalList)
+{
+    if (RivalList)
+    {
+        /* Only resolve collisions with the candidates found by the broadphase */
+        foreach (const CollisionNode* Rival, *RivalList)
+            performCollisionResolving(Rival);
+    }
+    else
+    {
+        /* Resolve collisions with all nodes of each rival material */
+        foreach (const CollisionMaterial* RivalMaterial, Material_->RivalCollMaterials_)
+        {
+            foreach (const CollisionNode* Rival, RivalMaterial->CollNodes_)
+                performCollisionResolving(Rival);
+        }
+    }
+}
+
+void CollisionNode::updateSleepState(u32 SleepFrameCount)
+{
+    if (HasMoved_)
+    {
+        HasMoved_ = false;
+        QuietFrames_ = 0;
+    }
+    else if (SleepFrameCount > 0 && ++QuietFrames_ >= SleepFrameCount)
+        IsSleeping_ = true;
+}
+
+bool CollisionNode::performSweptMovement(const std::vector<CollisionNode*>* RivalList, dim::vector3df Direction)
+{
+    if (!checkSweepSupport(RivalList))
+        return false;
+    
+    setPosition(getPrevPosition(), false);
+    
+    SweepRejectedRivals_.clear();
+    
+    for (u32 i = 0; i < COLLISION_MAX_SWEEP_ITERATIONS && Direction.getLengthSq() > math::ROUNDING_ERROR; ++i)
+    {
+        /* Find the first contact during the remaining movement */
+        SSweepContact Contact;
+        
+        if (!findFirstSweepContact(RivalList, Direction, Contact))
+        {
+            translate(Direction);
+            break;
+        }
+        
+        /*
+        Move to the time of impact and keep a small distance to the contact,
+        so the following collision resolving does not detect (and notify) the same contact again
+        */
+        translate(Direction * Contact.Time + Contact.Normal * math::ROUNDING_ERROR);
+        
+        /* Slide along the contact with the remaining movement */
+        Direction *= (1.0f - Contact.Time);
+        
+        const f32 NormalMovement = Direction.dot(Contact.Normal);
+        
+        if (NormalMovement < 0.0f)
+            Direction -= Contact.Normal * NormalMovement;
+    }
+    
+    return true;
+}
+
+bool CollisionNode::checkSweepSupport(const std::vector<CollisionNode*>* RivalList) const
+{
+    /* Swept collisions are only used when the collisions are resolved */
+    if (!(getFlags() & COLLISIONFLAG_RESOLVE))
+        return false;
+    
+    const s32 SupportFlags = getSweepSupportFlags();
+    
+    if (SupportFlags == COLLISIONSUPPORT_NONE)
+        return false;
+    
+    /* Check if all rival collision models are supported */
+    if (RivalList)
+    {
+        foreach (const CollisionNode* Rival, *RivalList)
+        {
+            if (Rival != this && !(SupportFlags & getCollisionSupportFlag(Rival->getType())))
+                return false;
+        }
+    }
+    else
+    {
+        foreach (const CollisionMaterial* RivalMaterial, Material_->RivalCollMaterials_)
+        {
+            foreach (const CollisionNode* Rival, RivalMaterial->CollNodes_)
+            {
+                if (Rival != this && !(SupportFlags & getCollisionSupportFlag(Rival->getType())))
+                    return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool CollisionNode::findFirstSweepContact(
+    const std::vector<CollisionNode*>* RivalList, const dim::vector3df &Direction, SSweepContact &Contact)
+{
+    while (1)
+    {
+        /* Find the earliest contact without notifying the candidates */
+        SSweepContact FirstContact;
+        const CollisionNode* FirstRival = 0;
+        
+        if (RivalList)
+        {
+            /* Only check the candidates found by the broadphase */
+            foreach (const CollisionNode* Rival, *RivalList)
+            {
+                if (checkSweepContact(Rival, Direction, FirstContact))
+                    FirstRival = Rival;
+            }
+        }
+        else
+        {
+            /* Check all nodes of each rival material */
+            foreach (const CollisionMaterial* RivalMaterial, Material_->RivalCollMaterials_)
+            {
+                foreach (const CollisionNode* Rival, RivalMaterial->CollNodes_)
+                {
+                    if (checkSweepContact(Rival, Direction, FirstContact))
+                        FirstRival = Rival;
+                }
+            }
+        }
+        
+        if (!FirstRival)
+            return false;
+        
+        /* Notify only the earliest contact, which can also reject the contact */
+        SCollisionContact CollContact;
+        
+        CollContact.Point       = FirstContact.Point;
+        CollContact.Normal      = FirstContact.Normal;
+        CollContact.Triangle    = FirstContact.Triangle;
+        CollContact.Face        = FirstContact.Face;
+        
+        if (notifyCollisionContact(FirstRival, CollContact))
+        {
+            Contact = FirstContact;
+            return true;
+        }
+        
+        /* Ignore the rejected rival for the rest of this movement and search the next contact */
+        SweepRejectedRivals_.push_back(FirstRival);
+    }
+}
+
+bool CollisionNode::checkSweepContact(const CollisionNode* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (Rival == this || std::find(SweepRejectedRivals_.begin(), SweepRejectedRivals_.end(), Rival) != SweepRejectedRivals_.end())
+        return false;
+    
+    SSweepContact CurContact;
+    
+    if (!sweepCollision(Rival, Direction, CurContact) || CurContact.Time >= Contact.Time)
+        return false;
+    
+    Contact = CurContact;
+    
+    return true;
+}
+
+const std::vector<SCollisionFace*>& CollisionNode::gatherSweepFaces(
+    const TreeNode* RootTreeNode, const dim::line3df &Line, f32 Radius) const
+{
+    /* Get tree node list along the movement and grow the scratch list if it was too small */
+    if (SweepTreeNodes_.empty())
+        SweepTreeNodes_.resize(64);
+    
+    const u32 Count = RootTreeNode->findLeafList(&SweepTreeNodes_[0], SweepTreeNodes_.size(), Line, Radius);
+    
+    if (Count > SweepTreeNodes_.size())
+    {
+        SweepTreeNodes_.resize(Count);
+        RootTreeNode->findLeafList(&SweepTreeNodes_[0], Count, Line, Radius);
+    }
+    
+    /* Gather the faces of each tree node */
+    SweepFaces_.clear();
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        CollisionMesh::TreeNodeDataType* TreeNodeData = static_cast<CollisionMesh::TreeNodeDataType*>(SweepTreeNodes_[i]->getUserData());
+        
+        if (!TreeNodeData)
+            continue;
+        
+        #ifndef _DEB_NEW_KDTREE_
+        SweepFaces_.insert(SweepFaces_.end(), TreeNodeData->begin(), TreeNodeData->end());
+        #else
+        foreach (SCollisionFace &Face, *TreeNodeData)
+            SweepFaces_.push_back(&Face);
+        #endif
+    }
+    
+    #ifndef _DEB_NEW_KDTREE_
+    /* Remove the faces which are referenced by several tree nodes */
+    std::sort(SweepFaces_.begin(), SweepFaces_.end());
+    SweepFaces_.erase(std::unique(SweepFaces_.begin(), SweepFaces_.end()), SweepFaces_.end());
+    #endif
+    
+    return SweepFaces_;
+}
+
+dim::aabbox3df CollisionNode::getTransformedBox(const dim::matrix4f &Matrix, const dim::aabbox3df &Box)
+{
+    dim::aabbox3df Result(dim::aabbox3df::OMEGA);
+    
+    for (u32 i = 0; i < 8; ++i)
+        Result.insertPoint(Matrix * Box.getCorner(i));
+    
+    return Result;
+}
+
 
 } // /namespace scene
 
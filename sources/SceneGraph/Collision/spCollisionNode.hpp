@@ -15,6 +15,7 @@
 #include "Base/spBaseObject.hpp"
 #include "SceneGraph/spSceneNode.hpp"
 #include "SceneGraph/Collision/spCollisionConfigTypes.hpp"
+#include "Base/spDynamicAABBTree.hpp"
 
 
 namespace sp
@@ -52,6 +53,15 @@ class SP_EXPORT CollisionNode : public BaseObject
         //! Sets the collision material
         virtual void setMaterial(CollisionMaterial* Material);
         
+        /**
+        Computes the global axis-aligned bounding box of this collision node.
+        This is used by the collision graph's broadphase.
+        \param[out] Box Specifies the resulting bounding box.
+        \return False if this collision model is unbounded (e.g. a plane). In this case
+        the collision node will always be passed to the narrow phase.
+        */
+        virtual bool getBoundingBox(dim::aabbox3df &Box) const;
+        
         /**
         Checks for intersections between this collision object and the given line and stored the result in the specified contact list.
         \param Line: Specifies the line which could intersect this object.
@@ -60,6 +70,27 @@ class SP_EXPORT CollisionNode : public BaseObject
         */
         virtual void findIntersections(const dim::line3df &Line, std::list<SIntersectionContact> &ContactList) const;
         
+        /**
+        Finds the nearest intersections between this collision object and the given line without any memory allocation.
+        \param[in] Line Specifies the line which could intersect this object.
+        \param[out] Contacts Pointer to the array where the intersection results are to be stored.
+        The contacts are sorted by their distance to the line's start point.
+        \param[in] MaxCount Specifies the count of elements in the array. Only the nearest intersections will be stored.
+        \return Count of intersections which have been stored.
+        \since Version 3.3
+        */
+        virtual u32 findIntersections(const dim::line3df &Line, SIntersectionContact* Contacts, u32 MaxCount) const;
+        
+        /**
+        Passes each intersection between this collision object and the given line to the specified visitor
+        without any memory allocation. The intersections are visited in the order of their distance to the line's start point.
+        \param[in] Line Specifies the line which could intersect this object.
+        \param[in] Visitor Specifies the visitor callback. Return false in this callback to stop the search.
+        \return False if the search has been stopped by the visitor.
+        \since Version 3.3
+        */
+        virtual bool findIntersections(const dim::line3df &Line, const IntersectionVisitorCallback &Visitor) const;
+        
         /**
         Checks for an intersection between this collision object and the given line and stores the result in the specified contact structure.
         \param Line: Specifies the line which could intersect this object.
@@ -86,6 +117,29 @@ class SP_EXPORT CollisionNode : public BaseObject
         //! Checks for a collision between this collision object and the rival object and performs collision resolving as well.
         virtual void performCollisionResolving(const CollisionNode* Rival);
         
+        /**
+        Checks for the first contact when this collision node is moved along the specified direction (swept collision test).
+        The rival collision node is assumed to be static during the movement.
+        \param[in] Rival Specifies the rival collision node.
+        \param[in] Direction Specifies the movement (in global space) starting at the current position.
+        \param[out] Contact Specifies the resulting contact. The "Time" member specifies
+        how far this collision node can be moved until the contact occurs.
+        \return True if a contact occurs during the movement. This is always false if the rival's collision model is not supported.
+        \see getSweepSupportFlags
+        \since Version 3.3
+        */
+        virtual bool sweepCollision(const CollisionNode* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        
+        /**
+        Returns the flags for swept collision support to rival collision nodes. By default COLLISIONSUPPORT_NONE.
+        Movements which are larger than "getMaxMovement" are resolved with a swept collision test if all rival
+        collision models are supported. Otherwise the movement is resolved in several small steps.
+        \see ECollisionSupportFlags
+        \see sweepCollision
+        \since Version 3.3
+        */
+        virtual s32 getSweepSupportFlags() const;
+        
         /**
         Sets up the collision node transformation directly.
         Only use this if you want to use a custom transformation for the collision node.
@@ -118,6 +172,16 @@ class SP_EXPORT CollisionNode : public BaseObject
         */
         void updateCollisions();
         
+        /**
+        Wakes up this collision node. A sleeping collision node will not be updated by the collision graph until it is woken up.
+        This is done automatically when the transformation is changed (e.g. with "setPosition" or "updateTransformation")
+        or when another collision node moves into its bounding box.
+        \see isSleeping
+        \see CollisionGraph::setSleepFrameCount
+        \since Version 3.3
+        */
+        void wakeUp();
+        
         /* === Inline functions === */
         
         //! Returns the collision model type.
@@ -238,6 +302,17 @@ class SP_EXPORT CollisionNode : public BaseObject
             return PrevPosition_;
         }
         
+        /**
+        Returns true if this collision node is sleeping, i.e. its transformation has not been changed
+        for several frames. Only the collision graph's broadphase puts collision nodes to sleep.
+        \see wakeUp
+        \since Version 3.3
+        */
+        inline bool isSleeping() const
+        {
+            return IsSleeping_;
+        }
+        
     protected:
         
         friend class CollisionGraph;
@@ -270,7 +345,18 @@ class SP_EXPORT CollisionNode : public BaseObject
         virtual void performCollisionResolvingToPlane   (const CollisionPlane*      Rival);
         virtual void performCollisionResolvingToMesh    (const CollisionMesh*       Rival);
         
-        //! Returns true if the collision is about to be resolved.
+        virtual bool sweepCollisionToSphere     (const CollisionSphere*     Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        virtual bool sweepCollisionToCapsule    (const CollisionCapsule*    Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        virtual bool sweepCollisionToCylinder   (const CollisionCylinder*   Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        virtual bool sweepCollisionToCone       (const CollisionCone*       Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        virtual bool sweepCollisionToBox        (const CollisionBox*        Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        virtual bool sweepCollisionToPlane      (const CollisionPlane*      Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        virtual bool sweepCollisionToMesh       (const CollisionMesh*       Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        
+        /**
+        Returns true if the collision is about to be resolved.
+        While the contacts are deferred (during a batched update) the contact is stored and true is returned.
+        */
         bool notifyCollisionContact(const CollisionNode* Rival, const SCollisionContact &Contact);
         //! Returns true if the collision has been resolved.
         bool performDetectedContact(const CollisionNode* Rival, const SCollisionContact &Contact);
@@ -279,10 +365,71 @@ class SP_EXPORT CollisionNode : public BaseObject
         
         void updatePrevPosition();
         
+        //! Delivers the contacts which have been deferred during a batched update. The return values are ignored.
+        void flushContacts();
+        
+        //! Returns true if this collision node needs to perform collision detection in the current frame.
+        bool requireCollisionUpdate() const;
+        
+        /**
+        Performs the collision resolving (in several steps if the movement is too large).
+        \param[in] RivalList Specifies the list of rival candidates. If this is null, all
+        collision nodes of the rival materials will be used.
+        */
+        void performCollisionUpdate(const std::vector<CollisionNode*>* RivalList);
+        void performRivalResolving(const std::vector<CollisionNode*>* RivalList);
+        
+        /**
+        Counts the frames without any transformation change and puts this collision node to sleep.
+        \param[in] SleepFrameCount Specifies the count of frames until the node falls asleep. If 0 the node never falls asleep.
+        */
+        void updateSleepState(u32 SleepFrameCount);
+        
+        /**
+        Moves this collision node from its previous position along the specified direction until the first contact
+        and slides along the contact with the remaining movement.
+        \return False if swept collision is not supported for all rivals. In this case the collision node is not moved.
+        */
+        bool performSweptMovement(const std::vector<CollisionNode*>* RivalList, dim::vector3df Direction);
+        
+        bool checkSweepSupport(const std::vector<CollisionNode*>* RivalList) const;
+        
+        /**
+        Searches the contact with the earliest time of impact and notifies only this contact.
+        If the contact is rejected by the contact callback, the rival is ignored for the rest of the movement.
+        */
+        bool findFirstSweepContact(const std::vector<CollisionNode*>* RivalList, const dim::vector3df &Direction, SSweepContact &Contact);
+        //! Returns true if the rival is hit earlier than the specified contact. The contact is not notified.
+        bool checkSweepContact(const CollisionNode* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        
+        /**
+        Gathers the unique faces of all tree leaves which are intersected by the specified volumetric line.
+        The scratch lists are kept by this collision node, so sweeping does not allocate memory once they have grown.
+        \param[in] RootTreeNode Specifies the rival mesh's root tree node.
+        \param[in] Line Specifies the line in the rival mesh's object space.
+        \param[in] Radius Specifies the line's radius.
+        \return Constant reference to the face list. This is valid until the next call.
+        */
+        const std::vector<SCollisionFace*>& gatherSweepFaces(const TreeNode* RootTreeNode, const dim::line3df &Line, f32 Radius) const;
+        
+        /* === Static functions === */
+        
+        //! Returns the axis-aligned bounding box of the specified transformed box.
+        static dim::aabbox3df getTransformedBox(const dim::matrix4f &Matrix, const dim::aabbox3df &Box);
+        
     private:
         
         friend class CollisionMaterial;
         
+        /* === Structures === */
+        
+        //! Contact whose callback is delivered after a batched update.
+        struct SDeferredContact
+        {
+            const CollisionNode* Rival;
+            SCollisionContact Contact;
+        };
+        
         /* === Members === */
         
         ECollisionModels Type_;         //!< Collision type (or rather model).
@@ -301,6 +448,21 @@ class SP_EXPORT CollisionNode : public BaseObject
         
         bool UseOffsetTrans_;           //!< Specifies whether offset transformation is enabled or not.
         
+        u32 QuietFrames_;               //!< Count of frames without any transformation change.
+        bool IsSleeping_;               //!< Specifies whether this node is sleeping. Used by the collision graph.
+        bool HasMoved_;                 //!< Specifies whether the transformation has changed since the last sleep state update.
+        
+        DynamicAABBTree* ProxyTree_;    //!< Broadphase tree which holds this node's proxy. Used by the collision graph.
+        s32 ProxyID_;                   //!< Broadphase proxy ID. Used by the collision graph.
+        
+        bool DeferContacts_;            //!< Specifies whether the contact callbacks are deferred. Used by the collision graph.
+        std::vector<SDeferredContact> DeferredContacts_;
+        
+        std::vector<const CollisionNode*> SweepRejectedRivals_; //!< Rivals whose swept contact has been rejected during the current movement.
+        
+        mutable std::vector<const TreeNode*> SweepTreeNodes_;   //!< Scratch list for the tree leaves of swept collisions.
+        mutable std::vector<SCollisionFace*> SweepFaces_;       //!< Scratch list for the faces of swept collisions.
+        
 };
 
 
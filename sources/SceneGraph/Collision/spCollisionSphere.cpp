@@ -39,11 +39,26 @@ s32 CollisionSphere::getSupportFlags() const
     return COLLISIONSUPPORT_ALL;
 }
 
+s32 CollisionSphere::getSweepSupportFlags() const
+{
+    return COLLISIONSUPPORT_SPHERE | COLLISIONSUPPORT_CAPSULE | COLLISIONSUPPORT_BOX | COLLISIONSUPPORT_PLANE | COLLISIONSUPPORT_MESH;
+}
+
 f32 CollisionSphere::getMaxMovement() const
 {
     return getRadius() * 0.8f;
 }
 
+bool CollisionSphere::getBoundingBox(dim::aabbox3df &Box) const
+{
+    const dim::vector3df SpherePos(getPosition());
+    
+    Box.Min = SpherePos - getRadius();
+    Box.Max = SpherePos + getRadius();
+    
+    return true;
+}
+
 bool CollisionSphere::checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const
 {
     const dim::vector3df SpherePos(getPosition());
@@ -356,6 +371,10 @@ bool CollisionSphere::checkAnyCollisionToMesh(const CollisionMesh* Rival) const
     
     const dim::vector3df SpherePosInv(RivalMatInv * SpherePos);
     
+    /* Use the batched sphere-triangle tests of the linear kd-Tree if available */
+    if (!Rival->getLinearTree().empty())
+        return Rival->getLinearTree().checkSphereIntersection(SpherePosInv, getRadius(), CollFace);
+    
     const f32 RadiusSq = math::pow2(getRadius());
     
     #ifndef _DEB_NEW_KDTREE_
@@ -613,6 +632,157 @@ void CollisionSphere::performCollisionResolvingToMesh(const CollisionMesh* Rival
     }
 }
 
+bool CollisionSphere::sweepCollisionToSphere(const CollisionSphere* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::vector3df SpherePos(getPosition());
+    const dim::vector3df OtherPos(Rival->getPosition());
+    
+    /* Check if this object hits the other one during the movement */
+    if (math::CollisionLibrary::checkSweptSphereSphereIntersection(
+            SpherePos, getRadius(), Direction, OtherPos, Rival->getRadius(), Contact.Time, Contact.Normal))
+    {
+        Contact.Point = OtherPos + Contact.Normal * Rival->getRadius();
+        return true;
+    }
+    
+    return false;
+}
+
+bool CollisionSphere::sweepCollisionToCapsule(const CollisionCapsule* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::vector3df SpherePos(getPosition());
+    const dim::line3df RivalLine(Rival->getLine());
+    
+    /* Check if this object hits the other one during the movement */
+    if (math::CollisionLibrary::checkSweptSphereCapsuleIntersection(
+            SpherePos, getRadius(), Direction, RivalLine, Rival->getRadius(), Contact.Time, Contact.Normal))
+    {
+        Contact.Point = SpherePos + Direction * Contact.Time - Contact.Normal * getRadius();
+        return true;
+    }
+    
+    return false;
+}
+
+bool CollisionSphere::sweepCollisionToBox(const CollisionBox* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::matrix4f Mat(Rival->getTransformation().getPositionRotationMatrix());
+    const dim::matrix4f InvMat(Mat.getInverse());
+    
+    const dim::aabbox3df Box(Rival->getBox().getScaled(Rival->getScale()));
+    const dim::vector3df SpherePos(getPosition());
+    const dim::vector3df SphereInvPos(InvMat * SpherePos);
+    
+    if (Box.isPointInside(SphereInvPos))
+        return false;
+    
+    /* Check if this object hits the box during the movement (in the box's object space) */
+    if (math::CollisionLibrary::checkSweptSphereBoxIntersection(
+            SphereInvPos, getRadius(), Mat.vecRotateInverse(Direction), Box, Contact.Time, Contact.Normal))
+    {
+        Contact.Normal  = Mat.vecRotate(Contact.Normal);
+        Contact.Point   = SpherePos + Direction * Contact.Time - Contact.Normal * getRadius();
+        return true;
+    }
+    
+    return false;
+}
+
+bool CollisionSphere::sweepCollisionToPlane(const CollisionPlane* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Store transformation */
+    const dim::vector3df SpherePos(getPosition());
+    const dim::plane3df RivalPlane(
+        Rival->getTransformation().getPositionRotationMatrix() * Rival->getPlane()
+    );
+    
+    /* Only the plane's front side is collidable */
+    const f32 Distance = RivalPlane.getPointDistance(SpherePos);
+    const f32 Movement = RivalPlane.Normal.dot(Direction);
+    
+    if (Distance <= 0.0f || Movement >= 0.0f)
+        return false;
+    
+    /* Compute the time where the sphere touches the plane */
+    Contact.Time = math::Max(0.0f, (Distance - getRadius()) / (-Movement));
+    
+    if (Contact.Time > 1.0f)
+        return false;
+    
+    Contact.Normal  = RivalPlane.Normal;
+    Contact.Point   = SpherePos + Direction * Contact.Time - Contact.Normal * getRadius();
+    
+    return true;
+}
+
+bool CollisionSphere::sweepCollisionToMesh(const CollisionMesh* Rival, const dim::vector3df &Direction, SSweepContact &Contact) const
+{
+    if (!Rival)
+        return false;
+    
+    /* Check if rival mesh has a tree-hierarchy */
+    KDTreeNode* RootTreeNode = Rival->getRootTreeNode();
+    
+    if (!RootTreeNode)
+        return false;
+    
+    /* Store transformation */
+    const dim::vector3df SpherePos(getPosition());
+    const video::EFaceTypes CollFace(Rival->getCollFace());
+    
+    const dim::matrix4f RivalMat(Rival->getTransformation());
+    const dim::matrix4f RivalMatInv(RivalMat.getInverse());
+    
+    const dim::line3df SweepLineInv(RivalMatInv * SpherePos, RivalMatInv * (SpherePos + Direction));
+    const f32 SweepRadius = (RivalMatInv.getScale() * getRadius()).getMax();
+    
+    bool Result = false;
+    f32 Time = 1.0f;
+    dim::vector3df Normal;
+    
+    /* Check swept collision with each unique triangle along the movement */
+    foreach (SCollisionFace* Face, gatherSweepFaces(RootTreeNode, SweepLineInv, SweepRadius))
+    {
+        /* Check for face-culling at the start position */
+        if (Face->isBackFaceCulling(CollFace, SweepLineInv.Start))
+            continue;
+        
+        /* Make swept sphere-triangle collision test */
+        const dim::triangle3df Triangle(RivalMat * Face->Triangle);
+        
+        if (math::CollisionLibrary::checkSweptSphereTriangleIntersection(SpherePos, getRadius(), Direction, Triangle, Time, Normal) &&
+            Time < Contact.Time)
+        {
+            /* Store new first contact */
+            Contact.Time        = Time;
+            Contact.Normal      = Normal;
+            Contact.Triangle    = Triangle;
+            Contact.Face        = Face;
+            Result              = true;
+        }
+    }
+    
+    if (Result)
+        Contact.Point = SpherePos + Direction * Contact.Time - Contact.Normal * getRadius();
+    
+    return Result;
+}
+
 bool CollisionSphere::checkPointDistanceSingle(
     const dim::vector3df &SpherePos, const dim::vector3df &ClosestPoint,
     f32 MaxRadius, SCollisionContact &Contact) const
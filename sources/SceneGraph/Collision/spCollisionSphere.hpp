@@ -36,8 +36,11 @@ class SP_EXPORT CollisionSphere : public CollisionNode
         /* Functions */
         
         s32 getSupportFlags() const;
+        s32 getSweepSupportFlags() const;
         f32 getMaxMovement() const;
         
+        bool getBoundingBox(dim::aabbox3df &Box) const;
+        
         bool checkIntersection(const dim::line3df &Line, SIntersectionContact &Contact) const;
         bool checkIntersection(const dim::line3df &Line, bool ExcludeCorners = false) const;
         
@@ -76,6 +79,12 @@ class SP_EXPORT CollisionSphere : public CollisionNode
         void performCollisionResolvingToPlane   (const CollisionPlane*      Rival);
         void performCollisionResolvingToMesh    (const CollisionMesh*       Rival);
         
+        bool sweepCollisionToSphere (const CollisionSphere*     Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToCapsule(const CollisionCapsule*    Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToBox    (const CollisionBox*        Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToPlane  (const CollisionPlane*      Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        bool sweepCollisionToMesh   (const CollisionMesh*       Rival, const dim::vector3df &Direction, SSweepContact &Contact) const;
+        
         bool checkPointDistanceSingle(
             const dim::vector3df &SpherePos, const dim::vector3df &ClosestPoint,
             f32 MaxRadius, SCollisionContact &Contact
@@ -39,6 +39,45 @@ bool BoundingVolume::checkFrustumCulling(const scene::ViewFrustum &Frustum, cons
     );
 }
 
+dim::aabbox3df BoundingVolume::getGlobalBox(const dim::matrix4f &Transformation) const
+{
+    switch (Type_)
+    {
+        case BOUNDING_SPHERE:
+        {
+            const dim::vector3df Center(Transformation.getPosition());
+            const f32 Radius = Radius_ * Transformation.getScale().getMax();
+            return dim::aabbox3df(Center - Radius, Center + Radius);
+        }
+        
+        case BOUNDING_BOX:
+        {
+            /* Compute the axis-aligned extent of the transformed box */
+            const dim::vector3df HalfSize((Box_.Max - Box_.Min) * 0.5f);
+            const dim::vector3df Center(Transformation * Box_.getCenter());
+            
+            dim::vector3df Extent;
+            
+            for (s32 k = 0; k < 3; ++k)
+            {
+                const dim::vector4df& Column = Transformation.getColumn(k);
+                
+                Extent.X += math::Abs(Column.X) * HalfSize[k];
+                Extent.Y += math::Abs(Column.Y) * HalfSize[k];
+                Extent.Z += math::Abs(Column.Z) * HalfSize[k];
+            }
+            
+            return dim::aabbox3df(Center - Extent, Center + Extent);
+        }
+        
+        default:
+        {
+            const dim::vector3df Position(Transformation.getPosition());
+            return dim::aabbox3df(Position, Position);
+        }
+    }
+}
+
 
 } // /namespace scene
 
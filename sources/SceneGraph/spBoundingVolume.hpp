@@ -50,6 +50,15 @@ class SP_EXPORT BoundingVolume
         */
         bool checkFrustumCulling(const scene::ViewFrustum &Frustum, const dim::matrix4f &Transformation) const;
         
+        /**
+        Returns the axis-aligned box which encloses the transformed bounding volume.
+        Bounding spheres are scaled by the largest scaling of the transformation.
+        \param Transformation: Global transformation of the object.
+        \return Global axis-aligned bounding box. For BOUNDING_NONE the box only contains the transformation's position.
+        \since Version 3.3
+        */
+        dim::aabbox3df getGlobalBox(const dim::matrix4f &Transformation) const;
+        
         /* === Inline functions === */
         
         /**
@@ -0,0 +1,1030 @@
+/*
+ * Mesh simplifier file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spMeshSimplifier.hpp"
+#include "SceneGraph/spSceneMesh.hpp"
+#include "SceneGraph/spSceneGraph.hpp"
+#include "Base/spMeshBuffer.hpp"
+#include "Base/spThreadManager.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spTimer.hpp"
+#include "Base/spInputOutputLog.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+
+
+namespace sp
+{
+
+extern io::OSInformator* GlbPlatformInfo;
+extern scene::SceneGraph* GlbSceneGraph;
+
+namespace scene
+{
+
+
+namespace MeshSimplifier
+{
+
+/*
+ * Internal members
+ */
+
+//! Weight of the constraint planes along open borders.
+static const f64 SIMPLIFY_BORDER_WEIGHT = 10.0;
+
+//! Weight of the normal deviation in the collapse error.
+static const f32 SIMPLIFY_NORMAL_WEIGHT = 1.0f;
+
+//! Minimal cosine between the old and new normal of a triangle which is moved by a collapse.
+static const f32 SIMPLIFY_FLIP_THRESHOLD = 0.25f;
+
+enum ESimplifyVertexKinds
+{
+    SIMPLIFYVERTEX_MANIFOLD,    //!< Inner vertex, can be collapsed onto any neighbour.
+    SIMPLIFYVERTEX_BORDER,      //!< Vertex on an open border, can only be collapsed along the border.
+    SIMPLIFYVERTEX_SEAM,        //!< Vertex which shares its position, is only moved together with the other vertices along the seam.
+    SIMPLIFYVERTEX_LOCKED,      //!< Non-manifold vertex or seam vertex on an open border, is never moved.
+};
+
+
+/*
+ * Internal structures
+ */
+
+//! Symmetric quadric matrix (A, b, c) with the error p^T*A*p + 2*b*p + c.
+struct SQuadric
+{
+    SQuadric() :
+        A00(0.0), A01(0.0), A02(0.0), A11(0.0), A12(0.0), A22(0.0),
+        B0(0.0), B1(0.0), B2(0.0), C(0.0)
+    {
+    }
+    
+    /* Functions */
+    
+    void addPlane(f64 NX, f64 NY, f64 NZ, f64 D, f64 Weight)
+    {
+        A00 += Weight*NX*NX; A01 += Weight*NX*NY; A02 += Weight*NX*NZ;
+        A11 += Weight*NY*NY; A12 += Weight*NY*NZ; A22 += Weight*NZ*NZ;
+        B0 += Weight*NX*D; B1 += Weight*NY*D; B2 += Weight*NZ*D;
+        C += Weight*D*D;
+    }
+    
+    void add(const SQuadric &Other)
+    {
+        A00 += Other.A00; A01 += Other.A01; A02 += Other.A02;
+        A11 += Other.A11; A12 += Other.A12; A22 += Other.A22;
+        B0 += Other.B0; B1 += Other.B1; B2 += Other.B2;
+        C += Other.C;
+    }
+    
+    f64 evaluate(const dim::vector3df &Point) const
+    {
+        const f64 X = Point.X, Y = Point.Y, Z = Point.Z;
+        return
+            A00*X*X + A11*Y*Y + A22*Z*Z + 2.0*(A01*X*Y + A02*X*Z + A12*Y*Z) +
+            2.0*(B0*X + B1*Y + B2*Z) + C;
+    }
+    
+    /* Members */
+    
+    f64 A00, A01, A02, A11, A12, A22;
+    f64 B0, B1, B2;
+    f64 C;
+};
+
+struct SCollapse
+{
+    bool operator < (const SCollapse &Other) const
+    {
+        return Error < Other.Error;
+    }
+    
+    u32 From, To;
+    f32 Error;
+};
+
+//! Simplification of one mesh buffer. The vertex data is extracted before, so no mesh buffer is accessed in the threads.
+struct SSimplifyTask
+{
+    std::vector<dim::vector3df> Coords;
+    std::vector<dim::vector3df> Normals;
+    std::vector<u32> Indices;
+    std::vector<u32> TargetCounts;              //!< Target triangle count of each level.
+    f32 MaxError;
+    bool Simplify;                              //!< False for mesh buffers which are no triangle lists.
+    std::vector< std::vector<u32> > Levels;     //!< Resulting triangle indices of each level.
+};
+
+//! Vertex which is moved onto another vertex by a collapse.
+typedef std::pair<u32, u32> TVertexMove;
+
+//! Simplification state of one mesh buffer.
+class SimplifyState
+{
+    
+    public:
+        
+        SimplifyState(SSimplifyTask &Task);
+        ~SimplifyState()
+        {
+        }
+        
+        /* Functions */
+        
+        void run();
+        
+    private:
+        
+        /* Functions */
+        
+        void setupVertexKinds();
+        void setupQuadrics();
+        
+        u32 collapsePass(u32 TargetCount);
+        void setupAdjacency();
+        
+        bool canCollapse(u32 From, u32 To) const;
+        bool getCollapseMoves(u32 From, u32 To, std::vector<TVertexMove> &Moves) const;
+        bool getSeamPartner(u32 Vertex, u32 Group, u32 &Partner) const;
+        
+        f32 getCollapseError(u32 From, u32 To) const;
+        f32 getCollapseError(const std::vector<TVertexMove> &Moves) const;
+        
+        bool isFlipped(u32 From, u32 To) const;
+        bool isFlipped(const std::vector<TVertexMove> &Moves) const;
+        bool isBorderEdge(u32 A, u32 B) const;
+        
+        static inline u64 getEdgeKey(u32 A, u32 B)
+        {
+            return (static_cast<u64>(A) << 32) | static_cast<u64>(B);
+        }
+        
+        /* Members */
+        
+        SSimplifyTask& Task_;
+        
+        std::vector<dim::vector3df> Coords_;    //!< Coordinates scaled into the unit cube.
+        std::vector<u32> Group_;                //!< First vertex with the same position.
+        std::vector<u32> GroupNext_;            //!< Next vertex with the same position (circular list).
+        std::vector<u8> Kind_;
+        std::vector<u64> BorderEdges_;          //!< Sorted undirected border edges.
+        std::vector<SQuadric> Quadrics_;
+        
+        std::vector<u32> AdjOffsets_;
+        std::vector<u32> AdjTriangles_;
+        
+        std::vector<u32> Indices_;
+        
+        std::vector<TVertexMove> Moves_;
+        
+};
+
+struct SSimplifierThreadData
+{
+    std::vector<SSimplifyTask>* Tasks;
+    u32 First, Step;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+
+/*
+ * Internal functions
+ */
+
+static void runSimplifyTasks(std::vector<SSimplifyTask> &Tasks, u32 First, u32 Step)
+{
+    for (u32 i = First; i < Tasks.size(); i += Step)
+    {
+        if (Tasks[i].Simplify)
+        {
+            SimplifyState State(Tasks[i]);
+            State.run();
+        }
+    }
+}
+
+THREAD_PROC(MeshSimplifierThreadProc)
+{
+    SSimplifierThreadData* ThreadData = reinterpret_cast<SSimplifierThreadData*>(Arguments);
+    
+    /* Simplify the mesh buffers given to this thread */
+    runSimplifyTasks(*ThreadData->Tasks, ThreadData->First, ThreadData->Step);
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+static bool cmpSimplifyCoords(const std::pair<dim::vector3df, u32> &A, const std::pair<dim::vector3df, u32> &B)
+{
+    if (A.first.X != B.first.X) return A.first.X < B.first.X;
+    if (A.first.Y != B.first.Y) return A.first.Y < B.first.Y;
+    if (A.first.Z != B.first.Z) return A.first.Z < B.first.Z;
+    return A.second < B.second;
+}
+
+static bool equalSimplifyCoords(const std::pair<dim::vector3df, u32> &A, const std::pair<dim::vector3df, u32> &B)
+{
+    return A.first.X == B.first.X && A.first.Y == B.first.Y && A.first.Z == B.first.Z;
+}
+
+static void weldSimplifyVertices(SSimplifyTask &Task, const video::MeshBuffer &Surface)
+{
+    const u32 NumVertices = Task.Coords.size();
+    
+    const dim::UniversalBuffer& Buffer = Surface.getVertexBuffer();
+    const size_t Stride = Buffer.getStride();
+    
+    /* Sort the vertices by their positions */
+    std::vector< std::pair<dim::vector3df, u32> > Order(NumVertices);
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+        Order[i] = std::make_pair(Task.Coords[i], i);
+    
+    std::sort(Order.begin(), Order.end(), cmpSimplifyCoords);
+    
+    /* Replace each vertex by the first vertex with exactly the same data */
+    std::vector<u32> Weld(NumVertices);
+    
+    for (u32 i = 0; i < NumVertices;)
+    {
+        u32 j = i + 1;
+        while (j < NumVertices && equalSimplifyCoords(Order[i], Order[j]))
+            ++j;
+        
+        for (u32 k = i; k < j; ++k)
+        {
+            const u32 Vertex = Order[k].second;
+            Weld[Vertex] = Vertex;
+            
+            for (u32 l = i; l < k; ++l)
+            {
+                const u32 Other = Order[l].second;
+                
+                if (Weld[Other] == Other && !memcmp(Buffer.getArray(Other, 0), Buffer.getArray(Vertex, 0), Stride))
+                {
+                    Weld[Vertex] = Other;
+                    break;
+                }
+            }
+        }
+        
+        i = j;
+    }
+    
+    foreach (u32 &Index, Task.Indices)
+        Index = Weld[Index];
+}
+
+static void checkSimplifyTask(const SSimplifyTask &Task)
+{
+    if (!Task.Simplify || Task.Levels.empty())
+        return;
+    
+    const u32 NumTriangles = Task.Levels.back().size() / 3;
+    
+    if (NumTriangles > Task.TargetCounts.back())
+    {
+        io::Log::warning(
+            "Mesh buffer could only be simplified to " + io::stringc(NumTriangles) + " instead of " +
+            io::stringc(Task.TargetCounts.back()) + " triangles (flat shading, locked seams or maximal error)"
+        );
+    }
+}
+
+static void setupSimplifyTask(SSimplifyTask &Task, const video::MeshBuffer &Surface, f32 MaxError)
+{
+    const u32 NumVertices = Surface.getVertexCount();
+    
+    Task.MaxError = MaxError;
+    Task.Simplify = (Surface.getPrimitiveType() == video::PRIMITIVE_TRIANGLES);
+    
+    /* Extract the vertex data */
+    Task.Coords.resize(NumVertices);
+    Task.Normals.resize(NumVertices);
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+    {
+        Task.Coords[i]  = Surface.getVertexCoord(i);
+        Task.Normals[i] = Surface.getVertexNormal(i);
+    }
+    
+    /* Extract the triangles or the primitive indices */
+    if (Task.Simplify)
+    {
+        u32 Indices[3];
+        
+        for (u32 i = 0, Num = Surface.getTriangleCount(); i < Num; ++i)
+        {
+            Surface.getTriangleIndices(i, Indices);
+            
+            if (Indices[0] < NumVertices && Indices[1] < NumVertices && Indices[2] < NumVertices)
+                Task.Indices.insert(Task.Indices.end(), Indices, Indices + 3);
+        }
+        
+        /* Unwelded meshes can be simplified like welded ones */
+        weldSimplifyVertices(Task, Surface);
+    }
+    else
+    {
+        for (u32 i = 0, Num = Surface.getIndexCount(); i < Num; ++i)
+            Task.Indices.push_back(Surface.getPrimitiveIndex(i));
+    }
+}
+
+static u32 fillMeshBuffer(const video::MeshBuffer &Source, video::MeshBuffer &Dest, const std::vector<u32> &Indices)
+{
+    /* Collect the used vertices in the order of their first use */
+    std::vector<u32> Remap(Source.getVertexCount(), ~0u);
+    std::vector<u32> UsedVertices;
+    
+    foreach (u32 Index, Indices)
+    {
+        if (Remap[Index] == ~0u)
+        {
+            Remap[Index] = UsedVertices.size();
+            UsedVertices.push_back(Index);
+        }
+    }
+    
+    const s32 FirstVertex = Dest.appendVertices(Source, UsedVertices);
+    
+    if (FirstVertex < 0)
+        return 0;
+    
+    /* Add the primitive indices */
+    const u32 PrevIndexCount = Dest.getIndexCount();
+    
+    Dest.addIndices(Indices.size());
+    
+    for (u32 i = 0; i < Indices.size(); ++i)
+        Dest.setPrimitiveIndex(PrevIndexCount + i, FirstVertex + Remap[Indices[i]]);
+    
+    return Indices.size() / 3;
+}
+
+
+/*
+ * SimplifyState class
+ */
+
+SimplifyState::SimplifyState(SSimplifyTask &Task) :
+    Task_   (Task           ),
+    Indices_(Task.Indices   )
+{
+}
+
+void SimplifyState::run()
+{
+    const u32 NumVertices = Task_.Coords.size();
+    
+    /* Scale the coordinates into the unit cube, so the error is relative to the mesh size */
+    dim::vector3df Min(Task_.Coords.empty() ? dim::vector3df(0.0f) : Task_.Coords.front()), Max(Min);
+    
+    foreach (const dim::vector3df &Coord, Task_.Coords)
+    {
+        Min = dim::vector3df(math::Min(Min.X, Coord.X), math::Min(Min.Y, Coord.Y), math::Min(Min.Z, Coord.Z));
+        Max = dim::vector3df(math::Max(Max.X, Coord.X), math::Max(Max.Y, Coord.Y), math::Max(Max.Z, Coord.Z));
+    }
+    
+    const f32 Extent = (Max - Min).getMax();
+    const f32 InvExtent = (Extent > 0.0f ? 1.0f / Extent : 1.0f);
+    
+    Coords_.resize(NumVertices);
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+        Coords_[i] = (Task_.Coords[i] - Min) * InvExtent;
+    
+    setupVertexKinds();
+    setupQuadrics();
+    
+    /* Collapse edges until the triangle count of each level is reached */
+    foreach (u32 TargetCount, Task_.TargetCounts)
+    {
+        while (Indices_.size() / 3 > TargetCount)
+        {
+            if (!collapsePass(TargetCount))
+                break;
+        }
+        Task_.Levels.push_back(Indices_);
+    }
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void SimplifyState::setupVertexKinds()
+{
+    const u32 NumVertices = Coords_.size();
+    
+    /* Group the used vertices with equal positions (unused vertices, e.g. welded ones, are never moved) */
+    std::vector<u8> Used(NumVertices, 0);
+    
+    foreach (u32 Index, Indices_)
+        Used[Index] = 1;
+    
+    std::vector< std::pair<dim::vector3df, u32> > Order;
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+    {
+        if (Used[i])
+            Order.push_back(std::make_pair(Task_.Coords[i], i));
+    }
+    
+    std::sort(Order.begin(), Order.end(), cmpSimplifyCoords);
+    
+    Group_.resize(NumVertices);
+    GroupNext_.resize(NumVertices);
+    Kind_.assign(NumVertices, SIMPLIFYVERTEX_LOCKED);
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+        Group_[i] = GroupNext_[i] = i;
+    
+    for (u32 i = 0; i < Order.size();)
+    {
+        u32 j = i + 1;
+        while (j < Order.size() && equalSimplifyCoords(Order[i], Order[j]))
+            ++j;
+        
+        for (u32 k = i; k < j; ++k)
+        {
+            Group_[Order[k].second] = Order[i].second;
+            GroupNext_[Order[k].second] = Order[k + 1 < j ? k + 1 : i].second;
+            
+            /* Vertices which share their position (UV seams, hard normal edges) are only moved together */
+            Kind_[Order[k].second] = (j - i > 1 ? SIMPLIFYVERTEX_SEAM : SIMPLIFYVERTEX_MANIFOLD);
+        }
+        
+        i = j;
+    }
+    
+    /* Find the open border edges (directed position edges without an opposite edge) */
+    std::vector<u64> Edges;
+    Edges.reserve(Indices_.size());
+    
+    for (u32 i = 0; i < Indices_.size(); i += 3)
+    {
+        for (u32 j = 0; j < 3; ++j)
+            Edges.push_back(getEdgeKey(Group_[Indices_[i + j]], Group_[Indices_[i + (j + 1) % 3]]));
+    }
+    
+    std::sort(Edges.begin(), Edges.end());
+    
+    std::vector<u32> BorderCount(NumVertices, 0);
+    
+    for (u32 i = 0; i < Indices_.size(); i += 3)
+    {
+        for (u32 j = 0; j < 3; ++j)
+        {
+            const u32 A = Indices_[i + j], B = Indices_[i + (j + 1) % 3];
+            const u64 Key = getEdgeKey(Group_[A], Group_[B]);
+            
+            /* Edges which are used twice in the same direction are non-manifold */
+            std::pair<std::vector<u64>::iterator, std::vector<u64>::iterator> Range(
+                std::equal_range(Edges.begin(), Edges.end(), Key)
+            );
+            
+            if (Range.second - Range.first > 1)
+            {
+                Kind_[A] = Kind_[B] = SIMPLIFYVERTEX_LOCKED;
+                continue;
+            }
+            
+            if (!std::binary_search(Edges.begin(), Edges.end(), getEdgeKey(Group_[B], Group_[A])))
+            {
+                ++BorderCount[A];
+                ++BorderCount[B];
+                BorderEdges_.push_back(getEdgeKey(math::Min(A, B), math::Max(A, B)));
+            }
+        }
+    }
+    
+    std::sort(BorderEdges_.begin(), BorderEdges_.end());
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+    {
+        if (BorderCount[i] > 0)
+        {
+            if (Kind_[i] == SIMPLIFYVERTEX_MANIFOLD)
+                Kind_[i] = (BorderCount[i] == 2 ? SIMPLIFYVERTEX_BORDER : SIMPLIFYVERTEX_LOCKED);
+            else
+                Kind_[i] = SIMPLIFYVERTEX_LOCKED;
+        }
+    }
+}
+
+void SimplifyState::setupQuadrics()
+{
+    Quadrics_.resize(Coords_.size());
+    
+    for (u32 i = 0; i < Indices_.size(); i += 3)
+    {
+        const u32 Tri[3] = { Indices_[i], Indices_[i + 1], Indices_[i + 2] };
+        
+        const dim::vector3df& A = Coords_[Tri[0]];
+        const dim::vector3df& B = Coords_[Tri[1]];
+        const dim::vector3df& C = Coords_[Tri[2]];
+        
+        /* Add the triangle plane, weighted by the triangle area */
+        dim::vector3df Normal((B - A).cross(C - A));
+        const f32 Length = Normal.getLength();
+        
+        if (Length <= 0.0f)
+            continue;
+        
+        Normal /= Length;
+        
+        SQuadric Quadric;
+        Quadric.addPlane(Normal.X, Normal.Y, Normal.Z, -Normal.dot(A), Length * 0.5f);
+        
+        for (u32 j = 0; j < 3; ++j)
+            Quadrics_[Tri[j]].add(Quadric);
+        
+        /* Add constraint planes perpendicular to the triangle along open borders */
+        for (u32 j = 0; j < 3; ++j)
+        {
+            const u32 E0 = Tri[j], E1 = Tri[(j + 1) % 3];
+            
+            if (!isBorderEdge(E0, E1))
+                continue;
+            
+            const dim::vector3df Edge(Coords_[E1] - Coords_[E0]);
+            dim::vector3df EdgeNormal(Edge.cross(Normal));
+            
+            const f32 EdgeLength = EdgeNormal.getLength();
+            
+            if (EdgeLength <= 0.0f)
+                continue;
+            
+            EdgeNormal /= EdgeLength;
+            
+            SQuadric Constraint;
+            Constraint.addPlane(
+                EdgeNormal.X, EdgeNormal.Y, EdgeNormal.Z, -EdgeNormal.dot(Coords_[E0]),
+                Edge.dot(Edge) * SIMPLIFY_BORDER_WEIGHT
+            );
+            
+            Quadrics_[E0].add(Constraint);
+            Quadrics_[E1].add(Constraint);
+        }
+    }
+}
+
+u32 SimplifyState::collapsePass(u32 TargetCount)
+{
+    const u32 NumVertices = Coords_.size();
+    const u32 NumTriangles = Indices_.size() / 3;
+    
+    setupAdjacency();
+    
+    /* Select the cheapest direction of each edge */
+    std::vector<SCollapse> Collapses;
+    Collapses.reserve(Indices_.size());
+    
+    for (u32 i = 0; i < Indices_.size(); i += 3)
+    {
+        for (u32 j = 0; j < 3; ++j)
+        {
+            const u32 A = Indices_[i + j], B = Indices_[i + (j + 1) % 3];
+            
+            /*
+            Each inner edge is visited twice, so only use the one with the lower index first.
+            Seam edges are not shared by the triangles of both sides, so they are always used.
+            */
+            if (A > B && !isBorderEdge(A, B) && Kind_[A] != SIMPLIFYVERTEX_SEAM && Kind_[B] != SIMPLIFYVERTEX_SEAM)
+                continue;
+            
+            SCollapse Collapse;
+            Collapse.Error = -1.0f;
+            
+            if (getCollapseMoves(A, B, Moves_))
+            {
+                Collapse.From   = A;
+                Collapse.To     = B;
+                Collapse.Error  = getCollapseError(Moves_);
+            }
+            if (getCollapseMoves(B, A, Moves_))
+            {
+                const f32 Error = getCollapseError(Moves_);
+                
+                if (Collapse.Error < 0.0f || Error < Collapse.Error)
+                {
+                    Collapse.From   = B;
+                    Collapse.To     = A;
+                    Collapse.Error  = Error;
+                }
+            }
+            
+            if (Collapse.Error >= 0.0f)
+                Collapses.push_back(Collapse);
+        }
+    }
+    
+    std::sort(Collapses.begin(), Collapses.end());
+    
+    /* Apply the cheapest collapses whose neighbourhoods don't overlap */
+    const f32 MaxError = Task_.MaxError * Task_.MaxError;
+    const u32 NumRemove = NumTriangles - TargetCount;
+    
+    std::vector<u32> Remap(NumVertices);
+    std::vector<u8> Touched(NumVertices, 0);
+    
+    for (u32 i = 0; i < NumVertices; ++i)
+        Remap[i] = i;
+    
+    u32 NumCollapses = 0, NumRemoved = 0;
+    
+    foreach (const SCollapse &Collapse, Collapses)
+    {
+        if (Collapse.Error > MaxError || NumRemoved >= NumRemove)
+            break;
+        
+        getCollapseMoves(Collapse.From, Collapse.To, Moves_);
+        
+        bool IsTouched = false;
+        
+        foreach (const TVertexMove &Move, Moves_)
+        {
+            if (Touched[Move.first] || Touched[Move.second])
+                IsTouched = true;
+        }
+        
+        if (IsTouched || isFlipped(Moves_))
+            continue;
+        
+        foreach (const TVertexMove &Move, Moves_)
+        {
+            Remap[Move.first] = Move.second;
+            Quadrics_[Move.second].add(Quadrics_[Move.first]);
+            
+            /* Lock the neighbourhood for this pass and count the triangles which become degenerated */
+            for (u32 j = AdjOffsets_[Move.first]; j < AdjOffsets_[Move.first + 1]; ++j)
+            {
+                const u32* Tri = &Indices_[AdjTriangles_[j]*3];
+                
+                if (Tri[0] == Move.second || Tri[1] == Move.second || Tri[2] == Move.second)
+                    ++NumRemoved;
+                
+                Touched[Tri[0]] = Touched[Tri[1]] = Touched[Tri[2]] = 1;
+            }
+        }
+        
+        ++NumCollapses;
+    }
+    
+    if (!NumCollapses)
+        return 0;
+    
+    /* Rebuild the index list without the degenerated triangles */
+    u32 Num = 0;
+    
+    for (u32 i = 0; i < Indices_.size(); i += 3)
+    {
+        const u32 A = Remap[Indices_[i]], B = Remap[Indices_[i + 1]], C = Remap[Indices_[i + 2]];
+        
+        if (A != B && B != C && A != C)
+        {
+            Indices_[Num++] = A;
+            Indices_[Num++] = B;
+            Indices_[Num++] = C;
+        }
+    }
+    
+    Indices_.resize(Num);
+    
+    return NumCollapses;
+}
+
+void SimplifyState::setupAdjacency()
+{
+    /* Store the triangles of each vertex in one list */
+    AdjOffsets_.assign(Coords_.size() + 1, 0);
+    
+    foreach (u32 Index, Indices_)
+        ++AdjOffsets_[Index + 1];
+    
+    for (u32 i = 1; i < AdjOffsets_.size(); ++i)
+        AdjOffsets_[i] += AdjOffsets_[i - 1];
+    
+    AdjTriangles_.resize(Indices_.size());
+    
+    std::vector<u32> Fill(AdjOffsets_.begin(), AdjOffsets_.end() - 1);
+    
+    for (u32 i = 0; i < Indices_.size(); ++i)
+        AdjTriangles_[Fill[Indices_[i]]++] = i / 3;
+}
+
+bool SimplifyState::canCollapse(u32 From, u32 To) const
+{
+    switch (Kind_[From])
+    {
+        case SIMPLIFYVERTEX_MANIFOLD:
+            return true;
+        case SIMPLIFYVERTEX_BORDER:
+            return Kind_[To] != SIMPLIFYVERTEX_MANIFOLD && isBorderEdge(From, To);
+        case SIMPLIFYVERTEX_SEAM:
+            return Kind_[To] == SIMPLIFYVERTEX_SEAM;
+        default:
+            return false;
+    }
+}
+
+bool SimplifyState::getCollapseMoves(u32 From, u32 To, std::vector<TVertexMove> &Moves) const
+{
+    Moves.clear();
+    
+    if (!canCollapse(From, To))
+        return false;
+    
+    if (Kind_[From] != SIMPLIFYVERTEX_SEAM)
+    {
+        Moves.push_back(TVertexMove(From, To));
+        return true;
+    }
+    
+    /*
+    Move all vertices with the same position together, each onto the vertex at the new position
+    which belongs to the same side of the seam. Otherwise the seam would be torn open.
+    */
+    u32 Vertex = From;
+    
+    do
+    {
+        if (Kind_[Vertex] != SIMPLIFYVERTEX_SEAM)
+            return false;
+        
+        if (AdjOffsets_[Vertex] < AdjOffsets_[Vertex + 1])
+        {
+            u32 Partner = 0;
+            
+            if (!getSeamPartner(Vertex, Group_[To], Partner))
+                return false;
+            
+            Moves.push_back(TVertexMove(Vertex, Partner));
+        }
+        
+        Vertex = GroupNext_[Vertex];
+    }
+    while (Vertex != From);
+    
+    return true;
+}
+
+bool SimplifyState::getSeamPartner(u32 Vertex, u32 Group, u32 &Partner) const
+{
+    /* Find the only vertex of the group which is connected to the specified vertex */
+    Partner = ~0u;
+    
+    for (u32 j = AdjOffsets_[Vertex]; j < AdjOffsets_[Vertex + 1]; ++j)
+    {
+        const u32* Tri = &Indices_[AdjTriangles_[j]*3];
+        
+        for (u32 k = 0; k < 3; ++k)
+        {
+            if (Group_[Tri[k]] == Group && Tri[k] != Partner)
+            {
+                if (Partner != ~0u)
+                    return false;
+                Partner = Tri[k];
+            }
+        }
+    }
+    
+    return Partner != ~0u;
+}
+
+f32 SimplifyState::getCollapseError(u32 From, u32 To) const
+{
+    SQuadric Quadric(Quadrics_[From]);
+    Quadric.add(Quadrics_[To]);
+    
+    f32 Error = static_cast<f32>(math::Max(0.0, Quadric.evaluate(Coords_[To])));
+    
+    /* Collapses between vertices with different normals are more expensive */
+    const dim::vector3df Edge(Coords_[To] - Coords_[From]);
+    const f32 NormalDeviation = 1.0f - Task_.Normals[From].dot(Task_.Normals[To]);
+    
+    Error += math::Max(0.0f, NormalDeviation) * Edge.dot(Edge) * SIMPLIFY_NORMAL_WEIGHT;
+    
+    return Error;
+}
+
+f32 SimplifyState::getCollapseError(const std::vector<TVertexMove> &Moves) const
+{
+    f32 Error = 0.0f;
+    
+    foreach (const TVertexMove &Move, Moves)
+        Error += getCollapseError(Move.first, Move.second);
+    
+    return Error;
+}
+
+bool SimplifyState::isFlipped(u32 From, u32 To) const
+{
+    const dim::vector3df& NewCoord = Coords_[To];
+    
+    for (u32 j = AdjOffsets_[From]; j < AdjOffsets_[From + 1]; ++j)
+    {
+        const u32* Tri = &Indices_[AdjTriangles_[j]*3];
+        
+        if (Tri[0] == To || Tri[1] == To || Tri[2] == To)
+            continue;
+        
+        /* Get the other two vertices in winding order */
+        const u32 k = (Tri[0] == From ? 0 : (Tri[1] == From ? 1 : 2));
+        
+        const dim::vector3df& B = Coords_[Tri[(k + 1) % 3]];
+        const dim::vector3df& C = Coords_[Tri[(k + 2) % 3]];
+        
+        const dim::vector3df OldNormal((B - Coords_[From]).cross(C - Coords_[From]));
+        const dim::vector3df NewNormal((B - NewCoord).cross(C - NewCoord));
+        
+        /* Also rejects triangles which become degenerated (e.g. across UV seams) */
+        if (OldNormal.dot(NewNormal) <= SIMPLIFY_FLIP_THRESHOLD * OldNormal.getLength() * NewNormal.getLength())
+            return true;
+    }
+    
+    return false;
+}
+
+bool SimplifyState::isFlipped(const std::vector<TVertexMove> &Moves) const
+{
+    foreach (const TVertexMove &Move, Moves)
+    {
+        if (isFlipped(Move.first, Move.second))
+            return true;
+    }
+    return false;
+}
+
+bool SimplifyState::isBorderEdge(u32 A, u32 B) const
+{
+    return std::binary_search(BorderEdges_.begin(), BorderEdges_.end(), getEdgeKey(math::Min(A, B), math::Max(A, B)));
+}
+
+
+/*
+ * Public functions
+ */
+
+SP_EXPORT u32 meshSimplify(const video::MeshBuffer &Source, video::MeshBuffer &Dest, f32 Ratio, f32 MaxError)
+{
+    if (Source.getPrimitiveType() != video::PRIMITIVE_TRIANGLES || Source.getVertexFormat() != Dest.getVertexFormat())
+        return 0;
+    
+    SSimplifyTask Task;
+    setupSimplifyTask(Task, Source, MaxError);
+    
+    Task.TargetCounts.push_back(static_cast<u32>(math::MinMax(Ratio, 0.0f, 1.0f) * (Task.Indices.size() / 3)));
+    
+    SimplifyState State(Task);
+    State.run();
+    
+    checkSimplifyTask(Task);
+    
+    return fillMeshBuffer(Source, Dest, Task.Levels.front());
+}
+
+SP_EXPORT u32 generateLODSubMeshes(Mesh &Obj, u32 NumLevels, f32 Ratio, f32 MaxError, u32 ThreadCount)
+{
+    const std::vector<video::MeshBuffer*>& SurfaceList = Obj.getMeshBufferList();
+    
+    if (!NumLevels || SurfaceList.empty() || !GlbSceneGraph)
+        return 0;
+    
+    Ratio = math::MinMax(Ratio, 0.0f, 1.0f);
+    
+    /* Extract the data of all mesh buffers */
+    std::vector<SSimplifyTask> Tasks(SurfaceList.size());
+    
+    for (u32 i = 0; i < SurfaceList.size(); ++i)
+    {
+        SSimplifyTask& Task = Tasks[i];
+        
+        setupSimplifyTask(Task, *SurfaceList[i], MaxError);
+        
+        f32 Count = static_cast<f32>(Task.Indices.size() / 3);
+        
+        for (u32 j = 0; j < NumLevels; ++j)
+        {
+            Count *= Ratio;
+            Task.TargetCounts.push_back(static_cast<u32>(Count));
+        }
+    }
+    
+    /* Determine the count of threads */
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Min(ThreadCount, static_cast<u32>(Tasks.size()));
+    
+    if (ThreadCount <= 1)
+        runSimplifyTasks(Tasks, 0, 1);
+    else
+    {
+        s32 NumRunningThreads = 0;
+        CriticalSection Mutex;
+        
+        std::vector<SSimplifierThreadData> ThreadDataList(ThreadCount - 1);
+        
+        typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+        std::vector<ThreadManagerPtr> Threads;
+        
+        /* Start worker threads, each simplifies every n-th mesh buffer */
+        for (u32 i = 1; i < ThreadCount; ++i)
+        {
+            SSimplifierThreadData& ThreadData = ThreadDataList[i - 1];
+            
+            ThreadData.Tasks                = (&Tasks);
+            ThreadData.First                = i;
+            ThreadData.Step                 = ThreadCount;
+            ThreadData.NumRunningThreads    = (&NumRunningThreads);
+            ThreadData.Mutex                = (&Mutex);
+            
+            Mutex.lock();
+            ++NumRunningThreads;
+            Mutex.unlock();
+            
+            Threads.push_back(boost::make_shared<ThreadManager>(MeshSimplifierThreadProc, &ThreadData));
+        }
+        
+        /* Process the first mesh buffers in the calling thread */
+        runSimplifyTasks(Tasks, 0, ThreadCount);
+        
+        /* Wait until all threads are finished */
+        while (1)
+        {
+            Mutex.lock();
+            const bool Finished = (NumRunningThreads <= 0);
+            Mutex.unlock();
+            
+            if (Finished)
+                break;
+            
+            io::Timer::yield();
+        }
+    }
+    
+    foreach (const SSimplifyTask &Task, Tasks)
+        checkSimplifyTask(Task);
+    
+    /* Create the sub meshes (mesh buffers are only created and updated in the calling thread) */
+    std::vector<Mesh*> SubMeshList(NumLevels);
+    
+    for (u32 j = 0; j < NumLevels; ++j)
+    {
+        Mesh* SubMesh = GlbSceneGraph->createMesh();
+        
+        for (u32 i = 0; i < SurfaceList.size(); ++i)
+        {
+            const video::MeshBuffer* Source = SurfaceList[i];
+            
+            video::MeshBuffer* Surface = SubMesh->createMeshBuffer(
+                Source->getVertexFormat(), Source->getIndexFormat()->getDataType()
+            );
+            
+            Surface->setPrimitiveType(Source->getPrimitiveType());
+            Surface->setTextureLayerList(Source->getTextureLayerList());
+            
+            fillMeshBuffer(*Source, *Surface, Tasks[i].Simplify ? Tasks[i].Levels[j] : Tasks[i].Indices);
+            
+            Surface->updateMeshBuffer();
+        }
+        
+        SubMesh->setVisible(false);
+        SubMesh->getMaterial()->copy(Obj.getMaterial());
+        
+        SubMeshList[j] = SubMesh;
+    }
+    
+    Obj.setLODSubMeshList(SubMeshList);
+    
+    return NumLevels;
+}
+
+} // /namespace MeshSimplifier
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
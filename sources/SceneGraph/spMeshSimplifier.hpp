@@ -0,0 +1,84 @@
+/*
+ * Mesh simplifier header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_MESH_SIMPLIFIER_H__
+#define __SP_SCENE_MESH_SIMPLIFIER_H__
+
+
+#include "Base/spStandard.hpp"
+
+
+namespace sp
+{
+namespace video
+{
+    class MeshBuffer;
+}
+namespace scene
+{
+
+
+class Mesh;
+
+
+/**
+Namespace for mesh simplification with quadric error metrics. The triangles are reduced by edge collapses
+where one vertex is moved onto the other one, so no new vertices are created and all vertex attributes stay unchanged.
+The edges with the lowest quadric error (sum of squared distances to the planes of the original triangles) are collapsed first.
+The following features are preserved:
+- UV seams and hard normal edges, i.e. vertices which share their position with other vertices, are only collapsed
+along the seam and all vertices at the same position are moved together. Vertices with equal data are welded before.
+- Flat shaded mesh buffers (where no triangles share their vertices) can not be simplified.
+A warning is printed when a mesh buffer could not be simplified to its target triangle count.
+- Open borders (e.g. the borders between mesh buffers with different materials) are only collapsed along themselves.
+- Collapses which flip triangles are rejected and collapses between vertices with different normals are more expensive.
+\since Version 3.3
+*/
+namespace MeshSimplifier
+{
+
+/**
+Simplifies the triangles of the specified mesh buffer.
+\param[in] Source Specifies the source mesh buffer. Only triangle lists can be simplified.
+\param[out] Dest Specifies the destination mesh buffer. It must have the same vertex format as the source.
+The vertices used by the simplified triangles and the triangles are appended. Don't forget to update the mesh buffer.
+\param[in] Ratio Specifies the ratio of triangles which are to be kept in the range [0.0 .. 1.0].
+\param[in] MaxError Specifies the maximal error of each collapse, relative to the size of the mesh buffer.
+With 1.0 (default) the error is practically unlimited.
+\return Count of triangles in the simplified mesh buffer or 0 if the mesh buffer could not be simplified.
+*/
+SP_EXPORT u32 meshSimplify(const video::MeshBuffer &Source, video::MeshBuffer &Dest, f32 Ratio, f32 MaxError = 1.0f);
+
+/**
+Generates the LOD (level-of-detail) sub meshes for the specified mesh. Each level keeps the specified ratio of the
+triangles of the previous level. The mesh buffers are simplified in parallel, each level continues the simplification
+of the previous level. The new sub meshes replace the current LOD sub mesh list (which is not deleted) and LOD is enabled.
+\param[in,out] Obj Specifies the mesh object.
+\param[in] NumLevels Specifies the count of sub meshes which are to be generated.
+\param[in] Ratio Specifies the ratio of triangles for each level. By default 0.5.
+\param[in] MaxError Specifies the maximal relative error of each collapse (see meshSimplify).
+\param[in] ThreadCount Specifies the count of threads. If 0 the count of processors is used. By default 0.
+\return Count of generated sub meshes.
+\see Mesh::setLODScreenSizes
+*/
+SP_EXPORT u32 generateLODSubMeshes(
+    Mesh &Obj, u32 NumLevels, f32 Ratio = 0.5f, f32 MaxError = 1.0f, u32 ThreadCount = 0
+);
+
+} // /namespace MeshSimplifier
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
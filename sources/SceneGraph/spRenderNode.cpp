@@ -44,7 +44,16 @@ bool RenderNode::compare(const RenderNode* Other) const
 void RenderNode::updateTransformation()
 {
     SceneNode::updateTransformation();
-    
+    alignTransformation();
+}
+
+
+/*
+ * ======= Protected: =======
+ */
+
+void RenderNode::alignTransformation()
+{
     DepthDistance_ = (spViewMatrix * FinalWorldMatrix_.getPosition()).Z;
 }
 
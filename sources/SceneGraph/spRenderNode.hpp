@@ -65,6 +65,11 @@ class SP_EXPORT RenderNode : public SceneNode
         
         RenderNode(const ENodeTypes Type);
         
+        /* Functions */
+        
+        //! Sets the depth distance for the current view matrix.
+        virtual void alignTransformation();
+        
         /* Members */
         
         f32 DepthDistance_;
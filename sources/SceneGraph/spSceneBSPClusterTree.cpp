@@ -0,0 +1,298 @@
+/*
+ * BSP cluster tree file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneBSPClusterTree.hpp"
+
+#ifdef SP_COMPILE_WITH_SCENELOADER_BSP3
+
+
+#include "SceneGraph/spSceneGraph.hpp"
+#include "SceneGraph/spSceneMesh.hpp"
+#include "SceneGraph/spSceneCamera.hpp"
+#include "RenderSystem/spRenderSystem.hpp"
+
+#include <boost/foreach.hpp>
+
+
+namespace sp
+{
+
+extern video::RenderSystem* GlbRenderSys;
+extern scene::SceneGraph* GlbSceneGraph;
+
+namespace scene
+{
+
+
+BSPClusterTree::BSPClusterTree() :
+    NumClusters_    (0      ),
+    VectorSize_     (0      ),
+    CurrentCluster_ (-1     ),
+    IsUpdated_      (false  ),
+    UpdateCounter_  (0      ),
+    NumVisibleFaces_(0      )
+{
+}
+BSPClusterTree::~BSPClusterTree()
+{
+}
+
+u32 BSPClusterTree::addNode(const dim::plane3df &Plane, s32 FrontChild, s32 BackChild)
+{
+    SNode Node;
+    {
+        Node.Plane          = Plane;
+        Node.Children[0]    = FrontChild;
+        Node.Children[1]    = BackChild;
+    }
+    Nodes_.push_back(Node);
+    return Nodes_.size() - 1;
+}
+
+u32 BSPClusterTree::addLeaf(s32 Cluster, const u32* Faces, u32 NumFaces)
+{
+    SLeaf Leaf;
+    {
+        Leaf.Cluster    = Cluster;
+        Leaf.FirstFace  = LeafFaces_.size();
+        Leaf.NumFaces   = 0;
+    }
+    
+    for (u32 i = 0; i < NumFaces; ++i)
+    {
+        if (Faces[i] < Faces_.size())
+        {
+            LeafFaces_.push_back(Faces[i]);
+            Faces_[Faces[i]].InLeaf = true;
+            ++Leaf.NumFaces;
+        }
+    }
+    
+    Leafs_.push_back(Leaf);
+    return Leafs_.size() - 1;
+}
+
+u32 BSPClusterTree::addSurface(video::MeshBuffer* Surface)
+{
+    Surfaces_.resize(Surfaces_.size() + 1);
+    
+    SSurface& NewSurface = Surfaces_.back();
+    NewSurface.Surface = Surface;
+    
+    /* Store the complete index data */
+    if (Surface)
+    {
+        Surface->setIndexBufferUsage(video::HWBUFFER_DYNAMIC);
+        
+        NewSurface.Indices.resize(Surface->getIndexCount());
+        for (u32 i = 0; i < NewSurface.Indices.size(); ++i)
+            NewSurface.Indices[i] = Surface->getPrimitiveIndex(i);
+    }
+    
+    return Surfaces_.size() - 1;
+}
+
+u32 BSPClusterTree::addFace(u32 Surface, u32 FirstIndex, u32 NumIndices)
+{
+    SFace Face;
+    {
+        Face.Surface        = Surface;
+        Face.FirstIndex     = FirstIndex;
+        Face.NumIndices     = NumIndices;
+        Face.VisibleFrame   = 0;
+        Face.InLeaf         = false;
+    }
+    Faces_.push_back(Face);
+    
+    if (Surface < Surfaces_.size())
+        Surfaces_[Surface].Faces.push_back(Faces_.size() - 1);
+    
+    return Faces_.size() - 1;
+}
+
+void BSPClusterTree::setVisibility(s32 NumClusters, s32 VectorSize, const std::vector<u8> &VisData)
+{
+    if (NumClusters > 0 && VectorSize > 0 && VisData.size() >= static_cast<u32>(NumClusters * VectorSize))
+    {
+        NumClusters_    = NumClusters;
+        VectorSize_     = VectorSize;
+        VisData_        = VisData;
+    }
+    else
+    {
+        NumClusters_    = 0;
+        VectorSize_     = 0;
+        VisData_.clear();
+    }
+    
+    IsUpdated_ = false;
+}
+
+s32 BSPClusterTree::findLeaf(const dim::vector3df &Point) const
+{
+    if (Nodes_.empty())
+        return Leafs_.empty() ? -1 : 0;
+    
+    /* Walk down the tree until a leaf has been reached */
+    s32 Index = 0;
+    
+    while (Index >= 0)
+    {
+        if (static_cast<u32>(Index) >= Nodes_.size())
+            return -1;
+        
+        const SNode& Node = Nodes_[Index];
+        Index = Node.Children[Node.Plane.isPointFrontSide(Point) ? 0 : 1];
+    }
+    
+    const s32 Leaf = -(Index + 1);
+    
+    return static_cast<u32>(Leaf) < Leafs_.size() ? Leaf : -1;
+}
+
+s32 BSPClusterTree::findCluster(const dim::vector3df &Point) const
+{
+    const s32 Leaf = findLeaf(Point);
+    return Leaf >= 0 ? Leafs_[Leaf].Cluster : -1;
+}
+
+bool BSPClusterTree::isClusterVisible(s32 From, s32 To) const
+{
+    if (From < 0 || To < 0)
+        return false;
+    if (VisData_.empty() || From >= NumClusters_ || To >= NumClusters_)
+        return true;
+    return (VisData_[From * VectorSize_ + (To >> 3)] & (1 << (To & 7))) != 0;
+}
+
+void BSPClusterTree::update(s32 Cluster)
+{
+    if (Cluster < 0)
+    {
+        reset();
+        return;
+    }
+    
+    if (IsUpdated_ && Cluster == CurrentCluster_)
+        return;
+    
+    CurrentCluster_ = Cluster;
+    IsUpdated_      = true;
+    
+    /* Mark the faces of all visible leafs */
+    ++UpdateCounter_;
+    
+    foreach (const SLeaf &Leaf, Leafs_)
+    {
+        if (!isClusterVisible(Cluster, Leaf.Cluster))
+            continue;
+        
+        for (u32 i = 0; i < Leaf.NumFaces; ++i)
+            Faces_[LeafFaces_[Leaf.FirstFace + i]].VisibleFrame = UpdateCounter_;
+    }
+    
+    /* Rebuild the index buffers */
+    NumVisibleFaces_ = 0;
+    
+    foreach (SSurface &Surface, Surfaces_)
+        rebuildSurface(Surface, false);
+}
+
+void BSPClusterTree::reset()
+{
+    if (IsUpdated_ && CurrentCluster_ < 0)
+        return;
+    
+    CurrentCluster_ = -1;
+    IsUpdated_      = true;
+    
+    NumVisibleFaces_ = 0;
+    
+    foreach (SSurface &Surface, Surfaces_)
+        rebuildSurface(Surface, true);
+}
+
+void BSPClusterTree::render(Mesh* Obj, const std::vector<video::MeshBuffer*> &SurfaceList, u32 LODIndex)
+{
+    /* Update the index buffers for the cluster of the active camera */
+    Camera* ActiveCamera = GlbSceneGraph->getActiveCamera();
+    
+    if (ActiveCamera)
+    {
+        const dim::vector3df Point(
+            Obj->getTransformMatrix(true).getInverse() * ActiveCamera->getPosition(true)
+        );
+        update(findCluster(Point));
+    }
+    
+    /* Draw all mesh buffers with visible faces */
+    foreach (video::MeshBuffer* Surface, SurfaceList)
+    {
+        if (Surface->getIndexCount() > 0)
+            GlbRenderSys->drawMeshBuffer(Surface);
+    }
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void BSPClusterTree::rebuildSurface(SSurface &Surface, bool AllFaces)
+{
+    if (!Surface.Surface)
+        return;
+    
+    /* Count the indices of the visible faces */
+    u32 NumIndices = 0;
+    
+    foreach (u32 FaceIndex, Surface.Faces)
+    {
+        const SFace& Face = Faces_[FaceIndex];
+        
+        if (AllFaces || !Face.InLeaf || Face.VisibleFrame == UpdateCounter_)
+        {
+            NumIndices += Face.NumIndices;
+            ++NumVisibleFaces_;
+        }
+    }
+    
+    /* Copy the indices of the visible faces into the index buffer */
+    Surface.Surface->clearIndices();
+    
+    if (!NumIndices)
+        return;
+    
+    Surface.Surface->addIndices(NumIndices);
+    
+    u32 Index = 0;
+    
+    foreach (u32 FaceIndex, Surface.Faces)
+    {
+        const SFace& Face = Faces_[FaceIndex];
+        
+        if (AllFaces || !Face.InLeaf || Face.VisibleFrame == UpdateCounter_)
+        {
+            for (u32 i = 0; i < Face.NumIndices; ++i)
+                Surface.Surface->setPrimitiveIndex(Index++, Surface.Indices[Face.FirstIndex + i]);
+        }
+    }
+    
+    Surface.Surface->updateIndexBuffer();
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
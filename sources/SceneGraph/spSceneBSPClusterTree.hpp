@@ -0,0 +1,224 @@
+/*
+ * BSP cluster tree header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_BSP_CLUSTER_TREE_H__
+#define __SP_SCENE_BSP_CLUSTER_TREE_H__
+
+
+#include "Base/spStandard.hpp"
+
+#ifdef SP_COMPILE_WITH_SCENELOADER_BSP3
+
+
+#include "Base/spDimension.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace video
+{
+    class MeshBuffer;
+}
+namespace scene
+{
+
+
+class Mesh;
+
+/**
+The BSP cluster tree keeps the node and leaf structure and the cluster visibility data (PVS) of a "Quake III Arena" map
+after loading. Each frame the leaf of the camera is searched in the tree, and when the camera enters another cluster,
+the index buffers of the map's mesh buffers are rebuilt with the faces of the clusters which are visible from there.
+So the faces of all other clusters cost neither draw calls nor overdraw. Faces which are not referenced by any leaf
+(e.g. the faces of doors and platforms) are always drawn. If the camera is outside the map, all faces are drawn.
+\note The index buffers only contain the visible faces after rendering. Use "reset" before the mesh buffers are
+used for anything else (e.g. to create a collision model).
+\see SceneLoaderBSP3::setClusterCulling
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT BSPClusterTree
+{
+    
+    public:
+        
+        BSPClusterTree();
+        ~BSPClusterTree();
+        
+        /* === Functions === */
+        
+        /**
+        Adds a new node to the tree. The first node is the root node.
+        \param[in] Plane Specifies the split plane in the local space of the map's mesh.
+        \param[in] FrontChild Specifies the child on the front side of the plane.
+        A negative value (-1 - LeafIndex) refers to a leaf, otherwise it's the index of another node.
+        \param[in] BackChild Specifies the child on the back side of the plane.
+        \return Index of the new node.
+        */
+        u32 addNode(const dim::plane3df &Plane, s32 FrontChild, s32 BackChild);
+        
+        /**
+        Adds a new leaf to the tree.
+        \param[in] Cluster Specifies the visibility cluster of the leaf. A negative value means the leaf is outside the map.
+        \param[in] Faces Specifies the indices of the faces inside the leaf (see "addFace").
+        \param[in] NumFaces Specifies the count of faces.
+        \return Index of the new leaf.
+        \note The faces must be added before the leafs.
+        */
+        u32 addLeaf(s32 Cluster, const u32* Faces, u32 NumFaces);
+        
+        /**
+        Adds a mesh buffer whose index buffer is to be rebuilt with the visible faces.
+        The current indices of the mesh buffer are stored as the complete face data.
+        \return Index of the new surface.
+        */
+        u32 addSurface(video::MeshBuffer* Surface);
+        
+        /**
+        Adds a new face.
+        \param[in] Surface Specifies the index of the surface (see "addSurface") which contains the face.
+        \param[in] FirstIndex Specifies the first index of the face in the surface's index buffer.
+        \param[in] NumIndices Specifies the count of indices of the face.
+        \return Index of the new face.
+        */
+        u32 addFace(u32 Surface, u32 FirstIndex, u32 NumIndices);
+        
+        /**
+        Sets the cluster visibility data.
+        \param[in] NumClusters Specifies the count of clusters.
+        \param[in] VectorSize Specifies the size (in bytes) of each cluster's bit vector.
+        \param[in] VisData Specifies the bit vectors of all clusters. Bit 'j' of vector 'i' is set
+        if cluster 'j' is visible from cluster 'i'. If the data is empty, all clusters are visible.
+        */
+        void setVisibility(s32 NumClusters, s32 VectorSize, const std::vector<u8> &VisData);
+        
+        //! Returns the index of the leaf which contains the specified point (in the local space of the map's mesh).
+        s32 findLeaf(const dim::vector3df &Point) const;
+        
+        //! Returns the cluster of the leaf which contains the specified point or -1 if the point is outside the map.
+        s32 findCluster(const dim::vector3df &Point) const;
+        
+        //! Returns true if the cluster 'To' is visible from the cluster 'From'.
+        bool isClusterVisible(s32 From, s32 To) const;
+        
+        /**
+        Updates the index buffers for the specified camera cluster. Nothing is done if the cluster has not changed.
+        \param[in] Cluster Specifies the cluster of the camera. If this is negative, all faces are visible.
+        */
+        void update(s32 Cluster);
+        
+        //! Restores the complete index buffers, i.e. all faces are visible until the next update.
+        void reset();
+        
+        /**
+        Render callback for the map's meshes (see "Mesh::setRenderCallback"). Updates the index buffers
+        for the cluster of the active camera and draws all mesh buffers which have visible faces.
+        */
+        void render(Mesh* Obj, const std::vector<video::MeshBuffer*> &SurfaceList, u32 LODIndex);
+        
+        /* === Inline functions === */
+        
+        inline u32 getNodeCount() const
+        {
+            return Nodes_.size();
+        }
+        inline u32 getLeafCount() const
+        {
+            return Leafs_.size();
+        }
+        inline u32 getFaceCount() const
+        {
+            return Faces_.size();
+        }
+        inline s32 getClusterCount() const
+        {
+            return NumClusters_;
+        }
+        
+        //! Returns the count of faces which have been visible after the last update.
+        inline u32 getVisibleFaceCount() const
+        {
+            return NumVisibleFaces_;
+        }
+        
+        //! Returns the cluster of the last update. This is -1 if the camera has been outside the map or no update was done yet.
+        inline s32 getCurrentCluster() const
+        {
+            return CurrentCluster_;
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SNode
+        {
+            dim::plane3df Plane;
+            s32 Children[2];
+        };
+        
+        struct SLeaf
+        {
+            s32 Cluster;
+            u32 FirstFace;      //!< First entry in the leaf face list.
+            u32 NumFaces;
+        };
+        
+        struct SFace
+        {
+            u32 Surface;
+            u32 FirstIndex;
+            u32 NumIndices;
+            u32 VisibleFrame;   //!< Update counter of the last update where this face was visible.
+            bool InLeaf;        //!< False if the face is not referenced by any leaf, i.e. it's always visible.
+        };
+        
+        struct SSurface
+        {
+            video::MeshBuffer* Surface;
+            std::vector<u32> Indices;   //!< Complete index data of all faces.
+            std::vector<u32> Faces;     //!< Faces in this surface.
+        };
+        
+        /* === Functions === */
+        
+        void rebuildSurface(SSurface &Surface, bool AllFaces);
+        
+        /* === Members === */
+        
+        std::vector<SNode> Nodes_;
+        std::vector<SLeaf> Leafs_;
+        std::vector<u32> LeafFaces_;
+        std::vector<SFace> Faces_;
+        std::vector<SSurface> Surfaces_;
+        
+        s32 NumClusters_;
+        s32 VectorSize_;
+        std::vector<u8> VisData_;
+        
+        s32 CurrentCluster_;
+        bool IsUpdated_;
+        u32 UpdateCounter_;
+        u32 NumVisibleFaces_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+#endif
+
+
+
+// ================================================================================
@@ -14,6 +14,7 @@ namespace sp
 {
 
 extern video::RenderSystem* GlbRenderSys;
+extern scene::SceneGraph* GlbSceneGraph;
 
 namespace scene
 {
@@ -36,6 +37,26 @@ Billboard::~Billboard()
 {
 }
 
+static MemoryPool& getBillboardPool()
+{
+    static MemoryPool Pool("scene::Billboard", sizeof(Billboard), 256);
+    return Pool;
+}
+
+void* Billboard::operator new(size_t Size)
+{
+    return getBillboardPool().allocate(Size);
+}
+void Billboard::operator delete(void* Ptr, size_t Size)
+{
+    getBillboardPool().release(Ptr, Size);
+}
+
+SMemoryPoolStats Billboard::getMemoryPoolStats()
+{
+    return getBillboardPool().getStats();
+}
+
 Billboard* Billboard::copy() const
 {
     /* Allocate a new sprite */
@@ -68,6 +89,10 @@ void Billboard::render()
     /* Matrix transformation */
     loadTransformation();
     
+    /* Enable the light sources of this billboard */
+    if (GlbSceneGraph && GlbSceneGraph->getLightBinning() && Material_.getLighting())
+        GlbSceneGraph->setupNodeLights(this);
+    
     /* Update the render matrix */
     GlbRenderSys->updateModelviewMatrix();
     
@@ -91,11 +116,14 @@ void Billboard::render()
     __isTexturing = isTexturing;
 }
 
-void Billboard::updateTransformation()
+
+/*
+ * ======= Protected: =======
+ */
+
+void Billboard::alignTransformation()
 {
     /* Update billboard transformation */
-    SceneNode::updateTransformation();
-    
     const dim::matrix4f WorldMatrix(spViewMatrix * FinalWorldMatrix_);
     
     if (Alignment_ != BILLBOARD_SCREEN_ALIGNED)
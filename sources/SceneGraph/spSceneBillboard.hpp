@@ -55,13 +55,20 @@ class SP_EXPORT Billboard : public MaterialNode
         virtual ~Billboard();
         
         /* === Functions === */
-
-        virtual void updateTransformation();
         
         Billboard* copy() const;
         
         virtual void render();
         
+        /* === Static functions === */
+        
+        //! Allocates the memory for a new billboard from the billboard memory pool (see SceneNode::operator new).
+        static void* operator new(size_t Size);
+        static void operator delete(void* Ptr, size_t Size);
+        
+        //! Returns the occupancy statistics of the billboard memory pool.
+        static SMemoryPoolStats getMemoryPoolStats();
+        
         /* === Inline functions === */
 
         /**
@@ -146,6 +153,13 @@ class SP_EXPORT Billboard : public MaterialNode
             return UpVector_;
         }
         
+    protected:
+        
+        /* === Functions === */
+        
+        //! Aligns the billboard to the view and sets the depth distance.
+        virtual void alignTransformation();
+        
     private:
         
         //friend bool cmpObjectBillboards(Billboard* &obj1, Billboard* &obj2);
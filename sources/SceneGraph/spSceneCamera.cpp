@@ -36,6 +36,26 @@ Camera::~Camera()
 {
 }
 
+static MemoryPool& getCameraPool()
+{
+    static MemoryPool Pool("scene::Camera", sizeof(Camera), 8);
+    return Pool;
+}
+
+void* Camera::operator new(size_t Size)
+{
+    return getCameraPool().allocate(Size);
+}
+void Camera::operator delete(void* Ptr, size_t Size)
+{
+    getCameraPool().release(Ptr, Size);
+}
+
+SMemoryPoolStats Camera::getMemoryPoolStats()
+{
+    return getCameraPool().getStats();
+}
+
 void Camera::updateControl()
 {
     // do nothing
@@ -170,6 +170,15 @@ class SP_EXPORT Camera : public SceneNode
         */
         const dim::matrix4f& getProjectionMatrix() const;
         
+        /* === Static functions === */
+        
+        //! Allocates the memory for a new camera from the camera memory pool (see SceneNode::operator new).
+        static void* operator new(size_t Size);
+        static void operator delete(void* Ptr, size_t Size);
+        
+        //! Returns the occupancy statistics of the camera memory pool.
+        static SMemoryPoolStats getMemoryPoolStats();
+        
         /* === Inline functions === */
         
         //! Sets the camera's projection object.
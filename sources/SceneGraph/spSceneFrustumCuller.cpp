@@ -0,0 +1,304 @@
+/*
+ * Frustum culler file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneFrustumCuller.hpp"
+#include "SceneGraph/spRenderNode.hpp"
+#include "Base/spMathSIMD.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spTimer.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <limits>
+
+
+namespace sp
+{
+
+
+/*
+ * Internal members
+ */
+
+extern io::OSInformator* GlbPlatformInfo;
+
+namespace scene
+{
+
+
+/*
+ * Internal structures
+ */
+
+//! Minimal count of nodes for each thread in a culling pass.
+static const u32 CULLING_MIN_BLOCK_SIZE = 4096;
+
+struct SFrustumCullerThreadData
+{
+    const FrustumCuller* Culler;
+    const ViewFrustum* Frustum;
+    u32 Begin, End;
+    std::vector<u32>* VisibleIndices;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+
+/*
+ * Internal functions
+ */
+
+THREAD_PROC(FrustumCullerThreadProc)
+{
+    SFrustumCullerThreadData* ThreadData = reinterpret_cast<SFrustumCullerThreadData*>(Arguments);
+    
+    /* Process the range of bounding blocks given to this thread */
+    ThreadData->Culler->cullBlocks(
+        *ThreadData->Frustum, ThreadData->Begin, ThreadData->End, *ThreadData->VisibleIndices
+    );
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+
+/*
+ * FrustumCuller class
+ */
+
+FrustumCuller::FrustumCuller() :
+    NumNodes_   (0),
+    ThreadCount_(0)
+{
+}
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::updateBounds(const std::vector<RenderNode*> &NodeList)
+{
+    NumNodes_ = NodeList.size();
+    Blocks_.resize((NumNodes_ + 3) / 4);
+    
+    for (u32 i = 0, Num = Blocks_.size() * 4; i < Num; ++i)
+    {
+        SBoundsBlock4& Block = Blocks_[i / 4];
+        const u32 j = i % 4;
+        
+        dim::vector3df Center;
+        dim::vector3df Axes[3];
+        f32 Radius = -std::numeric_limits<f32>::max();
+        
+        /* Padding and invisible nodes get a negative infinite radius, so they are always culled */
+        const RenderNode* Node = (i < NumNodes_ ? NodeList[i] : 0);
+        
+        if (Node && Node->getVisible())
+        {
+            const BoundingVolume& Bounds = Node->getBoundingVolume();
+            const dim::matrix4f& Matrix = Node->FinalWorldMatrix_;
+            
+            switch (Bounds.getType())
+            {
+                case BOUNDING_SPHERE:
+                    Center = Matrix.getPosition();
+                    Radius = Bounds.getRadius();
+                    break;
+                
+                case BOUNDING_BOX:
+                {
+                    /* Transform the box into a world-space oriented box */
+                    const dim::vector3df HalfSize((Bounds.getBox().Max - Bounds.getBox().Min) * 0.5f);
+                    
+                    Center = Matrix * Bounds.getBox().getCenter();
+                    Radius = 0.0f;
+                    
+                    for (s32 k = 0; k < 3; ++k)
+                    {
+                        const dim::vector4df& Column = Matrix.getColumn(k);
+                        Axes[k] = dim::vector3df(Column.X, Column.Y, Column.Z) * HalfSize[k];
+                    }
+                }
+                break;
+                
+                default:
+                    Radius = std::numeric_limits<f32>::max();
+                    break;
+            }
+        }
+        
+        /* Store bounds in SoA layout */
+        for (s32 k = 0; k < 3; ++k)
+        {
+            Block.Center[k][j] = Center[k];
+            for (s32 c = 0; c < 3; ++c)
+                Block.Axes[k][c][j] = Axes[k][c];
+        }
+        Block.Radius[j] = Radius;
+    }
+}
+
+u32 FrustumCuller::cull(const ViewFrustum &Frustum, std::vector<u32> &VisibleIndices) const
+{
+    VisibleIndices.clear();
+    
+    const u32 Count = Blocks_.size();
+    
+    if (!Count)
+        return 0;
+    
+    /* Determine the count of threads */
+    u32 ThreadCount = ThreadCount_;
+    
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Min(ThreadCount, (NumNodes_ + CULLING_MIN_BLOCK_SIZE - 1) / CULLING_MIN_BLOCK_SIZE);
+    
+    if (ThreadCount <= 1)
+        cullBlocks(Frustum, 0, Count, VisibleIndices);
+    else
+    {
+        const u32 BlockSize = (Count + ThreadCount - 1) / ThreadCount;
+        
+        s32 NumRunningThreads = 0;
+        CriticalSection Mutex;
+        
+        std::vector<SFrustumCullerThreadData> ThreadDataList(ThreadCount - 1);
+        std::vector< std::vector<u32> > ThreadIndices(ThreadCount - 1);
+        
+        typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+        std::vector<ThreadManagerPtr> Threads;
+        
+        /* Start worker threads for all ranges except the first one */
+        for (u32 i = 0, Begin = BlockSize; i + 1 < ThreadCount && Begin < Count; ++i, Begin += BlockSize)
+        {
+            SFrustumCullerThreadData& ThreadData = ThreadDataList[i];
+            
+            ThreadData.Culler               = this;
+            ThreadData.Frustum              = (&Frustum);
+            ThreadData.Begin                = Begin;
+            ThreadData.End                  = math::Min(Begin + BlockSize, Count);
+            ThreadData.VisibleIndices       = (&ThreadIndices[i]);
+            ThreadData.NumRunningThreads    = (&NumRunningThreads);
+            ThreadData.Mutex                = (&Mutex);
+            
+            Mutex.lock();
+            ++NumRunningThreads;
+            Mutex.unlock();
+            
+            Threads.push_back(boost::make_shared<ThreadManager>(FrustumCullerThreadProc, &ThreadData));
+        }
+        
+        /* Process the first range in the calling thread */
+        cullBlocks(Frustum, 0, BlockSize, VisibleIndices);
+        
+        /* Wait until all threads are finished */
+        while (1)
+        {
+            Mutex.lock();
+            const bool Finished = (NumRunningThreads <= 0);
+            Mutex.unlock();
+            
+            if (Finished)
+                break;
+            
+            io::Timer::yield();
+        }
+        
+        /* Append the indices of the other threads (the ranges are in ascending order) */
+        foreach (const std::vector<u32> &Indices, ThreadIndices)
+            VisibleIndices.insert(VisibleIndices.end(), Indices.begin(), Indices.end());
+    }
+    
+    return VisibleIndices.size();
+}
+
+void FrustumCuller::clear()
+{
+    Blocks_.clear();
+    NumNodes_ = 0;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void FrustumCuller::cullBlocks(const ViewFrustum &Frustum, u32 Begin, u32 End, std::vector<u32> &VisibleIndices) const
+{
+    /* Broadcast the frustum planes */
+    math::float4 PlaneNormals[VIEWFRUSTUM_PLANE_COUNT][3];
+    math::float4 PlaneDistances[VIEWFRUSTUM_PLANE_COUNT];
+    
+    for (s32 i = 0; i < VIEWFRUSTUM_PLANE_COUNT; ++i)
+    {
+        const dim::plane3df& Plane = Frustum.getPlane(static_cast<EViewFrustumPlanes>(i));
+        
+        PlaneNormals[i][0]  = math::float4(Plane.Normal.X);
+        PlaneNormals[i][1]  = math::float4(Plane.Normal.Y);
+        PlaneNormals[i][2]  = math::float4(Plane.Normal.Z);
+        PlaneDistances[i]   = math::float4(Plane.Distance);
+    }
+    
+    for (u32 b = Begin; b < End; ++b)
+    {
+        const SBoundsBlock4& Block = Blocks_[b];
+        
+        const math::float4 CenterX(math::float4::load(Block.Center[0]));
+        const math::float4 CenterY(math::float4::load(Block.Center[1]));
+        const math::float4 CenterZ(math::float4::load(Block.Center[2]));
+        const math::float4 Radius(math::float4::load(Block.Radius));
+        
+        s32 CulledMask = 0;
+        
+        for (s32 i = 0; i < VIEWFRUSTUM_PLANE_COUNT && CulledMask != 0xF; ++i)
+        {
+            const math::float4& NX = PlaneNormals[i][0];
+            const math::float4& NY = PlaneNormals[i][1];
+            const math::float4& NZ = PlaneNormals[i][2];
+            
+            /* Signed distance of the center and projection radius of the bounding volume */
+            const math::float4 Dist(NX*CenterX + NY*CenterY + NZ*CenterZ - PlaneDistances[i]);
+            
+            math::float4 ProjRadius(Radius);
+            
+            for (s32 k = 0; k < 3; ++k)
+            {
+                ProjRadius = ProjRadius + math::float4::abs(
+                    NX*math::float4::load(Block.Axes[k][0]) +
+                    NY*math::float4::load(Block.Axes[k][1]) +
+                    NZ*math::float4::load(Block.Axes[k][2])
+                );
+            }
+            
+            /* The volume is culled if it is completely in front of any plane */
+            CulledMask |= (Dist > ProjRadius).getMask();
+        }
+        
+        /* Store the indices of the visible nodes */
+        for (u32 j = 0; j < 4; ++j)
+        {
+            if (!(CulledMask & (1 << j)))
+                VisibleIndices.push_back(b*4 + j);
+        }
+    }
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
@@ -0,0 +1,127 @@
+/*
+ * Frustum culler header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_FRUSTUM_CULLER_H__
+#define __SP_SCENE_FRUSTUM_CULLER_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spViewFrustum.hpp"
+#include "Base/spThreadManager.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+class RenderNode;
+
+/**
+The frustum culler is a separate culling stage for a list of render nodes. It stores the world-space bounding volumes
+of all nodes in structure-of-arrays layout (blocks of 4 nodes) and tests 4 nodes at once against the planes of a view frustum
+(see "math::float4"). Large node lists are distributed over several threads. The result is a compact list of node indices.
+Once the bounds have been updated for a frame, the culler can be used for any count of view frustums,
+e.g. for the main camera as well as for shadow or reflection cameras.
+\see SceneGraph::getFrustumCuller
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT FrustumCuller
+{
+    
+    public:
+        
+        FrustumCuller();
+        ~FrustumCuller();
+        
+        /* === Functions === */
+        
+        /**
+        Stores the world-space bounding volumes of the specified render nodes.
+        This must be called after the final world matrices of the nodes have been updated (see SceneNode::updateTransformation).
+        Invisible nodes will always be culled and nodes with the bounding volume type BOUNDING_NONE will never be culled.
+        \param[in] NodeList Specifies the render nodes. The indices of this list are used for the visible-index list.
+        */
+        void updateBounds(const std::vector<RenderNode*> &NodeList);
+        
+        /**
+        Tests all stored bounding volumes against the specified view frustum.
+        \param[in] Frustum Specifies the view frustum.
+        \param[out] VisibleIndices Specifies the output list. It will be filled with the indices (in ascending order)
+        of all nodes which are at least partially inside the view frustum.
+        \return Count of visible nodes.
+        \see updateBounds
+        */
+        u32 cull(const ViewFrustum &Frustum, std::vector<u32> &VisibleIndices) const;
+        
+        //! Removes all stored bounding volumes.
+        void clear();
+        
+        /* === Inline functions === */
+        
+        /**
+        Sets the count of threads for the culling.
+        \param[in] ThreadCount Specifies the count of threads. If 0 the count of processors is used. By default 0.
+        \note Each thread gets at least a few thousand nodes, so small lists are always culled in the calling thread.
+        */
+        inline void setThreadCount(u32 ThreadCount)
+        {
+            ThreadCount_ = ThreadCount;
+        }
+        inline u32 getThreadCount() const
+        {
+            return ThreadCount_;
+        }
+        
+        //! Returns the count of nodes whose bounding volumes are stored.
+        inline u32 getNodeCount() const
+        {
+            return NumNodes_;
+        }
+        
+    private:
+        
+        friend THREAD_PROC(FrustumCullerThreadProc);
+        
+        /* === Structures === */
+        
+        //! Oriented bounding boxes and spheres of 4 nodes. A sphere has zero axes, a box has a zero radius.
+        struct SBoundsBlock4
+        {
+            f32 Center[3][4];   //!< [Component][Node]
+            f32 Axes[3][3][4];  //!< [Axis][Component][Node], each axis is scaled by the box half size.
+            f32 Radius[4];      //!< [Node]
+        };
+        
+        /* === Functions === */
+        
+        void cullBlocks(const ViewFrustum &Frustum, u32 Begin, u32 End, std::vector<u32> &VisibleIndices) const;
+        
+        /* === Members === */
+        
+        std::vector<SBoundsBlock4> Blocks_;
+        
+        u32 NumNodes_;
+        u32 ThreadCount_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
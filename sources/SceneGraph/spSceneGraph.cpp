@@ -102,15 +102,20 @@ static bool compareRenderNodesMeshBuffer(RenderNode* ObjA, RenderNode* ObjB)
 bool SceneGraph::ReverseDepthSorting_ = false;
 
 SceneGraph::SceneGraph(const ESceneGraphs Type) :
-    RenderNode      (NODE_SCENEGRAPH        ),
-    GraphType_      (Type                   ),
-    hasChildTree_   (false                  ),
-    ActiveCamera_   (0                      ),
-    ActiveMesh_     (0                      ),
-    WireframeFront_ (video::WIREFRAME_SOLID ),
-    WireframeBack_  (video::WIREFRAME_SOLID ),
-    DepthSorting_   (true                   ),
-    LightSorting_   (true                   )
+    RenderNode          (NODE_SCENEGRAPH        ),
+    GraphType_          (Type                   ),
+    hasChildTree_       (false                  ),
+    ActiveCamera_       (0                      ),
+    ActiveMesh_         (0                      ),
+    WireframeFront_     (video::WIREFRAME_SOLID ),
+    WireframeBack_      (video::WIREFRAME_SOLID ),
+    DepthSorting_       (true                   ),
+    LightSorting_       (true                   ),
+    PreCulling_         (false                  ),
+    OcclusionCulling_   (false                  ),
+    RenderQueueSorting_ (false                  ),
+    Instancing_         (false                  ),
+    LightBinning_       (false                  )
 {
 }
 SceneGraph::~SceneGraph()
@@ -120,41 +125,59 @@ SceneGraph::~SceneGraph()
 void SceneGraph::addSceneNode(SceneNode* Object)
 {
     if (Object)
+    {
         NodeList_.push_back(Object);
+        addMember(Object);
+    }
 }
 void SceneGraph::removeSceneNode(SceneNode* Object)
 {
-    MemoryManager::removeElement(NodeList_, Object);
+    if (MemoryManager::removeElement(NodeList_, Object))
+        removeMember(Object);
 }
 
 void SceneGraph::addSceneNode(Camera* Object)
 {
     if (Object)
+    {
         CameraList_.push_back(Object);
+        addMember(Object);
+    }
 }
 void SceneGraph::removeSceneNode(Camera* Object)
 {
-    MemoryManager::removeElement(CameraList_, Object);
+    if (MemoryManager::removeElement(CameraList_, Object))
+        removeMember(Object);
 }
 
 void SceneGraph::addSceneNode(Light* Object)
 {
     if (Object)
+    {
         LightList_.push_back(Object);
+        addMember(Object);
+    }
 }
 void SceneGraph::removeSceneNode(Light* Object)
 {
-    MemoryManager::removeElement(LightList_, Object);
+    if (MemoryManager::removeElement(LightList_, Object))
+        removeMember(Object);
+    LightGrid_.clear();
 }
 
 void SceneGraph::addSceneNode(RenderNode* Object)
 {
     if (Object)
+    {
         RenderList_.push_back(Object);
+        addMember(Object);
+    }
 }
 void SceneGraph::removeSceneNode(RenderNode* Object)
 {
-    MemoryManager::removeElement(RenderList_, Object);
+    if (MemoryManager::removeElement(RenderList_, Object))
+        removeMember(Object);
+    removeOccluderNode(Object);
 }
 
 void SceneGraph::addRootNode(SceneNode* Object)
@@ -367,11 +390,26 @@ void SceneGraph::clearScene(
     bool isRemoveLights, bool isRemoveBillboards, bool isRemoveTerrains)
 {
     if (isRemoveNodes)
+    {
+        removeMembers(NodeList_);
         NodeList_.clear();
+    }
     if (isRemoveCameras)
+    {
+        removeMembers(CameraList_);
         CameraList_.clear();
+    }
     if (isRemoveLights)
+    {
+        removeMembers(LightList_);
         LightList_.clear();
+        LightGrid_.clear();
+    }
+    
+    removeMembers(RenderList_);
+    
+    if (isRemoveMeshes)
+        OcclusionCuller_.clearOccluders();
     
     if (isRemoveMeshes && isRemoveBillboards && isRemoveTerrains)
         RenderList_.clear();
@@ -446,6 +484,9 @@ bool SceneGraph::deleteNode(SceneNode* Object)
                 break;
         }
         
+        /* Occluders are not necessarily part of the render list */
+        removeOccluderNode(Object);
+        
         gSharedObjects.SceneMngr->deleteNode(Object);
     }
     return false;
@@ -455,26 +496,29 @@ std::list<SceneNode*> SceneGraph::findNodes(const io::stringc &Name) const
 {
     std::list<SceneNode*> NodeList;
     
-    addNodeToList<SceneNode ,SceneNode> (Name, NodeList, NodeList_  );
-    addNodeToList<Camera, Camera>       (Name, NodeList, CameraList_);
-    addNodeToList<Light, Light>         (Name, NodeList, LightList_ );
-    addNodeToList<Mesh, RenderNode>     (Name, NodeList, RenderList_);
-    addNodeToList<Billboard, RenderNode>(Name, NodeList, RenderList_);
-    addNodeToList<Terrain, RenderNode>  (Name, NodeList, RenderList_);
+    /* Query the name index of the scene manager and keep the nodes of this scene graph */
+    typedef SceneManager::NameIndexIterator ItType;
+    const std::pair<ItType, ItType> Range = gSharedObjects.SceneMngr->getNameIndexRange(Name);
+    
+    for (ItType it = Range.first; it != Range.second; ++it)
+    {
+        if (hasMember(it->second) && it->second->getName() == Name)
+            NodeList.push_back(it->second);
+    }
     
     return NodeList;
 }
 
 SceneNode* SceneGraph::findNode(const io::stringc &Name) const
 {
-    SceneNode* Object = 0;
+    typedef SceneManager::NameIndexIterator ItType;
+    const std::pair<ItType, ItType> Range = gSharedObjects.SceneMngr->getNameIndexRange(Name);
     
-    if ( ( Object = findNodeInList<SceneNode>   (Name, NodeList_    ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Camera>      (Name, CameraList_  ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Light>       (Name, LightList_   ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<RenderNode>  (Name, RenderList_  ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<RenderNode>  (Name, RenderList_  ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<RenderNode>  (Name, RenderList_  ) ) != 0 ) return Object;
+    for (ItType it = Range.first; it != Range.second; ++it)
+    {
+        if (hasMember(it->second) && it->second->getName() == Name)
+            return it->second;
+    }
     
     return 0;
 }
@@ -610,6 +654,24 @@ void SceneGraph::sortRenderList(const ERenderListSortMethods Method, std::vector
         case RENDERLIST_SORT_MESHBUFFER:
             std::sort(ObjectList.begin(), ObjectList.end(), compareRenderNodesMeshBuffer);
             break;
+        case RENDERLIST_SORT_RENDERQUEUE:
+        {
+            /* Sort visible nodes by the render queue and append the invisible nodes */
+            RenderQueue_.build(ObjectList);
+            
+            std::vector<RenderNode*> InvisibleList;
+            foreach (RenderNode* Node, ObjectList)
+            {
+                if (!Node->getVisible())
+                    InvisibleList.push_back(Node);
+            }
+            
+            for (u32 i = 0; i < RenderQueue_.getSize(); ++i)
+                ObjectList[i] = RenderQueue_.getNode(i);
+            
+            std::copy(InvisibleList.begin(), InvisibleList.end(), ObjectList.begin() + RenderQueue_.getSize());
+        }
+        break;
         default:
             break;
     }
@@ -640,13 +702,21 @@ void SceneGraph::arrangeRenderList(std::vector<RenderNode*> &ObjectList, const d
     if (ActiveCamera_)
         ActiveCamera_->updateTransformation();
     
-    foreach (RenderNode* Obj, ObjectList)
+    if (hasChildTree_)
+    {
+        foreach (RenderNode* Obj, ObjectList)
+        {
+            if (Obj->getVisible())
+                Obj->updateTransformationBase(BaseMatrix);
+        }
+    }
+    else
     {
-        if (Obj->getVisible())
-            Obj->updateTransformationBase(BaseMatrix);
+        /* Only recompute the world matrices of changed sub-trees */
+        Transforms_.update(ObjectList, BaseMatrix);
     }
     
-    if (DepthSorting_)
+    if (DepthSorting_ && !RenderQueueSorting_)
         sortRenderList(RENDERLIST_SORT_DEPTHDISTANCE, ObjectList);
 }
 
@@ -686,6 +756,23 @@ void SceneGraph::arrangeLightList(std::vector<Light*> &ObjectList)
 
 void SceneGraph::renderLightsDefault(const dim::matrix4f &BaseMatrix, bool RenderFixedFunctionOnly)
 {
+    if (LightBinning_)
+    {
+        /* Bin the light sources; they are enabled for each mesh by "setupNodeLights" */
+        LightGrid_.build(LightList_, BaseMatrix);
+        
+        if (!GlbRenderSys->getGlobalShaderClass())
+        {
+            const s32 MaxLightCount = math::Min(GlbRenderSys->getMaxLightCount(), MAX_COUNT_OF_LIGHTS);
+            
+            for (s32 i = 0; i < MaxLightCount; ++i)
+                GlbRenderSys->setLightStatus(i, false);
+        }
+        
+        BoundLights_.clear();
+        return;
+    }
+    
     if (LightSorting_)
         arrangeLightList(LightList_);
     
@@ -706,11 +793,67 @@ void SceneGraph::renderLightsDefault(const dim::matrix4f &BaseMatrix, bool Rende
     }
 }
 
+void SceneGraph::setupNodeLights(const RenderNode* Node)
+{
+    if (GlbRenderSys->getGlobalShaderClass())
+        return;
+    
+    /* Get the light sources of this node */
+    if (!LightGrid_.getNodeLights(Node, NodeLights_))
+        LightGrid_.findLights(Node, NodeLights_);
+    
+    /* Consecutive nodes often have the same light sources */
+    if (NodeLights_ == BoundLights_)
+        return;
+    
+    const u32 MaxLightCount = static_cast<u32>(math::Min(GlbRenderSys->getMaxLightCount(), MAX_COUNT_OF_LIGHTS));
+    
+    /* Keep the world matrix of the node while the light sources are updated */
+    const dim::matrix4f WorldMatrix(spWorldMatrix);
+    
+    video::color Diffuse, Ambient, Specular;
+    
+    for (u32 i = 0; i < MaxLightCount; ++i)
+    {
+        if (i < NodeLights_.size())
+        {
+            Light* Obj = NodeLights_[i];
+            
+            /* Update light colors and status */
+            Obj->getLightingColor(Diffuse, Ambient, Specular);
+            GlbRenderSys->setLightColor(i, Diffuse, Ambient, Specular);
+            GlbRenderSys->setLightStatus(i, true);
+            
+            /*
+             * Render the light into the slot of this node temporarily.
+             * The registered ID must be kept, because the light releases it on destruction.
+             */
+            const u32 RegisteredID = Obj->LightID_;
+            
+            Obj->LightID_ = i;
+            Obj->render();
+            Obj->LightID_ = RegisteredID;
+        }
+        else if (i < BoundLights_.size())
+            GlbRenderSys->setLightStatus(i, false);
+    }
+    
+    spWorldMatrix = WorldMatrix;
+    
+    BoundLights_ = NodeLights_;
+}
+
 void SceneGraph::finishRenderScene()
 {
     GlbRenderSys->endSceneRendering();
 }
 
+void SceneGraph::removeOccluderNode(SceneNode* Object)
+{
+    if (Object && Object->getType() == NODE_MESH)
+        OcclusionCuller_.removeOccluder(static_cast<Mesh*>(Object));
+}
+
 
 } // /namespace scene
 
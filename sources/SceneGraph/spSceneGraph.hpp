@@ -22,6 +22,13 @@
 #include "SceneGraph/spCameraFirstPerson.hpp"
 #include "SceneGraph/spCameraBlender.hpp"
 #include "SceneGraph/spCameraTracking.hpp"
+#include "SceneGraph/spSceneTransformHierarchy.hpp"
+#include "SceneGraph/spSceneFrustumCuller.hpp"
+#include "SceneGraph/spSceneOcclusionCuller.hpp"
+#include "SceneGraph/spSceneRenderQueue.hpp"
+#include "SceneGraph/spSceneInstanceBatcher.hpp"
+#include "SceneGraph/spSceneLightGrid.hpp"
+#include "SceneGraph/spMeshSimplifier.hpp"
 #include "SceneGraph/Animation/spNodeAnimation.hpp"
 #include "SceneGraph/Animation/spMorphTargetAnimation.hpp"
 #include "SceneGraph/Animation/spSkeletalAnimation.hpp"
@@ -30,6 +37,7 @@
 
 #include <list>
 #include <vector>
+#include <set>
 
 
 namespace sp
@@ -46,6 +54,7 @@ enum ESceneGraphs
     SCENEGRAPH_SIMPLE_STREAM,   //!< Simple scene graph with streaming (used for multi-threading).
     SCENEGRAPH_FAMILY_TREE,     //!< Scene graph with child tree hierarchy.
     SCENEGRAPH_PORTAL_BASED,    //!< Portal-based scene graph.
+    SCENEGRAPH_SPATIAL,         //!< Scene graph with loose octrees for culling and spatial queries.
 };
 
 //! Sort methods for the render node list.
@@ -61,6 +70,13 @@ enum ERenderListSortMethods
     depth-sorting is disabled for performance optimization.
     */
     RENDERLIST_SORT_MESHBUFFER,
+    /**
+    Sorting with packed 64-bit keys (layer, translucency, shader class, material states, textures and depth)
+    by a radix sort. Opaque nodes are grouped by their render states and translucent nodes are sorted back to front.
+    \see RenderQueue
+    \since Version 3.3
+    */
+    RENDERLIST_SORT_RENDERQUEUE,
 };
 
 
@@ -261,6 +277,8 @@ class SP_EXPORT SceneGraph : public RenderNode
         Tries to find each node with the specified name.
         \param Name: Name of the wanted nodes.
         \return List with each Node object which could found.
+        \note Since version 3.3 this uses the name index of the scene manager (see SceneManager::findNodes),
+        so only nodes which are managed by the scene manager can be found.
         */
         virtual std::list<SceneNode*> findNodes(const io::stringc &Name) const;
         
@@ -268,6 +286,7 @@ class SP_EXPORT SceneGraph : public RenderNode
         Tries to find the specified node.
         \param Name: Name of the wanted node.
         \return Pointer to the Node object which could found. If no object could found the return value is 0.
+        \note Since version 3.3 this uses the name index of the scene manager (see SceneManager::findNode).
         */
         virtual SceneNode* findNode(const io::stringc &Name) const;
         
@@ -403,6 +422,77 @@ class SP_EXPORT SceneGraph : public RenderNode
             return NodeList_;
         }
         
+        /**
+        Returns a reference to the transform hierarchy. It caches the world matrices of all render nodes
+        and is used to update their transformations when the scene graph has no child tree.
+        \see TransformHierarchy
+        \since Version 3.3
+        */
+        inline TransformHierarchy& getTransformHierarchy()
+        {
+            return Transforms_;
+        }
+        inline const TransformHierarchy& getTransformHierarchy() const
+        {
+            return Transforms_;
+        }
+        
+        /**
+        Returns a reference to the frustum culler. It is used to cull the render nodes
+        for the active camera and for plain scene rendering (e.g. for shadow maps).
+        \see FrustumCuller
+        \since Version 3.3
+        */
+        inline FrustumCuller& getFrustumCuller()
+        {
+            return Culler_;
+        }
+        inline const FrustumCuller& getFrustumCuller() const
+        {
+            return Culler_;
+        }
+        
+        /**
+        Returns true while the render nodes are rendered from the visible-node list of the frustum culler.
+        In this case the render nodes don't need their own frustum culling.
+        \since Version 3.3
+        */
+        inline bool hasPreCulling() const
+        {
+            return PreCulling_;
+        }
+        
+        /**
+        Enables or disables software occlusion culling. If enabled the occluders of the occlusion culler are rasterized
+        for the active camera each frame and the frustum-visible render nodes which are hidden behind them are not rendered.
+        \param[in] Enable Specifies whether occlusion culling is to be enabled or disabled. By default disabled.
+        \see OcclusionCuller
+        \since Version 3.3
+        */
+        inline void setOcclusionCulling(bool Enable)
+        {
+            OcclusionCulling_ = Enable;
+        }
+        //! Returns true if software occlusion culling is enabled. By default disabled.
+        inline bool getOcclusionCulling() const
+        {
+            return OcclusionCulling_;
+        }
+        
+        /**
+        Returns a reference to the occlusion culler, e.g. to add the occluder meshes.
+        \see OcclusionCuller
+        \since Version 3.3
+        */
+        inline OcclusionCuller& getOcclusionCuller()
+        {
+            return OcclusionCuller_;
+        }
+        inline const OcclusionCuller& getOcclusionCuller() const
+        {
+            return OcclusionCuller_;
+        }
+        
         /**
         Sets the current active camera.
         \param ActiveCamera: Camera which is to be set to the current active one.
@@ -465,6 +555,96 @@ class SP_EXPORT SceneGraph : public RenderNode
             return LightSorting_;
         }
         
+        /**
+        Enables or disables light binning. If enabled the light sources are not sorted by their distance to the view camera,
+        but inserted into the light grid each frame and each visible render node gets its own list of the most relevant light sources.
+        For the fixed-function pipeline these light sources are enabled before each mesh is rendered. With a global shader class
+        the lists can be queried in the shader callback (see LightGrid::getNodeLights and "getActiveMesh").
+        \param[in] Enable Specifies whether light binning is to be enabled or disabled. By default disabled.
+        \note Instanced meshes (see "setInstancing") are rendered with the light sources of the first instance.
+        \see LightGrid
+        \since Version 3.3
+        */
+        inline void setLightBinning(bool Enable)
+        {
+            LightBinning_ = Enable;
+        }
+        //! Returns true if light binning is enabled. By default disabled.
+        inline bool getLightBinning() const
+        {
+            return LightBinning_;
+        }
+        
+        /**
+        Returns a reference to the light grid, e.g. to set the cell size.
+        \see LightGrid
+        \since Version 3.3
+        */
+        inline LightGrid& getLightGrid()
+        {
+            return LightGrid_;
+        }
+        inline const LightGrid& getLightGrid() const
+        {
+            return LightGrid_;
+        }
+        
+        /**
+        Enables or disables the render queue for rendering the scene. If enabled the visible render nodes
+        are sorted by the render queue (see RENDERLIST_SORT_RENDERQUEUE) instead of the depth sorting.
+        \param[in] Enable Specifies whether the render queue is to be enabled or disabled. By default disabled.
+        \see RenderQueue
+        \since Version 3.3
+        */
+        inline void setRenderQueueSorting(bool Enable)
+        {
+            RenderQueueSorting_ = Enable;
+        }
+        //! Returns true if the render queue is enabled. By default disabled.
+        inline bool getRenderQueueSorting() const
+        {
+            return RenderQueueSorting_;
+        }
+        
+        //! Returns a constant reference to the render queue, e.g. to query the count of saved state changes.
+        inline const RenderQueue& getRenderQueue() const
+        {
+            return RenderQueue_;
+        }
+        
+        /**
+        Enables or disables automatic instancing. If enabled the visible meshes which share the same mesh buffers,
+        material states and shader class are rendered with one hardware instanced draw call per mesh buffer.
+        This is only used when hardware instancing is supported by the render system.
+        \param[in] Enable Specifies whether instancing is to be enabled or disabled. By default disabled.
+        \see InstanceBatcher
+        \since Version 3.3
+        */
+        inline void setInstancing(bool Enable)
+        {
+            Instancing_ = Enable;
+        }
+        //! Returns true if automatic instancing is enabled. By default disabled.
+        inline bool getInstancing() const
+        {
+            return Instancing_;
+        }
+        
+        /**
+        Returns a reference to the instance batcher, e.g. to set the instance transformation callback
+        or to query the count of issued and saved draw calls.
+        \see InstanceBatcher
+        \since Version 3.3
+        */
+        inline InstanceBatcher& getInstanceBatcher()
+        {
+            return InstanceBatcher_;
+        }
+        inline const InstanceBatcher& getInstanceBatcher() const
+        {
+            return InstanceBatcher_;
+        }
+        
         /* === Static functions === */
         
         /**
@@ -481,6 +661,9 @@ class SP_EXPORT SceneGraph : public RenderNode
         friend class RenderNode;
         friend class MaterialNode;
         friend class Mesh;
+        friend class Billboard;
+        friend class Terrain;
+        friend class InstanceBatcher;
         
         /* === Functions === */
         
@@ -510,8 +693,38 @@ class SP_EXPORT SceneGraph : public RenderNode
         */
         void renderLightsDefault(const dim::matrix4f &BaseMatrix, bool RenderFixedFunctionOnly = true);
         
+        /**
+        Enables the light sources of the specified render node for the fixed-function pipeline when light binning is enabled.
+        The light sources are taken from the last "LightGrid::assign" call or searched if the node has not been assigned.
+        This is called by each mesh, terrain and lit billboard (and by each group of instances) before it's rendered.
+        */
+        void setupNodeLights(const RenderNode* Node);
+        
         static void finishRenderScene();
         
+        //! Removes the specified node from the occluder list if it's a mesh.
+        void removeOccluderNode(SceneNode* Object);
+        
+        /**
+        Registers the specified node as member of this scene graph. Each scene graph class must call this
+        when it adds a node to one of its lists, and "removeMember" when it removes a node, to keep "findNode" working.
+        */
+        inline void addMember(const SceneNode* Object)
+        {
+            Members_.insert(Object);
+        }
+        inline void removeMember(const SceneNode* Object)
+        {
+            std::multiset<const SceneNode*>::iterator it = Members_.find(Object);
+            if (it != Members_.end())
+                Members_.erase(it);
+        }
+        //! Returns true if the specified node has been added to this scene graph.
+        inline bool hasMember(const SceneNode* Object) const
+        {
+            return Members_.find(Object) != Members_.end();
+        }
+        
         /* === Templates === */
         
         template <class T> void clearRenderObjectList(const ENodeTypes Type, std::vector<RenderNode*> &ObjectList)
@@ -567,26 +780,10 @@ class SP_EXPORT SceneGraph : public RenderNode
             return 0;
         }
         
-        template <class T, class L> void addNodeToList(
-            const io::stringc &Name, std::list<SceneNode*> &NodeList, const std::vector<L*> &SearchList) const
-        {
-            for (typename std::vector< L*, std::allocator<L*> >::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
-            {
-                if ((*it)->getName() == Name)
-                    NodeList.push_back(*it);
-            }
-        }
-        
-        template <class T> SceneNode* findNodeInList(
-            const io::stringc &Name, const std::vector<T*> &SearchList) const
+        template <class T> void removeMembers(const std::vector<T*> &ObjectList)
         {
-            for (typename std::vector< T*, std::allocator<T*> >::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
-            {
-                if ((*it)->getName() == Name)
-                    return *it;
-            }
-            
-            return 0;
+            for (typename std::vector< T*, std::allocator<T*> >::const_iterator it = ObjectList.begin(); it != ObjectList.end(); ++it)
+                removeMember(*it);
         }
         
         template <class T> std::list<T*> filterRenderNodeList(const ENodeTypes Type) const
@@ -612,6 +809,8 @@ class SP_EXPORT SceneGraph : public RenderNode
         std::vector<Light*>         LightList_;     //!< \todo Rename this to "LightSources_".
         std::vector<RenderNode*>    RenderList_;    //!< \todo Rename this to "RenderNodes_".
         
+        std::multiset<const SceneNode*> Members_;   //!< All nodes of the lists above (a node can be added several times).
+        
         Camera* ActiveCamera_;
         Mesh* ActiveMesh_;
         
@@ -620,6 +819,25 @@ class SP_EXPORT SceneGraph : public RenderNode
         bool DepthSorting_;
         bool LightSorting_;
         
+        TransformHierarchy Transforms_;
+        FrustumCuller Culler_;
+        std::vector<u32> VisibleIndices_;
+        bool PreCulling_;
+        
+        OcclusionCuller OcclusionCuller_;
+        bool OcclusionCulling_;
+        
+        RenderQueue RenderQueue_;
+        bool RenderQueueSorting_;
+        
+        InstanceBatcher InstanceBatcher_;
+        bool Instancing_;
+        
+        LightGrid LightGrid_;
+        bool LightBinning_;
+        std::vector<Light*> NodeLights_;
+        std::vector<Light*> BoundLights_;   //!< Light sources which are currently enabled by "setupNodeLights".
+        
         static bool ReverseDepthSorting_;
         
 };
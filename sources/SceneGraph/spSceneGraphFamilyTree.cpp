@@ -50,14 +50,16 @@ void SceneGraphFamilyTree::addSceneNode(SceneNode* Object)
     {
         NodeList_.push_back(Object);
         RootNodeList_.push_back(Object);
+        addMember(Object);
     }
 }
 void SceneGraphFamilyTree::removeSceneNode(SceneNode* Object)
 {
     if (Object)
     {
-        removeObjectFromList<SceneNode>(Object, NodeList_       );
-        removeObjectFromList<SceneNode>(Object, RootNodeList_   );
+        if (removeObjectFromList<SceneNode>(Object, NodeList_))
+            removeMember(Object);
+        removeObjectFromList<SceneNode>(Object, RootNodeList_);
     }
 }
 
@@ -67,14 +69,16 @@ void SceneGraphFamilyTree::addSceneNode(Camera* Object)
     {
         CameraList_.push_back(Object);
         RootNodeList_.push_back(Object);
+        addMember(Object);
     }
 }
 void SceneGraphFamilyTree::removeSceneNode(Camera* Object)
 {
     if (Object)
     {
-        removeObjectFromList<Camera>    (Object, CameraList_    );
-        removeObjectFromList<SceneNode> (Object, RootNodeList_  );
+        if (removeObjectFromList<Camera>(Object, CameraList_))
+            removeMember(Object);
+        removeObjectFromList<SceneNode>(Object, RootNodeList_);
     }
 }
 
@@ -84,14 +88,16 @@ void SceneGraphFamilyTree::addSceneNode(Light* Object)
     {
         LightList_.push_back(Object);
         RootNodeList_.push_back(Object);
+        addMember(Object);
     }
 }
 void SceneGraphFamilyTree::removeSceneNode(Light* Object)
 {
     if (Object)
     {
-        removeObjectFromList<Light>     (Object, LightList_     );
-        removeObjectFromList<SceneNode> (Object, RootNodeList_  );
+        if (removeObjectFromList<Light>(Object, LightList_))
+            removeMember(Object);
+        removeObjectFromList<SceneNode>(Object, RootNodeList_);
     }
 }
 
@@ -101,14 +107,17 @@ void SceneGraphFamilyTree::addSceneNode(RenderNode* Object)
     {
         RenderList_.push_back(Object);
         RootNodeList_.push_back(Object);
+        addMember(Object);
     }
 }
 void SceneGraphFamilyTree::removeSceneNode(RenderNode* Object)
 {
     if (Object)
     {
-        removeObjectFromList<RenderNode>(Object, RenderList_    );
-        removeObjectFromList<SceneNode> (Object, RootNodeList_  );
+        if (removeObjectFromList<RenderNode>(Object, RenderList_))
+            removeMember(Object);
+        removeObjectFromList<SceneNode>(Object, RootNodeList_);
+        removeOccluderNode(Object);
     }
 }
 
@@ -15,18 +15,306 @@
 #include "SceneGraph/spScenePortal.hpp"
 #include "SceneGraph/spSceneLight.hpp"
 #include "SceneGraph/spRenderNode.hpp"
+#include "SceneGraph/spSceneCamera.hpp"
+#include "Base/spInputOutputFileSystem.hpp"
+#include "Base/spInputOutputLog.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spTimer.hpp"
 
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 
 
 namespace sp
 {
+
+
+/*
+ * Internal members
+ */
+
+extern io::OSInformator* GlbPlatformInfo;
+
 namespace scene
 {
 
 
+/*
+ * Internal structures
+ */
+
+static const s32 PVS_MAGIC_NUMBER   = *((s32*)"SPVS");
+static const u16 PVS_VERSION_NUMBER = 1;
+
+//! Distance tolerance for the clipping of the portal windings.
+static const f32 PVS_EPSILON = 0.001f;
+
+//! Minimal count of render nodes for each thread when the visible sectors are culled.
+static const u32 PORTAL_CULLING_MIN_BLOCK_SIZE = 4096;
+
+struct SPortalThreadData
+{
+    SceneGraphPortalBased* Graph;
+    s32 Job;
+    u32 Begin, End, Block;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+struct SPVSFloodState
+{
+    u32* Row;
+    std::vector<bool> OnPath;                   //!< Sectors on the current portal sequence.
+    std::vector<dim::vector3df> Source;         //!< Winding of the first portal of the sequence.
+    dim::plane3df SourcePlane;
+    std::vector<dim::vector3df> Temp;
+};
+
+
+/*
+ * Internal functions
+ */
+
+THREAD_PROC(PortalBasedThreadProc)
+{
+    SPortalThreadData* ThreadData = reinterpret_cast<SPortalThreadData*>(Arguments);
+    
+    /* Process the range of sectors given to this thread */
+    ThreadData->Graph->processBlock(
+        static_cast<SceneGraphPortalBased::EThreadJobs>(ThreadData->Job),
+        ThreadData->Begin, ThreadData->End, ThreadData->Block
+    );
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+static inline void setPVSBit(u32* Row, u32 Index)
+{
+    Row[Index >> 5] |= (1u << (Index & 31));
+}
+
+//! Returns the portal's corners as polygon winding.
+static void getPortalWinding(const Portal* PortalObj, std::vector<dim::vector3df> &Winding)
+{
+    Winding.resize(4);
+    Winding[0] = PortalObj->getPoint(0);
+    Winding[1] = PortalObj->getPoint(1);
+    Winding[2] = PortalObj->getPoint(3);
+    Winding[3] = PortalObj->getPoint(2);
+}
+
+//! Returns the portal's plane whose front side points away from the specified sector.
+static dim::plane3df getPortalPlane(const Portal* PortalObj, const Sector* SectorObj)
+{
+    dim::plane3df Plane(PortalObj->getPoint(0), PortalObj->getPoint(1), PortalObj->getPoint(2));
+    
+    if (Plane.isPointFrontSide(SectorObj->getCenter()))
+        Plane.swap();
+    
+    return Plane;
+}
+
+//! Clips the winding to the front side of the plane and returns false if nothing remains.
+static bool clipWinding(
+    std::vector<dim::vector3df> &Winding, const dim::plane3df &Plane, std::vector<dim::vector3df> &Temp)
+{
+    Temp.clear();
+    
+    const u32 Count = Winding.size();
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        const dim::vector3df& PointA = Winding[i];
+        const dim::vector3df& PointB = Winding[(i + 1) % Count];
+        
+        const f32 DistA = Plane.getPointDistance(PointA);
+        const f32 DistB = Plane.getPointDistance(PointB);
+        
+        if (DistA >= -PVS_EPSILON)
+            Temp.push_back(PointA);
+        
+        if ( ( DistA > PVS_EPSILON && DistB < -PVS_EPSILON ) || ( DistA < -PVS_EPSILON && DistB > PVS_EPSILON ) )
+            Temp.push_back(PointA + (PointB - PointA) * (DistA / (DistA - DistB)));
+    }
+    
+    Winding.swap(Temp);
+    
+    return Winding.size() >= 3;
+}
+
+/**
+Builds the plane through the edge and the point and returns true if it separates the source winding (back side)
+from the pass winding (front side). Each line of sight through both windings ends on the front side of such a plane.
+*/
+static bool getSeparatingPlane(
+    const dim::vector3df &EdgeA, const dim::vector3df &EdgeB, const dim::vector3df &Point,
+    const std::vector<dim::vector3df> &Source, const std::vector<dim::vector3df> &Pass, dim::plane3df &Plane)
+{
+    dim::vector3df Normal((EdgeB - EdgeA).cross(Point - EdgeA));
+    
+    const f32 Length = Normal.getLength();
+    
+    if (Length < PVS_EPSILON)
+        return false;
+    
+    Normal /= Length;
+    Plane = dim::plane3df(Normal, Normal.dot(EdgeA));
+    
+    /* The source winding must be completely on one side */
+    s32 Side = 0;
+    
+    foreach (const dim::vector3df &SourcePoint, Source)
+    {
+        const f32 Dist = Plane.getPointDistance(SourcePoint);
+        
+        if (Dist > PVS_EPSILON)
+        {
+            if (Side < 0)
+                return false;
+            Side = 1;
+        }
+        else if (Dist < -PVS_EPSILON)
+        {
+            if (Side > 0)
+                return false;
+            Side = -1;
+        }
+    }
+    
+    if (!Side)
+        return false;
+    
+    /* The pass winding must be on the other side */
+    bool Separated = false;
+    
+    foreach (const dim::vector3df &PassPoint, Pass)
+    {
+        const f32 Dist = Plane.getPointDistance(PassPoint) * Side;
+        
+        if (Dist > PVS_EPSILON)
+            return false;
+        if (Dist < -PVS_EPSILON)
+            Separated = true;
+    }
+    
+    if (!Separated)
+        return false;
+    
+    if (Side > 0)
+        Plane.swap();
+    
+    return true;
+}
+
+static void addSeparatingPlanes(
+    const std::vector<dim::vector3df> &EdgeWinding, const std::vector<dim::vector3df> &PointWinding,
+    const std::vector<dim::vector3df> &Source, const std::vector<dim::vector3df> &Pass,
+    std::vector<dim::plane3df> &Separators)
+{
+    dim::plane3df Plane;
+    
+    for (u32 i = 0, Count = EdgeWinding.size(); i < Count; ++i)
+    {
+        foreach (const dim::vector3df &Point, PointWinding)
+        {
+            if (getSeparatingPlane(EdgeWinding[i], EdgeWinding[(i + 1) % Count], Point, Source, Pass, Plane))
+                Separators.push_back(Plane);
+        }
+    }
+}
+
+/**
+Marks all sectors which are visible from the source portal through the pass portal, which leads into the specified sector.
+The winding of each further portal is clipped by the source plane, the pass plane and the separating planes.
+*/
+static void floodPVS(
+    SPVSFloodState &State, Sector* SectorObj, const Portal* EntryPortal,
+    const std::vector<dim::vector3df> &Pass, const dim::plane3df &PassPlane, bool IsSourcePass)
+{
+    /* Compute the planes which separate the source portal from the pass portal */
+    std::vector<dim::plane3df> Separators;
+    
+    if (!IsSourcePass)
+    {
+        addSeparatingPlanes(State.Source, Pass, State.Source, Pass, Separators);
+        addSeparatingPlanes(Pass, State.Source, State.Source, Pass, Separators);
+    }
+    
+    std::vector<dim::vector3df> Target;
+    
+    foreach (const Portal* PortalObj, SectorObj->getPortalList())
+    {
+        Sector* Neighbor = PortalObj->getNeighbor(SectorObj);
+        
+        if (PortalObj == EntryPortal || !Neighbor || State.OnPath[Neighbor->getIndex()])
+            continue;
+        
+        /* The source portal must be at least partially behind the target portal */
+        const dim::plane3df TargetPlane(getPortalPlane(PortalObj, SectorObj));
+        
+        bool IsBehind = false;
+        
+        foreach (const dim::vector3df &SourcePoint, State.Source)
+        {
+            if (TargetPlane.getPointDistance(SourcePoint) < -PVS_EPSILON)
+            {
+                IsBehind = true;
+                break;
+            }
+        }
+        
+        if (!IsBehind)
+            continue;
+        
+        /* Clip the target portal */
+        getPortalWinding(PortalObj, Target);
+        
+        if ( !clipWinding(Target, State.SourcePlane, State.Temp) ||
+             ( !IsSourcePass && !clipWinding(Target, PassPlane, State.Temp) ) )
+        {
+            continue;
+        }
+        
+        bool IsVisible = true;
+        
+        foreach (const dim::plane3df &Plane, Separators)
+        {
+            if (!clipWinding(Target, Plane, State.Temp))
+            {
+                IsVisible = false;
+                break;
+            }
+        }
+        
+        if (!IsVisible)
+            continue;
+        
+        /* Mark the neighbor as visible and continue with the clipped target as new pass portal */
+        setPVSBit(State.Row, Neighbor->getIndex());
+        
+        State.OnPath[Neighbor->getIndex()] = true;
+        floodPVS(State, Neighbor, PortalObj, Target, TargetPlane, false);
+        State.OnPath[Neighbor->getIndex()] = false;
+    }
+}
+
+
+/*
+ * SceneGraphPortalBased class
+ */
+
 SceneGraphPortalBased::SceneGraphPortalBased() :
-    SceneGraph(SCENEGRAPH_PORTAL_BASED)
+    SceneGraph  (SCENEGRAPH_PORTAL_BASED),
+    PVSRowSize_ (0                      ),
+    Frame_      (0                      ),
+    ThreadCount_(0                      )
 {
 }
 SceneGraphPortalBased::~SceneGraphPortalBased()
@@ -42,17 +330,28 @@ Sector* SceneGraphPortalBased::createSector(const scene::Transformation &Transfo
     
     NewSector->setTransformation(Transform.getMatrix());
     
+    updateSectorIndices();
+    clearPVS();
+    
     return NewSector;
 }
 
 void SceneGraphPortalBased::deleteSector(Sector* SectorObj)
 {
     MemoryManager::removeElement(Sectors_, SectorObj, true);
+    
+    updateSectorIndices();
+    clearPVS();
+    VisibleSectors_.clear();
 }
 
 void SceneGraphPortalBased::clearSectors()
 {
     MemoryManager::deleteList(Sectors_);
+    
+    SectorArray_.clear();
+    clearPVS();
+    VisibleSectors_.clear();
 }
 
 Portal* SceneGraphPortalBased::createPortal(const scene::Transformation &Transform)
@@ -62,6 +361,8 @@ Portal* SceneGraphPortalBased::createPortal(const scene::Transformation &Transfo
     
     NewPortal->setTransformation(Transform.getMatrix());
     
+    clearPVS();
+    
     return NewPortal;
 }
 
@@ -78,11 +379,13 @@ Portal* SceneGraphPortalBased::createPortal(const scene::Transformation &Transfo
 void SceneGraphPortalBased::deletePortal(Portal* PortalObj)
 {
     MemoryManager::removeElement(Portals_, PortalObj, true);
+    clearPVS();
 }
 
 void SceneGraphPortalBased::clearPortals()
 {
     MemoryManager::deleteList(Portals_);
+    clearPVS();
 }
 
 void SceneGraphPortalBased::render()
@@ -93,29 +396,45 @@ void SceneGraphPortalBased::render()
     /* Render lights */
     renderLightsDefault(BaseMatrix);
     
-    /* Draw portal-based render nodes */
+    /* Find the visible sectors, starting with the camera's sector */
     Camera* ViewCamera = getActiveCamera();
-    ViewFrustum& Frustum = ViewCamera->ViewFrustum_;
+    ViewFrustum Frustum(ViewCamera->getViewFrustum());
     
     const dim::vector3df GlobalViewOrigin(ViewCamera->getPosition(true));
     
     Sector* SectorObj = findSector(GlobalViewOrigin);
     
+    VisibleSectors_.clear();
+    VisibleNodes_.clear();
+    
     if (SectorObj)
-        SectorObj->render(0, GlobalViewOrigin, Frustum, BaseMatrix);
-    #if 0
-    else
+        SectorObj->traverse(GlobalViewOrigin, Frustum, getPVSRow(SectorObj), ++Frame_, VisibleSectors_);
+    
+    /* Cull the render nodes of the visible sectors against their narrowed frustums */
+    if (!VisibleSectors_.empty())
     {
-        const ViewFrustum OrigFrustum(Frustum);
+        /* Update the transformations on the calling thread, since the nodes can share their parents */
+        u32 NumNodes = 0;
         
-        /* If no sector has found, draw all sectors */
-        foreach (Sector* Sctr, Sectors_)
+        foreach (Sector* Obj, VisibleSectors_)
         {
-            Sctr->render(GlobalViewOrigin, Frustum, BaseMatrix);
-            Frustum = OrigFrustum;
+            Obj->updateRenderNodes(BaseMatrix);
+            NumNodes += Obj->RenderNodes_.size();
         }
+        
+        runThreadJob(
+            THREADJOB_CULLING, VisibleSectors_.size(),
+            (NumNodes + PORTAL_CULLING_MIN_BLOCK_SIZE - 1) / PORTAL_CULLING_MIN_BLOCK_SIZE
+        );
+        
+        /* Draw portal-based render nodes */
+        PreCulling_ = true;
+        
+        foreach (RenderNode* Node, VisibleNodes_)
+            Node->render();
+        
+        PreCulling_ = false;
     }
-    #endif
     
     /* Draw global render nodes */
     foreach (RenderNode* Node, GlobalRenderNodes_)
@@ -141,6 +460,8 @@ Sector* SceneGraphPortalBased::findSector(const dim::vector3df &Point) const
 
 void SceneGraphPortalBased::connectSectors(f32 DistanceTolerance)
 {
+    clearPVS();
+    
     foreach (Portal* PortalObj, Portals_)
     {
         /* Find nearest sectors */
@@ -212,6 +533,246 @@ void SceneGraphPortalBased::releaseRenderNodes()
     //...
 }
 
+void SceneGraphPortalBased::computePVS()
+{
+    const u32 Count = SectorArray_.size();
+    
+    PVSRowSize_ = (Count + 31) / 32;
+    PVS_.assign(Count * PVSRowSize_, 0);
+    
+    /* Compute the rows of the sectors in parallel (each thread only writes the rows of its own sectors) */
+    runThreadJob(THREADJOB_PVS, Count, Count);
+}
+
+bool SceneGraphPortalBased::savePVS(const io::stringc &Filename) const
+{
+    if (!hasPVS())
+    {
+        io::Log::error("Can not save PVS because it has not been computed");
+        return false;
+    }
+    
+    io::FileSystem FileSys;
+    io::File* PVSFile = FileSys.openFile(Filename, io::FILE_WRITE);
+    
+    if (!PVSFile)
+        return false;
+    
+    /* Write header: magic number ("SPVS"), format version and dimension */
+    PVSFile->writeValue<s32>(PVS_MAGIC_NUMBER);
+    PVSFile->writeValue<u16>(PVS_VERSION_NUMBER);
+    PVSFile->writeValue<u32>(SectorArray_.size());
+    PVSFile->writeValue<u32>(PVSRowSize_);
+    
+    /* Write bit matrix */
+    PVSFile->writeBuffer(&PVS_[0], sizeof(u32), PVS_.size());
+    
+    FileSys.closeFile(PVSFile);
+    
+    return true;
+}
+
+bool SceneGraphPortalBased::loadPVS(const io::stringc &Filename)
+{
+    clearPVS();
+    
+    io::FileSystem FileSys;
+    io::File* PVSFile = FileSys.openFile(Filename, io::FILE_READ);
+    
+    if (!PVSFile)
+        return false;
+    
+    bool Result = false;
+    
+    /* Read header */
+    const s32 MagicNumber   = PVSFile->readValue<s32>();
+    const u16 Version       = PVSFile->readValue<u16>();
+    const u32 Count         = PVSFile->readValue<u32>();
+    const u32 RowSize       = PVSFile->readValue<u32>();
+    
+    if (MagicNumber != PVS_MAGIC_NUMBER)
+        io::Log::error("PVS file has invalid magic number");
+    else if (Version != PVS_VERSION_NUMBER)
+        io::Log::error("Unsupported version in PVS file");
+    else if (Count != SectorArray_.size() || RowSize != (Count + 31) / 32)
+        io::Log::error("PVS file does not match the count of sectors");
+    else if (Count > 0)
+    {
+        /* Read bit matrix */
+        PVS_.resize(Count * RowSize);
+        
+        /* "readBuffer" returns the count of bytes */
+        if (PVSFile->readBuffer(&PVS_[0], sizeof(u32), PVS_.size()) == static_cast<s32>(PVS_.size()*sizeof(u32)))
+        {
+            PVSRowSize_ = RowSize;
+            Result = true;
+        }
+        else
+        {
+            io::Log::error("PVS file is incomplete");
+            PVS_.clear();
+        }
+    }
+    
+    FileSys.closeFile(PVSFile);
+    
+    return Result;
+}
+
+void SceneGraphPortalBased::clearPVS()
+{
+    PVS_.clear();
+    PVSRowSize_ = 0;
+}
+
+bool SceneGraphPortalBased::isSectorVisible(const Sector* From, const Sector* To) const
+{
+    const u32* Row = getPVSRow(From);
+    return !Row || !To || (Row[To->getIndex() >> 5] & (1u << (To->getIndex() & 31))) != 0;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void SceneGraphPortalBased::updateSectorIndices()
+{
+    SectorArray_.assign(Sectors_.begin(), Sectors_.end());
+    
+    for (u32 i = 0; i < SectorArray_.size(); ++i)
+        SectorArray_[i]->Index_ = i;
+}
+
+const u32* SceneGraphPortalBased::getPVSRow(const Sector* SectorObj) const
+{
+    if (PVS_.empty() || !SectorObj || SectorObj->getIndex() >= SectorArray_.size())
+        return 0;
+    return &PVS_[SectorObj->getIndex() * PVSRowSize_];
+}
+
+void SceneGraphPortalBased::computeSectorPVS(Sector* SectorObj)
+{
+    SPVSFloodState State;
+    
+    State.Row = &PVS_[SectorObj->getIndex() * PVSRowSize_];
+    State.OnPath.resize(SectorArray_.size(), false);
+    
+    /* Each sector can see itself and its direct neighbors */
+    setPVSBit(State.Row, SectorObj->getIndex());
+    State.OnPath[SectorObj->getIndex()] = true;
+    
+    foreach (Portal* PortalObj, SectorObj->getPortalList())
+    {
+        Sector* Neighbor = PortalObj->getNeighbor(SectorObj);
+        
+        if (!Neighbor || Neighbor == SectorObj)
+            continue;
+        
+        setPVSBit(State.Row, Neighbor->getIndex());
+        
+        /* Flood through the neighbor with this portal as source */
+        getPortalWinding(PortalObj, State.Source);
+        State.SourcePlane = getPortalPlane(PortalObj, SectorObj);
+        
+        State.OnPath[Neighbor->getIndex()] = true;
+        floodPVS(State, Neighbor, PortalObj, State.Source, State.SourcePlane, true);
+        State.OnPath[Neighbor->getIndex()] = false;
+    }
+}
+
+void SceneGraphPortalBased::runThreadJob(EThreadJobs Job, u32 Count, u32 ThreadCount)
+{
+    /* Determine the count of threads */
+    u32 MaxThreadCount = ThreadCount_;
+    
+    if (!MaxThreadCount)
+        MaxThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Max(1u, math::Min(math::Min(ThreadCount, MaxThreadCount), Count));
+    
+    const u32 BlockSize = (Count + ThreadCount - 1) / ThreadCount;
+    
+    if (Job == THREADJOB_CULLING)
+    {
+        if (BlockNodes_.size() < ThreadCount)
+            BlockNodes_.resize(ThreadCount);
+        for (u32 i = 0; i < ThreadCount; ++i)
+            BlockNodes_[i].clear();
+    }
+    
+    if (ThreadCount <= 1)
+        processBlock(Job, 0, Count, 0);
+    else
+    {
+        s32 NumRunningThreads = 0;
+        CriticalSection Mutex;
+        
+        std::vector<SPortalThreadData> ThreadDataList(ThreadCount - 1);
+        
+        typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+        std::vector<ThreadManagerPtr> Threads;
+        
+        /* Start worker threads for all ranges except the first one */
+        for (u32 i = 1, Begin = BlockSize; i < ThreadCount && Begin < Count; ++i, Begin += BlockSize)
+        {
+            SPortalThreadData& ThreadData = ThreadDataList[i - 1];
+            
+            ThreadData.Graph                = this;
+            ThreadData.Job                  = Job;
+            ThreadData.Begin                = Begin;
+            ThreadData.End                  = math::Min(Begin + BlockSize, Count);
+            ThreadData.Block                = i;
+            ThreadData.NumRunningThreads    = (&NumRunningThreads);
+            ThreadData.Mutex                = (&Mutex);
+            
+            Mutex.lock();
+            ++NumRunningThreads;
+            Mutex.unlock();
+            
+            Threads.push_back(boost::make_shared<ThreadManager>(PortalBasedThreadProc, &ThreadData));
+        }
+        
+        /* Process the first range in the calling thread */
+        processBlock(Job, 0, BlockSize, 0);
+        
+        /* Wait until all threads are finished */
+        while (1)
+        {
+            Mutex.lock();
+            const bool Finished = (NumRunningThreads <= 0);
+            Mutex.unlock();
+            
+            if (Finished)
+                break;
+            
+            io::Timer::yield();
+        }
+    }
+    
+    /* Gather the visible nodes in the order of the sectors */
+    if (Job == THREADJOB_CULLING)
+    {
+        for (u32 i = 0; i < ThreadCount; ++i)
+            VisibleNodes_.insert(VisibleNodes_.end(), BlockNodes_[i].begin(), BlockNodes_[i].end());
+    }
+}
+
+void SceneGraphPortalBased::processBlock(EThreadJobs Job, u32 Begin, u32 End, u32 Block)
+{
+    switch (Job)
+    {
+        case THREADJOB_PVS:
+            for (u32 i = Begin; i < End; ++i)
+                computeSectorPVS(SectorArray_[i]);
+            break;
+        
+        case THREADJOB_CULLING:
+            for (u32 i = Begin; i < End; ++i)
+                VisibleSectors_[i]->cullRenderNodes(BlockNodes_[Block]);
+            break;
+    }
+}
 
 } // /namespace scene
 
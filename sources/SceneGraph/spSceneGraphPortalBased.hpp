@@ -15,6 +15,7 @@
 
 
 #include "SceneGraph/spSceneGraph.hpp"
+#include "Base/spThreadManager.hpp"
 
 
 namespace sp
@@ -27,7 +28,12 @@ class Sector;
 class Portal;
 
 /**
-This is the class for portal-based scene graphs.
+This is the class for portal-based scene graphs. Rendering starts in the sector of the active camera and traverses
+the neighbor sectors through the portals, whereby the view frustum is narrowed by each portal.
+The render nodes of each visible sector are culled against the narrowed frustums (multi-threaded for large scenes).
+For large indoor levels a potentially visible set (PVS) can be computed offline with "computePVS" and
+stored alongside the scene with "savePVS". Sectors which are not potentially visible from the camera's
+sector are then skipped during the traversal with a single bit test.
 \ingroup group_scenegraph
 \since Version 3.2
 */
@@ -76,6 +82,44 @@ class SP_EXPORT SceneGraphPortalBased : public SceneGraph
         */
         void releaseRenderNodes();
         
+        /**
+        Computes the potentially visible set (PVS) of all sectors. A sector is potentially visible from another sector
+        if there is a line of sight through a sequence of portals between them. This is a conservative test:
+        the sequence is only rejected when the portals are clipped away by the planes which separate the first portal
+        and the current portal. Disabled portals are considered to be open.
+        The sectors are distributed over several threads.
+        \note The PVS must be recomputed (or loaded) whenever the sectors or portals have been changed.
+        Creating or deleting sectors and portals and "connectSectors" clear the PVS.
+        \see savePVS
+        \since Version 3.3
+        */
+        void computePVS();
+        
+        /**
+        Saves the PVS to the specified file.
+        \return True if the PVS could be saved. Otherwise there is no PVS or the file could not be opened.
+        \since Version 3.3
+        */
+        bool savePVS(const io::stringc &Filename) const;
+        
+        /**
+        Loads the PVS from the specified file.
+        \return True if the PVS could be loaded. Otherwise the file is invalid or it does not match the count of sectors.
+        \note The sectors must be created in the same order as they were when the PVS has been computed.
+        \since Version 3.3
+        */
+        bool loadPVS(const io::stringc &Filename);
+        
+        //! Clears the PVS. Afterwards all sectors are traversed again.
+        void clearPVS();
+        
+        /**
+        Returns true if the specified sector is potentially visible from the other sector.
+        If no PVS has been computed or loaded, the return value is always true.
+        \since Version 3.3
+        */
+        bool isSectorVisible(const Sector* From, const Sector* To) const;
+        
         /* === Inline functions === */
         
         inline const std::list<Sector*>& getSectorList() const
@@ -87,8 +131,56 @@ class SP_EXPORT SceneGraphPortalBased : public SceneGraph
             return Portals_;
         }
         
+        //! Returns true if a PVS has been computed or loaded.
+        inline bool hasPVS() const
+        {
+            return !PVS_.empty();
+        }
+        
+        //! Returns the list of sectors which have been visible in the last frame.
+        inline const std::vector<Sector*>& getVisibleSectorList() const
+        {
+            return VisibleSectors_;
+        }
+        
+        /**
+        Sets the count of threads for the PVS computation and the culling of the visible sectors.
+        \param[in] ThreadCount Specifies the count of threads. If 0 the count of processors is used. By default 0.
+        \note The sectors are only culled in several threads when they contain a few thousand render nodes.
+        \since Version 3.3
+        */
+        inline void setThreadCount(u32 ThreadCount)
+        {
+            ThreadCount_ = ThreadCount;
+        }
+        inline u32 getThreadCount() const
+        {
+            return ThreadCount_;
+        }
+        
     private:
         
+        friend THREAD_PROC(PortalBasedThreadProc);
+        
+        /* === Enumerations === */
+        
+        enum EThreadJobs
+        {
+            THREADJOB_PVS,      //!< Computes the PVS rows of a range of "SectorArray_".
+            THREADJOB_CULLING,  //!< Culls the render nodes of a range of "VisibleSectors_".
+        };
+        
+        /* === Functions === */
+        
+        void updateSectorIndices();
+        
+        const u32* getPVSRow(const Sector* SectorObj) const;
+        
+        void computeSectorPVS(Sector* SectorObj);
+        
+        void runThreadJob(EThreadJobs Job, u32 Count, u32 ThreadCount);
+        void processBlock(EThreadJobs Job, u32 Begin, u32 End, u32 Block);
+        
         /* === Members === */
         
         std::list<Sector*> Sectors_;
@@ -96,6 +188,18 @@ class SP_EXPORT SceneGraphPortalBased : public SceneGraph
         
         std::vector<RenderNode*> GlobalRenderNodes_;
         
+        std::vector<Sector*> SectorArray_;  //!< Sectors in the order of their indices.
+        
+        std::vector<u32> PVS_;              //!< Bit matrix with one row for each sector.
+        u32 PVSRowSize_;                    //!< Count of 32-bit words for each row.
+        
+        u32 Frame_;
+        std::vector<Sector*> VisibleSectors_;
+        std::vector< std::vector<RenderNode*> > BlockNodes_;
+        std::vector<RenderNode*> VisibleNodes_;
+        
+        u32 ThreadCount_;
+        
 };
 
 
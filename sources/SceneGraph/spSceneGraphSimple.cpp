@@ -50,7 +50,56 @@ void SceneGraphSimple::render()
     /* Render geometry */
     arrangeRenderList(RenderList_, BaseMatrix);
     
-    if (DepthSorting_)
+    if (ActiveCamera_)
+    {
+        /* Cull all render nodes at once and render only the visible ones (in the order of the render list) */
+        Culler_.updateBounds(RenderList_);
+        Culler_.cull(ActiveCamera_->getViewFrustum(), VisibleIndices_);
+        
+        if (OcclusionCulling_)
+        {
+            /* Drop the visible nodes which are hidden behind the occluders */
+            OcclusionCuller_.renderOccluders(ActiveCamera_);
+            OcclusionCuller_.cull(RenderList_, VisibleIndices_);
+        }
+        
+        /* Assign the light sources to the visible nodes only */
+        if (LightBinning_)
+            LightGrid_.assign(RenderList_, &VisibleIndices_);
+        
+        PreCulling_ = true;
+        
+        if (RenderQueueSorting_)
+        {
+            /* Render the visible nodes sorted by their render states */
+            RenderQueue_.build(RenderList_, &VisibleIndices_);
+            
+            if (Instancing_)
+            {
+                InstanceBatcher_.build(RenderQueue_);
+                InstanceBatcher_.render();
+            }
+            else
+            {
+                for (u32 i = 0; i < RenderQueue_.getSize(); ++i)
+                    RenderQueue_.getNode(i)->render();
+            }
+        }
+        else if (Instancing_)
+        {
+            /* Render the visible nodes with instancing */
+            InstanceBatcher_.build(RenderList_, &VisibleIndices_);
+            InstanceBatcher_.render();
+        }
+        else
+        {
+            foreach (u32 Index, VisibleIndices_)
+                RenderList_[Index]->render();
+        }
+        
+        PreCulling_ = false;
+    }
+    else if (DepthSorting_)
     {
         foreach (RenderNode* Node, RenderList_)
         {
@@ -91,32 +140,24 @@ void SceneGraphSimple::renderScenePlain(Camera* ActiveCamera)
     /* Setup default material states */
     GlbRenderSys->setupMaterialStates(&MaterialPlain_);
     
-    /* Render geometry */
+    /* Update mesh transformations */
     foreach (RenderNode* Node, RenderList_)
     {
-        if (Node->getType() != scene::NODE_MESH || !Node->getVisible())
-            continue;
-        
-        /* Render mesh object plain */
-        Mesh* MeshObj = static_cast<scene::Mesh*>(Node);
-        
-        /* Matrix transformation */
-        MeshObj->updateTransformation();
-        MeshObj->loadTransformation();
-        
-        /* Frustum culling */
-        if (!MeshObj->getBoundingVolume().checkFrustumCulling(ActiveCamera->getViewFrustum(), GlbRenderSys->getWorldMatrix()))
-            return;
-        
-        /* Update the render matrix */
-        GlbRenderSys->updateModelviewMatrix();
-        
-        /* Setup shader class */
-        GlbRenderSys->setupShaderClass(MeshObj, MeshObj->getShaderClass());
+        if (Node->getType() == scene::NODE_MESH && Node->getVisible())
+            Node->updateTransformation();
+    }
+    
+    /* Frustum culling for the specified camera */
+    Culler_.updateBounds(RenderList_);
+    Culler_.cull(ActiveCamera->getViewFrustum(), VisibleIndices_);
+    
+    /* Render geometry */
+    foreach (u32 Index, VisibleIndices_)
+    {
+        RenderNode* Node = RenderList_[Index];
         
-        /* Draw the current mesh object */
-        foreach (video::MeshBuffer* Surface, MeshObj->getMeshBufferList())
-            GlbRenderSys->drawMeshBufferPlain(Surface, true);
+        if (Node->getType() == scene::NODE_MESH)
+            renderMeshPlain(static_cast<scene::Mesh*>(Node));
     }
     
     /* Finish rendering the scene */
@@ -124,6 +165,27 @@ void SceneGraphSimple::renderScenePlain(Camera* ActiveCamera)
 }
 
 
+/*
+ * ======= Protected: =======
+ */
+
+void SceneGraphSimple::renderMeshPlain(Mesh* MeshObj)
+{
+    /* Matrix transformation */
+    MeshObj->loadTransformation();
+    
+    /* Update the render matrix */
+    GlbRenderSys->updateModelviewMatrix();
+    
+    /* Setup shader class */
+    GlbRenderSys->setupShaderClass(MeshObj, MeshObj->getShaderClass());
+    
+    /* Draw the current mesh object */
+    foreach (video::MeshBuffer* Surface, MeshObj->getMeshBufferList())
+        GlbRenderSys->drawMeshBufferPlain(Surface, true);
+}
+
+
 } // /namespace scene
 
 } // /namespace sp
@@ -45,6 +45,11 @@ class SP_EXPORT SceneGraphSimple : public SceneGraph
         
     protected:
         
+        /* Functions */
+        
+        //! Renders the specified mesh with its transformation and shader class but without material states.
+        void renderMeshPlain(Mesh* MeshObj);
+        
         /* Members */
         
         video::MaterialStates MaterialPlain_;
@@ -10,6 +10,8 @@
 #ifdef SP_COMPILE_WITH_SCENEGRAPH_SIMPLE_STREAM
 
 
+#include "Base/spTimer.hpp"
+
 #include <boost/foreach.hpp>
 
 
@@ -20,7 +22,9 @@ namespace scene
 
 
 SceneGraphSimpleStream::SceneGraphSimpleStream() :
-    SceneGraphSimple()
+    SceneGraphSimple(   ),
+    PendingIndex_   (0  ),
+    TimeBudget_     (0  )
 {
     GraphType_ = SCENEGRAPH_SIMPLE_STREAM;
 }
@@ -28,91 +32,151 @@ SceneGraphSimpleStream::~SceneGraphSimpleStream()
 {
 }
 
-#define SEMAPHORE(l)                \
-    if (Object)                     \
-    {                               \
-        SemaphoreQueues_.lock();    \
-        l.push_back(Object);        \
-        SemaphoreQueues_.unlock();  \
-    }
-
 void SceneGraphSimpleStream::addSceneNode(SceneNode* Object)
 {
-    SEMAPHORE(QueueAddNodes_)
+    pushCommand(STREAMCMD_ADD_NODE, Object);
 }
 void SceneGraphSimpleStream::removeSceneNode(SceneNode* Object)
 {
-    SEMAPHORE(QueueRemoveNodes_)
+    pushCommand(STREAMCMD_REMOVE_NODE, Object);
 }
 
 void SceneGraphSimpleStream::addSceneNode(Camera* Object)
 {
-    SEMAPHORE(QueueAddCameras_)
+    pushCommand(STREAMCMD_ADD_CAMERA, Object);
 }
 void SceneGraphSimpleStream::removeSceneNode(Camera* Object)
 {
-    SEMAPHORE(QueueRemoveCameras_)
+    pushCommand(STREAMCMD_REMOVE_CAMERA, Object);
 }
 
 void SceneGraphSimpleStream::addSceneNode(Light* Object)
 {
-    SEMAPHORE(QueueAddLights_)
+    pushCommand(STREAMCMD_ADD_LIGHT, Object);
 }
 void SceneGraphSimpleStream::removeSceneNode(Light* Object)
 {
-    SEMAPHORE(QueueRemoveLights_)
+    pushCommand(STREAMCMD_REMOVE_LIGHT, Object);
 }
 
 void SceneGraphSimpleStream::addSceneNode(RenderNode* Object)
 {
-    SEMAPHORE(QueueAddRenderNodes_)
+    pushCommand(STREAMCMD_ADD_RENDERNODE, Object);
 }
 void SceneGraphSimpleStream::removeSceneNode(RenderNode* Object)
 {
-    SEMAPHORE(QueueRemoveRenderNodes_)
+    pushCommand(STREAMCMD_REMOVE_RENDERNODE, Object);
 }
 
-#undef SEMAPHORE
-
 void SceneGraphSimpleStream::render()
 {
-    #define QUEUE_ADD(t, l, q)                      \
-        if (!q.empty())                             \
-        {                                           \
-            l.insert(l.end(), q.begin(), q.end());  \
-            q.clear();                              \
-        }
-    
-    #define QUEUE_REMOVE(t, l, q)                   \
-        if (!q.empty())                             \
-        {                                           \
-            foreach (t* Object, q)                  \
-                removeObjectFromList<t>(Object, l); \
-            q.clear();                              \
-        }
-    
     /* Render scene in default way */
     SceneGraphSimple::render();
     
     /* Start streaming objects */
-    SemaphoreQueues_.lock();
+    applyStreamCommands();
+}
+
+void SceneGraphSimpleStream::clearScene(
+    bool isRemoveNodes, bool isRemoveMeshes, bool isRemoveCameras,
+    bool isRemoveLights, bool isRemoveBillboards, bool isRemoveTerrains)
+{
+    SceneGraphSimple::clearScene(
+        isRemoveNodes, isRemoveMeshes, isRemoveCameras, isRemoveLights, isRemoveBillboards, isRemoveTerrains
+    );
     
-    QUEUE_ADD   (SceneNode, NodeList_, QueueAddNodes_)
-    QUEUE_REMOVE(SceneNode, NodeList_, QueueRemoveNodes_)
+    /* Clear the storage lists in the same way */
+    if (isRemoveNodes)
+        clearList<SceneNode>(NodeStorage_);
+    if (isRemoveCameras)
+        clearList<Camera>(CameraStorage_);
+    if (isRemoveLights)
+        clearList<Light>(LightStorage_);
     
-    QUEUE_ADD   (Light, LightList_, QueueAddLights_)
-    QUEUE_REMOVE(Light, LightList_, QueueRemoveLights_)
+    /* The render list is always cleared */
+    clearList<RenderNode>(RenderStorage_);
+}
+
+u32 SceneGraphSimpleStream::applyStreamCommands()
+{
+    /* Take all new commands from the queue */
+    CommandQueue_.popAll(PendingCommands_);
     
-    QUEUE_ADD   (Camera, CameraList_, QueueAddCameras_)
-    QUEUE_REMOVE(Camera, CameraList_, QueueRemoveCameras_)
+    const u32 Count = PendingCommands_.size();
+    const u64 StartTime = (TimeBudget_ > 0 ? io::Timer::microsecs() : 0);
     
-    QUEUE_ADD   (RenderNode, RenderList_, QueueAddRenderNodes_)
-    QUEUE_REMOVE(RenderNode, RenderList_, QueueRemoveRenderNodes_)
+    /* Apply the commands in their order (the timer is only checked after every 64 commands) */
+    while (PendingIndex_ < Count)
+    {
+        applyCommand(PendingCommands_[PendingIndex_++]);
+        
+        if (TimeBudget_ > 0 && (PendingIndex_ & 63) == 0 && io::Timer::microsecs() - StartTime >= TimeBudget_)
+            break;
+    }
     
-    SemaphoreQueues_.unlock();
+    /* Update the scene graph's lists whose storage has been changed */
+    updateList<SceneNode>(NodeStorage_, NodeList_);
+    updateList<Camera>(CameraStorage_, CameraList_);
+    updateList<Light>(LightStorage_, LightList_);
+    updateList<RenderNode>(RenderStorage_, RenderList_);
     
-    #undef QUEUE_ADD
-    #undef QUEUE_REMOVE
+    /* Release the applied commands */
+    if (PendingIndex_ >= Count)
+    {
+        PendingCommands_.clear();
+        PendingIndex_ = 0;
+    }
+    else if (PendingIndex_ > Count/2)
+    {
+        PendingCommands_.erase(PendingCommands_.begin(), PendingCommands_.begin() + PendingIndex_);
+        PendingIndex_ = 0;
+    }
+    
+    return getNumPendingCommands();
+}
+
+
+/*
+ * ======= Protected: =======
+ */
+
+void SceneGraphSimpleStream::pushCommand(const EStreamCommands Type, SceneNode* Object)
+{
+    if (Object)
+        CommandQueue_.push(SStreamCommand(Type, Object));
+}
+
+void SceneGraphSimpleStream::applyCommand(const SStreamCommand &Command)
+{
+    switch (Command.Type)
+    {
+        case STREAMCMD_ADD_NODE:
+            addToList<SceneNode>(Command.Object, NodeStorage_);
+            break;
+        case STREAMCMD_ADD_CAMERA:
+            addToList<Camera>(Command.Object, CameraStorage_);
+            break;
+        case STREAMCMD_ADD_LIGHT:
+            addToList<Light>(Command.Object, LightStorage_);
+            break;
+        case STREAMCMD_ADD_RENDERNODE:
+            addToList<RenderNode>(Command.Object, RenderStorage_);
+            break;
+        
+        case STREAMCMD_REMOVE_NODE:
+            removeFromList<SceneNode>(Command.Object, NodeStorage_);
+            break;
+        case STREAMCMD_REMOVE_CAMERA:
+            removeFromList<Camera>(Command.Object, CameraStorage_);
+            break;
+        case STREAMCMD_REMOVE_LIGHT:
+            removeFromList<Light>(Command.Object, LightStorage_);
+            break;
+        case STREAMCMD_REMOVE_RENDERNODE:
+            removeFromList<RenderNode>(Command.Object, RenderStorage_);
+            removeOccluderNode(Command.Object);
+            break;
+    }
 }
 
 
@@ -15,6 +15,7 @@
 
 
 #include "SceneGraph/spSceneGraphSimple.hpp"
+#include "Base/spDimensionLockFreeQueue.hpp"
 
 
 namespace sp
@@ -28,7 +29,13 @@ This is thread-safe version of the default simple scene graph (SceneGraphSimple)
 When new objects are hooked into the scene graph they will be streamed.
 i.e. only when the render loop is over the new objects will be added to the root list
 and the queue will be cleared.
+Adding and removing objects only pushes a command into a lock-free queue (see dim::LockFreeQueue),
+so any count of loader threads can stream objects without blocking each other or the render thread.
+The commands are applied in their order after rendering. Each object is stored in an unsorted storage list
+where it is removed in constant time by swapping it with the last object. The node lists of the scene graph
+(which are reordered by depth sorting) are copies of these storage lists and are only updated when the storage has changed.
 \note Here you have to use only the second "renderScene" function which expects a Camera object.
+An object must not be deleted before its removal has been applied.
 \ingroup group_scenegraph
 \since Version 3.0
 */
@@ -54,21 +61,147 @@ class SP_EXPORT SceneGraphSimpleStream : public SceneGraphSimple
         
         virtual void render();
         
+        void clearScene(
+            bool isRemoveNodes = true, bool isRemoveMeshes = true, bool isRemoveCameras = true,
+            bool isRemoveLights = true, bool isRemoveBillboards = true, bool isRemoveTerrains = true
+        );
+        
+        /**
+        Applies the queued add- and remove commands. This is called automatically after each rendering.
+        If a time budget is set, the remaining commands are applied in the next frames.
+        \return Count of commands which are still pending.
+        \see setStreamingTimeBudget
+        */
+        u32 applyStreamCommands();
+        
+        /* Inline functions */
+        
+        /**
+        Sets the time budget for applying the streamed commands each frame.
+        \param[in] Microseconds Specifies the time budget in microseconds. If 0 all commands are applied each frame. By default 0.
+        */
+        inline void setStreamingTimeBudget(u64 Microseconds)
+        {
+            TimeBudget_ = Microseconds;
+        }
+        inline u64 getStreamingTimeBudget() const
+        {
+            return TimeBudget_;
+        }
+        
+        //! Returns the count of commands which have been taken from the queue but not yet applied.
+        inline u32 getNumPendingCommands() const
+        {
+            return PendingCommands_.size() - PendingIndex_;
+        }
+        
     protected:
         
+        /* Enumerations */
+        
+        enum EStreamCommands
+        {
+            STREAMCMD_ADD_NODE,
+            STREAMCMD_ADD_CAMERA,
+            STREAMCMD_ADD_LIGHT,
+            STREAMCMD_ADD_RENDERNODE,
+            
+            STREAMCMD_REMOVE_NODE,
+            STREAMCMD_REMOVE_CAMERA,
+            STREAMCMD_REMOVE_LIGHT,
+            STREAMCMD_REMOVE_RENDERNODE,
+        };
+        
+        /* Structures */
+        
+        struct SStreamCommand
+        {
+            SStreamCommand(EStreamCommands InitType = STREAMCMD_ADD_NODE, SceneNode* InitObject = 0) :
+                Type    (InitType   ),
+                Object  (InitObject )
+            {
+            }
+            
+            EStreamCommands Type;
+            SceneNode* Object;
+        };
+        
+        //! Unsorted node storage. The list slot of each node (see SceneNode::ListSlot_) refers to this list.
+        template <class T> struct SNodeStorage
+        {
+            SNodeStorage() :
+                Modified(false)
+            {
+            }
+            
+            std::vector<T*> Nodes;
+            bool Modified;          //!< Specifies whether the scene graph's list needs to be updated.
+        };
+        
+        /* Functions */
+        
+        void pushCommand(const EStreamCommands Type, SceneNode* Object);
+        void applyCommand(const SStreamCommand &Command);
+        
+        /* Templates */
+        
+        template <class T> void addToList(SceneNode* Object, SNodeStorage<T> &Storage)
+        {
+            Object->ListSlot_ = Storage.Nodes.size();
+            Storage.Nodes.push_back(static_cast<T*>(Object));
+            Storage.Modified = true;
+            
+            addMember(Object);
+        }
+        
+        template <class T> void removeFromList(SceneNode* Object, SNodeStorage<T> &Storage)
+        {
+            const u32 Slot = Object->ListSlot_;
+            
+            if (Slot >= Storage.Nodes.size() || Storage.Nodes[Slot] != Object)
+                return;
+            
+            /* Swap with the last object and pop (the storage is never reordered otherwise, so the slots stay valid) */
+            Storage.Nodes[Slot] = Storage.Nodes.back();
+            Storage.Nodes[Slot]->ListSlot_ = Slot;
+            Storage.Nodes.pop_back();
+            Storage.Modified = true;
+            
+            Object->ListSlot_ = ~0u;
+            
+            removeMember(Object);
+        }
+        
+        template <class T> void updateList(SNodeStorage<T> &Storage, std::vector<T*> &List)
+        {
+            if (Storage.Modified)
+            {
+                List = Storage.Nodes;
+                Storage.Modified = false;
+            }
+        }
+        
+        template <class T> void clearList(SNodeStorage<T> &Storage)
+        {
+            for (u32 i = 0; i < Storage.Nodes.size(); ++i)
+                Storage.Nodes[i]->ListSlot_ = ~0u;
+            Storage.Nodes.clear();
+            Storage.Modified = false;
+        }
+        
         /* Members */
         
-        std::list<SceneNode*>   QueueAddNodes_;
-        std::list<Light*>       QueueAddLights_;
-        std::list<Camera*>      QueueAddCameras_;
-        std::list<RenderNode*>  QueueAddRenderNodes_;
+        dim::LockFreeQueue<SStreamCommand> CommandQueue_;
+        
+        std::vector<SStreamCommand> PendingCommands_;
+        u32 PendingIndex_;
         
-        std::list<SceneNode*>   QueueRemoveNodes_;
-        std::list<Light*>       QueueRemoveLights_;
-        std::list<Camera*>      QueueRemoveCameras_;
-        std::list<RenderNode*>  QueueRemoveRenderNodes_;
+        u64 TimeBudget_;
         
-        CriticalSection SemaphoreQueues_;
+        SNodeStorage<SceneNode> NodeStorage_;
+        SNodeStorage<Camera> CameraStorage_;
+        SNodeStorage<Light> LightStorage_;
+        SNodeStorage<RenderNode> RenderStorage_;
         
 };
 
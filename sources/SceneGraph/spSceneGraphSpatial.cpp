@@ -0,0 +1,376 @@
+/*
+ * Spatial scene graph file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneGraphSpatial.hpp"
+
+#ifdef SP_COMPILE_WITH_SCENEGRAPH_SPATIAL
+
+
+#include "RenderSystem/spRenderSystem.hpp"
+
+#include <boost/foreach.hpp>
+
+
+namespace sp
+{
+
+extern video::RenderSystem* GlbRenderSys;
+
+namespace scene
+{
+
+
+/*
+ * Internal members
+ */
+
+//! Half extent of the bounding box for nodes without bounding volume (they are never culled).
+static const f32 SPATIAL_INFINITE_EXTENT = 1.0e+30f;
+
+
+/*
+ * SceneGraphSpatial class
+ */
+
+SceneGraphSpatial::SceneGraphSpatial() :
+    SceneGraphSimple()
+{
+    GraphType_ = SCENEGRAPH_SPATIAL;
+}
+SceneGraphSpatial::~SceneGraphSpatial()
+{
+}
+
+void SceneGraphSpatial::removeSceneNode(SceneNode* Object)
+{
+    SceneGraphSimple::removeSceneNode(Object);
+}
+void SceneGraphSpatial::removeSceneNode(Camera* Object)
+{
+    SceneGraphSimple::removeSceneNode(Object);
+}
+void SceneGraphSpatial::removeSceneNode(Light* Object)
+{
+    LightTree_.remove(Object);
+    SceneGraphSimple::removeSceneNode(Object);
+}
+void SceneGraphSpatial::removeSceneNode(RenderNode* Object)
+{
+    RenderTree_.remove(Object);
+    SceneGraphSimple::removeSceneNode(Object);
+}
+
+void SceneGraphSpatial::render()
+{
+    if (!ActiveCamera_)
+    {
+        SceneGraphSimple::render();
+        return;
+    }
+    
+    GlbRenderSys->setRenderMode(video::RENDERMODE_SCENE);
+    
+    /* Update scene graph transformation */
+    const dim::matrix4f BaseMatrix(getTransformMatrix(true));
+    
+    /* Render lights */
+    renderLightsDefault(BaseMatrix);
+    
+    /* Update the spatial trees and transform only the visible render nodes */
+    ActiveCamera_->updateTransformation();
+    
+    updateTree(BaseMatrix);
+    arrangeVisibleNodes(ActiveCamera_->getViewFrustum(), BaseMatrix);
+    
+    if (OcclusionCulling_)
+    {
+        /* Drop the visible nodes which are hidden behind the occluders */
+        OcclusionCuller_.renderOccluders(ActiveCamera_);
+        OcclusionCuller_.cull(VisibleNodes_);
+    }
+    
+    if (LightBinning_)
+        LightGrid_.assign(VisibleNodes_);
+    
+    /* Render geometry */
+    PreCulling_ = true;
+    
+    if (RenderQueueSorting_)
+    {
+        RenderQueue_.build(VisibleNodes_);
+        
+        if (Instancing_)
+        {
+            InstanceBatcher_.build(RenderQueue_);
+            InstanceBatcher_.render();
+        }
+        else
+        {
+            for (u32 i = 0; i < RenderQueue_.getSize(); ++i)
+                RenderQueue_.getNode(i)->render();
+        }
+    }
+    else
+    {
+        if (DepthSorting_)
+            sortRenderList(RENDERLIST_SORT_DEPTHDISTANCE, VisibleNodes_);
+        
+        if (Instancing_)
+        {
+            InstanceBatcher_.build(VisibleNodes_);
+            InstanceBatcher_.render();
+        }
+        else
+        {
+            foreach (RenderNode* Node, VisibleNodes_)
+                Node->render();
+        }
+    }
+    
+    PreCulling_ = false;
+    
+    GlbRenderSys->setRenderMode(video::RENDERMODE_NONE);
+}
+
+void SceneGraphSpatial::renderScenePlain(Camera* ActiveCamera)
+{
+    if (!ActiveCamera)
+        return;
+    
+    /* Begin with scene rendering */
+    GlbRenderSys->setRenderMode(video::RENDERMODE_SCENE);
+    
+    /* Setup active camera for drawing the scene */
+    setActiveCamera(ActiveCamera);
+    ActiveCamera->setupRenderView();
+    
+    /* Update scene graph transformation */
+    spWorldMatrix.reset();
+    
+    const dim::matrix4f BaseMatrix(getTransformMatrix(true));
+    
+    /* Setup default material states */
+    GlbRenderSys->setupMaterialStates(&MaterialPlain_);
+    
+    /* Update the spatial trees and transform only the visible render nodes */
+    updateTree(BaseMatrix);
+    arrangeVisibleNodes(ActiveCamera->getViewFrustum(), BaseMatrix);
+    
+    /* Render geometry */
+    foreach (RenderNode* Node, VisibleNodes_)
+    {
+        if (Node->getType() == scene::NODE_MESH)
+            renderMeshPlain(static_cast<scene::Mesh*>(Node));
+    }
+    
+    /* Finish rendering the scene */
+    GlbRenderSys->setRenderMode(video::RENDERMODE_NONE);
+}
+
+void SceneGraphSpatial::clearScene(
+    bool isRemoveNodes, bool isRemoveMeshes, bool isRemoveCameras,
+    bool isRemoveLights, bool isRemoveBillboards, bool isRemoveTerrains)
+{
+    SceneGraphSimple::clearScene(
+        isRemoveNodes, isRemoveMeshes, isRemoveCameras,
+        isRemoveLights, isRemoveBillboards, isRemoveTerrains
+    );
+    
+    /* The trees are rebuilt with the remaining nodes by the next update */
+    RenderTree_.clear();
+    LightTree_.clear();
+    
+    VisibleNodes_.clear();
+    Transforms_.clear();
+}
+
+void SceneGraphSpatial::updateTree()
+{
+    updateTree(getTransformMatrix(true));
+}
+
+void SceneGraphSpatial::updateNodeBounds(RenderNode* Node)
+{
+    if (Node && RenderTree_.contains(Node))
+        RenderTree_.update(Node, getNodeBox(Node, TreeBaseMatrix_));
+}
+
+void SceneGraphSpatial::setWorldBox(const dim::aabbox3df &WorldBox, u32 MaxDepth)
+{
+    RenderTree_.setWorldBox(WorldBox, MaxDepth);
+    LightTree_.setWorldBox(WorldBox, MaxDepth);
+}
+
+void SceneGraphSpatial::findNodes(const ViewFrustum &Frustum, std::vector<RenderNode*> &NodeList) const
+{
+    NodeList.clear();
+    TreeNodes_.clear();
+    
+    RenderTree_.findNodes(Frustum, TreeNodes_);
+    
+    foreach (SceneNode* Node, TreeNodes_)
+        NodeList.push_back(static_cast<RenderNode*>(Node));
+}
+
+void SceneGraphSpatial::findNodes(const dim::aabbox3df &Box, std::vector<RenderNode*> &NodeList) const
+{
+    NodeList.clear();
+    TreeNodes_.clear();
+    
+    RenderTree_.findNodes(Box, TreeNodes_);
+    
+    foreach (SceneNode* Node, TreeNodes_)
+        NodeList.push_back(static_cast<RenderNode*>(Node));
+}
+
+void SceneGraphSpatial::findNodes(const dim::vector3df &Center, f32 Radius, std::vector<RenderNode*> &NodeList) const
+{
+    NodeList.clear();
+    TreeNodes_.clear();
+    
+    RenderTree_.findNodes(Center, Radius, TreeNodes_);
+    
+    foreach (SceneNode* Node, TreeNodes_)
+        NodeList.push_back(static_cast<RenderNode*>(Node));
+}
+
+void SceneGraphSpatial::findNearestLights(const dim::vector3df &Point, u32 MaxCount, std::vector<Light*> &LightList) const
+{
+    LightList.clear();
+    
+    if (!MaxCount)
+        return;
+    
+    /* Search more lights as long as too many of the nearest ones are invisible */
+    for (u32 Count = MaxCount; ; Count *= 2)
+    {
+        LightList.clear();
+        LightTree_.findNearestNodes(Point, Count, TreeNodes_);
+        
+        foreach (SceneNode* Node, TreeNodes_)
+        {
+            if (Node->getVisible())
+            {
+                LightList.push_back(static_cast<Light*>(Node));
+                if (LightList.size() >= MaxCount)
+                    return;
+            }
+        }
+        
+        if (TreeNodes_.size() < Count)
+            break;
+    }
+}
+
+
+/*
+ * ======= Protected: =======
+ */
+
+void SceneGraphSpatial::updateTree(const dim::matrix4f &BaseMatrix)
+{
+    /* Relocate all nodes if the scene graph itself has been moved */
+    const bool UpdateAll = (TreeBaseMatrix_ != BaseMatrix);
+    TreeBaseMatrix_ = BaseMatrix;
+    
+    /* Update the world matrices and relocate only the changed render nodes */
+    Transforms_.updateWorldMatrices(RenderList_);
+    
+    foreach (RenderNode* Node, RenderList_)
+    {
+        if (UpdateAll || Transforms_.hasChanged(Node))
+            RenderTree_.update(Node, getNodeBox(Node, BaseMatrix));
+    }
+    
+    /* Rebuild the tree if nodes have been removed from the render list without "removeSceneNode" */
+    if (RenderTree_.getNodeCount() > RenderList_.size())
+    {
+        RenderTree_.clear();
+        foreach (RenderNode* Node, RenderList_)
+            RenderTree_.update(Node, getNodeBox(Node, BaseMatrix));
+    }
+    
+    /* Update the light sources (the light list is usually small) */
+    if (LightTree_.getNodeCount() > LightList_.size())
+        LightTree_.clear();
+    
+    foreach (Light* Node, LightList_)
+        updateLightBounds(Node, BaseMatrix);
+}
+
+void SceneGraphSpatial::updateLightBounds(Light* Node, const dim::matrix4f &BaseMatrix)
+{
+    /* Directional lights have no position */
+    if (Node->getLightModel() == LIGHT_DIRECTIONAL)
+    {
+        LightTree_.remove(Node);
+        return;
+    }
+    
+    const dim::vector3df Position(BaseMatrix * Node->getPosition(true));
+    const f32 Radius = (Node->getVolumetric() ? Node->getVolumetricRadius() : 0.0f);
+    
+    LightTree_.update(Node, dim::aabbox3df(Position - Radius, Position + Radius));
+}
+
+void SceneGraphSpatial::arrangeVisibleNodes(const ViewFrustum &Frustum, const dim::matrix4f &BaseMatrix)
+{
+    TreeNodes_.clear();
+    VisibleNodes_.clear();
+    
+    RenderTree_.findNodes(Frustum, TreeNodes_);
+    
+    /* Setup the final world matrices of the visible nodes only */
+    foreach (SceneNode* Node, TreeNodes_)
+    {
+        RenderNode* Obj = static_cast<RenderNode*>(Node);
+        
+        if (!Obj->getVisible())
+            continue;
+        
+        const dim::matrix4f* WorldMatrix = Transforms_.getWorldMatrix(Obj);
+        
+        if (WorldMatrix)
+            Obj->updateTransformationBase(BaseMatrix, *WorldMatrix);
+        else
+            Obj->updateTransformationBase(BaseMatrix);
+        
+        VisibleNodes_.push_back(Obj);
+    }
+}
+
+dim::aabbox3df SceneGraphSpatial::getNodeBox(RenderNode* Node, const dim::matrix4f &BaseMatrix) const
+{
+    const dim::matrix4f* WorldMatrix = Transforms_.getWorldMatrix(Node);
+    
+    const dim::matrix4f Matrix(
+        WorldMatrix ? BaseMatrix * (*WorldMatrix) : BaseMatrix * Node->getTransformMatrix(true)
+    );
+    
+    const BoundingVolume& Bounds = Node->getBoundingVolume();
+    
+    /* Nodes without bounding volume are never culled */
+    if (Bounds.getType() == BOUNDING_NONE)
+    {
+        const dim::vector3df Center(Matrix.getPosition());
+        return dim::aabbox3df(Center - SPATIAL_INFINITE_EXTENT, Center + SPATIAL_INFINITE_EXTENT);
+    }
+    
+    return Bounds.getGlobalBox(Matrix);
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
@@ -0,0 +1,148 @@
+/*
+ * Spatial scene graph header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENEGRAPH_SPATIAL_H__
+#define __SP_SCENEGRAPH_SPATIAL_H__
+
+
+#include "Base/spStandard.hpp"
+
+#ifdef SP_COMPILE_WITH_SCENEGRAPH_SPATIAL
+
+
+#include "SceneGraph/spSceneGraphSimple.hpp"
+#include "SceneGraph/spSceneLooseOctree.hpp"
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/**
+The SceneGraphSpatial stores all render nodes and light sources in loose octrees. Each frame only the nodes whose
+transformation has changed are relocated in the tree (see TransformHierarchy::hasChanged), and only the nodes
+inside the view frustum are transformed, sorted and rendered. This is intended for large open scenes
+where most of the objects are off-screen.
+\note If the bounding volume of a render node is changed without changing its transformation,
+call "updateNodeBounds" for this node.
+\see LooseOctree
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT SceneGraphSpatial : public SceneGraphSimple
+{
+    
+    public:
+        
+        SceneGraphSpatial();
+        virtual ~SceneGraphSpatial();
+        
+        /* Functions */
+        
+        virtual void removeSceneNode(SceneNode*     Object);
+        virtual void removeSceneNode(Camera*        Object);
+        virtual void removeSceneNode(Light*         Object);
+        virtual void removeSceneNode(RenderNode*    Object);
+        
+        virtual void render();
+        
+        virtual void renderScenePlain(Camera* ActiveCamera);
+        
+        virtual void clearScene(
+            bool isRemoveNodes = true, bool isRemoveMeshes = true,
+            bool isRemoveCameras = true, bool isRemoveLights = true,
+            bool isRemoveBillboards = true, bool isRemoveTerrains = true
+        );
+        
+        /**
+        Updates the spatial trees with the current transformations of all render nodes and light sources.
+        This is called automatically each time the scene graph is rendered. Call it before any query
+        if nodes have been moved since the last rendering.
+        */
+        void updateTree();
+        
+        //! Updates the world-space bounding box of the specified render node in the tree, e.g. after its bounding volume has changed.
+        void updateNodeBounds(RenderNode* Node);
+        
+        /**
+        Sets the world box and the maximal depth of the render node tree and the light tree.
+        \see LooseOctree::setWorldBox
+        */
+        void setWorldBox(const dim::aabbox3df &WorldBox, u32 MaxDepth = 8);
+        
+        /**
+        Searches all render nodes which are at least partially inside the specified view frustum.
+        The visibility of the nodes is not considered.
+        \param[in] Frustum Specifies the view frustum.
+        \param[out] NodeList Specifies the output list. It will be cleared before the search.
+        */
+        void findNodes(const ViewFrustum &Frustum, std::vector<RenderNode*> &NodeList) const;
+        //! Searches all render nodes whose bounding boxes intersect with the specified box.
+        void findNodes(const dim::aabbox3df &Box, std::vector<RenderNode*> &NodeList) const;
+        //! Searches all render nodes whose bounding boxes intersect with the specified sphere.
+        void findNodes(const dim::vector3df &Center, f32 Radius, std::vector<RenderNode*> &NodeList) const;
+        
+        /**
+        Searches the nearest light sources to the specified point. Only point- and spot lights are considered.
+        A volumetric light source is treated as a sphere with its volumetric radius.
+        \param[in] Point Specifies the search point.
+        \param[in] MaxCount Specifies the maximal count of light sources.
+        \param[out] LightList Specifies the output list. It will be filled with the nearest visible light sources sorted by their distance.
+        */
+        void findNearestLights(const dim::vector3df &Point, u32 MaxCount, std::vector<Light*> &LightList) const;
+        
+        /* Inline functions */
+        
+        //! Returns a constant reference to the loose octree of the render nodes.
+        inline const LooseOctree& getRenderTree() const
+        {
+            return RenderTree_;
+        }
+        //! Returns a constant reference to the loose octree of the light sources.
+        inline const LooseOctree& getLightTree() const
+        {
+            return LightTree_;
+        }
+        
+    protected:
+        
+        /* Functions */
+        
+        void updateTree(const dim::matrix4f &BaseMatrix);
+        void updateLightBounds(Light* Node, const dim::matrix4f &BaseMatrix);
+        
+        void arrangeVisibleNodes(const ViewFrustum &Frustum, const dim::matrix4f &BaseMatrix);
+        
+        dim::aabbox3df getNodeBox(RenderNode* Node, const dim::matrix4f &BaseMatrix) const;
+        
+        /* Members */
+        
+        LooseOctree RenderTree_;
+        LooseOctree LightTree_;
+        
+        dim::matrix4f TreeBaseMatrix_;
+        
+        mutable std::vector<SceneNode*> TreeNodes_;
+        std::vector<RenderNode*> VisibleNodes_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+#endif
+
+
+
+// ================================================================================
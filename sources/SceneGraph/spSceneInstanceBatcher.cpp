@@ -0,0 +1,379 @@
+/*
+ * Instance batcher file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneInstanceBatcher.hpp"
+#include "SceneGraph/spSceneRenderQueue.hpp"
+#include "SceneGraph/spSceneGraph.hpp"
+#include "SceneGraph/spSceneMesh.hpp"
+#include "RenderSystem/spRenderSystem.hpp"
+#include "RenderSystem/spShaderClass.hpp"
+
+#include <boost/foreach.hpp>
+
+
+namespace sp
+{
+
+extern video::RenderSystem* GlbRenderSys;
+extern scene::SceneGraph* GlbSceneGraph;
+
+namespace scene
+{
+
+
+/*
+ * Internal members
+ */
+
+static const u32 INSTANCE_INVALID_INDEX = ~0u;
+
+
+/*
+ * Internal functions
+ */
+
+static inline u32 hashInstanceValue(u32 Hash, size_t Value)
+{
+    /* FNV-1a hash over the bytes of the value */
+    for (size_t i = 0; i < sizeof(size_t); ++i)
+    {
+        Hash ^= static_cast<u32>(Value & 0xFF);
+        Hash *= 16777619u;
+        Value >>= 8;
+    }
+    return Hash;
+}
+
+
+/*
+ * InstanceBatcher class
+ */
+
+InstanceBatcher::InstanceBatcher() :
+    IsSupported_        (false                      ),
+    MinInstances_       (2                          ),
+    MaxInstancesPerDraw_(64                         ),
+    TransformCallback_  (defaultTransformCallback   ),
+    NumDrawCalls_       (0                          ),
+    NumDrawCallsSaved_  (0                          ),
+    NumInstancedNodes_  (0                          )
+{
+}
+InstanceBatcher::~InstanceBatcher()
+{
+}
+
+void InstanceBatcher::build(const std::vector<RenderNode*> &NodeList, const std::vector<u32>* Indices)
+{
+    beginBuild();
+    
+    if (Indices)
+    {
+        foreach (u32 Index, *Indices)
+            addNode(NodeList[Index]);
+    }
+    else
+    {
+        foreach (RenderNode* Node, NodeList)
+        {
+            if (Node->getVisible())
+                addNode(Node);
+        }
+    }
+    
+    endBuild();
+}
+
+void InstanceBatcher::build(const RenderQueue &Queue)
+{
+    beginBuild();
+    
+    for (u32 i = 0; i < Queue.getSize(); ++i)
+        addNode(Queue.getNode(i));
+    
+    endBuild();
+}
+
+void InstanceBatcher::render()
+{
+    const u32 PrevDrawCalls = video::RenderSystem::getNumDrawCalls();
+    
+    NumDrawCallsSaved_  = 0;
+    NumInstancedNodes_  = 0;
+    
+    /* Render the groups and single render nodes in the order of the last build */
+    foreach (const SRenderItem &Item, Items_)
+    {
+        if (Item.Group < 0)
+            Item.Node->render();
+        else
+        {
+            const SInstanceGroup& Group = Groups_[Item.Group];
+            
+            if (Group.NumMembers >= MinInstances_)
+                renderGroup(Group);
+            else
+                renderMembers(Group, 0);
+        }
+    }
+    
+    NumDrawCalls_ = video::RenderSystem::getNumDrawCalls() - PrevDrawCalls;
+}
+
+void InstanceBatcher::clear()
+{
+    Groups_.clear();
+    Members_.clear();
+    MemberNext_.clear();
+    Items_.clear();
+    GroupMap_.clear();
+    InstanceMatrices_.clear();
+    
+    NumDrawCalls_       = 0;
+    NumDrawCallsSaved_  = 0;
+    NumInstancedNodes_  = 0;
+}
+
+bool InstanceBatcher::isInstanceable(const RenderNode* Node)
+{
+    if (Node->getType() != NODE_MESH)
+        return false;
+    
+    const Mesh* Obj = static_cast<const Mesh*>(Node);
+    
+    return
+        !Obj->UserRenderProc_ &&
+        !Obj->getMaterial()->getMaterialCallback() &&
+        !RenderQueue::isTranslucent(Node);
+}
+
+bool InstanceBatcher::defaultTransformCallback(
+    video::ShaderClass* ShaderObject, const dim::matrix4f* Matrices, u32 NumInstances)
+{
+    /* The dummy render system draws nothing, so the instancing can be profiled without shaders */
+    if (GlbRenderSys->getRendererType() == video::RENDERER_DUMMY)
+        return true;
+    
+    if (!ShaderObject || !ShaderObject->getVertexShader())
+        return false;
+    
+    return ShaderObject->getVertexShader()->setConstant(
+        "InstanceMatrices", Matrices[0].getArray(), static_cast<s32>(NumInstances * 16)
+    );
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void InstanceBatcher::beginBuild()
+{
+    Groups_.clear();
+    Members_.clear();
+    MemberNext_.clear();
+    Items_.clear();
+    GroupMap_.clear();
+    InstanceMatrices_.clear();
+    
+    IsSupported_ = (
+        GlbRenderSys->queryVideoSupport(video::VIDEOSUPPORT_HARDWARE_INSTANCING) &&
+        !(GlbSceneGraph && GlbSceneGraph->hasChildTree())
+    );
+}
+
+void InstanceBatcher::addNode(RenderNode* Node)
+{
+    SRenderItem Item;
+    {
+        Item.Node   = Node;
+        Item.Group  = -1;
+    }
+    
+    if (!IsSupported_ || !isInstanceable(Node))
+    {
+        Items_.push_back(Item);
+        return;
+    }
+    
+    Mesh* Obj = static_cast<Mesh*>(Node);
+    
+    /* Select the mesh buffers of the current level of detail */
+    Obj->updateLevelOfDetail();
+    
+    if (Obj->LODSurfaceList_->empty())
+        return;
+    
+    /* Search a group with the same mesh buffers, material and shader class */
+    const u32 Hash = getGroupHash(Obj);
+    
+    std::map<u32, u32>::iterator it = GroupMap_.find(Hash);
+    
+    u32 GroupIndex = INSTANCE_INVALID_INDEX;
+    
+    if (it != GroupMap_.end())
+    {
+        for (u32 i = it->second; i != INSTANCE_INVALID_INDEX; i = Groups_[i].NextGroup)
+        {
+            if (compareGroup(Groups_[i], Obj))
+            {
+                GroupIndex = i;
+                break;
+            }
+        }
+    }
+    
+    const u32 MemberIndex = Members_.size();
+    
+    Members_.push_back(Obj);
+    MemberNext_.push_back(INSTANCE_INVALID_INDEX);
+    
+    if (GroupIndex == INSTANCE_INVALID_INDEX)
+    {
+        /* Create a new group at the position of its first mesh */
+        SInstanceGroup Group;
+        {
+            Group.Node          = Obj;
+            Group.Hash          = Hash;
+            Group.NextGroup     = (it != GroupMap_.end() ? it->second : INSTANCE_INVALID_INDEX);
+            Group.FirstMember   = MemberIndex;
+            Group.LastMember    = MemberIndex;
+            Group.NumMembers    = 1;
+            Group.FirstInstance = 0;
+        }
+        GroupIndex = Groups_.size();
+        
+        Groups_.push_back(Group);
+        GroupMap_[Hash] = GroupIndex;
+        
+        Item.Group = static_cast<s32>(GroupIndex);
+        Items_.push_back(Item);
+    }
+    else
+    {
+        /* Append the mesh to the group */
+        SInstanceGroup& Group = Groups_[GroupIndex];
+        
+        MemberNext_[Group.LastMember] = MemberIndex;
+        Group.LastMember = MemberIndex;
+        ++Group.NumMembers;
+    }
+}
+
+void InstanceBatcher::endBuild()
+{
+    /* Fill the instance transformation buffer */
+    InstanceMatrices_.reserve(Members_.size());
+    
+    foreach (SInstanceGroup &Group, Groups_)
+    {
+        Group.FirstInstance = InstanceMatrices_.size();
+        
+        for (u32 i = Group.FirstMember; i != INSTANCE_INVALID_INDEX; i = MemberNext_[i])
+            InstanceMatrices_.push_back(Members_[i]->FinalWorldMatrix_);
+    }
+}
+
+bool InstanceBatcher::compareGroup(const SInstanceGroup &Group, const Mesh* Node) const
+{
+    const Mesh* Other = Group.Node;
+    
+    return
+        *Other->LODSurfaceList_ == *Node->LODSurfaceList_ &&
+        Other->getShaderClass() == Node->getShaderClass() &&
+        Other->getOrder() == Node->getOrder() &&
+        Other->getMaterial()->compare(Node->getMaterial());
+}
+
+void InstanceBatcher::renderGroup(const SInstanceGroup &Group)
+{
+    Mesh* Obj = Group.Node;
+    
+    const std::vector<video::MeshBuffer*>& SurfaceList = *Obj->LODSurfaceList_;
+    
+    /* Setup the transformation, material and shader of the first mesh for the whole group */
+    Obj->loadTransformation();
+    
+    GlbSceneGraph->setActiveMesh(Obj);
+    
+    if (GlbSceneGraph->getLightBinning())
+        GlbSceneGraph->setupNodeLights(Obj);
+    
+    GlbRenderSys->updateModelviewMatrix();
+    
+    GlbRenderSys->setupMaterialStates(Obj->getMaterial());
+    GlbRenderSys->setupShaderClass(Obj, Obj->getShaderClass());
+    
+    video::ShaderClass* ShaderObject = (
+        GlbRenderSys->getGlobalShaderClass() ? GlbRenderSys->getGlobalShaderClass() : Obj->getShaderClass()
+    );
+    
+    /* Draw the instances (split into several draw calls if the group is too large) */
+    for (u32 First = 0; First < Group.NumMembers; First += MaxInstancesPerDraw_)
+    {
+        const u32 Count = math::Min(MaxInstancesPerDraw_, Group.NumMembers - First);
+        
+        if ( Count < 2 || !TransformCallback_ ||
+             !TransformCallback_(ShaderObject, &InstanceMatrices_[Group.FirstInstance + First], Count) )
+        {
+            /* Render the remaining meshes one after another */
+            GlbRenderSys->unbindShaders();
+            renderMembers(Group, First);
+            return;
+        }
+        
+        foreach (video::MeshBuffer* Surface, SurfaceList)
+        {
+            /* The render system uses the instance count of the referenced mesh buffer */
+            video::MeshBuffer* Reference = Surface->getReference();
+            
+            const u32 PrevInstances = Reference->getHardwareInstancing();
+            
+            Reference->setHardwareInstancing(Count);
+            GlbRenderSys->drawMeshBuffer(Surface);
+            Reference->setHardwareInstancing(PrevInstances);
+        }
+        
+        NumDrawCallsSaved_ += (Count - 1) * SurfaceList.size();
+        NumInstancedNodes_ += Count;
+    }
+    
+    GlbRenderSys->unbindShaders();
+}
+
+void InstanceBatcher::renderMembers(const SInstanceGroup &Group, u32 First)
+{
+    u32 i = Group.FirstMember;
+    
+    for (; First > 0 && i != INSTANCE_INVALID_INDEX; --First)
+        i = MemberNext_[i];
+    
+    for (; i != INSTANCE_INVALID_INDEX; i = MemberNext_[i])
+        Members_[i]->render();
+}
+
+u32 InstanceBatcher::getGroupHash(const Mesh* Node)
+{
+    u32 Hash = 2166136261u;
+    
+    Hash = hashInstanceValue(Hash, reinterpret_cast<size_t>(Node->getShaderClass()));
+    Hash = hashInstanceValue(Hash, static_cast<size_t>(Node->getOrder()));
+    
+    foreach (video::MeshBuffer* Surface, *Node->LODSurfaceList_)
+        Hash = hashInstanceValue(Hash, reinterpret_cast<size_t>(Surface));
+    
+    return Hash;
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
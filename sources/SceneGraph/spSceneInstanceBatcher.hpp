@@ -0,0 +1,230 @@
+/*
+ * Instance batcher header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_INSTANCE_BATCHER_H__
+#define __SP_SCENE_INSTANCE_BATCHER_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimensionMatrix4.hpp"
+#include "Base/spMathCore.hpp"
+
+#include <boost/function.hpp>
+#include <vector>
+#include <map>
+
+
+namespace sp
+{
+namespace video
+{
+    class ShaderClass;
+}
+namespace scene
+{
+
+
+class RenderNode;
+class Mesh;
+class RenderQueue;
+
+/**
+Instance transformation callback. This is called once for each instanced draw after the shader class has been bound.
+It must upload the world matrices of the instances, e.g. as a shader constant array, so that the vertex shader
+can transform each instance with the matrix at the instance index.
+\param ShaderObject Specifies the active shader class. This may be null if the mesh has no shader class.
+\param Matrices Specifies the world matrices of the instances.
+\param NumInstances Specifies the count of instances.
+\return True if the matrices have been uploaded. Otherwise the instances will be rendered one after another.
+\see InstanceBatcher::setTransformCallback
+*/
+typedef boost::function<bool (video::ShaderClass* ShaderObject, const dim::matrix4f* Matrices, u32 NumInstances)> InstanceTransformCallback;
+
+/**
+The instance batcher groups visible meshes which share the same mesh buffers (e.g. meshes created with
+"Mesh::setReference"), the same material states and the same shader class. Each frame it collects the world matrices
+of each group in one instance transformation buffer and renders the group with one hardware instanced draw call per
+mesh buffer instead of one draw call for each mesh. Meshes with a render callback, a material callback or a translucent
+material are always rendered on their own. The position of the first mesh of a group in the input order is the
+position where the whole group is rendered.
+\note The vertex shader of an instanced mesh must read its world matrix from the instance transformation buffer
+(by default the constant array "InstanceMatrices", see setTransformCallback).
+\see SceneGraph::setInstancing
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT InstanceBatcher
+{
+    
+    public:
+        
+        InstanceBatcher();
+        ~InstanceBatcher();
+        
+        /* === Functions === */
+        
+        /**
+        Builds the instance groups for the specified render nodes.
+        \param[in] NodeList Specifies the render nodes. Their transformations must already be updated (see RenderNode::updateTransformation).
+        \param[in] Indices Optional pointer to a list of indices into the node list (e.g. from FrustumCuller::cull).
+        If this is null all visible nodes of the list are used.
+        */
+        void build(const std::vector<RenderNode*> &NodeList, const std::vector<u32>* Indices = 0);
+        //! Builds the instance groups for the render nodes of the specified render queue (in the sorted order).
+        void build(const RenderQueue &Queue);
+        
+        //! Renders all groups and single render nodes in the order of the last build.
+        void render();
+        
+        //! Removes all groups and resets the counters.
+        void clear();
+        
+        /**
+        Returns true if the specified render node can be rendered as instance. This is the case for meshes
+        without render- or material callback and with a material which is not translucent.
+        */
+        static bool isInstanceable(const RenderNode* Node);
+        
+        /**
+        Default instance transformation callback. Uploads the matrices to the vertex shader
+        constant array "InstanceMatrices" (an array of 4x4 matrices). For the dummy render system this always succeeds.
+        */
+        static bool defaultTransformCallback(video::ShaderClass* ShaderObject, const dim::matrix4f* Matrices, u32 NumInstances);
+        
+        /* === Inline functions === */
+        
+        /**
+        Sets the minimal count of instances for a group to be rendered instanced. Smaller groups are rendered one mesh after another.
+        \param[in] Count Specifies the minimal count of instances. This will be clamped to at least 2. By default 2.
+        */
+        inline void setMinInstances(u32 Count)
+        {
+            MinInstances_ = math::Max(2u, Count);
+        }
+        inline u32 getMinInstances() const
+        {
+            return MinInstances_;
+        }
+        
+        /**
+        Sets the maximal count of instances for one draw call. Larger groups are split into several draw calls.
+        This must not exceed the size of the instance transformation buffer in the shader.
+        \param[in] Count Specifies the maximal count of instances. This will be clamped to at least 2. By default 64.
+        */
+        inline void setMaxInstancesPerDraw(u32 Count)
+        {
+            MaxInstancesPerDraw_ = math::Max(2u, Count);
+        }
+        inline u32 getMaxInstancesPerDraw() const
+        {
+            return MaxInstancesPerDraw_;
+        }
+        
+        //! Sets the instance transformation callback. By default "defaultTransformCallback".
+        inline void setTransformCallback(const InstanceTransformCallback &Callback)
+        {
+            TransformCallback_ = Callback;
+        }
+        inline const InstanceTransformCallback& getTransformCallback() const
+        {
+            return TransformCallback_;
+        }
+        
+        //! Returns the count of instance groups of the last build (including groups which are too small for instancing).
+        inline u32 getGroupCount() const
+        {
+            return Groups_.size();
+        }
+        //! Returns the instance transformation buffer of the last build. The matrices of each group are stored consecutively.
+        inline const std::vector<dim::matrix4f>& getInstanceMatrixList() const
+        {
+            return InstanceMatrices_;
+        }
+        
+        //! Returns the count of draw calls which have been issued by the last rendering.
+        inline u32 getNumDrawCalls() const
+        {
+            return NumDrawCalls_;
+        }
+        //! Returns the count of draw calls which have been saved by instancing in the last rendering.
+        inline u32 getNumDrawCallsSaved() const
+        {
+            return NumDrawCallsSaved_;
+        }
+        //! Returns the count of meshes which have been rendered as instances in the last rendering.
+        inline u32 getNumInstancedNodes() const
+        {
+            return NumInstancedNodes_;
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SInstanceGroup
+        {
+            Mesh* Node;             //!< First mesh of the group. Its mesh buffers, material and shader class are used for the group.
+            u32 Hash;
+            u32 NextGroup;          //!< Next group with the same hash.
+            u32 FirstMember;
+            u32 LastMember;
+            u32 NumMembers;
+            u32 FirstInstance;      //!< First matrix in the instance transformation buffer.
+        };
+        
+        struct SRenderItem
+        {
+            RenderNode* Node;
+            s32 Group;              //!< Group index or -1 for a single render node.
+        };
+        
+        /* === Functions === */
+        
+        void beginBuild();
+        void addNode(RenderNode* Node);
+        void endBuild();
+        
+        bool compareGroup(const SInstanceGroup &Group, const Mesh* Node) const;
+        
+        void renderGroup(const SInstanceGroup &Group);
+        void renderMembers(const SInstanceGroup &Group, u32 First);
+        
+        static u32 getGroupHash(const Mesh* Node);
+        
+        /* === Members === */
+        
+        std::vector<SInstanceGroup> Groups_;
+        std::vector<Mesh*> Members_;
+        std::vector<u32> MemberNext_;
+        std::vector<SRenderItem> Items_;
+        std::map<u32, u32> GroupMap_;
+        
+        std::vector<dim::matrix4f> InstanceMatrices_;
+        
+        bool IsSupported_;
+        u32 MinInstances_;
+        u32 MaxInstancesPerDraw_;
+        
+        InstanceTransformCallback TransformCallback_;
+        
+        u32 NumDrawCalls_;
+        u32 NumDrawCallsSaved_;
+        u32 NumInstancedNodes_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
@@ -46,6 +46,26 @@ Light::~Light()
     __spLightIDList[LightID_] = false;
 }
 
+static MemoryPool& getLightPool()
+{
+    static MemoryPool Pool("scene::Light", sizeof(Light), 16);
+    return Pool;
+}
+
+void* Light::operator new(size_t Size)
+{
+    return getLightPool().allocate(Size);
+}
+void Light::operator delete(void* Ptr, size_t Size)
+{
+    getLightPool().release(Ptr, Size);
+}
+
+SMemoryPoolStats Light::getMemoryPoolStats()
+{
+    return getLightPool().getStats();
+}
+
 void Light::setColor(const SLightColor &Color)
 {
     Color_ = Color;
@@ -225,6 +225,13 @@ class SP_EXPORT Light : public SceneNode
         */
         static void setRCUsage(bool UseAllRCs);
         
+        //! Allocates the memory for a new light from the light memory pool (see SceneNode::operator new).
+        static void* operator new(size_t Size);
+        static void operator delete(void* Ptr, size_t Size);
+        
+        //! Returns the occupancy statistics of the light memory pool.
+        static SMemoryPoolStats getMemoryPoolStats();
+        
         /* === Inline functions === */
         
         //! Sets the light shading model.
@@ -0,0 +1,456 @@
+/*
+ * Light grid file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneLightGrid.hpp"
+#include "SceneGraph/spRenderNode.hpp"
+#include "SceneGraph/spSceneLight.hpp"
+
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <cmath>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/*
+ * Internal members
+ */
+
+//! Maximal count of cells for each light source. Larger light sources are tested for each render node.
+static const f32 LIGHTGRID_MAX_LIGHT_CELLS = 512.0f;
+
+//! Maximal count of cells which are searched for each render node. For larger nodes all light sources are tested.
+static const f32 LIGHTGRID_MAX_NODE_CELLS = 64.0f;
+
+//! Minimal size of the cell hash table.
+static const u32 LIGHTGRID_MIN_TABLE_SIZE = 64;
+
+
+/*
+ * Internal functions
+ */
+
+static inline u32 getCellHash(s32 X, s32 Y, s32 Z)
+{
+    return
+        (static_cast<u32>(X) * 73856093u) ^
+        (static_cast<u32>(Y) * 19349663u) ^
+        (static_cast<u32>(Z) * 83492791u);
+}
+
+static f32 getBoxDistanceSq(const dim::aabbox3df &Box, const dim::vector3df &Point)
+{
+    f32 DistanceSq = 0.0f;
+    
+    for (s32 k = 0; k < 3; ++k)
+    {
+        if (Point[k] < Box.Min[k])
+            DistanceSq += math::pow2(Box.Min[k] - Point[k]);
+        else if (Point[k] > Box.Max[k])
+            DistanceSq += math::pow2(Point[k] - Box.Max[k]);
+    }
+    
+    return DistanceSq;
+}
+
+
+/*
+ * LightGrid class
+ */
+
+LightGrid::LightGrid() :
+    NumCells_           (0                  ),
+    Stamp_              (0                  ),
+    CellSize_           (10.0f              ),
+    MaxLightsPerNode_   (MAX_COUNT_OF_LIGHTS)
+{
+}
+LightGrid::~LightGrid()
+{
+}
+
+void LightGrid::build(const std::vector<Light*> &LightList, const dim::matrix4f &BaseMatrix)
+{
+    clear();
+    
+    /* Collect the visible light sources and their cell ranges */
+    u32 NumEntries = 0;
+    
+    foreach (Light* Obj, LightList)
+    {
+        if (!Obj->getVisible())
+            continue;
+        
+        SLightRange Range;
+        
+        Range.Object    = Obj;
+        Range.Position  = BaseMatrix * Obj->getPosition(true);
+        Range.Radius    = (Obj->getVolumetric() ? Obj->getVolumetricRadius() : -1.0f);
+        Range.IsBinned  = false;
+        
+        if (Obj->getLightModel() != LIGHT_DIRECTIONAL && Range.Radius >= 0.0f)
+        {
+            Range.IsBinned = getCellRange(
+                dim::aabbox3df(Range.Position - Range.Radius, Range.Position + Range.Radius),
+                LIGHTGRID_MAX_LIGHT_CELLS, Range.MinCell, Range.MaxCell
+            );
+        }
+        
+        if (Range.IsBinned)
+        {
+            NumEntries +=
+                (Range.MaxCell[0] - Range.MinCell[0] + 1) *
+                (Range.MaxCell[1] - Range.MinCell[1] + 1) *
+                (Range.MaxCell[2] - Range.MinCell[2] + 1);
+        }
+        else
+            UnbinnedLights_.push_back(Lights_.size());
+        
+        Lights_.push_back(Range);
+    }
+    
+    LightStamps_.assign(Lights_.size(), 0);
+    Stamp_ = 0;
+    
+    /* Setup the hash table with a load factor of at most 0.5 */
+    u32 TableSize = LIGHTGRID_MIN_TABLE_SIZE;
+    while (TableSize < NumEntries * 2)
+        TableSize <<= 1;
+    
+    const SCell EmptyCell = { 0, 0, 0, 0, 0, 0 };
+    Cells_.assign(TableSize, EmptyCell);
+    
+    /* Count the light sources of each cell */
+    foreach (const SLightRange &Range, Lights_)
+    {
+        if (!Range.IsBinned)
+            continue;
+        
+        for (s32 z = Range.MinCell[2]; z <= Range.MaxCell[2]; ++z)
+        {
+            for (s32 y = Range.MinCell[1]; y <= Range.MaxCell[1]; ++y)
+            {
+                for (s32 x = Range.MinCell[0]; x <= Range.MaxCell[0]; ++x)
+                    ++Cells_[insertCell(x, y, z)].Count;
+            }
+        }
+    }
+    
+    /* Allocate the ranges of the cells in one list */
+    u32 First = 0;
+    
+    foreach (SCell &Cell, Cells_)
+    {
+        Cell.First = First;
+        First += Cell.Count;
+    }
+    
+    CellLights_.resize(NumEntries);
+    
+    /* Fill the cells */
+    for (u32 i = 0; i < Lights_.size(); ++i)
+    {
+        const SLightRange& Range = Lights_[i];
+        
+        if (!Range.IsBinned)
+            continue;
+        
+        for (s32 z = Range.MinCell[2]; z <= Range.MaxCell[2]; ++z)
+        {
+            for (s32 y = Range.MinCell[1]; y <= Range.MaxCell[1]; ++y)
+            {
+                for (s32 x = Range.MinCell[0]; x <= Range.MaxCell[0]; ++x)
+                {
+                    SCell& Cell = Cells_[findCell(x, y, z)];
+                    CellLights_[Cell.First + Cell.Fill++] = i;
+                }
+            }
+        }
+    }
+}
+
+void LightGrid::assign(const std::vector<RenderNode*> &NodeList, const std::vector<u32>* Indices)
+{
+    NodeLights_.clear();
+    NodeLookup_.clear();
+    
+    const u32 NumNodes = (Indices ? Indices->size() : NodeList.size());
+    
+    for (u32 i = 0; i < NumNodes; ++i)
+    {
+        const RenderNode* Node = NodeList[Indices ? (*Indices)[i] : i];
+        
+        if (!Node->getVisible())
+            continue;
+        
+        SNodeLights Entry;
+        
+        Entry.Node  = Node;
+        Entry.First = NodeLights_.size();
+        
+        gatherLights(getNodeBox(Node), NodeLights_);
+        
+        Entry.Count = NodeLights_.size() - Entry.First;
+        
+        NodeLookup_.push_back(Entry);
+    }
+    
+    /* Sort the entries for the binary search in "getNodeLights" */
+    std::sort(NodeLookup_.begin(), NodeLookup_.end(), LightGrid::cmpNodeLights);
+}
+
+bool LightGrid::getNodeLights(const RenderNode* Node, std::vector<Light*> &LightList) const
+{
+    LightList.clear();
+    
+    SNodeLights Key;
+    Key.Node = Node;
+    
+    std::vector<SNodeLights>::const_iterator it = std::lower_bound(
+        NodeLookup_.begin(), NodeLookup_.end(), Key, LightGrid::cmpNodeLights
+    );
+    
+    if (it == NodeLookup_.end() || it->Node != Node)
+        return false;
+    
+    LightList.insert(
+        LightList.end(), NodeLights_.begin() + it->First, NodeLights_.begin() + (it->First + it->Count)
+    );
+    
+    return true;
+}
+
+u32 LightGrid::findLights(const RenderNode* Node, std::vector<Light*> &LightList) const
+{
+    LightList.clear();
+    
+    if (Node)
+        gatherLights(getNodeBox(Node), LightList);
+    
+    return LightList.size();
+}
+
+u32 LightGrid::findLights(const dim::aabbox3df &Box, std::vector<Light*> &LightList) const
+{
+    LightList.clear();
+    gatherLights(Box, LightList);
+    return LightList.size();
+}
+
+void LightGrid::clear()
+{
+    Lights_.clear();
+    UnbinnedLights_.clear();
+    
+    Cells_.clear();
+    CellLights_.clear();
+    NumCells_ = 0;
+    
+    NodeLights_.clear();
+    NodeLookup_.clear();
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+bool LightGrid::getCellRange(const dim::aabbox3df &Box, f32 MaxCells, s32 (&MinCell)[3], s32 (&MaxCell)[3]) const
+{
+    const f32 InvCellSize = 1.0f / CellSize_;
+    
+    f32 NumCells = 1.0f;
+    
+    for (s32 k = 0; k < 3; ++k)
+    {
+        const f32 Min = std::floor(Box.Min[k] * InvCellSize);
+        const f32 Max = std::floor(Box.Max[k] * InvCellSize);
+        
+        /* Check the count before the conversion to avoid integer overflows for huge boxes */
+        NumCells *= (Max - Min + 1.0f);
+        
+        if (!(NumCells <= MaxCells))
+            return false;
+        
+        MinCell[k] = static_cast<s32>(Min);
+        MaxCell[k] = static_cast<s32>(Max);
+    }
+    
+    return true;
+}
+
+u32 LightGrid::findCell(s32 X, s32 Y, s32 Z) const
+{
+    if (Cells_.empty())
+        return ~0u;
+    
+    const u32 Mask = Cells_.size() - 1;
+    
+    for (u32 i = getCellHash(X, Y, Z) & Mask; ; i = (i + 1) & Mask)
+    {
+        const SCell& Cell = Cells_[i];
+        
+        if (!Cell.Count)
+            return ~0u;
+        if (Cell.X == X && Cell.Y == Y && Cell.Z == Z)
+            return i;
+    }
+}
+
+u32 LightGrid::insertCell(s32 X, s32 Y, s32 Z)
+{
+    const u32 Mask = Cells_.size() - 1;
+    
+    for (u32 i = getCellHash(X, Y, Z) & Mask; ; i = (i + 1) & Mask)
+    {
+        SCell& Cell = Cells_[i];
+        
+        if (!Cell.Count)
+        {
+            /* Use this empty cell (the caller increments the counter) */
+            Cell.X = X;
+            Cell.Y = Y;
+            Cell.Z = Z;
+            ++NumCells_;
+            return i;
+        }
+        
+        if (Cell.X == X && Cell.Y == Y && Cell.Z == Z)
+            return i;
+    }
+}
+
+void LightGrid::gatherLights(const dim::aabbox3df &Box, std::vector<Light*> &LightList) const
+{
+    Candidates_.clear();
+    
+    /* Reset the stamps when the counter wraps around */
+    if (++Stamp_ == 0)
+    {
+        std::fill(LightStamps_.begin(), LightStamps_.end(), 0);
+        Stamp_ = 1;
+    }
+    
+    /* Gather the light sources of all cells which are covered by the box */
+    s32 MinCell[3], MaxCell[3];
+    
+    if (getCellRange(Box, LIGHTGRID_MAX_NODE_CELLS, MinCell, MaxCell))
+    {
+        for (s32 z = MinCell[2]; z <= MaxCell[2]; ++z)
+        {
+            for (s32 y = MinCell[1]; y <= MaxCell[1]; ++y)
+            {
+                for (s32 x = MinCell[0]; x <= MaxCell[0]; ++x)
+                {
+                    const u32 CellIndex = findCell(x, y, z);
+                    
+                    if (CellIndex == ~0u)
+                        continue;
+                    
+                    const SCell& Cell = Cells_[CellIndex];
+                    
+                    /* Light sources which cover several cells are only added once */
+                    for (u32 i = Cell.First, n = Cell.First + Cell.Count; i < n; ++i)
+                    {
+                        const u32 Index = CellLights_[i];
+                        
+                        if (LightStamps_[Index] != Stamp_)
+                        {
+                            LightStamps_[Index] = Stamp_;
+                            addCandidate(Index, Box);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        /* The box covers too many cells -> test all binned light sources */
+        for (u32 i = 0; i < Lights_.size(); ++i)
+        {
+            if (Lights_[i].IsBinned)
+                addCandidate(i, Box);
+        }
+    }
+    
+    foreach (u32 Index, UnbinnedLights_)
+        addCandidate(Index, Box);
+    
+    /* Keep only the most relevant light sources */
+    const u32 Count = math::Min(static_cast<u32>(Candidates_.size()), MaxLightsPerNode_);
+    
+    std::partial_sort(Candidates_.begin(), Candidates_.begin() + Count, Candidates_.end(), LightGrid::cmpCandidates);
+    
+    for (u32 i = 0; i < Count; ++i)
+        LightList.push_back(Candidates_[i].Object);
+}
+
+void LightGrid::addCandidate(u32 Index, const dim::aabbox3df &Box) const
+{
+    const SLightRange& Range = Lights_[Index];
+    
+    SCandidate Candidate;
+    Candidate.Object = Range.Object;
+    
+    if (Range.Object->getLightModel() == LIGHT_DIRECTIONAL)
+    {
+        /* Directional lights are always the most relevant ones */
+        Candidate.Score         = -1.0f;
+        Candidate.DistanceSq    = 0.0f;
+    }
+    else
+    {
+        Candidate.DistanceSq = getBoxDistanceSq(Box, Range.Position);
+        
+        if (Range.Radius < 0.0f)
+            Candidate.Score = 0.0f;
+        else
+        {
+            /* Ignore light sources which are out of range */
+            const f32 RadiusSq = math::pow2(Range.Radius);
+            
+            if (Candidate.DistanceSq > RadiusSq)
+                return;
+            
+            Candidate.Score = (RadiusSq > 0.0f ? Candidate.DistanceSq / RadiusSq : 0.0f);
+        }
+    }
+    
+    Candidates_.push_back(Candidate);
+}
+
+dim::aabbox3df LightGrid::getNodeBox(const RenderNode* Node)
+{
+    /* Nodes without bounding volume get the light sources of their origin */
+    return Node->getBoundingVolume().getGlobalBox(Node->FinalWorldMatrix_);
+}
+
+bool LightGrid::cmpCandidates(const SCandidate &ObjA, const SCandidate &ObjB)
+{
+    if (ObjA.Score != ObjB.Score)
+        return ObjA.Score < ObjB.Score;
+    return ObjA.DistanceSq < ObjB.DistanceSq;
+}
+
+bool LightGrid::cmpNodeLights(const SNodeLights &ObjA, const SNodeLights &ObjB)
+{
+    return ObjA.Node < ObjB.Node;
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
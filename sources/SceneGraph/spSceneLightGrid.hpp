@@ -0,0 +1,232 @@
+/*
+ * Light grid header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_LIGHT_GRID_H__
+#define __SP_SCENE_LIGHT_GRID_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimension.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+class RenderNode;
+class Light;
+
+/**
+The light grid assigns the most relevant light sources to each render node instead of using the nearest lights
+to the camera for the whole scene. Each frame the visible light sources are inserted into the cells of a uniform
+grid which are covered by their range (see Light::setVolumetricRadius). The cells are stored in a hash table,
+so the grid has no bounds. Then the light sources of each render node are gathered from the cells which are covered
+by its bounding box and the nearest ones (relative to their range) are kept. Thus the work scales with the count of
+visible render nodes times the count of nearby light sources.
+\code
+spScene->setLightBinning(true);
+spScene->getLightGrid().setCellSize(25.0f);
+\endcode
+\note Directional lights and light sources without a range (non-volumetric lights) light the whole scene.
+They are tested for each render node and directional lights come first. Spot lights are binned with their range sphere.
+\see SceneGraph::setLightBinning
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT LightGrid
+{
+    
+    public:
+        
+        LightGrid();
+        ~LightGrid();
+        
+        /* === Functions === */
+        
+        /**
+        Inserts the visible light sources into the grid. This must be called each frame before the light sources are assigned.
+        \param[in] LightList Specifies the light sources.
+        \param[in] BaseMatrix Specifies the base matrix transformation for the light sources (the scene graph's transformation).
+        */
+        void build(const std::vector<Light*> &LightList, const dim::matrix4f &BaseMatrix);
+        
+        /**
+        Assigns the most relevant light sources to each of the specified render nodes.
+        The previous assignments are removed. Invisible render nodes are ignored.
+        \param[in] NodeList Specifies the render nodes. Their final world matrices must already be updated.
+        \param[in] Indices Optional pointer to the indices of the nodes which are to be assigned (e.g. from FrustumCuller::cull).
+        If this is null, all render nodes are assigned.
+        */
+        void assign(const std::vector<RenderNode*> &NodeList, const std::vector<u32>* Indices = 0);
+        
+        /**
+        Returns the light sources which have been assigned to the specified render node by the last "assign" call.
+        \param[in] Node Specifies the render node.
+        \param[out] LightList Receives the light sources sorted by their relevance. It will be cleared before.
+        \return False if the render node has not been assigned.
+        */
+        bool getNodeLights(const RenderNode* Node, std::vector<Light*> &LightList) const;
+        
+        /**
+        Searches the most relevant light sources for the specified render node without assigning them.
+        \param[in] Node Specifies the render node. Its final world matrix must already be updated.
+        \param[out] LightList Receives the light sources sorted by their relevance. It will be cleared before.
+        \return Count of found light sources.
+        */
+        u32 findLights(const RenderNode* Node, std::vector<Light*> &LightList) const;
+        
+        /**
+        Searches the most relevant light sources for the specified bounding box.
+        \param[in] Box Specifies the world-space bounding box.
+        \param[out] LightList Receives the light sources sorted by their relevance. It will be cleared before.
+        \return Count of found light sources.
+        */
+        u32 findLights(const dim::aabbox3df &Box, std::vector<Light*> &LightList) const;
+        
+        //! Removes all light sources and assignments.
+        void clear();
+        
+        /* === Inline functions === */
+        
+        /**
+        Sets the size of each grid cell. This should be in the magnitude of the light ranges.
+        The new size is used by the next "build" call.
+        \param[in] Size Specifies the cell size. By default 10.0.
+        */
+        inline void setCellSize(f32 Size)
+        {
+            if (Size > 0.0f)
+                CellSize_ = Size;
+        }
+        inline f32 getCellSize() const
+        {
+            return CellSize_;
+        }
+        
+        /**
+        Sets the maximal count of light sources for each render node.
+        \param[in] Count Specifies the maximal count. By default MAX_COUNT_OF_LIGHTS (8).
+        */
+        inline void setMaxLightsPerNode(u32 Count)
+        {
+            MaxLightsPerNode_ = Count;
+        }
+        inline u32 getMaxLightsPerNode() const
+        {
+            return MaxLightsPerNode_;
+        }
+        
+        //! Returns the count of visible light sources which have been inserted by the last "build" call.
+        inline u32 getNumLights() const
+        {
+            return Lights_.size();
+        }
+        /**
+        Returns the count of light sources which are not stored in the grid cells but tested for each render node.
+        These are the directional lights, the lights without range and the lights which cover too many cells.
+        */
+        inline u32 getNumUnbinnedLights() const
+        {
+            return UnbinnedLights_.size();
+        }
+        //! Returns the count of used grid cells.
+        inline u32 getNumCells() const
+        {
+            return NumCells_;
+        }
+        //! Returns the count of render nodes which have been assigned by the last "assign" call.
+        inline u32 getNumAssignedNodes() const
+        {
+            return NodeLookup_.size();
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SLightRange
+        {
+            Light* Object;
+            dim::vector3df Position;
+            f32 Radius;             //!< Negative for light sources without range.
+            s32 MinCell[3];
+            s32 MaxCell[3];
+            bool IsBinned;          //!< False if the light source is tested for each render node.
+        };
+        
+        struct SCell
+        {
+            s32 X, Y, Z;
+            u32 First;  //!< First index in the "CellLights_" list.
+            u32 Count;  //!< Count of light sources. 0 for unused cells.
+            u32 Fill;
+        };
+        
+        struct SCandidate
+        {
+            f32 Score;
+            f32 DistanceSq;
+            Light* Object;
+        };
+        
+        struct SNodeLights
+        {
+            const RenderNode* Node;
+            u32 First;  //!< First index in the "NodeLights_" list.
+            u32 Count;
+        };
+        
+        /* === Functions === */
+        
+        bool getCellRange(const dim::aabbox3df &Box, f32 MaxCells, s32 (&MinCell)[3], s32 (&MaxCell)[3]) const;
+        
+        u32 findCell(s32 X, s32 Y, s32 Z) const;
+        u32 insertCell(s32 X, s32 Y, s32 Z);
+        
+        void gatherLights(const dim::aabbox3df &Box, std::vector<Light*> &LightList) const;
+        void addCandidate(u32 Index, const dim::aabbox3df &Box) const;
+        
+        static dim::aabbox3df getNodeBox(const RenderNode* Node);
+        static bool cmpCandidates(const SCandidate &ObjA, const SCandidate &ObjB);
+        static bool cmpNodeLights(const SNodeLights &ObjA, const SNodeLights &ObjB);
+        
+        /* === Members === */
+        
+        std::vector<SLightRange> Lights_;
+        std::vector<u32> UnbinnedLights_;
+        
+        std::vector<SCell> Cells_;      //!< Hash table with linear probing. The size is a power of two.
+        std::vector<u32> CellLights_;
+        u32 NumCells_;
+        
+        std::vector<Light*> NodeLights_;
+        std::vector<SNodeLights> NodeLookup_;
+        
+        mutable std::vector<SCandidate> Candidates_;
+        mutable std::vector<u32> LightStamps_;
+        mutable u32 Stamp_;
+        
+        f32 CellSize_;
+        u32 MaxLightsPerNode_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
@@ -0,0 +1,523 @@
+/*
+ * Loose octree file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneLooseOctree.hpp"
+
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <queue>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/*
+ * Internal members
+ */
+
+static const u32 OCTREE_INVALID_INDEX = ~0u;
+
+
+/*
+ * Internal functions
+ */
+
+//! Returns true if the box is completely in front of any frustum plane.
+static bool isBoxCulled(const ViewFrustum &Frustum, const dim::aabbox3df &Box)
+{
+    for (s32 i = 0; i < VIEWFRUSTUM_PLANE_COUNT; ++i)
+    {
+        if (Frustum.getPlane(static_cast<EViewFrustumPlanes>(i)).getAABBoxRelation(Box) == dim::PLANE_RELATION_FRONT)
+            return true;
+    }
+    return false;
+}
+
+//! Returns the squared distance between the point and the box (zero if the point is inside the box).
+static f32 getBoxDistanceSq(const dim::aabbox3df &Box, const dim::vector3df &Point)
+{
+    f32 DistSq = 0.0f;
+    
+    for (s32 i = 0; i < 3; ++i)
+    {
+        f32 Delta = 0.0f;
+        
+        if (Point[i] < Box.Min[i])
+            Delta = Box.Min[i] - Point[i];
+        else if (Point[i] > Box.Max[i])
+            Delta = Point[i] - Box.Max[i];
+        
+        DistSq += Delta*Delta;
+    }
+    
+    return DistSq;
+}
+
+
+/*
+ * LooseOctree class
+ */
+
+LooseOctree::LooseOctree(const dim::aabbox3df &WorldBox, u32 MaxDepth) :
+    WorldBox_   (WorldBox   ),
+    MaxDepth_   (MaxDepth   )
+{
+    clear();
+}
+LooseOctree::~LooseOctree()
+{
+}
+
+void LooseOctree::update(SceneNode* Node, const dim::aabbox3df &Box)
+{
+    if (!Node)
+        return;
+    
+    std::map<const SceneNode*, u32>::iterator it = ItemMap_.find(Node);
+    
+    if (it != ItemMap_.end())
+    {
+        const u32 ItemIndex = it->second;
+        
+        /* Relocate the node only if it doesn't belong to the same cell anymore */
+        Items_[ItemIndex].Box = Box;
+        
+        if (findCell(Box, false) != Items_[ItemIndex].Cell)
+        {
+            removeItem(ItemIndex);
+            insertItem(ItemIndex, findCell(Box, true));
+        }
+    }
+    else
+    {
+        /* Allocate a new item */
+        u32 ItemIndex = 0;
+        
+        if (!FreeItems_.empty())
+        {
+            ItemIndex = FreeItems_.back();
+            FreeItems_.pop_back();
+        }
+        else
+        {
+            ItemIndex = Items_.size();
+            Items_.resize(ItemIndex + 1);
+        }
+        
+        SItem& Item = Items_[ItemIndex];
+        {
+            Item.Node   = Node;
+            Item.Box    = Box;
+        }
+        ItemMap_[Node] = ItemIndex;
+        
+        insertItem(ItemIndex, findCell(Box, true));
+    }
+}
+
+bool LooseOctree::remove(SceneNode* Node)
+{
+    std::map<const SceneNode*, u32>::iterator it = ItemMap_.find(Node);
+    
+    if (it == ItemMap_.end())
+        return false;
+    
+    const u32 ItemIndex = it->second;
+    
+    removeItem(ItemIndex);
+    
+    Items_[ItemIndex].Node = 0;
+    FreeItems_.push_back(ItemIndex);
+    ItemMap_.erase(it);
+    
+    return true;
+}
+
+void LooseOctree::clear()
+{
+    Cells_.resize(1);
+    FreeCells_.clear();
+    
+    Items_.clear();
+    FreeItems_.clear();
+    ItemMap_.clear();
+    
+    /* Setup the root cell as a cube around the world box */
+    const dim::vector3df HalfSize((WorldBox_.Max - WorldBox_.Min) * 0.5f);
+    
+    SCell& Root = Cells_.front();
+    
+    Root.Center     = WorldBox_.getCenter();
+    Root.HalfSize   = math::Max(HalfSize.X, math::Max(HalfSize.Y, HalfSize.Z));
+    Root.LooseBox   = dim::aabbox3df(Root.Center - Root.HalfSize, Root.Center + Root.HalfSize);
+    Root.Depth      = 0;
+    Root.Parent     = OCTREE_INVALID_INDEX;
+    Root.NumItems   = 0;
+    Root.Items.clear();
+    
+    for (u32 i = 0; i < 8; ++i)
+        Root.Children[i] = OCTREE_INVALID_INDEX;
+}
+
+void LooseOctree::setWorldBox(const dim::aabbox3df &WorldBox, u32 MaxDepth)
+{
+    /* Store all nodes and re-insert them into the new tree */
+    std::vector<SItem> Items;
+    Items.reserve(ItemMap_.size());
+    
+    foreach (const SItem &Item, Items_)
+    {
+        if (Item.Node)
+            Items.push_back(Item);
+    }
+    
+    WorldBox_ = WorldBox;
+    MaxDepth_ = MaxDepth;
+    
+    clear();
+    
+    foreach (const SItem &Item, Items)
+        update(Item.Node, Item.Box);
+}
+
+bool LooseOctree::contains(const SceneNode* Node) const
+{
+    return ItemMap_.find(Node) != ItemMap_.end();
+}
+
+const dim::aabbox3df* LooseOctree::getBox(const SceneNode* Node) const
+{
+    std::map<const SceneNode*, u32>::const_iterator it = ItemMap_.find(Node);
+    return it != ItemMap_.end() ? &Items_[it->second].Box : 0;
+}
+
+void LooseOctree::findNodes(const ViewFrustum &Frustum, std::vector<SceneNode*> &NodeList) const
+{
+    findNodesInFrustum(0, Frustum, NodeList);
+}
+
+void LooseOctree::findNodes(const dim::aabbox3df &Box, std::vector<SceneNode*> &NodeList) const
+{
+    findNodesInBox(0, Box, NodeList);
+}
+
+void LooseOctree::findNodes(const dim::vector3df &Center, f32 Radius, std::vector<SceneNode*> &NodeList) const
+{
+    findNodesInSphere(0, Center, Radius*Radius, NodeList);
+}
+
+void LooseOctree::findNearestNodes(const dim::vector3df &Point, u32 MaxCount, std::vector<SceneNode*> &NodeList) const
+{
+    NodeList.clear();
+    
+    if (!MaxCount || ItemMap_.empty())
+        return;
+    
+    typedef std::pair<f32, u32> SCellEntry;
+    typedef std::pair<f32, SceneNode*> SNodeEntry;
+    
+    /* Visit the cells in the order of their distance (min-heap) and keep the nearest nodes (max-heap) */
+    std::priority_queue< SCellEntry, std::vector<SCellEntry>, std::greater<SCellEntry> > CellQueue;
+    std::vector<SNodeEntry> Nearest;
+    
+    CellQueue.push(SCellEntry(0.0f, 0));
+    
+    while (!CellQueue.empty())
+    {
+        const SCellEntry Entry = CellQueue.top();
+        CellQueue.pop();
+        
+        /* The remaining cells are farther away than all found nodes */
+        if (Nearest.size() == MaxCount && Entry.first > Nearest.front().first)
+            break;
+        
+        const SCell& Cell = Cells_[Entry.second];
+        
+        foreach (u32 ItemIndex, Cell.Items)
+        {
+            const SItem& Item = Items_[ItemIndex];
+            const f32 DistSq = getBoxDistanceSq(Item.Box, Point);
+            
+            if (Nearest.size() < MaxCount)
+            {
+                Nearest.push_back(SNodeEntry(DistSq, Item.Node));
+                std::push_heap(Nearest.begin(), Nearest.end());
+            }
+            else if (DistSq < Nearest.front().first)
+            {
+                std::pop_heap(Nearest.begin(), Nearest.end());
+                Nearest.back() = SNodeEntry(DistSq, Item.Node);
+                std::push_heap(Nearest.begin(), Nearest.end());
+            }
+        }
+        
+        for (u32 i = 0; i < 8; ++i)
+        {
+            if (Cell.Children[i] != OCTREE_INVALID_INDEX)
+                CellQueue.push(SCellEntry(getBoxDistanceSq(Cells_[Cell.Children[i]].LooseBox, Point), Cell.Children[i]));
+        }
+    }
+    
+    /* Return the nodes sorted by their distance */
+    std::sort_heap(Nearest.begin(), Nearest.end());
+    
+    NodeList.reserve(Nearest.size());
+    foreach (const SNodeEntry &Entry, Nearest)
+        NodeList.push_back(Entry.second);
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+u32 LooseOctree::findCell(const dim::aabbox3df &Box, bool CreateCells)
+{
+    const dim::vector3df Center(Box.getCenter());
+    const dim::vector3df Size(Box.getSize());
+    const f32 Extent = math::Max(Size.X, math::Max(Size.Y, Size.Z));
+    
+    /* Nodes outside the world box are stored in the root cell */
+    const SCell& Root = Cells_.front();
+    
+    if (!Root.LooseBox.isPointInside(Center))
+        return 0;
+    
+    u32 CellIndex = 0;
+    
+    while (Cells_[CellIndex].Depth < MaxDepth_)
+    {
+        const SCell& Cell = Cells_[CellIndex];
+        
+        /* A child cell (with half the size) can only hold boxes which are not larger than the child cell itself */
+        if (Extent > Cell.HalfSize)
+            break;
+        
+        const u32 ChildIndex = (
+            (Center.X >= Cell.Center.X ? 1 : 0) |
+            (Center.Y >= Cell.Center.Y ? 2 : 0) |
+            (Center.Z >= Cell.Center.Z ? 4 : 0)
+        );
+        
+        u32 Child = Cell.Children[ChildIndex];
+        
+        if (Child == OCTREE_INVALID_INDEX)
+        {
+            if (!CreateCells)
+                return OCTREE_INVALID_INDEX;
+            Child = createCell(CellIndex, ChildIndex);
+        }
+        
+        CellIndex = Child;
+    }
+    
+    return CellIndex;
+}
+
+u32 LooseOctree::createCell(u32 Parent, u32 ChildIndex)
+{
+    /* Allocate a new cell (this may invalidate all references to the cells) */
+    u32 CellIndex = 0;
+    
+    if (!FreeCells_.empty())
+    {
+        CellIndex = FreeCells_.back();
+        FreeCells_.pop_back();
+    }
+    else
+    {
+        CellIndex = Cells_.size();
+        Cells_.resize(CellIndex + 1);
+    }
+    
+    SCell& ParentCell = Cells_[Parent];
+    SCell& Cell = Cells_[CellIndex];
+    
+    ParentCell.Children[ChildIndex] = CellIndex;
+    
+    /* Setup the cell and its loose bounds */
+    const f32 Offset = ParentCell.HalfSize * 0.5f;
+    
+    Cell.Center = dim::vector3df(
+        ParentCell.Center.X + ((ChildIndex & 1) ? Offset : -Offset),
+        ParentCell.Center.Y + ((ChildIndex & 2) ? Offset : -Offset),
+        ParentCell.Center.Z + ((ChildIndex & 4) ? Offset : -Offset)
+    );
+    
+    Cell.HalfSize   = Offset;
+    Cell.LooseBox   = dim::aabbox3df(Cell.Center - Offset*2, Cell.Center + Offset*2);
+    Cell.Depth      = ParentCell.Depth + 1;
+    Cell.Parent     = Parent;
+    Cell.NumItems   = 0;
+    Cell.Items.clear();
+    
+    for (u32 i = 0; i < 8; ++i)
+        Cell.Children[i] = OCTREE_INVALID_INDEX;
+    
+    return CellIndex;
+}
+
+void LooseOctree::insertItem(u32 ItemIndex, u32 CellIndex)
+{
+    SItem& Item = Items_[ItemIndex];
+    SCell& Cell = Cells_[CellIndex];
+    
+    Item.Cell = CellIndex;
+    Item.Slot = Cell.Items.size();
+    
+    Cell.Items.push_back(ItemIndex);
+    
+    for (u32 i = CellIndex; i != OCTREE_INVALID_INDEX; i = Cells_[i].Parent)
+        ++Cells_[i].NumItems;
+}
+
+void LooseOctree::removeItem(u32 ItemIndex)
+{
+    const SItem& Item = Items_[ItemIndex];
+    SCell& Cell = Cells_[Item.Cell];
+    
+    /* Remove the item from its cell by swapping it with the last one */
+    const u32 LastItem = Cell.Items.back();
+    
+    Cell.Items[Item.Slot] = LastItem;
+    Items_[LastItem].Slot = Item.Slot;
+    Cell.Items.pop_back();
+    
+    /* Update the item counters and release empty cells (except the root) */
+    for (u32 i = Item.Cell; i != OCTREE_INVALID_INDEX;)
+    {
+        SCell& Current = Cells_[i];
+        const u32 Parent = Current.Parent;
+        
+        if (--Current.NumItems == 0 && Parent != OCTREE_INVALID_INDEX)
+        {
+            SCell& ParentCell = Cells_[Parent];
+            
+            for (u32 j = 0; j < 8; ++j)
+            {
+                if (ParentCell.Children[j] == i)
+                    ParentCell.Children[j] = OCTREE_INVALID_INDEX;
+            }
+            
+            FreeCells_.push_back(i);
+        }
+        
+        i = Parent;
+    }
+}
+
+void LooseOctree::addItems(u32 CellIndex, std::vector<SceneNode*> &NodeList) const
+{
+    const SCell& Cell = Cells_[CellIndex];
+    
+    foreach (u32 ItemIndex, Cell.Items)
+        NodeList.push_back(Items_[ItemIndex].Node);
+    
+    for (u32 i = 0; i < 8; ++i)
+    {
+        if (Cell.Children[i] != OCTREE_INVALID_INDEX)
+            addItems(Cell.Children[i], NodeList);
+    }
+}
+
+void LooseOctree::findNodesInFrustum(u32 CellIndex, const ViewFrustum &Frustum, std::vector<SceneNode*> &NodeList) const
+{
+    const SCell& Cell = Cells_[CellIndex];
+    
+    /* Classify the loose bounds (the root cell may also hold nodes outside the world box) */
+    if (CellIndex != 0)
+    {
+        bool Clipped = false;
+        
+        for (s32 i = 0; i < VIEWFRUSTUM_PLANE_COUNT; ++i)
+        {
+            const dim::EPlaneAABBRelations Relation = Frustum.getPlane(
+                static_cast<EViewFrustumPlanes>(i)
+            ).getAABBoxRelation(Cell.LooseBox);
+            
+            if (Relation == dim::PLANE_RELATION_FRONT)
+                return;
+            if (Relation == dim::PLANE_RELATION_CLIPPED)
+                Clipped = true;
+        }
+        
+        /* Add the whole sub-tree if the cell is completely inside the frustum */
+        if (!Clipped)
+        {
+            addItems(CellIndex, NodeList);
+            return;
+        }
+    }
+    
+    foreach (u32 ItemIndex, Cell.Items)
+    {
+        const SItem& Item = Items_[ItemIndex];
+        if (!isBoxCulled(Frustum, Item.Box))
+            NodeList.push_back(Item.Node);
+    }
+    
+    for (u32 i = 0; i < 8; ++i)
+    {
+        if (Cell.Children[i] != OCTREE_INVALID_INDEX)
+            findNodesInFrustum(Cell.Children[i], Frustum, NodeList);
+    }
+}
+
+void LooseOctree::findNodesInBox(u32 CellIndex, const dim::aabbox3df &Box, std::vector<SceneNode*> &NodeList) const
+{
+    const SCell& Cell = Cells_[CellIndex];
+    
+    if (CellIndex != 0 && !Cell.LooseBox.checkBoxBoxIntersection(Box))
+        return;
+    
+    foreach (u32 ItemIndex, Cell.Items)
+    {
+        const SItem& Item = Items_[ItemIndex];
+        if (Item.Box.checkBoxBoxIntersection(Box))
+            NodeList.push_back(Item.Node);
+    }
+    
+    for (u32 i = 0; i < 8; ++i)
+    {
+        if (Cell.Children[i] != OCTREE_INVALID_INDEX)
+            findNodesInBox(Cell.Children[i], Box, NodeList);
+    }
+}
+
+void LooseOctree::findNodesInSphere(
+    u32 CellIndex, const dim::vector3df &Center, f32 RadiusSq, std::vector<SceneNode*> &NodeList) const
+{
+    const SCell& Cell = Cells_[CellIndex];
+    
+    if (CellIndex != 0 && getBoxDistanceSq(Cell.LooseBox, Center) > RadiusSq)
+        return;
+    
+    foreach (u32 ItemIndex, Cell.Items)
+    {
+        const SItem& Item = Items_[ItemIndex];
+        if (getBoxDistanceSq(Item.Box, Center) <= RadiusSq)
+            NodeList.push_back(Item.Node);
+    }
+    
+    for (u32 i = 0; i < 8; ++i)
+    {
+        if (Cell.Children[i] != OCTREE_INVALID_INDEX)
+            findNodesInSphere(Cell.Children[i], Center, RadiusSq, NodeList);
+    }
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
@@ -0,0 +1,196 @@
+/*
+ * Loose octree header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_LOOSE_OCTREE_H__
+#define __SP_SCENE_LOOSE_OCTREE_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimensionAABB.hpp"
+#include "Base/spViewFrustum.hpp"
+
+#include <vector>
+#include <map>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+class SceneNode;
+
+/**
+The loose octree is an incrementally updated spatial index for scene nodes and their world-space bounding boxes.
+Each cell of the tree has loose bounds of twice its size, so each node is stored in exactly one cell which is
+determined directly by the size and the center of its bounding box. Moving a node only relocates it when its center
+leaves the cell or its size changes the tree level. Nodes outside the world box of the tree are stored in the root cell.
+Empty cells are released immediately.
+\see SceneGraphSpatial
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT LooseOctree
+{
+    
+    public:
+        
+        /**
+        Constructs the loose octree.
+        \param[in] WorldBox Specifies the bounding box of the root cell.
+        This should enclose the whole scene. The box is extended to a cube.
+        \param[in] MaxDepth Specifies the maximal depth of the tree. By default 8.
+        */
+        LooseOctree(const dim::aabbox3df &WorldBox = dim::aabbox3df(-5000.0f, 5000.0f), u32 MaxDepth = 8);
+        ~LooseOctree();
+        
+        /* === Functions === */
+        
+        /**
+        Inserts the specified node into the tree or relocates it if it's already part of the tree.
+        \param[in] Node Specifies the scene node.
+        \param[in] Box Specifies the world-space bounding box of the node.
+        */
+        void update(SceneNode* Node, const dim::aabbox3df &Box);
+        
+        /**
+        Removes the specified node from the tree.
+        \return True if the node has been removed. Otherwise the node was not part of the tree.
+        */
+        bool remove(SceneNode* Node);
+        
+        //! Removes all nodes from the tree.
+        void clear();
+        
+        /**
+        Sets a new world box and maximal depth for the tree and re-inserts all nodes.
+        \see LooseOctree
+        */
+        void setWorldBox(const dim::aabbox3df &WorldBox, u32 MaxDepth);
+        
+        //! Returns true if the specified node is part of the tree.
+        bool contains(const SceneNode* Node) const;
+        
+        //! Returns a pointer to the stored bounding box of the specified node or null if the node is not part of the tree.
+        const dim::aabbox3df* getBox(const SceneNode* Node) const;
+        
+        /**
+        Searches all nodes whose bounding boxes are at least partially inside the specified view frustum.
+        Cells which are completely inside the frustum are added without testing their nodes.
+        \param[in] Frustum Specifies the view frustum.
+        \param[out] NodeList Specifies the output list. The found nodes are appended to this list.
+        */
+        void findNodes(const ViewFrustum &Frustum, std::vector<SceneNode*> &NodeList) const;
+        
+        //! Searches all nodes whose bounding boxes intersect with the specified box.
+        void findNodes(const dim::aabbox3df &Box, std::vector<SceneNode*> &NodeList) const;
+        
+        //! Searches all nodes whose bounding boxes intersect with the specified sphere.
+        void findNodes(const dim::vector3df &Center, f32 Radius, std::vector<SceneNode*> &NodeList) const;
+        
+        /**
+        Searches the nearest nodes to the specified point. The distance of a node is the distance
+        between the point and its bounding box, i.e. it's zero when the point is inside the box.
+        The cells are visited in the order of their distance to the point, so only the surrounding cells are searched.
+        \param[in] Point Specifies the search point.
+        \param[in] MaxCount Specifies the maximal count of nodes.
+        \param[out] NodeList Specifies the output list. It will be filled with the nearest nodes sorted by their distance.
+        */
+        void findNearestNodes(const dim::vector3df &Point, u32 MaxCount, std::vector<SceneNode*> &NodeList) const;
+        
+        /* === Inline functions === */
+        
+        //! Returns the count of nodes in the tree.
+        inline u32 getNodeCount() const
+        {
+            return ItemMap_.size();
+        }
+        //! Returns the count of allocated cells (including the root cell).
+        inline u32 getCellCount() const
+        {
+            return Cells_.size() - FreeCells_.size();
+        }
+        
+        //! Returns the world box of the root cell.
+        inline const dim::aabbox3df& getWorldBox() const
+        {
+            return WorldBox_;
+        }
+        //! Returns the maximal depth of the tree.
+        inline u32 getMaxDepth() const
+        {
+            return MaxDepth_;
+        }
+        
+    private:
+        
+        /* === Structures === */
+        
+        struct SCell
+        {
+            dim::aabbox3df LooseBox;    //!< Loose bounds of this cell (twice the size of the cell).
+            dim::vector3df Center;
+            f32 HalfSize;
+            u32 Depth;
+            u32 Parent;
+            u32 Children[8];
+            u32 NumItems;               //!< Count of items in this cell and all its children.
+            std::vector<u32> Items;
+        };
+        
+        struct SItem
+        {
+            SceneNode* Node;
+            dim::aabbox3df Box;
+            u32 Cell;
+            u32 Slot;                   //!< Index of this item in the item list of its cell.
+        };
+        
+        /* === Functions === */
+        
+        u32 findCell(const dim::aabbox3df &Box, bool CreateCells);
+        
+        u32 createCell(u32 Parent, u32 ChildIndex);
+        
+        void insertItem(u32 ItemIndex, u32 CellIndex);
+        void removeItem(u32 ItemIndex);
+        
+        void addItems(u32 CellIndex, std::vector<SceneNode*> &NodeList) const;
+        
+        void findNodesInFrustum(u32 CellIndex, const ViewFrustum &Frustum, std::vector<SceneNode*> &NodeList) const;
+        void findNodesInBox(u32 CellIndex, const dim::aabbox3df &Box, std::vector<SceneNode*> &NodeList) const;
+        void findNodesInSphere(
+            u32 CellIndex, const dim::vector3df &Center, f32 RadiusSq, std::vector<SceneNode*> &NodeList
+        ) const;
+        
+        /* === Members === */
+        
+        std::vector<SCell> Cells_;
+        std::vector<u32> FreeCells_;
+        
+        std::vector<SItem> Items_;
+        std::vector<u32> FreeItems_;
+        
+        std::map<const SceneNode*, u32> ItemMap_;
+        
+        dim::aabbox3df WorldBox_;
+        u32 MaxDepth_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
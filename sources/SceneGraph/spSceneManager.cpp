@@ -14,6 +14,7 @@
 #include "Base/spSharedObjects.hpp"
 #include "Base/spBaseExceptions.hpp"
 #include "Base/spBasicMeshGenerator.hpp"
+#include "Base/spMathCollisionLibrary.hpp"
 #include "FileFormats/Mesh/spMeshFileFormats.hpp"
 #include "RenderSystem/spRenderSystem.hpp"
 
@@ -49,7 +50,7 @@ SceneManager::~SceneManager()
 Mesh* SceneManager::createMesh()
 {
     Mesh* NewMesh = MemoryManager::createMemory<Mesh>("scene::Mesh (Empty)");
-    MeshList_.push_back(NewMesh);
+    addSceneNode(MeshList_, NewMesh);
     return NewMesh;
 }
 
@@ -86,7 +87,7 @@ Mesh* SceneManager::createHeightField(const video::Texture* TexHeightMap, const
     //!!!
     Mesh* NewMesh = BasicMeshGenerator().createHeightField(TexHeightMap, Segments);
     if (NewMesh)
-        MeshList_.push_back(NewMesh);
+        addSceneNode(MeshList_, NewMesh);
     return NewMesh;
 }
 
@@ -166,7 +167,7 @@ Mesh* SceneManager::createMeshList(std::list<Mesh*> MergeList, bool isOldDelete)
     /* Update mesh buffer and add the mesh to the list */
     NewMesh->updateMeshBuffer();
     
-    MeshList_.push_back(NewMesh);
+    addSceneNode(MeshList_, NewMesh);
     
     return NewMesh;
 }
@@ -222,7 +223,7 @@ Mesh* SceneManager::createMeshSurface(Mesh* Model, u32 Surface)
     /* Update mesh buffer and add the mesh to the list */
     NewMesh->updateMeshBuffer();
     
-    MeshList_.push_back(NewMesh);
+    addSceneNode(MeshList_, NewMesh);
     
     return NewMesh;
 }
@@ -298,7 +299,7 @@ Mesh* SceneManager::loadMesh(
     Mesh* NewMesh = Loader->loadMesh(Filename, TexturePath, Flags);
     
     if (NewMesh)
-        MeshList_.push_back(NewMesh);
+        addSceneNode(MeshList_, NewMesh);
     
     /* Delete the temporary mesh loader */
     delete Loader;
@@ -391,7 +392,7 @@ Mesh* SceneManager::loadScene(io::stringc Filename, io::stringc TexturePath, con
     Mesh* NewMesh = Loader->loadScene(Filename, TexturePath, Flags);
     
     if (NewMesh)
-        MeshList_.push_back(NewMesh);
+        addSceneNode(MeshList_, NewMesh);
     
     /* Delete the temporary scene loader */
     delete Loader;
@@ -514,7 +515,7 @@ void SceneManager::createFurMesh(
 SceneNode* SceneManager::createNode()
 {
     SceneNode* NewNode = new SceneNode(NODE_BASICNODE);
-    NodeList_.push_back(NewNode);
+    addSceneNode(NodeList_, NewNode);
     return NewNode;
 }
 
@@ -523,7 +524,7 @@ Light* SceneManager::createLight(const ELightModels Type)
     try
     {
         Light* NewLight = new Light(Type);
-        LightList_.push_back(NewLight);
+        addSceneNode(LightList_, NewLight);
         return NewLight;
     }
     catch (const std::exception &Err)
@@ -536,7 +537,7 @@ Light* SceneManager::createLight(const ELightModels Type)
 Billboard* SceneManager::createBillboard(video::Texture* BaseTexture)
 {
     Billboard* NewBillboard = new Billboard(BaseTexture);
-    BillboardList_.push_back(NewBillboard);
+    addSceneNode(BillboardList_, NewBillboard);
     return NewBillboard;
 }
 
@@ -554,7 +555,7 @@ Terrain* SceneManager::createTerrain(
     Terrain* NewTerrain = new Terrain();
     NewTerrain->generate(static_cast<u32>(Resolution.Width), static_cast<u8>(GeoMIPLevels));
     #endif
-    TerrainList_.push_back(NewTerrain);
+    addSceneNode(TerrainList_, NewTerrain);
     return NewTerrain;
 }
 
@@ -589,20 +590,20 @@ void SceneManager::clearScene(
     bool isDeleteLights, bool isDeleteBillboards, bool isDeleteTerrains)
 {
     if (isDeleteNodes)
-        MemoryManager::deleteList(NodeList_);
+        deleteNodeList(NodeList_);
     if (isDeleteMeshes)
     {
-        MemoryManager::deleteList(MeshList_);
+        deleteNodeList(MeshList_);
         MeshMap_.clear();
     }
     if (isDeleteCameras)
-        MemoryManager::deleteList(CameraList_);
+        deleteNodeList(CameraList_);
     if (isDeleteLights)
-        MemoryManager::deleteList(LightList_);
+        deleteNodeList(LightList_);
     if (isDeleteBillboards)
-        MemoryManager::deleteList(BillboardList_);
+        deleteNodeList(BillboardList_);
     if (isDeleteTerrains)
-        MemoryManager::deleteList(TerrainList_);
+        deleteNodeList(TerrainList_);
 }
 
 SceneNode* SceneManager::copyNode(const SceneNode* TemplateObject)
@@ -640,12 +641,12 @@ bool SceneManager::deleteNode(SceneNode* Object)
     
     switch (Object->getType())
     {
-        case NODE_BASICNODE:    deleteSceneNode(NodeList_,      Object);
-        case NODE_CAMERA:       deleteSceneNode(CameraList_,    static_cast<Camera*     >(Object));
-        case NODE_LIGHT:        deleteSceneNode(LightList_,     static_cast<Light*      >(Object));
-        case NODE_MESH:         deleteSceneNode(MeshList_,      static_cast<Mesh*       >(Object));
-        case NODE_BILLBOARD:    deleteSceneNode(BillboardList_, static_cast<Billboard*  >(Object));
-        case NODE_TERRAIN:      deleteSceneNode(TerrainList_,   static_cast<Terrain*    >(Object));
+        case NODE_BASICNODE:    return deleteSceneNode(NodeList_,      Object);
+        case NODE_CAMERA:       return deleteSceneNode(CameraList_,    static_cast<Camera*     >(Object));
+        case NODE_LIGHT:        return deleteSceneNode(LightList_,     static_cast<Light*      >(Object));
+        case NODE_MESH:         return deleteSceneNode(MeshList_,      static_cast<Mesh*       >(Object));
+        case NODE_BILLBOARD:    return deleteSceneNode(BillboardList_, static_cast<Billboard*  >(Object));
+        case NODE_TERRAIN:      return deleteSceneNode(TerrainList_,   static_cast<Terrain*    >(Object));
         default:
             break;
     }
@@ -657,30 +658,105 @@ std::list<SceneNode*> SceneManager::findNodes(const io::stringc &Name) const
 {
     std::list<SceneNode*> NodeList;
     
-    filterNodeByName<SceneNode> (Name, NodeList, NodeList_      );
-    filterNodeByName<Camera>    (Name, NodeList, CameraList_    );
-    filterNodeByName<Light>     (Name, NodeList, LightList_     );
-    filterNodeByName<Mesh>      (Name, NodeList, MeshList_      );
-    filterNodeByName<Billboard> (Name, NodeList, BillboardList_ );
-    filterNodeByName<Terrain>   (Name, NodeList, TerrainList_   );
+    typedef std::multimap<u32, SceneNode*>::const_iterator ItType;
+    const std::pair<ItType, ItType> Range = NameIndex_.equal_range(getNameHash(Name));
+    
+    for (ItType it = Range.first; it != Range.second; ++it)
+    {
+        if (it->second->getName() == Name)
+            NodeList.push_back(it->second);
+    }
     
     return NodeList;
 }
 
+u32 SceneManager::findNodes(const io::stringc &Name, std::vector<SceneNode*> &NodeList) const
+{
+    NodeList.clear();
+    
+    typedef std::multimap<u32, SceneNode*>::const_iterator ItType;
+    const std::pair<ItType, ItType> Range = NameIndex_.equal_range(getNameHash(Name));
+    
+    /* Compare the names too, because different names can have the same hash */
+    for (ItType it = Range.first; it != Range.second; ++it)
+    {
+        if (it->second->getName() == Name)
+            NodeList.push_back(it->second);
+    }
+    
+    return NodeList.size();
+}
+
 SceneNode* SceneManager::findNode(const io::stringc &Name) const
 {
-    SceneNode* Object = 0;
+    typedef std::multimap<u32, SceneNode*>::const_iterator ItType;
+    const std::pair<ItType, ItType> Range = NameIndex_.equal_range(getNameHash(Name));
     
-    if ( ( Object = findNodeInList<SceneNode>   (Name, NodeList_        ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Camera>      (Name, CameraList_      ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Light>       (Name, LightList_       ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Mesh>        (Name, MeshList_        ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Billboard>   (Name, BillboardList_   ) ) != 0 ) return Object;
-    if ( ( Object = findNodeInList<Terrain>     (Name, TerrainList_     ) ) != 0 ) return Object;
+    for (ItType it = Range.first; it != Range.second; ++it)
+    {
+        if (it->second->getName() == Name)
+            return it->second;
+    }
     
     return 0;
 }
 
+std::pair<SceneManager::NameIndexIterator, SceneManager::NameIndexIterator> SceneManager::getNameIndexRange(const io::stringc &Name) const
+{
+    return NameIndex_.equal_range(getNameHash(Name));
+}
+
+void SceneManager::updateSpatialIndex()
+{
+    updateSpatialList(NodeList_     );
+    updateSpatialList(CameraList_   );
+    updateSpatialList(LightList_    );
+    updateSpatialList(MeshList_     );
+    updateSpatialList(BillboardList_);
+    updateSpatialList(TerrainList_  );
+}
+
+u32 SceneManager::findNodes(const dim::aabbox3df &Box, std::vector<SceneNode*> &NodeList) const
+{
+    NodeList.clear();
+    QueryResults_.clear();
+    
+    SpatialIndex_.findOverlaps(Box, QueryResults_);
+    
+    /* Test the exact boxes, because the tree only stores the enlarged boxes */
+    foreach (void* Data, QueryResults_)
+    {
+        SceneNode* Node = static_cast<SceneNode*>(Data);
+        
+        if (SpatialBoxes_[Node->SpatialProxy_].checkBoxBoxIntersection(Box))
+            NodeList.push_back(Node);
+    }
+    
+    return NodeList.size();
+}
+
+u32 SceneManager::findNodes(const dim::vector3df &Center, f32 Radius, std::vector<SceneNode*> &NodeList) const
+{
+    NodeList.clear();
+    QueryResults_.clear();
+    
+    SpatialIndex_.findOverlaps(dim::aabbox3df(Center - Radius, Center + Radius), QueryResults_);
+    
+    foreach (void* Data, QueryResults_)
+    {
+        SceneNode* Node = static_cast<SceneNode*>(Data);
+        
+        const dim::vector3df Point(
+            math::CollisionLibrary::getClosestPoint(SpatialBoxes_[Node->SpatialProxy_], Center)
+        );
+        
+        if (math::getDistanceSq(Point, Center) <= Radius*Radius)
+            NodeList.push_back(Node);
+    }
+    
+    return NodeList.size();
+}
+
 std::list<SceneNode*> SceneManager::findChildren(const SceneNode* ParentNode) const
 {
     std::list<SceneNode*> NodeList;
@@ -863,6 +939,72 @@ ESceneFileFormats SceneManager::getSceneFileFormat(
 }
 
 
+
+/*
+ * ======= Private: =======
+ */
+
+void SceneManager::addNameIndex(SceneNode* Object)
+{
+    NameIndex_.insert(std::make_pair(getNameHash(Object->getName()), Object));
+}
+
+bool SceneManager::removeNameIndex(SceneNode* Object)
+{
+    typedef std::multimap<u32, SceneNode*>::iterator ItType;
+    const std::pair<ItType, ItType> Range = NameIndex_.equal_range(getNameHash(Object->getName()));
+    
+    for (ItType it = Range.first; it != Range.second; ++it)
+    {
+        if (it->second == Object)
+        {
+            NameIndex_.erase(it);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void SceneManager::updateNodeName(SceneNode* Object, const io::stringc &Name)
+{
+    /* Only re-insert the node if it belongs to this scene manager */
+    const bool IsIndexed = removeNameIndex(Object);
+    
+    Object->BaseObject::setName(Name);
+    
+    if (IsIndexed)
+        addNameIndex(Object);
+}
+
+void SceneManager::removeSpatialIndex(SceneNode* Object)
+{
+    if (Object->SpatialProxy_ >= 0)
+    {
+        SpatialIndex_.destroyProxy(Object->SpatialProxy_);
+        Object->SpatialProxy_ = -1;
+    }
+}
+
+u32 SceneManager::getNameHash(const io::stringc &Name)
+{
+    /* FNV-1a hash */
+    u32 Hash = 2166136261u;
+    
+    for (u32 i = 0; i < Name.size(); ++i)
+    {
+        Hash ^= static_cast<u8>(Name[i]);
+        Hash *= 16777619u;
+    }
+    
+    return Hash;
+}
+
+dim::aabbox3df SceneManager::getNodeBox(const SceneNode* Node)
+{
+    return Node->getBoundingVolume().getGlobalBox(Node->getTransformMatrix(true));
+}
+
 } // /namespace scene
 
 } // /namespace sp
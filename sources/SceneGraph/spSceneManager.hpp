@@ -12,9 +12,12 @@
 #include "Base/spStandard.hpp"
 #include "Base/spBasicMeshGenerator.hpp"
 #include "Base/spGeometryStructures.hpp"
+#include "Base/spDynamicAABBTree.hpp"
 #include "SceneGraph/spSceneLight.hpp"
 
 #include <list>
+#include <vector>
+#include <map>
 
 
 namespace sp
@@ -41,6 +44,8 @@ class SP_EXPORT SceneManager
     
     public:
         
+        typedef std::multimap<u32, SceneNode*>::const_iterator NameIndexIterator;
+        
         SceneManager();
         ~SceneManager();
         
@@ -219,13 +224,62 @@ class SP_EXPORT SceneManager
         */
         std::list<SceneNode*> findNodes(const io::stringc &Name) const;
         
+        /**
+        Searches each node with the specified name. The nodes are looked up in the hashed name index
+        which is updated by "SceneNode::setName", so this takes O(log n) time.
+        \param[in] Name Specifies the name of the wanted nodes.
+        \param[out] NodeList Specifies the output list. It will be cleared before the search.
+        No memory is allocated as long as the list has enough capacity.
+        \return Count of found nodes.
+        \since Version 3.3
+        */
+        u32 findNodes(const io::stringc &Name, std::vector<SceneNode*> &NodeList) const;
+        
         /**
         Tries to find the specified node.
         \param Name: Name of the wanted node.
         \return Pointer to the Node object which could found. If no object could found the return value is 0.
+        \note Since version 3.3 this uses the name index, see findNodes(const io::stringc&, std::vector<SceneNode*>&).
         */
         SceneNode* findNode(const io::stringc &Name) const;
         
+        /**
+        Returns the range of the hashed name index which contains all nodes with the specified name.
+        Different names can have the same hash, so the node names must be compared too.
+        Use this to search the nodes without any memory allocation.
+        \since Version 3.3
+        */
+        std::pair<NameIndexIterator, NameIndexIterator> getNameIndexRange(const io::stringc &Name) const;
+        
+        /**
+        Updates the spatial index with the current global transformations and bounding volumes of all nodes.
+        The index is a dynamic AABB tree where each node is stored with an enlarged bounding box,
+        so nodes which only move a little don't change the tree. Call this after the nodes have been moved
+        (e.g. once per frame) and before the spatial "findNodes" functions are used.
+        \see DynamicAABBTree
+        \since Version 3.3
+        */
+        void updateSpatialIndex();
+        
+        /**
+        Searches each node whose global bounding box intersects with the specified box.
+        Nodes without bounding volume are treated as points and nodes with a bounding sphere are treated as boxes.
+        \param[in] Box Specifies the box in global space.
+        \param[out] NodeList Specifies the output list. It will be cleared before the search.
+        No memory is allocated as long as the list has enough capacity.
+        \return Count of found nodes.
+        \note The result is based on the last "updateSpatialIndex" call. The visibility of the nodes is not considered.
+        \since Version 3.3
+        */
+        u32 findNodes(const dim::aabbox3df &Box, std::vector<SceneNode*> &NodeList) const;
+        
+        /**
+        Searches each node whose global bounding box intersects with the specified sphere.
+        \see findNodes(const dim::aabbox3df&, std::vector<SceneNode*>&)
+        \since Version 3.3
+        */
+        u32 findNodes(const dim::vector3df &Center, f32 Radius, std::vector<SceneNode*> &NodeList) const;
+        
         /**
         Tries to find each child of the specified parent.
         \param ParentNode: Pointer to the Node object which is the parent of the wanted children.
@@ -281,7 +335,7 @@ class SP_EXPORT SceneManager
         template <class T> T* createCamera()
         {
             T* NewCamera = MemoryManager::createMemory<T>("scene::Camera");
-            CameraList_.push_back(NewCamera);
+            addSceneNode(CameraList_, NewCamera);
             return NewCamera;
         }
         
@@ -296,27 +350,31 @@ class SP_EXPORT SceneManager
         
         /* === Inline functions === */
         
-        inline const std::list<Mesh*>& getMeshList() const
+        /**
+        Returns the list of all meshes. The node lists are contiguous and a deleted node is replaced
+        by the last node of its list, so the order of the nodes changes when a node is deleted.
+        */
+        inline const std::vector<Mesh*>& getMeshList() const
         {
             return MeshList_;
         }
-        inline const std::list<Billboard*>& getBillboardList() const
+        inline const std::vector<Billboard*>& getBillboardList() const
         {
             return BillboardList_;
         }
-        inline const std::list<Terrain*>& getTerrainList() const
+        inline const std::vector<Terrain*>& getTerrainList() const
         {
             return TerrainList_;
         }
-        inline const std::list<Light*>& getLightList() const
+        inline const std::vector<Light*>& getLightList() const
         {
             return LightList_;
         }
-        inline const std::list<Camera*>& getCameraList() const
+        inline const std::vector<Camera*>& getCameraList() const
         {
             return CameraList_;
         }
-        inline const std::list<SceneNode*>& getNodeList() const
+        inline const std::vector<SceneNode*>& getNodeList() const
         {
             return NodeList_;
         }
@@ -357,12 +415,26 @@ class SP_EXPORT SceneManager
         
     private:
         
+        friend class SceneNode;
+        
+        /* === Functions === */
+        
+        void addNameIndex(SceneNode* Object);
+        bool removeNameIndex(SceneNode* Object);
+        
+        void updateNodeName(SceneNode* Object, const io::stringc &Name);
+        
+        void removeSpatialIndex(SceneNode* Object);
+        
+        static u32 getNameHash(const io::stringc &Name);
+        static dim::aabbox3df getNodeBox(const SceneNode* Node);
+        
         /* === Templates === */
         
         template <class T> void addChildToList(
-            const Node* ParentNode, std::list<SceneNode*> &NodeList, const std::list<T*> &SearchList) const
+            const Node* ParentNode, std::list<SceneNode*> &NodeList, const std::vector<T*> &SearchList) const
         {
-            for (typename std::list< T*, std::allocator<T*> >::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
+            for (typename std::vector<T*>::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
             {
                 if ((*it)->getParent() == ParentNode)
                     NodeList.push_back(*it);
@@ -370,9 +442,9 @@ class SP_EXPORT SceneManager
         }
         
         template <class T> SceneNode* findChildInList(
-            const SceneNode* ParentNode, const std::list<T*> &SearchList, const io::stringc &Name) const
+            const SceneNode* ParentNode, const std::vector<T*> &SearchList, const io::stringc &Name) const
         {
-            for (typename std::list< T*, std::allocator<T*> >::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
+            for (typename std::vector<T*>::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
             {
                 if ((*it)->getParent() == ParentNode && (*it)->getName() == Name)
                     return *it;
@@ -381,58 +453,95 @@ class SP_EXPORT SceneManager
             return 0;
         }
         
-        template <class T> void filterNodeByName(
-            const io::stringc &Name, std::list<SceneNode*> &NodeList, const std::list<T*> &SearchList) const
+        template <class T> T* addSceneNode(std::vector<T*> &NodeList, T* Object)
         {
-            for (typename std::list< T*, std::allocator<T*> >::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
-            {
-                if ((*it)->getName() == Name)
-                    NodeList.push_back(*it);
-            }
+            /* Some loaders already create their meshes with the scene manager */
+            if (Object->ManagerSlot_ < NodeList.size() && NodeList[Object->ManagerSlot_] == Object)
+                return Object;
+            
+            Object->ManagerSlot_ = NodeList.size();
+            NodeList.push_back(Object);
+            
+            addNameIndex(Object);
+            
+            return Object;
         }
         
-        template <class T> SceneNode* findNodeInList(
-            const io::stringc &Name, const std::list<T*> &SearchList) const
+        template <class T> T* copySceneNode(std::vector<T*> &NodeList, const T* TemplateObject)
         {
-            for (typename std::list< T*, std::allocator<T*> >::const_iterator it = SearchList.begin(); it != SearchList.end(); ++it)
-            {
-                if ((*it)->getName() == Name)
-                    return *it;
-            }
-            
+            if (TemplateObject)
+                return addSceneNode(NodeList, TemplateObject->copy());
             return 0;
         }
         
-        template <class T> T* copySceneNode(std::list<T*> &NodeList, const T* TemplateObject)
+        template <class T> bool deleteSceneNode(std::vector<T*> &NodeList, T* Object)
         {
-            if (TemplateObject)
+            const u32 Slot = Object->ManagerSlot_;
+            
+            if (Slot >= NodeList.size() || NodeList[Slot] != Object)
+                return false;
+            
+            /* Swap with the last node and pop */
+            NodeList[Slot] = NodeList.back();
+            NodeList[Slot]->ManagerSlot_ = Slot;
+            NodeList.pop_back();
+            
+            removeNameIndex(Object);
+            removeSpatialIndex(Object);
+            
+            MemoryManager::deleteMemory(Object);
+            
+            return true;
+        }
+        
+        template <class T> void deleteNodeList(std::vector<T*> &NodeList)
+        {
+            for (typename std::vector<T*>::iterator it = NodeList.begin(); it != NodeList.end(); ++it)
             {
-                T* NewObject = TemplateObject->copy();
-                NodeList.push_back(NewObject);
-                return NewObject;
+                removeNameIndex(*it);
+                removeSpatialIndex(*it);
             }
-            return 0;
+            MemoryManager::deleteList(NodeList);
         }
         
-        template <class T> void deleteSceneNode(std::list<T*> &NodeList, T* Object)
+        template <class T> void updateSpatialList(const std::vector<T*> &NodeList)
         {
-            MemoryManager::removeElement(NodeList, Object, true);
+            for (typename std::vector<T*>::const_iterator it = NodeList.begin(); it != NodeList.end(); ++it)
+            {
+                SceneNode* Node = *it;
+                const dim::aabbox3df Box(getNodeBox(Node));
+                
+                if (Node->SpatialProxy_ < 0)
+                    Node->SpatialProxy_ = SpatialIndex_.createProxy(Box, Node);
+                else
+                    SpatialIndex_.moveProxy(Node->SpatialProxy_, Box);
+                
+                if (static_cast<u32>(Node->SpatialProxy_) >= SpatialBoxes_.size())
+                    SpatialBoxes_.resize(Node->SpatialProxy_ + 1);
+                SpatialBoxes_[Node->SpatialProxy_] = Box;
+            }
         }
         
         /* === Members === */
         
-        std::list<SceneNode*>   NodeList_;
+        std::vector<SceneNode*> NodeList_;
         
-        std::list<Mesh*>        MeshList_;
-        std::list<Billboard*>   BillboardList_;
-        std::list<Terrain*>     TerrainList_;
-        std::list<Camera*>      CameraList_;
-        std::list<Light*>       LightList_;
+        std::vector<Mesh*>      MeshList_;
+        std::vector<Billboard*> BillboardList_;
+        std::vector<Terrain*>   TerrainList_;
+        std::vector<Camera*>    CameraList_;
+        std::vector<Light*>     LightList_;
         
         std::list<Animation*>   AnimationList_;
         
         std::map<std::string, Mesh*> MeshMap_;
         
+        std::multimap<u32, SceneNode*> NameIndex_;
+        
+        DynamicAABBTree SpatialIndex_;
+        std::vector<dim::aabbox3df> SpatialBoxes_;  //!< Exact global boxes of the proxies (by proxy ID).
+        mutable std::vector<void*> QueryResults_;
+        
         static const video::VertexFormat* DefaultVertexFormat_;
         static video::ERendererDataTypes DefaultIndexFormat_;
         
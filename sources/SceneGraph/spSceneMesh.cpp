@@ -81,6 +81,26 @@ Mesh::~Mesh()
     MemoryManager::deleteList(OrigSurfaceList_);
 }
 
+static MemoryPool& getMeshPool()
+{
+    static MemoryPool Pool("scene::Mesh", sizeof(Mesh));
+    return Pool;
+}
+
+void* Mesh::operator new(size_t Size)
+{
+    return getMeshPool().allocate(Size);
+}
+void Mesh::operator delete(void* Ptr, size_t Size)
+{
+    getMeshPool().release(Ptr, Size);
+}
+
+SMemoryPoolStats Mesh::getMemoryPoolStats()
+{
+    return getMeshPool().getStats();
+}
+
 bool Mesh::compareMeshBuffers(const Mesh* Other) const
 {
     /* Compare order */
@@ -411,6 +431,11 @@ void Mesh::setLODDistance(f32 Distance)
     LODSubMeshDistance_ = math::Abs(Distance);
 }
 
+void Mesh::setLODScreenSizes(const std::vector<f32> &ScreenSizes)
+{
+    LODScreenSizes_ = ScreenSizes;
+}
+
 void Mesh::setLOD(bool Enable)
 {
     UseLODSubMeshes_ = Enable;
@@ -771,7 +796,7 @@ Mesh* Mesh::copy() const
 
 void Mesh::copyMesh(Mesh* NewMesh) const // !ANY ERROR DETECTED! (when copying meshes)
 {
-    /* Copy mesh surfaces */
+    /* Copy mesh surfaces (the geometry and hardware buffers are shared until a surface is modified) */
     NewMesh->SurfaceList_->resize(SurfaceList_->size());
     
     for (u32 i = 0; i < SurfaceList_->size(); ++i)
@@ -783,6 +808,7 @@ void Mesh::copyMesh(Mesh* NewMesh) const // !ANY ERROR DETECTED! (when copying m
     
     NewMesh->UseLODSubMeshes_       = UseLODSubMeshes_;
     NewMesh->LODSubMeshDistance_    = LODSubMeshDistance_;
+    NewMesh->LODScreenSizes_        = LODScreenSizes_;
     NewMesh->LODSubMeshList_        = LODSubMeshList_;
     
     NewMesh->Material_.copy(&Material_);
@@ -804,13 +830,20 @@ void Mesh::render()
     
     if (GlbSceneGraph)
     {
-        /* Frustum culling */
-        if (GlbSceneGraph->getActiveCamera() && !BoundVolume_.checkFrustumCulling(GlbSceneGraph->getActiveCamera()->getViewFrustum(), spWorldMatrix))
+        /* Frustum culling (if not already done by the scene graph) */
+        if ( !GlbSceneGraph->hasPreCulling() && GlbSceneGraph->getActiveCamera() &&
+             !BoundVolume_.checkFrustumCulling(GlbSceneGraph->getActiveCamera()->getViewFrustum(), spWorldMatrix) )
+        {
             return;
+        }
         
         #if 1
         GlbSceneGraph->setActiveMesh(this); // !!! (only needed for Direct3D11 renderer)
         #endif
+        
+        /* Enable the light sources of this mesh */
+        if (GlbSceneGraph->getLightBinning())
+            GlbSceneGraph->setupNodeLights(this);
     }
     
     /* Update the render matrix */
@@ -855,7 +888,18 @@ u32 Mesh::updateLevelOfDetail()
         return 0;
     
     /* Compute LOD index */
-    const u32 LODIndex = static_cast<u32>(DepthDistance_ / LODSubMeshDistance_);
+    u32 LODIndex = 0;
+    
+    const f32 ScreenSize = (LODScreenSizes_.empty() ? -1.0f : getLODScreenSize());
+    
+    if (ScreenSize >= 0.0f)
+    {
+        while (LODIndex < LODScreenSizes_.size() && ScreenSize < LODScreenSizes_[LODIndex])
+            ++LODIndex;
+    }
+    else
+        LODIndex = static_cast<u32>(DepthDistance_ / LODSubMeshDistance_);
+    
     s32 SubMeshesIndex = static_cast<s32>(LODIndex) - 1;
     
     /* Clamp LOD index */
@@ -871,6 +915,39 @@ u32 Mesh::updateLevelOfDetail()
     return LODIndex;
 }
 
+f32 Mesh::getLODScreenSize() const
+{
+    const Camera* Cam = (GlbSceneGraph ? GlbSceneGraph->getActiveCamera() : 0);
+    
+    if (!Cam)
+        return -1.0f;
+    
+    /* Get the radius of the bounding volume in world space */
+    f32 Radius = 0.0f;
+    
+    switch (BoundVolume_.getType())
+    {
+        case BOUNDING_SPHERE:
+            Radius = BoundVolume_.getRadius();
+            break;
+        case BOUNDING_BOX:
+            Radius = (BoundVolume_.getBox().Max - BoundVolume_.getBox().Min).getLength() * 0.5f;
+            break;
+        default:
+            return -1.0f;
+    }
+    
+    Radius *= FinalWorldMatrix_.getScale().getMax();
+    
+    /* Project the diameter with the vertical scale of the projection matrix */
+    const f32 ProjScale = Cam->getProjection().getMatrixLH()[5];
+    
+    if (Cam->getOrtho())
+        return Radius * ProjScale;
+    
+    return Radius * ProjScale / math::Max(DepthDistance_, Cam->getRangeNear());
+}
+
 
 } // /namespace scene
 
@@ -241,6 +241,19 @@ class SP_EXPORT Mesh : public MaterialNode
         */
         void setLODDistance(f32 Distance);
         
+        /**
+        Sets the screen sizes for the LOD (level-of-detail) selection. If this list is not empty the LOD sub mesh is
+        selected by the projected size of the bounding volume instead of the camera distance.
+        The screen size is the diameter of the bounding volume relative to the viewport height
+        (e.g. 1.0 if the mesh fills the whole height).
+        \param[in] ScreenSizes Specifies the screen size for each LOD sub mesh in descending order. If the screen size
+        of the mesh is less than the i-th entry, the i-th or a later sub mesh is used. E.g. { 0.5, 0.25, 0.1 }.
+        \note This requires a bounding volume (see "getBoundingVolume"). Otherwise the camera distance is used.
+        \see MeshSimplifier::generateLODSubMeshes
+        \since Version 3.3
+        */
+        void setLODScreenSizes(const std::vector<f32> &ScreenSizes);
+        
         //! Enables or disables the LOD (level-of-detail) management.
         void setLOD(bool Enable);
         
@@ -326,7 +339,11 @@ class SP_EXPORT Mesh : public MaterialNode
         */
         void copy(const Mesh* Other);
         
-        //! Returns a pointer to a new Mesh object which has been copied by this Mesh.
+        /**
+        Returns a pointer to a new Mesh object which has been copied by this Mesh.
+        The mesh buffers of the copy share their vertex- and index data and their hardware buffers with this mesh
+        until they are modified (see video::MeshBuffer::hasSharedGeometry).
+        */
         Mesh* copy() const;
         
         /**
@@ -335,6 +352,15 @@ class SP_EXPORT Mesh : public MaterialNode
         */
         virtual void render();
         
+        /* === Static functions === */
+        
+        //! Allocates the memory for a new mesh from the mesh memory pool (see SceneNode::operator new).
+        static void* operator new(size_t Size);
+        static void operator delete(void* Ptr, size_t Size);
+        
+        //! Returns the occupancy statistics of the mesh memory pool.
+        static SMemoryPoolStats getMemoryPoolStats();
+        
         /* === Inline functions === */
         
         //! Returns the specified video::MeshBuffer object.
@@ -403,6 +429,11 @@ class SP_EXPORT Mesh : public MaterialNode
         {
             return LODSubMeshDistance_;
         }
+        //! Returns the screen sizes for the LOD selection. If the list is empty, the LOD distance is used.
+        inline const std::vector<f32>& getLODScreenSizes() const
+        {
+            return LODScreenSizes_;
+        }
         //! Returns status of the LOD management.
         inline bool getLOD() const
         {
@@ -441,12 +472,14 @@ class SP_EXPORT Mesh : public MaterialNode
         friend struct SCollisionSystemObject;
         friend struct SPickingObject;
         friend struct SCollisionObject;
+        friend class InstanceBatcher;
         
         friend bool cmpObjectMeshes(Mesh* &obj1, Mesh* &obj2);
         
         /* === Functions === */
         
         u32 updateLevelOfDetail();
+        f32 getLODScreenSize() const;
         
         void copyMesh(Mesh* NewMesh) const;
         
@@ -457,6 +490,7 @@ class SP_EXPORT Mesh : public MaterialNode
         
         bool UseLODSubMeshes_;
         f32 LODSubMeshDistance_;
+        std::vector<f32> LODScreenSizes_;
         std::vector<Mesh*> LODSubMeshList_;
         
         Mesh* Reference_;
@@ -6,7 +6,9 @@
  */
 
 #include "SceneGraph/spSceneNode.hpp"
+#include "SceneGraph/spSceneManager.hpp"
 #include "Platform/spSoftPixelDeviceOS.hpp"
+#include "Base/spSharedObjects.hpp"
 
 #include <boost/foreach.hpp>
 
@@ -30,9 +32,13 @@ dim::matrix4f spTextureMatrix[MAX_COUNT_OF_TEXTURES];
 
 
 SceneNode::SceneNode(const ENodeTypes Type) :
-    Node        (       ),
-    SceneParent_(0      ),
-    Type_       (Type   )
+    Node            (       ),
+    SceneParent_    (0      ),
+    Type_           (Type   ),
+    TransformIndex_ (~0u    ),
+    ListSlot_       (~0u    ),
+    ManagerSlot_    (~0u    ),
+    SpatialProxy_   (-1     )
 {
 }
 SceneNode::~SceneNode()
@@ -40,6 +46,30 @@ SceneNode::~SceneNode()
     clearAnimations();
 }
 
+/*
+The memory pools are created with the first allocation, so they also exist
+when scene nodes are created during the static initialization.
+*/
+static MemoryPool& getSceneNodePool()
+{
+    static MemoryPool Pool("scene::SceneNode", sizeof(SceneNode));
+    return Pool;
+}
+
+void* SceneNode::operator new(size_t Size)
+{
+    return getSceneNodePool().allocate(Size);
+}
+void SceneNode::operator delete(void* Ptr, size_t Size)
+{
+    getSceneNodePool().release(Ptr, Size);
+}
+
+SMemoryPoolStats SceneNode::getMemoryPoolStats()
+{
+    return getSceneNodePool().getStats();
+}
+
 
 /* === Detailed localisation === */
 
@@ -202,6 +232,12 @@ void SceneNode::updateTransformationBase(const dim::matrix4f &BaseMatrix)
     updateTransformation();
     FinalWorldMatrix_ = BaseMatrix * FinalWorldMatrix_;
 }
+void SceneNode::updateTransformationBase(const dim::matrix4f &BaseMatrix, const dim::matrix4f &WorldMatrix)
+{
+    FinalWorldMatrix_ = WorldMatrix;
+    alignTransformation();
+    FinalWorldMatrix_ = BaseMatrix * FinalWorldMatrix_;
+}
 
 void SceneNode::loadTransformation()
 {
@@ -225,6 +261,14 @@ SceneNode* SceneNode::copy() const
     return NewNode;
 }
 
+void SceneNode::setName(const io::stringc &Name)
+{
+    if (ManagerSlot_ != ~0u && gSharedObjects.SceneMngr)
+        gSharedObjects.SceneMngr->updateNodeName(this, Name);
+    else
+        BaseObject::setName(Name);
+}
+
 
 /* === Children === */
 
@@ -316,6 +360,11 @@ void SceneNode::copyRoot(SceneNode* NewNode) const
     NewNode->Type_              = Type_;
 }
 
+void SceneNode::alignTransformation()
+{
+    // do nothing
+}
+
 
 } // /namespace scene
 
@@ -17,6 +17,7 @@
 #include "Base/spNode.hpp"
 #include "Base/spMath.hpp"
 #include "Base/spTransformation3D.hpp"
+#include "Base/spMemoryPool.hpp"
 #include "SceneGraph/spBoundingVolume.hpp"
 #include "RenderSystem/spShaderProgram.hpp"
 
@@ -30,6 +31,12 @@ namespace scene
 
 
 class Animation;
+class TransformHierarchy;
+class FrustumCuller;
+class OcclusionCuller;
+class SceneGraphSimpleStream;
+class Sector;
+class SceneManager;
 
 /*
  * Global members
@@ -80,6 +87,12 @@ class SP_EXPORT SceneNode : public Node
         
         SceneNode* copy() const;
         
+        /**
+        Sets the node's name. If the node has been created by the SceneManager, its name index is updated.
+        \see SceneManager::findNode
+        */
+        virtual void setName(const io::stringc &Name);
+        
         /**
         Sets the object's position matrix.
         \param Position: Matrix which is to be used for the position transformation.
@@ -174,11 +187,36 @@ class SP_EXPORT SceneNode : public Node
         virtual void updateTransformation();
         virtual void updateTransformationBase(const dim::matrix4f &BaseMatrix);
         
+        /**
+        Updates the objects transformation with an already computed global world matrix.
+        This is used by the TransformHierarchy which caches the world matrices of all scene nodes.
+        \param[in] BaseMatrix Specifies the base matrix which is applied after the world matrix.
+        \param[in] WorldMatrix Specifies the global world matrix (without the base matrix).
+        \see TransformHierarchy
+        \since Version 3.3
+        */
+        void updateTransformationBase(const dim::matrix4f &BaseMatrix, const dim::matrix4f &WorldMatrix);
+        
         Transformation getTransformation(bool isGlobal) const;
         
         //! Loads the transformation into the render system which has been updated previously.
         virtual void loadTransformation();
         
+        /* === Static functions === */
+        
+        /**
+        Allocates the memory for a new scene node from the scene node memory pool. Derived classes with a different size
+        (e.g. Terrain or custom scene nodes) are allocated from the heap, unless they have their own memory pool
+        (Mesh, Light, Billboard and Camera).
+        \see MemoryPool
+        \since Version 3.3
+        */
+        static void* operator new(size_t Size);
+        static void operator delete(void* Ptr, size_t Size);
+        
+        //! Returns the occupancy statistics of the scene node memory pool.
+        static SMemoryPoolStats getMemoryPoolStats();
+        
         /* === Inline functions === */
         
         /**
@@ -366,11 +404,25 @@ class SP_EXPORT SceneNode : public Node
     protected:
         
         friend class Animation;
+        friend class TransformHierarchy;
+        friend class FrustumCuller;
+        friend class OcclusionCuller;
+        friend class LightGrid;
+        friend class SceneGraphSimpleStream;
+        friend class Sector;
+        friend class SceneManager;
         
         /* === Functions === */
         
         void copyRoot(SceneNode* NewNode) const;
         
+        /**
+        Finishes the final world matrix after it has been setup, e.g. the billboard alignment
+        or the depth distance for render nodes. By default nothing is done.
+        \since Version 3.3
+        */
+        virtual void alignTransformation();
+        
         /* === Members === */
         
         BoundingVolume BoundVolume_;
@@ -390,6 +442,11 @@ class SP_EXPORT SceneNode : public Node
         
         ENodeTypes Type_;
         
+        u32 TransformIndex_; //!< Entry index in the last TransformHierarchy this node was added to.
+        u32 ListSlot_;       //!< Index in the unsorted node storage of the SceneGraphSimpleStream this node was added to.
+        u32 ManagerSlot_;    //!< Index in the node list of the SceneManager.
+        s32 SpatialProxy_;   //!< Proxy ID in the spatial index of the SceneManager.
+        
 };
 
 
@@ -0,0 +1,675 @@
+/*
+ * Occlusion culler file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneOcclusionCuller.hpp"
+#include "SceneGraph/spSceneMesh.hpp"
+#include "SceneGraph/spSceneCamera.hpp"
+#include "Base/spMathRasterizer.hpp"
+#include "Base/spMathSIMD.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spTimer.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace sp
+{
+
+
+/*
+ * Internal members
+ */
+
+extern io::OSInformator* GlbPlatformInfo;
+
+namespace scene
+{
+
+
+/*
+ * Internal structures
+ */
+
+//! Minimal count of triangles for each thread in a rasterization pass.
+static const u32 OCCLUSION_MIN_TRIANGLES = 256;
+
+//! Minimal W coordinate of projected vertices. Triangles and boxes closer to the camera plane are not used.
+static const f32 OCCLUSION_NEAR_W = 0.001f;
+
+//! Maximal distance (in pixels) of projected occluder vertices to the screen center to avoid integer overflows in the rasterizer.
+static const f32 OCCLUSION_GUARD_BAND = 8192.0f;
+
+struct SOcclusionCullerThreadData
+{
+    const OcclusionCuller* Culler;
+    u32 Begin, End;
+    f32* DepthBuffer;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+struct SOcclusionTarget
+{
+    f32* DepthBuffer;
+    s32 Width;
+};
+
+
+/*
+ * Internal functions
+ */
+
+THREAD_PROC(OcclusionCullerThreadProc)
+{
+    SOcclusionCullerThreadData* ThreadData = reinterpret_cast<SOcclusionCullerThreadData*>(Arguments);
+    
+    /* Rasterize the range of triangles given to this thread into its own depth buffer */
+    ThreadData->Culler->rasterizeTriangles(ThreadData->Begin, ThreadData->End, ThreadData->DepthBuffer);
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+
+/*
+ * SOccluderVertex structure
+ */
+
+OcclusionCuller::SOccluderVertex& OcclusionCuller::SOccluderVertex::operator += (const SOccluderVertex &Other)
+{
+    X += Other.X; Y += Other.Y; Depth += Other.Depth;
+    return *this;
+}
+OcclusionCuller::SOccluderVertex& OcclusionCuller::SOccluderVertex::operator -= (const SOccluderVertex &Other)
+{
+    X -= Other.X; Y -= Other.Y; Depth -= Other.Depth;
+    return *this;
+}
+OcclusionCuller::SOccluderVertex& OcclusionCuller::SOccluderVertex::operator *= (f32 Factor)
+{
+    X *= Factor; Y *= Factor; Depth *= Factor;
+    return *this;
+}
+OcclusionCuller::SOccluderVertex& OcclusionCuller::SOccluderVertex::operator /= (f32 Factor)
+{
+    X /= Factor; Y /= Factor; Depth /= Factor;
+    return *this;
+}
+
+s32 OcclusionCuller::SOccluderVertex::getScreenCoordX() const
+{
+    return static_cast<s32>(std::floor(X + 0.5f));
+}
+s32 OcclusionCuller::SOccluderVertex::getScreenCoordY() const
+{
+    return static_cast<s32>(std::floor(Y + 0.5f));
+}
+
+
+/*
+ * OcclusionCuller class
+ */
+
+OcclusionCuller::OcclusionCuller() :
+    Resolution_         (256, 128   ),
+    ThreadCount_        (0          ),
+    IsRendered_         (false      ),
+    NumOccludedNodes_   (0          )
+{
+}
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+bool OcclusionCuller::addOccluder(Mesh* Obj)
+{
+    if (!Obj || std::find(Occluders_.begin(), Occluders_.end(), Obj) != Occluders_.end())
+        return false;
+    Occluders_.push_back(Obj);
+    return true;
+}
+
+void OcclusionCuller::removeOccluder(Mesh* Obj)
+{
+    std::vector<Mesh*>::iterator it = std::find(Occluders_.begin(), Occluders_.end(), Obj);
+    if (it != Occluders_.end())
+        Occluders_.erase(it);
+}
+
+void OcclusionCuller::clearOccluders()
+{
+    Occluders_.clear();
+    Vertices_.clear();
+    VertexValid_.clear();
+    Triangles_.clear();
+    IsRendered_ = false;
+}
+
+void OcclusionCuller::renderOccluders(const dim::matrix4f &ViewProjection)
+{
+    ViewProjection_ = ViewProjection;
+    
+    /* Project the vertices of all occluders and collect the triangles which are on the screen */
+    Vertices_.clear();
+    VertexValid_.clear();
+    Triangles_.clear();
+    
+    foreach (Mesh* Obj, Occluders_)
+    {
+        const dim::matrix4f Matrix(ViewProjection * Obj->getTransformMatrix(true));
+        
+        foreach (video::MeshBuffer* Surface, Obj->getMeshBufferList())
+        {
+            if (Surface->getPrimitiveType() == video::PRIMITIVE_TRIANGLES)
+                projectSurface(Surface, Matrix);
+        }
+    }
+    
+    /* Setup the levels of the hierarchical-Z pyramid */
+    u32 NumLevels = 1;
+    
+    for (dim::size2di Size(Resolution_); Size.Width > 1 || Size.Height > 1; ++NumLevels)
+    {
+        Size.Width  = (Size.Width + 1) / 2;
+        Size.Height = (Size.Height + 1) / 2;
+    }
+    
+    Levels_.resize(NumLevels);
+    
+    dim::size2di Size(Resolution_);
+    
+    foreach (SHiZLevel &Level, Levels_)
+    {
+        Level.Size = Size;
+        Level.Depth.resize(Size.Width * Size.Height);
+        
+        Size.Width  = (Size.Width + 1) / 2;
+        Size.Height = (Size.Height + 1) / 2;
+    }
+    
+    /* Clear the depth buffer */
+    std::vector<f32>& DepthBuffer = Levels_.front().Depth;
+    std::fill(DepthBuffer.begin(), DepthBuffer.end(), std::numeric_limits<f32>::max());
+    
+    /* Determine the count of threads */
+    const u32 NumTriangles = Triangles_.size() / 3;
+    
+    u32 ThreadCount = ThreadCount_;
+    
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Min(ThreadCount, (NumTriangles + OCCLUSION_MIN_TRIANGLES - 1) / OCCLUSION_MIN_TRIANGLES);
+    
+    if (ThreadCount <= 1)
+        rasterizeTriangles(0, NumTriangles, &DepthBuffer[0]);
+    else
+    {
+        const u32 BlockSize = (NumTriangles + ThreadCount - 1) / ThreadCount;
+        
+        s32 NumRunningThreads = 0;
+        CriticalSection Mutex;
+        
+        std::vector<SOcclusionCullerThreadData> ThreadDataList(ThreadCount - 1);
+        
+        ThreadBuffers_.resize(ThreadCount - 1);
+        
+        typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+        std::vector<ThreadManagerPtr> Threads;
+        
+        /* Start worker threads for all ranges except the first one, each with its own depth buffer */
+        u32 NumThreadBuffers = 0;
+        
+        for (u32 Begin = BlockSize; NumThreadBuffers + 1 < ThreadCount && Begin < NumTriangles; Begin += BlockSize)
+        {
+            std::vector<f32>& ThreadBuffer = ThreadBuffers_[NumThreadBuffers];
+            ThreadBuffer.assign(DepthBuffer.size(), std::numeric_limits<f32>::max());
+            
+            SOcclusionCullerThreadData& ThreadData = ThreadDataList[NumThreadBuffers++];
+            
+            ThreadData.Culler               = this;
+            ThreadData.Begin                = Begin;
+            ThreadData.End                  = math::Min(Begin + BlockSize, NumTriangles);
+            ThreadData.DepthBuffer          = (&ThreadBuffer[0]);
+            ThreadData.NumRunningThreads    = (&NumRunningThreads);
+            ThreadData.Mutex                = (&Mutex);
+            
+            Mutex.lock();
+            ++NumRunningThreads;
+            Mutex.unlock();
+            
+            Threads.push_back(boost::make_shared<ThreadManager>(OcclusionCullerThreadProc, &ThreadData));
+        }
+        
+        /* Process the first range in the calling thread */
+        rasterizeTriangles(0, BlockSize, &DepthBuffer[0]);
+        
+        /* Wait until all threads are finished */
+        while (1)
+        {
+            Mutex.lock();
+            const bool Finished = (NumRunningThreads <= 0);
+            Mutex.unlock();
+            
+            if (Finished)
+                break;
+            
+            io::Timer::yield();
+        }
+        
+        /* Merge the depth buffers of the other threads (the buffer size is a multiple of 4) */
+        for (u32 i = 0; i < NumThreadBuffers; ++i)
+        {
+            const f32* Src = &(ThreadBuffers_[i][0]);
+            f32* Dest = &DepthBuffer[0];
+            
+            for (u32 j = 0, Num = DepthBuffer.size(); j < Num; j += 4)
+                math::float4::min(math::float4::load(Dest + j), math::float4::load(Src + j)).store(Dest + j);
+        }
+    }
+    
+    /* Build the hierarchical-Z pyramid */
+    buildHiZ();
+    
+    IsRendered_ = true;
+}
+
+void OcclusionCuller::renderOccluders(const Camera* Cam)
+{
+    if (Cam)
+    {
+        dim::matrix4f ViewProjection(Cam->getProjection().getMatrixLH());
+        ViewProjection *= Cam->getTransformation(true).getInverseMatrix();
+        renderOccluders(ViewProjection);
+    }
+}
+
+bool OcclusionCuller::isOccluded(const dim::aabbox3df &Box, const dim::matrix4f &WorldMatrix) const
+{
+    if (!IsRendered_)
+        return false;
+    
+    const dim::matrix4f Matrix(ViewProjection_ * WorldMatrix);
+    
+    /* Store the 8 box corners in SoA layout */
+    f32 Corners[3][8];
+    
+    for (s32 i = 0; i < 8; ++i)
+    {
+        Corners[0][i] = ((i & 1) ? Box.Max.X : Box.Min.X);
+        Corners[1][i] = ((i & 2) ? Box.Max.Y : Box.Min.Y);
+        Corners[2][i] = ((i & 4) ? Box.Max.Z : Box.Min.Z);
+    }
+    
+    /* Project 4 corners at once and determine the screen bounds and the nearest depth */
+    math::float4 MinX(std::numeric_limits<f32>::max()), MaxX(-std::numeric_limits<f32>::max());
+    math::float4 MinY(std::numeric_limits<f32>::max()), MaxY(-std::numeric_limits<f32>::max());
+    math::float4 MinDepth(std::numeric_limits<f32>::max());
+    
+    for (s32 i = 0; i < 8; i += 4)
+    {
+        const math::float4 X(math::float4::load(Corners[0] + i));
+        const math::float4 Y(math::float4::load(Corners[1] + i));
+        const math::float4 Z(math::float4::load(Corners[2] + i));
+        
+        const math::float4 W(
+            X*math::float4(Matrix[3]) + Y*math::float4(Matrix[7]) + Z*math::float4(Matrix[11]) + math::float4(Matrix[15])
+        );
+        
+        /* Boxes which intersect the camera plane are always visible */
+        if ((W <= math::float4(OCCLUSION_NEAR_W)).getMask())
+            return false;
+        
+        const math::float4 PX(
+            (X*math::float4(Matrix[0]) + Y*math::float4(Matrix[4]) + Z*math::float4(Matrix[ 8]) + math::float4(Matrix[12])) / W
+        );
+        const math::float4 PY(
+            (X*math::float4(Matrix[1]) + Y*math::float4(Matrix[5]) + Z*math::float4(Matrix[ 9]) + math::float4(Matrix[13])) / W
+        );
+        const math::float4 PZ(
+            (X*math::float4(Matrix[2]) + Y*math::float4(Matrix[6]) + Z*math::float4(Matrix[10]) + math::float4(Matrix[14])) / W
+        );
+        
+        MinX        = math::float4::min(MinX, PX);
+        MaxX        = math::float4::max(MaxX, PX);
+        MinY        = math::float4::min(MinY, PY);
+        MaxY        = math::float4::max(MaxY, PY);
+        MinDepth    = math::float4::min(MinDepth, PZ);
+    }
+    
+    f32 Bounds[5][4];
+    
+    MinX.store(Bounds[0]);
+    MaxX.store(Bounds[1]);
+    MinY.store(Bounds[2]);
+    MaxY.store(Bounds[3]);
+    MinDepth.store(Bounds[4]);
+    
+    for (s32 i = 1; i < 4; ++i)
+    {
+        Bounds[0][0] = math::Min(Bounds[0][0], Bounds[0][i]);
+        Bounds[1][0] = math::Max(Bounds[1][0], Bounds[1][i]);
+        Bounds[2][0] = math::Min(Bounds[2][0], Bounds[2][i]);
+        Bounds[3][0] = math::Max(Bounds[3][0], Bounds[3][i]);
+        Bounds[4][0] = math::Min(Bounds[4][0], Bounds[4][i]);
+    }
+    
+    /* Convert the bounds to texel coordinates (enlarged by one texel against rounding errors of the rasterizer) */
+    const f32 HalfWidth     = static_cast<f32>(Resolution_.Width) * 0.5f;
+    const f32 HalfHeight    = static_cast<f32>(Resolution_.Height) * 0.5f;
+    
+    const f32 Left      = (Bounds[0][0] + 1.0f) * HalfWidth - 1.0f;
+    const f32 Right     = (Bounds[1][0] + 1.0f) * HalfWidth + 1.0f;
+    const f32 Top       = (1.0f - Bounds[3][0]) * HalfHeight - 1.0f;
+    const f32 Bottom    = (1.0f - Bounds[2][0]) * HalfHeight + 1.0f;
+    
+    /* Boxes which are not on the screen are left to the frustum culling */
+    if ( Right < 0.0f || Bottom < 0.0f ||
+         Left >= static_cast<f32>(Resolution_.Width) || Top >= static_cast<f32>(Resolution_.Height) )
+    {
+        return false;
+    }
+    
+    s32 x0 = static_cast<s32>(math::Max(0.0f, Left));
+    s32 y0 = static_cast<s32>(math::Max(0.0f, Top));
+    s32 x1 = static_cast<s32>(math::Min(static_cast<f32>(Resolution_.Width  - 1), Right));
+    s32 y1 = static_cast<s32>(math::Min(static_cast<f32>(Resolution_.Height - 1), Bottom));
+    
+    /* Select the pyramid level where the rectangle covers at most 2x2 texels */
+    u32 LevelIndex = 0;
+    
+    while ((x1 - x0 > 1 || y1 - y0 > 1) && LevelIndex + 1 < Levels_.size())
+    {
+        x0 >>= 1; y0 >>= 1;
+        x1 >>= 1; y1 >>= 1;
+        ++LevelIndex;
+    }
+    
+    const SHiZLevel& Level = Levels_[LevelIndex];
+    
+    /* The box is occluded if its nearest depth is behind the farthest occluder depth of the rectangle */
+    for (s32 y = y0; y <= y1; ++y)
+    {
+        for (s32 x = x0; x <= x1; ++x)
+        {
+            if (Bounds[4][0] <= Level.Depth[y*Level.Size.Width + x])
+                return false;
+        }
+    }
+    
+    return true;
+}
+
+u32 OcclusionCuller::cull(const std::vector<RenderNode*> &NodeList, std::vector<u32> &VisibleIndices)
+{
+    u32 Num = 0;
+    
+    foreach (u32 Index, VisibleIndices)
+    {
+        if (!isNodeOccluded(NodeList[Index]))
+            VisibleIndices[Num++] = Index;
+    }
+    
+    NumOccludedNodes_ = VisibleIndices.size() - Num;
+    VisibleIndices.resize(Num);
+    
+    return Num;
+}
+
+u32 OcclusionCuller::cull(std::vector<RenderNode*> &NodeList)
+{
+    u32 Num = 0;
+    
+    foreach (RenderNode* Node, NodeList)
+    {
+        if (!isNodeOccluded(Node))
+            NodeList[Num++] = Node;
+    }
+    
+    NumOccludedNodes_ = NodeList.size() - Num;
+    NodeList.resize(Num);
+    
+    return Num;
+}
+
+const f32* OcclusionCuller::getDepthBuffer(u32 Level, dim::size2di &Size) const
+{
+    if (Level < getLevelCount())
+    {
+        Size = Levels_[Level].Size;
+        return &(Levels_[Level].Depth[0]);
+    }
+    Size = dim::size2di(0, 0);
+    return 0;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void OcclusionCuller::projectSurface(const video::MeshBuffer* Surface, const dim::matrix4f &Matrix)
+{
+    const u32 NumVertices   = Surface->getVertexCount();
+    const u32 FirstVertex   = Vertices_.size();
+    
+    Vertices_.resize(FirstVertex + NumVertices);
+    VertexValid_.resize(FirstVertex + NumVertices);
+    
+    /* Broadcast the matrix and the viewport */
+    math::float4 M[16];
+    
+    for (s32 i = 0; i < 16; ++i)
+        M[i] = math::float4(Matrix[i]);
+    
+    const math::float4 HalfWidth(static_cast<f32>(Resolution_.Width) * 0.5f);
+    const math::float4 HalfHeight(static_cast<f32>(Resolution_.Height) * 0.5f);
+    const math::float4 One(1.0f);
+    const math::float4 NearW(OCCLUSION_NEAR_W);
+    const math::float4 GuardBand(OCCLUSION_GUARD_BAND);
+    
+    /* Project 4 vertices at once */
+    for (u32 i = 0; i < NumVertices; i += 4)
+    {
+        f32 Coords[3][4] = { { 0 } };
+        
+        const u32 Num = math::Min(4u, NumVertices - i);
+        
+        for (u32 j = 0; j < Num; ++j)
+        {
+            const dim::vector3df Coord(Surface->getVertexCoord(i + j));
+            Coords[0][j] = Coord.X;
+            Coords[1][j] = Coord.Y;
+            Coords[2][j] = Coord.Z;
+        }
+        
+        const math::float4 X(math::float4::load(Coords[0]));
+        const math::float4 Y(math::float4::load(Coords[1]));
+        const math::float4 Z(math::float4::load(Coords[2]));
+        
+        const math::float4 W(X*M[3] + Y*M[7] + Z*M[11] + M[15]);
+        const math::float4 ValidW(W > NearW);
+        
+        /* Vertices behind the camera plane get W = 1 to avoid invalid divisions, they are marked as invalid anyway */
+        const math::float4 InvW(One / math::float4::select(ValidW, W, One));
+        
+        const math::float4 ScreenX(((X*M[0] + Y*M[4] + Z*M[ 8] + M[12])*InvW + One) * HalfWidth);
+        const math::float4 ScreenY((One - (X*M[1] + Y*M[5] + Z*M[ 9] + M[13])*InvW) * HalfHeight);
+        const math::float4 Depth((X*M[2] + Y*M[6] + Z*M[10] + M[14])*InvW);
+        
+        const s32 ValidMask = (
+            ValidW &
+            (math::float4::abs(ScreenX - HalfWidth) < GuardBand) &
+            (math::float4::abs(ScreenY - HalfHeight) < GuardBand)
+        ).getMask();
+        
+        f32 Result[3][4];
+        
+        ScreenX.store(Result[0]);
+        ScreenY.store(Result[1]);
+        Depth.store(Result[2]);
+        
+        for (u32 j = 0; j < Num; ++j)
+        {
+            SOccluderVertex& Vertex = Vertices_[FirstVertex + i + j];
+            
+            Vertex.X        = Result[0][j];
+            Vertex.Y        = Result[1][j];
+            Vertex.Depth    = Result[2][j];
+            
+            VertexValid_[FirstVertex + i + j] = ((ValidMask & (1 << j)) != 0);
+        }
+    }
+    
+    /* Store the triangles whose vertices are all valid and which overlap the screen */
+    const f32 Width     = static_cast<f32>(Resolution_.Width);
+    const f32 Height    = static_cast<f32>(Resolution_.Height);
+    
+    u32 Indices[3];
+    
+    for (u32 i = 0, Num = Surface->getTriangleCount(); i < Num; ++i)
+    {
+        Surface->getTriangleIndices(i, Indices);
+        
+        if ( Indices[0] >= NumVertices || Indices[1] >= NumVertices || Indices[2] >= NumVertices ||
+             !VertexValid_[FirstVertex + Indices[0]] ||
+             !VertexValid_[FirstVertex + Indices[1]] ||
+             !VertexValid_[FirstVertex + Indices[2]] )
+        {
+            continue;
+        }
+        
+        const SOccluderVertex& A = Vertices_[FirstVertex + Indices[0]];
+        const SOccluderVertex& B = Vertices_[FirstVertex + Indices[1]];
+        const SOccluderVertex& C = Vertices_[FirstVertex + Indices[2]];
+        
+        if ( math::Max(A.X, math::Max(B.X, C.X)) < 0.0f || math::Min(A.X, math::Min(B.X, C.X)) >= Width ||
+             math::Max(A.Y, math::Max(B.Y, C.Y)) < 0.0f || math::Min(A.Y, math::Min(B.Y, C.Y)) >= Height )
+        {
+            continue;
+        }
+        
+        for (s32 j = 0; j < 3; ++j)
+            Triangles_.push_back(FirstVertex + Indices[j]);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangles(u32 Begin, u32 End, f32* DepthBuffer) const
+{
+    const boost::function<void (s32 x, s32 y, const SOccluderVertex &Vertex, void* UserData)> Callback(
+        OcclusionCuller::renderPixel
+    );
+    
+    SOcclusionTarget Target;
+    {
+        Target.DepthBuffer  = DepthBuffer;
+        Target.Width        = Resolution_.Width;
+    }
+    
+    const dim::rect2di ClipRect(0, 0, Resolution_.Width, Resolution_.Height);
+    
+    for (u32 i = Begin * 3, Num = math::Min(End * 3, static_cast<u32>(Triangles_.size())); i < Num; i += 3)
+    {
+        math::Rasterizer::rasterizeTriangle<SOccluderVertex>(
+            Callback,
+            Vertices_[Triangles_[i    ]],
+            Vertices_[Triangles_[i + 1]],
+            Vertices_[Triangles_[i + 2]],
+            &Target, &ClipRect
+        );
+    }
+}
+
+void OcclusionCuller::renderPixel(s32 x, s32 y, const SOccluderVertex &Vertex, void* UserData)
+{
+    SOcclusionTarget* Target = reinterpret_cast<SOcclusionTarget*>(UserData);
+    
+    f32& Depth = Target->DepthBuffer[y*Target->Width + x];
+    
+    if (Vertex.Depth < Depth)
+        Depth = Vertex.Depth;
+}
+
+void OcclusionCuller::buildHiZ()
+{
+    std::vector<f32> Row(Resolution_.Width);
+    
+    for (u32 i = 1; i < Levels_.size(); ++i)
+    {
+        const SHiZLevel& Src = Levels_[i - 1];
+        SHiZLevel& Dest = Levels_[i];
+        
+        const s32 SrcWidth = Src.Size.Width;
+        
+        for (s32 y = 0; y < Dest.Size.Height; ++y)
+        {
+            /* Take the farthest depth of two source rows (4 texels at once) */
+            const f32* Row0 = &Src.Depth[(y*2)*SrcWidth];
+            const f32* Row1 = (y*2 + 1 < Src.Size.Height ? Row0 + SrcWidth : Row0);
+            
+            s32 x = 0;
+            
+            for (; x + 4 <= SrcWidth; x += 4)
+                math::float4::max(math::float4::load(Row0 + x), math::float4::load(Row1 + x)).store(&Row[x]);
+            
+            for (; x < SrcWidth; ++x)
+                Row[x] = math::Max(Row0[x], Row1[x]);
+            
+            /* Take the farthest depth of two columns */
+            f32* DestRow = &Dest.Depth[y*Dest.Size.Width];
+            
+            for (x = 0; x < Dest.Size.Width; ++x)
+                DestRow[x] = math::Max(Row[x*2], Row[math::Min(x*2 + 1, SrcWidth - 1)]);
+        }
+    }
+}
+
+bool OcclusionCuller::isNodeOccluded(const RenderNode* Node) const
+{
+    const BoundingVolume& Bounds = Node->getBoundingVolume();
+    
+    switch (Bounds.getType())
+    {
+        case BOUNDING_BOX:
+            return isOccluded(Bounds.getBox(), Node->FinalWorldMatrix_);
+        
+        case BOUNDING_SPHERE:
+        {
+            /* Test the bounding box of the sphere at the node's position (like the frustum culler) */
+            const dim::vector3df Radius(Bounds.getRadius());
+            
+            dim::matrix4f Matrix;
+            Matrix.setPosition(Node->FinalWorldMatrix_.getPosition());
+            
+            return isOccluded(dim::aabbox3df(-Radius, Radius), Matrix);
+        }
+        
+        default:
+            break;
+    }
+    
+    return false;
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
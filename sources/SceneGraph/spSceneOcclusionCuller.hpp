@@ -0,0 +1,243 @@
+/*
+ * Occlusion culler header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_OCCLUSION_CULLER_H__
+#define __SP_SCENE_OCCLUSION_CULLER_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimension.hpp"
+#include "Base/spThreadManager.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace video
+{
+    class MeshBuffer;
+}
+namespace scene
+{
+
+
+class RenderNode;
+class Mesh;
+class Camera;
+
+/**
+The occlusion culler is a software culling stage which runs after the frustum culling. Each frame the triangles of
+the designated occluder meshes (e.g. large walls and terrain blocks) are rasterized on the CPU into a low-resolution
+depth buffer (see "math::Rasterizer::rasterizeTriangle"). The occluder vertices are transformed with SIMD instructions
+(see "math::float4") and the triangles are distributed over several threads, each with its own depth buffer, which are
+merged afterwards. From this depth buffer a hierarchical-Z pyramid is built where each texel stores the farthest depth of
+the underlying texels. Then the screen rectangle of each node's bounding box is tested against the pyramid level
+where it covers only a few texels, and the node is dropped if its nearest depth is behind the stored depth.
+Because nothing is rendered by the render system, the occlusion culler also works with the dummy render system.
+\code
+spScene->getOcclusionCuller().addOccluder(WallMesh);
+spScene->setOcclusionCulling(true);
+\endcode
+\note Occluders may be invisible (e.g. simplified occluder geometry) and are not culled by themselves.
+Render nodes with the bounding volume type BOUNDING_NONE are never occluded, and bounding spheres are tested with their bounding box.
+\see SceneGraph::setOcclusionCulling
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT OcclusionCuller
+{
+    
+    public:
+        
+        OcclusionCuller();
+        ~OcclusionCuller();
+        
+        /* === Functions === */
+        
+        /**
+        Adds the specified mesh to the occluder list. Only mesh buffers which consist of triangle lists are rasterized.
+        \return False if the mesh is null or has already been added.
+        \note The scene graph removes its occluders when they are removed or deleted with "SceneGraph::removeSceneNode"
+        or "SceneGraph::deleteNode". If the mesh is deleted in any other way (e.g. directly by the SceneManager),
+        it must be removed from the occluder list before.
+        */
+        bool addOccluder(Mesh* Obj);
+        //! Removes the specified mesh from the occluder list.
+        void removeOccluder(Mesh* Obj);
+        //! Removes all occluders and invalidates the depth buffer.
+        void clearOccluders();
+        
+        /**
+        Rasterizes all occluders into the depth buffer and builds the hierarchical-Z pyramid.
+        This must be called each frame before the render nodes are tested.
+        \param[in] ViewProjection Specifies the view-projection matrix (projection * inverse camera transformation).
+        The depth is the projected Z coordinate divided by W.
+        */
+        void renderOccluders(const dim::matrix4f &ViewProjection);
+        
+        /**
+        Rasterizes all occluders for the specified camera.
+        \see renderOccluders(const dim::matrix4f&)
+        */
+        void renderOccluders(const Camera* Cam);
+        
+        /**
+        Tests the specified bounding box against the hierarchical-Z pyramid of the last "renderOccluders" call.
+        \param[in] Box Specifies the bounding box in object space.
+        \param[in] WorldMatrix Specifies the world matrix of the object.
+        \return True if the box is completely behind the occluders. If the box intersects the near plane
+        or nothing has been rendered yet, the return value is false.
+        */
+        bool isOccluded(const dim::aabbox3df &Box, const dim::matrix4f &WorldMatrix) const;
+        
+        /**
+        Removes the occluded nodes from the specified index list.
+        \param[in] NodeList Specifies the render nodes. Their final world matrices must already be updated.
+        \param[in,out] VisibleIndices Specifies the indices of the nodes which are to be tested (e.g. from FrustumCuller::cull).
+        The order of the remaining indices is kept.
+        \return Count of remaining (not occluded) nodes.
+        */
+        u32 cull(const std::vector<RenderNode*> &NodeList, std::vector<u32> &VisibleIndices);
+        
+        /**
+        Removes the occluded nodes from the specified node list. The order of the remaining nodes is kept.
+        \return Count of remaining (not occluded) nodes.
+        */
+        u32 cull(std::vector<RenderNode*> &NodeList);
+        
+        /**
+        Returns the specified level of the hierarchical-Z pyramid. Level 0 is the depth buffer.
+        Empty texels have the maximal float value.
+        \param[in] Level Specifies the pyramid level. Must be less than "getLevelCount".
+        \param[out] Size Receives the resolution of the level.
+        \return Constant pointer to the depth values (row by row).
+        */
+        const f32* getDepthBuffer(u32 Level, dim::size2di &Size) const;
+        
+        /* === Inline functions === */
+        
+        /**
+        Sets the resolution of the depth buffer. The width is rounded up to a multiple of 4.
+        \param[in] Resolution Specifies the new resolution. By default 256 x 128.
+        */
+        inline void setResolution(const dim::size2di &Resolution)
+        {
+            Resolution_.Width   = (math::Max(4, Resolution.Width) + 3) & ~3;
+            Resolution_.Height  = math::Max(1, Resolution.Height);
+            IsRendered_         = false;
+        }
+        inline const dim::size2di& getResolution() const
+        {
+            return Resolution_;
+        }
+        
+        /**
+        Sets the count of threads for the rasterization.
+        \param[in] ThreadCount Specifies the count of threads. If 0 the count of processors is used. By default 0.
+        \note Each thread gets at least a few hundred triangles, so small occluder sets are always rasterized in the calling thread.
+        */
+        inline void setThreadCount(u32 ThreadCount)
+        {
+            ThreadCount_ = ThreadCount;
+        }
+        inline u32 getThreadCount() const
+        {
+            return ThreadCount_;
+        }
+        
+        inline const std::vector<Mesh*>& getOccluderList() const
+        {
+            return Occluders_;
+        }
+        
+        //! Returns the count of levels of the hierarchical-Z pyramid. This is 0 until the first "renderOccluders" call.
+        inline u32 getLevelCount() const
+        {
+            return IsRendered_ ? Levels_.size() : 0;
+        }
+        
+        //! Returns the count of occluder triangles which have been rasterized by the last "renderOccluders" call.
+        inline u32 getNumRasterizedTriangles() const
+        {
+            return Triangles_.size() / 3;
+        }
+        //! Returns the count of render nodes which have been removed by the last "cull" call.
+        inline u32 getNumOccludedNodes() const
+        {
+            return NumOccludedNodes_;
+        }
+        
+    private:
+        
+        friend THREAD_PROC(OcclusionCullerThreadProc);
+        
+        /* === Structures === */
+        
+        //! Projected occluder vertex for the rasterizer (see "math::RasterizerVertex").
+        struct SOccluderVertex
+        {
+            SOccluderVertex& operator += (const SOccluderVertex &Other);
+            SOccluderVertex& operator -= (const SOccluderVertex &Other);
+            SOccluderVertex& operator *= (f32 Factor);
+            SOccluderVertex& operator /= (f32 Factor);
+            
+            s32 getScreenCoordX() const;
+            s32 getScreenCoordY() const;
+            
+            f32 X, Y;   //!< Screen coordinates.
+            f32 Depth;  //!< Projected Z divided by W. This is linear in screen space.
+        };
+        
+        struct SHiZLevel
+        {
+            dim::size2di Size;
+            std::vector<f32> Depth;
+        };
+        
+        /* === Functions === */
+        
+        void projectSurface(const video::MeshBuffer* Surface, const dim::matrix4f &Matrix);
+        void rasterizeTriangles(u32 Begin, u32 End, f32* DepthBuffer) const;
+        
+        static void renderPixel(s32 x, s32 y, const SOccluderVertex &Vertex, void* UserData);
+        
+        void buildHiZ();
+        
+        bool isNodeOccluded(const RenderNode* Node) const;
+        
+        /* === Members === */
+        
+        std::vector<Mesh*> Occluders_;
+        
+        std::vector<SOccluderVertex> Vertices_;
+        std::vector<u8> VertexValid_;
+        std::vector<u32> Triangles_;
+        
+        std::vector<SHiZLevel> Levels_;
+        std::vector< std::vector<f32> > ThreadBuffers_;
+        
+        dim::matrix4f ViewProjection_;
+        dim::size2di Resolution_;
+        u32 ThreadCount_;
+        
+        bool IsRendered_;
+        u32 NumOccludedNodes_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
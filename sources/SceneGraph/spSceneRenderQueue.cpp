@@ -0,0 +1,340 @@
+/*
+ * Render queue file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneRenderQueue.hpp"
+#include "SceneGraph/spSceneGraph.hpp"
+#include "SceneGraph/spSceneMesh.hpp"
+#include "SceneGraph/spSceneBillboard.hpp"
+
+#include <boost/foreach.hpp>
+#include <cstring>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+/*
+ * Internal members
+ */
+
+/* Bit layout of the sort keys (from the highest to the lowest bits) */
+static const u32 RENDERQUEUE_LAYER_SHIFT        = 56;
+static const u64 RENDERQUEUE_TRANSLUCENT_BIT    = (u64(1) << 55);
+
+static const u32 RENDERQUEUE_SHADER_BITS        = 12;
+static const u32 RENDERQUEUE_MATERIAL_BITS      = 16;
+static const u32 RENDERQUEUE_TEXTURE_BITS       = 16;
+
+
+/*
+ * Internal functions
+ */
+
+static inline u32 hashCombine(u32 Hash, u32 Value)
+{
+    /* FNV-1a hash over the four bytes of the value */
+    for (s32 i = 0; i < 4; ++i)
+    {
+        Hash ^= (Value & 0xFF);
+        Hash *= 16777619u;
+        Value >>= 8;
+    }
+    return Hash;
+}
+
+static inline u32 hashPointer(u32 Hash, const void* Pointer)
+{
+    const size_t Value = reinterpret_cast<size_t>(Pointer);
+    
+    Hash = hashCombine(Hash, static_cast<u32>(Value));
+    
+    if (sizeof(size_t) > 4)
+        Hash = hashCombine(Hash, static_cast<u32>(static_cast<u64>(Value) >> 32));
+    
+    return Hash;
+}
+
+static inline u32 hashFloat(u32 Hash, f32 Value)
+{
+    u32 Bits;
+    memcpy(&Bits, &Value, sizeof(u32));
+    return hashCombine(Hash, Bits);
+}
+
+//! Folds the hash value into the specified count of bits.
+static inline u64 foldHash(u32 Hash, u32 NumBits)
+{
+    return static_cast<u64>((Hash ^ (Hash >> 16)) & ((1u << NumBits) - 1));
+}
+
+//! Returns the bits of a positive floating-point number which are monotonic to its value.
+static inline u32 getDepthBits(f32 Depth)
+{
+    if (!(Depth > 0.0f))
+        return 0;
+    
+    u32 Bits;
+    memcpy(&Bits, &Depth, sizeof(u32));
+    
+    return Bits;
+}
+
+//! Hashes all material states which are compared in "MaterialStates::compare".
+static u32 hashMaterialStates(const video::MaterialStates* Material)
+{
+    u32 Hash = 2166136261u;
+    
+    Hash = hashCombine(Hash, Material->getColorMaterial());
+    Hash = hashCombine(Hash, Material->getFog());
+    Hash = hashCombine(Hash, Material->getRenderFace());
+    Hash = hashCombine(Hash, Material->getWireframeFront());
+    Hash = hashCombine(Hash, Material->getWireframeBack());
+    Hash = hashCombine(Hash, Material->getLighting());
+    
+    if (Material->getLighting())
+    {
+        Hash = hashFloat(Hash, Material->getShininess());
+        Hash = hashCombine(Hash, Material->getDiffuseColor().getSingle());
+        Hash = hashCombine(Hash, Material->getAmbientColor().getSingle());
+        Hash = hashCombine(Hash, Material->getSpecularColor().getSingle());
+        Hash = hashCombine(Hash, Material->getEmissionColor().getSingle());
+    }
+    
+    Hash = hashCombine(Hash, Material->getBlending());
+    
+    if (Material->getBlending())
+    {
+        Hash = hashCombine(Hash, Material->getBlendSource());
+        Hash = hashCombine(Hash, Material->getBlendTarget());
+    }
+    
+    Hash = hashCombine(Hash, Material->getDepthBuffer());
+    Hash = hashCombine(Hash, Material->getDepthMethod());
+    Hash = hashCombine(Hash, Material->getPolygonOffset());
+    
+    if (Material->getPolygonOffset())
+    {
+        Hash = hashFloat(Hash, Material->getPolygonOffsetFactor());
+        Hash = hashFloat(Hash, Material->getPolygonOffsetUnits());
+    }
+    
+    Hash = hashCombine(Hash, Material->getAlphaMethod());
+    Hash = hashFloat(Hash, Material->getAlphaReference());
+    
+    return Hash;
+}
+
+//! Hashes the texture set of the specified material node.
+static u32 hashTextures(const MaterialNode* Node)
+{
+    u32 Hash = 2166136261u;
+    
+    switch (Node->getType())
+    {
+        case NODE_MESH:
+        {
+            foreach (video::MeshBuffer* Surface, static_cast<const Mesh*>(Node)->getMeshBufferList())
+            {
+                foreach (video::TextureLayer* TexLayer, Surface->getTextureLayerList())
+                    Hash = hashPointer(Hash, TexLayer->getTexture());
+            }
+        }
+        break;
+        
+        case NODE_BILLBOARD:
+            Hash = hashPointer(Hash, static_cast<const Billboard*>(Node)->getTexture());
+            break;
+        
+        default:
+            break;
+    }
+    
+    return Hash;
+}
+
+
+/*
+ * RenderQueue class
+ */
+
+RenderQueue::RenderQueue() :
+    NumStateChanges_        (0),
+    NumStateChangesSaved_   (0)
+{
+}
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::build(const std::vector<RenderNode*> &NodeList, const std::vector<u32>* Indices)
+{
+    Entries_.clear();
+    
+    /* Setup the sort key for each node */
+    if (Indices)
+    {
+        Entries_.resize(Indices->size());
+        
+        for (u32 i = 0; i < Indices->size(); ++i)
+            setupEntry(Entries_[i], NodeList[(*Indices)[i]]);
+    }
+    else
+    {
+        Entries_.reserve(NodeList.size());
+        
+        foreach (RenderNode* Node, NodeList)
+        {
+            if (Node->getVisible())
+            {
+                Entries_.resize(Entries_.size() + 1);
+                setupEntry(Entries_.back(), Node);
+            }
+        }
+    }
+    
+    /* Sort the entries and count the saved state changes */
+    const u32 NumUnsortedChanges = countStateChanges(Entries_);
+    
+    sortEntries();
+    
+    NumStateChanges_        = countStateChanges(Entries_);
+    NumStateChangesSaved_   = (NumUnsortedChanges > NumStateChanges_ ? NumUnsortedChanges - NumStateChanges_ : 0);
+}
+
+void RenderQueue::clear()
+{
+    Entries_.clear();
+    TempEntries_.clear();
+    
+    NumStateChanges_        = 0;
+    NumStateChangesSaved_   = 0;
+}
+
+bool RenderQueue::isTranslucent(const RenderNode* Node)
+{
+    if (Node->getType() < NODE_MESH)
+        return false;
+    
+    const video::MaterialStates* Material = static_cast<const MaterialNode*>(Node)->getMaterial();
+    
+    return Material->getBlending() && (
+        Material->getDiffuseColor().Alpha < 255 ||
+        Material->getBlendTarget() != video::BLEND_INVSRCALPHA ||
+        Node->getType() == NODE_BILLBOARD
+    );
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void RenderQueue::setupEntry(SRenderQueueEntry &Entry, RenderNode* Node)
+{
+    /* Layer from the render node order (higher orders are rendered first) */
+    const s32 Layer = 255 - math::MinMax(Node->getOrder() + 128, 0, 255);
+    
+    Entry.Key   = (static_cast<u64>(Layer) << RENDERQUEUE_LAYER_SHIFT);
+    Entry.State = 0;
+    Entry.Node  = Node;
+    
+    if (Node->getType() < NODE_MESH)
+        return;
+    
+    /* Pack the render state identifiers */
+    const MaterialNode* MatNode = static_cast<const MaterialNode*>(Node);
+    
+    const u64 ShaderID      = foldHash(hashPointer(2166136261u, MatNode->getShaderClass()), RENDERQUEUE_SHADER_BITS);
+    const u64 MaterialID    = foldHash(hashMaterialStates(MatNode->getMaterial()), RENDERQUEUE_MATERIAL_BITS);
+    const u64 TextureID     = foldHash(hashTextures(MatNode), RENDERQUEUE_TEXTURE_BITS);
+    
+    Entry.State = (ShaderID << 32) | (MaterialID << 16) | TextureID;
+    
+    const u32 DepthBits = getDepthBits(Node->getDepthDistance());
+    
+    if (isTranslucent(Node))
+    {
+        /* Translucent: 24 bit depth (back to front), 12 bit shader, 16 bit material, 3 bit textures */
+        u64 Depth = (DepthBits >> 7) & 0xFFFFFF;
+        
+        if (!SceneGraph::getReverseDepthSorting())
+            Depth = (~Depth) & 0xFFFFFF;
+        
+        Entry.Key |= RENDERQUEUE_TRANSLUCENT_BIT | (Depth << 31) | (ShaderID << 19) | (MaterialID << 3) | (TextureID & 0x7);
+    }
+    else
+    {
+        /* Opaque: 12 bit shader, 16 bit material, 16 bit textures, 11 bit depth (front to back) */
+        const u64 Depth = (DepthBits >> 20) & 0x7FF;
+        
+        Entry.Key |= (ShaderID << 43) | (MaterialID << 27) | (TextureID << 11) | Depth;
+    }
+}
+
+void RenderQueue::sortEntries()
+{
+    const u32 Count = Entries_.size();
+    
+    if (Count < 2)
+        return;
+    
+    TempEntries_.resize(Count);
+    
+    /* LSD radix sort with 8 bit digits (passes where all digits are equal are skipped) */
+    u32 Histogram[256];
+    
+    for (u32 Shift = 0; Shift < 64; Shift += 8)
+    {
+        memset(Histogram, 0, sizeof(Histogram));
+        
+        foreach (const SRenderQueueEntry &Entry, Entries_)
+            ++Histogram[(Entry.Key >> Shift) & 0xFF];
+        
+        if (Histogram[(Entries_.front().Key >> Shift) & 0xFF] == Count)
+            continue;
+        
+        /* Compute the bucket offsets */
+        u32 Offset = 0;
+        for (u32 i = 0; i < 256; ++i)
+        {
+            const u32 Num = Histogram[i];
+            Histogram[i] = Offset;
+            Offset += Num;
+        }
+        
+        /* Scatter the entries (stable) */
+        foreach (const SRenderQueueEntry &Entry, Entries_)
+            TempEntries_[Histogram[(Entry.Key >> Shift) & 0xFF]++] = Entry;
+        
+        Entries_.swap(TempEntries_);
+    }
+}
+
+u32 RenderQueue::countStateChanges(const std::vector<SRenderQueueEntry> &Entries)
+{
+    u32 NumChanges = 0;
+    
+    for (u32 i = 1; i < Entries.size(); ++i)
+    {
+        if (Entries[i].State != Entries[i - 1].State)
+            ++NumChanges;
+    }
+    
+    return NumChanges;
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
@@ -0,0 +1,135 @@
+/*
+ * Render queue header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_RENDER_QUEUE_H__
+#define __SP_SCENE_RENDER_QUEUE_H__
+
+
+#include "Base/spStandard.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+class RenderNode;
+
+//! Render queue entry with the packed sort key.
+struct SRenderQueueEntry
+{
+    u64 Key;            //!< Packed 64-bit sort key.
+    u64 State;          //!< Packed render state identifiers (shader class, material states and textures).
+    RenderNode* Node;   //!< Render node for this draw.
+};
+
+/**
+The render queue sorts the render nodes by packed 64-bit keys with a radix sort. From the highest to the lowest bits a key contains:
+the layer (the render node order, see RenderNode::setOrder), the translucency flag, and then for opaque nodes the shader class,
+the material states, the texture set and the quantized depth (front to back). Translucent nodes are sorted by their
+quantized depth (back to front) first. This way opaque nodes with the same states are rendered one after another,
+which minimizes the calls to "RenderSystem::setupMaterialStates" and shader switches.
+\see SceneGraph::setRenderQueueSorting
+\see RENDERLIST_SORT_RENDERQUEUE
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT RenderQueue
+{
+    
+    public:
+        
+        RenderQueue();
+        ~RenderQueue();
+        
+        /* === Functions === */
+        
+        /**
+        Builds and sorts the render queue for the specified render nodes.
+        \param[in] NodeList Specifies the render nodes. Their depth distances must already be updated (see RenderNode::updateTransformation).
+        \param[in] Indices Optional pointer to a list of indices into the node list (e.g. from FrustumCuller::cull).
+        If this is null all visible nodes of the list are used.
+        */
+        void build(const std::vector<RenderNode*> &NodeList, const std::vector<u32>* Indices = 0);
+        
+        //! Removes all entries from the queue.
+        void clear();
+        
+        /**
+        Returns true if the specified render node is translucent, i.e. it will be sorted back to front.
+        This is the case for material nodes with blending whose diffuse alpha is less than 255, billboards
+        with blending and nodes whose blend target is not the default one (inverse source alpha).
+        */
+        static bool isTranslucent(const RenderNode* Node);
+        
+        /* === Inline functions === */
+        
+        //! Returns the count of entries in the queue.
+        inline u32 getSize() const
+        {
+            return Entries_.size();
+        }
+        
+        //! Returns the render node at the specified position in the sorted queue.
+        inline RenderNode* getNode(u32 Index) const
+        {
+            return Entries_[Index].Node;
+        }
+        
+        //! Returns the sorted entry list.
+        inline const std::vector<SRenderQueueEntry>& getEntryList() const
+        {
+            return Entries_;
+        }
+        
+        //! Returns the count of render state changes in the sorted queue.
+        inline u32 getNumStateChanges() const
+        {
+            return NumStateChanges_;
+        }
+        /**
+        Returns the count of render state changes which have been saved by sorting,
+        compared to the order of the input node list.
+        */
+        inline u32 getNumStateChangesSaved() const
+        {
+            return NumStateChangesSaved_;
+        }
+        
+    private:
+        
+        /* === Functions === */
+        
+        void setupEntry(SRenderQueueEntry &Entry, RenderNode* Node);
+        void sortEntries();
+        
+        static u32 countStateChanges(const std::vector<SRenderQueueEntry> &Entries);
+        
+        /* === Members === */
+        
+        std::vector<SRenderQueueEntry> Entries_;
+        std::vector<SRenderQueueEntry> TempEntries_;
+        
+        u32 NumStateChanges_;
+        u32 NumStateChangesSaved_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
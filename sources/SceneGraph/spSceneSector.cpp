@@ -24,7 +24,10 @@ namespace sp
 namespace scene
 {
 
-Sector::Sector()
+Sector::Sector() :
+    Index_      (0      ),
+    VisitFrame_ (0      ),
+    InTraversal_(false  )
 {
 }
 Sector::~Sector()
@@ -138,45 +141,82 @@ dim::matrix4f Sector::getTransformation() const
  * ======= Private: =======
  */
 
-void Sector::render(
-    Sector* Predecessor, const dim::vector3df &GlobalViewOrigin,
-    ViewFrustum &Frustum, const dim::matrix4f &BaseMatrix)
+void Sector::traverse(
+    const dim::vector3df &GlobalViewOrigin, ViewFrustum &Frustum,
+    const u32* PVSRow, u32 Frame, std::vector<Sector*> &VisibleSectors)
 {
+    /* Store the frustum this sector has been reached with */
+    if (VisitFrame_ != Frame)
+    {
+        VisitFrame_ = Frame;
+        Frustums_.clear();
+        VisibleSectors.push_back(this);
+    }
+    
+    Frustums_.push_back(Frustum);
+    
     /* Find portals */
     const ViewFrustum OrigFrustum(Frustum);
     
+    InTraversal_ = true;
+    
     foreach (Portal* PortalObj, Portals_)
     {
         if (!PortalObj->getEnable())
             continue;
         
-        /*Check if this sector has a neighbor within this portal */
+        /* Check if this sector has a neighbor within this portal which is not already on the current path */
         Sector* Neighbor = PortalObj->getNeighbor(this);
         
-        if (!Neighbor || Neighbor == Predecessor)
+        if (!Neighbor || Neighbor->InTraversal_)
             continue;
         
-        /* Transform current view-frustum through the portal */
+        /* Skip sectors which are not potentially visible from the camera's sector */
+        if (PVSRow && !(PVSRow[Neighbor->Index_ >> 5] & (1u << (Neighbor->Index_ & 31))))
+            continue;
+        
+        /* Narrow the current view-frustum through the portal */
         if (!PortalObj->transformViewFrustum(GlobalViewOrigin, Frustum))
             continue;
         
-        /* Render next sector */
-        Neighbor->render(this, GlobalViewOrigin, Frustum, BaseMatrix);
+        /* Traverse next sector */
+        Neighbor->traverse(GlobalViewOrigin, Frustum, PVSRow, Frame, VisibleSectors);
         
         Frustum = OrigFrustum;
     }
     
-    /* Draw render nodes of this sector */
+    InTraversal_ = false;
+}
+
+void Sector::updateRenderNodes(const dim::matrix4f &BaseMatrix)
+{
     foreach (RenderNode* Node, RenderNodes_)
     {
         if (Node->getVisible())
-        {
             Node->updateTransformationBase(BaseMatrix);
-            Node->render();
-        }
     }
 }
 
+void Sector::cullRenderNodes(std::vector<RenderNode*> &NodeList) const
+{
+    foreach (RenderNode* Node, RenderNodes_)
+    {
+        if (!Node->getVisible())
+            continue;
+        
+        /* Check the node against all narrowed frustums of this sector */
+        const BoundingVolume& BoundVolume = Node->getBoundingVolume();
+        
+        foreach (const ViewFrustum &Frustum, Frustums_)
+        {
+            if (BoundVolume.checkFrustumCulling(Frustum, Node->FinalWorldMatrix_))
+            {
+                NodeList.push_back(Node);
+                break;
+            }
+        }
+    }
+}
 
 } // /namespace scene
 
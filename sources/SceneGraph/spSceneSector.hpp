@@ -74,17 +74,65 @@ class SP_EXPORT Sector
         void setTransformation(const dim::matrix4f &Transform);
         dim::matrix4f getTransformation() const;
         
+        /* === Inline functions === */
+        
+        //! Returns the center of this sector's bounding box.
+        inline const dim::vector3df& getCenter() const
+        {
+            return BoundBox_.Center;
+        }
+        
+        inline const std::vector<Portal*>& getPortalList() const
+        {
+            return Portals_;
+        }
+        inline const std::vector<RenderNode*>& getRenderNodeList() const
+        {
+            return RenderNodes_;
+        }
+        
+        /**
+        Returns the index of this sector in the sector list of its scene graph.
+        This is the row and column of the sector in the potentially visible set (PVS).
+        \see SceneGraphPortalBased::computePVS
+        \since Version 3.3
+        */
+        inline u32 getIndex() const
+        {
+            return Index_;
+        }
+        
     private:
         
         friend class SceneGraphPortalBased;
         
         /* === Functions === */
         
-        void render(
-            Sector* Predecessor, const dim::vector3df &GlobalViewOrigin,
-            ViewFrustum &Frustum, const dim::matrix4f &BaseMatrix
+        /**
+        Traverses the sectors which are visible through the portals of this sector. The view frustum is narrowed
+        by each portal, and each visible sector stores all frustums it has been reached with in the current frame.
+        \param[in] PVSRow Specifies the PVS row of the camera's sector. Sectors which are not in this set are skipped.
+        If this is null, all sectors are traversed.
+        \param[in] Frame Specifies the current frame number.
+        \param[out] VisibleSectors Specifies the output list. Each visible sector is added once per frame.
+        */
+        void traverse(
+            const dim::vector3df &GlobalViewOrigin, ViewFrustum &Frustum,
+            const u32* PVSRow, u32 Frame, std::vector<Sector*> &VisibleSectors
         );
         
+        /**
+        Updates the final world matrices of the visible render nodes of this sector.
+        This is not thread safe, because the transformations of the parent nodes are cached lazily.
+        */
+        void updateRenderNodes(const dim::matrix4f &BaseMatrix);
+        
+        /**
+        Adds the render nodes of this sector which are inside one of its frustums to the list.
+        The transformations must already be updated, so this function only reads the render nodes and can run on several threads.
+        */
+        void cullRenderNodes(std::vector<RenderNode*> &NodeList) const;
+        
         /* === Members === */
         
         dim::matrix4f InvTransform_;
@@ -94,6 +142,12 @@ class SP_EXPORT Sector
         std::vector<Portal*> Portals_;
         std::vector<RenderNode*> RenderNodes_;
         
+        u32 Index_;
+        
+        u32 VisitFrame_;
+        bool InTraversal_;
+        std::vector<ViewFrustum> Frustums_; //!< View frustums this sector has been reached with in the current frame.
+        
 };
 
 
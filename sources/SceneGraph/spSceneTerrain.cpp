@@ -37,6 +37,10 @@ void Terrain::render()
     if (!GlbSceneGraph->getActiveCamera())
         return;
     
+    /* Enable the light sources of this terrain */
+    if (GlbSceneGraph->getLightBinning())
+        GlbSceneGraph->setupNodeLights(this);
+    
     /* Setup material states */
     GlbRenderSys->setupMaterialStates(getMaterial());
     GlbRenderSys->setupShaderClass(this, getShaderClass());
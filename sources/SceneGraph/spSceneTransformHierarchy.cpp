@@ -0,0 +1,385 @@
+/*
+ * Transform hierarchy file
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#include "SceneGraph/spSceneTransformHierarchy.hpp"
+#include "SceneGraph/spRenderNode.hpp"
+#include "Base/spCriticalSection.hpp"
+#include "Base/spInputOutputOSInformator.hpp"
+#include "Base/spTimer.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <map>
+
+
+namespace sp
+{
+
+
+/*
+ * Internal members
+ */
+
+extern io::OSInformator* GlbPlatformInfo;
+
+namespace scene
+{
+
+
+/*
+ * Internal structures
+ */
+
+static const u32 TRANSFORM_INVALID_INDEX = ~0u;
+
+//! Minimal count of nodes for each thread in a transform update.
+static const u32 TRANSFORM_MIN_BLOCK_SIZE = 4096;
+
+struct STransformThreadData
+{
+    TransformHierarchy* Hierarchy;
+    const dim::matrix4f* BaseMatrix;
+    u32 Begin, End;
+    s32* NumRunningThreads;
+    CriticalSection* Mutex;
+};
+
+//! Sorts the entry indices by their root sub-tree (used with a stable sort to keep the pre-order).
+struct SRootIndexCompare
+{
+    SRootIndexCompare(const std::vector<u32> &RootIndices) :
+        RootIndices_(RootIndices)
+    {
+    }
+    
+    bool operator () (u32 IndexA, u32 IndexB) const
+    {
+        return RootIndices_[IndexA] < RootIndices_[IndexB];
+    }
+    
+    const std::vector<u32> &RootIndices_;
+};
+
+
+/*
+ * Internal functions
+ */
+
+THREAD_PROC(TransformHierarchyThreadProc)
+{
+    STransformThreadData* ThreadData = reinterpret_cast<STransformThreadData*>(Arguments);
+    
+    /* Process the block of root sub-trees given to this thread */
+    ThreadData->Hierarchy->updateBlock(ThreadData->Begin, ThreadData->End, ThreadData->BaseMatrix);
+    
+    /* Decrement running thread counter */
+    ThreadData->Mutex->lock();
+    --(*ThreadData->NumRunningThreads);
+    ThreadData->Mutex->unlock();
+    
+    return 0;
+}
+
+
+/*
+ * TransformHierarchy class
+ */
+
+TransformHierarchy::TransformHierarchy() :
+    NumListed_  (0      ),
+    Stamp_      (0      ),
+    ThreadCount_(0      ),
+    ForceUpdate_(true   )
+{
+}
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+void TransformHierarchy::update(const std::vector<RenderNode*> &NodeList, const dim::matrix4f &BaseMatrix)
+{
+    updateEntries(NodeList, &BaseMatrix);
+}
+
+void TransformHierarchy::updateWorldMatrices(const std::vector<RenderNode*> &NodeList)
+{
+    updateEntries(NodeList, 0);
+}
+
+void TransformHierarchy::clear()
+{
+    Entries_.clear();
+    WorldMatrices_.clear();
+    RootOffsets_.clear();
+    
+    NumListed_      = 0;
+    ForceUpdate_    = true;
+}
+
+const dim::matrix4f* TransformHierarchy::getWorldMatrix(const SceneNode* Node) const
+{
+    if (Node && Node->TransformIndex_ < Entries_.size() && Entries_[Node->TransformIndex_].Node == Node)
+        return &WorldMatrices_[Node->TransformIndex_];
+    return 0;
+}
+
+bool TransformHierarchy::hasChanged(const SceneNode* Node) const
+{
+    if (Node && Node->TransformIndex_ < Entries_.size() && Entries_[Node->TransformIndex_].Node == Node)
+        return Entries_[Node->TransformIndex_].Dirty;
+    return true;
+}
+
+
+/*
+ * ======= Private: =======
+ */
+
+void TransformHierarchy::updateEntries(const std::vector<RenderNode*> &NodeList, const dim::matrix4f* BaseMatrix)
+{
+    if (!checkLayout(NodeList))
+        rebuildLayout(NodeList);
+    
+    const u32 Count = Entries_.size();
+    
+    if (!Count)
+        return;
+    
+    /* Determine the count of threads */
+    u32 ThreadCount = ThreadCount_;
+    
+    if (!ThreadCount)
+        ThreadCount = (GlbPlatformInfo ? GlbPlatformInfo->getProcessorCount() : 1);
+    
+    ThreadCount = math::Min(ThreadCount, (Count + TRANSFORM_MIN_BLOCK_SIZE - 1) / TRANSFORM_MIN_BLOCK_SIZE);
+    
+    /* Split the entries only at root sub-tree boundaries */
+    std::vector<u32> Bounds(1, 0);
+    
+    if (ThreadCount > 1)
+    {
+        const u32 BlockSize = (Count + ThreadCount - 1) / ThreadCount;
+        
+        for (u32 i = 1; i + 1 < RootOffsets_.size(); ++i)
+        {
+            if (RootOffsets_[i] - Bounds.back() >= BlockSize)
+                Bounds.push_back(RootOffsets_[i]);
+        }
+    }
+    
+    Bounds.push_back(Count);
+    
+    const u32 NumBlocks = Bounds.size() - 1;
+    
+    if (NumBlocks <= 1)
+        updateBlock(0, Count, BaseMatrix);
+    else
+    {
+        s32 NumRunningThreads = 0;
+        CriticalSection Mutex;
+        
+        std::vector<STransformThreadData> ThreadDataList(NumBlocks - 1);
+        
+        typedef boost::shared_ptr<ThreadManager> ThreadManagerPtr;
+        std::vector<ThreadManagerPtr> Threads;
+        
+        /* Start worker threads for all blocks except the first one */
+        for (u32 i = 1; i < NumBlocks; ++i)
+        {
+            STransformThreadData& ThreadData = ThreadDataList[i - 1];
+            
+            ThreadData.Hierarchy            = this;
+            ThreadData.BaseMatrix           = BaseMatrix;
+            ThreadData.Begin                = Bounds[i];
+            ThreadData.End                  = Bounds[i + 1];
+            ThreadData.NumRunningThreads    = (&NumRunningThreads);
+            ThreadData.Mutex                = (&Mutex);
+            
+            Mutex.lock();
+            ++NumRunningThreads;
+            Mutex.unlock();
+            
+            Threads.push_back(boost::make_shared<ThreadManager>(TransformHierarchyThreadProc, &ThreadData));
+        }
+        
+        /* Process the first block in the calling thread */
+        updateBlock(Bounds[0], Bounds[1], BaseMatrix);
+        
+        /* Wait until all threads are finished */
+        while (1)
+        {
+            Mutex.lock();
+            const bool Finished = (NumRunningThreads <= 0);
+            Mutex.unlock();
+            
+            if (Finished)
+                break;
+            
+            io::Timer::yield();
+        }
+    }
+    
+    ForceUpdate_ = false;
+}
+
+bool TransformHierarchy::checkLayout(const std::vector<RenderNode*> &NodeList)
+{
+    if (NodeList.size() != NumListed_)
+        return false;
+    
+    /* Check if each listed node is still stored in this hierarchy (exactly once) */
+    ++Stamp_;
+    
+    foreach (RenderNode* Node, NodeList)
+    {
+        const u32 Index = Node->TransformIndex_;
+        
+        if (Index >= Entries_.size())
+            return false;
+        
+        SEntry& Entry = Entries_[Index];
+        
+        if (Entry.Node != Node || !Entry.Listed || Entry.Stamp == Stamp_)
+            return false;
+        
+        Entry.Stamp = Stamp_;
+    }
+    
+    /*
+    Check the parents in reverse order, i.e. children before their parents.
+    This way a parent node is only accessed when its child still refers to it.
+    */
+    for (u32 i = Entries_.size(); i > 0; --i)
+    {
+        const SEntry& Entry = Entries_[i - 1];
+        const SceneNode* Parent = (Entry.ParentIndex != TRANSFORM_INVALID_INDEX ? Entries_[Entry.ParentIndex].Node : 0);
+        
+        if (Entry.Node->getParent() != Parent)
+            return false;
+    }
+    
+    return true;
+}
+
+void TransformHierarchy::rebuildLayout(const std::vector<RenderNode*> &NodeList)
+{
+    clear();
+    
+    /* Add all nodes and their parents (parents before children) */
+    std::vector<SEntry> Entries;
+    std::vector<u32> RootIndices;
+    std::map<SceneNode*, u32> IndexMap;
+    std::vector<SceneNode*> Path;
+    
+    foreach (RenderNode* Node, NodeList)
+    {
+        Path.clear();
+        
+        for (SceneNode* Ancestor = Node; Ancestor && IndexMap.find(Ancestor) == IndexMap.end(); Ancestor = Ancestor->getParent())
+            Path.push_back(Ancestor);
+        
+        for (std::vector<SceneNode*>::reverse_iterator it = Path.rbegin(); it != Path.rend(); ++it)
+        {
+            SceneNode* Parent = (*it)->getParent();
+            
+            SEntry Entry;
+            {
+                Entry.Node          = *it;
+                Entry.ParentIndex   = (Parent ? IndexMap[Parent] : TRANSFORM_INVALID_INDEX);
+                Entry.RootIndex     = (Parent ? Entries[Entry.ParentIndex].RootIndex : Entries.size());
+                Entry.Revision      = 0;
+                Entry.Stamp         = 0;
+                Entry.Listed        = false;
+                Entry.Dirty         = true;
+            }
+            IndexMap[*it] = Entries.size();
+            RootIndices.push_back(Entry.RootIndex);
+            Entries.push_back(Entry);
+        }
+        
+        Entries[IndexMap[Node]].Listed = true;
+    }
+    
+    /* Store the nodes of each root sub-tree contiguously (the stable sort keeps the pre-order) */
+    const u32 Count = Entries.size();
+    
+    std::vector<u32> Order(Count);
+    for (u32 i = 0; i < Count; ++i)
+        Order[i] = i;
+    
+    std::stable_sort(Order.begin(), Order.end(), SRootIndexCompare(RootIndices));
+    
+    std::vector<u32> NewIndices(Count);
+    for (u32 i = 0; i < Count; ++i)
+        NewIndices[Order[i]] = i;
+    
+    Entries_.resize(Count);
+    WorldMatrices_.resize(Count);
+    
+    for (u32 i = 0; i < Count; ++i)
+    {
+        SEntry& Entry = Entries_[i];
+        
+        Entry = Entries[Order[i]];
+        
+        if (Entry.ParentIndex != TRANSFORM_INVALID_INDEX)
+            Entry.ParentIndex = NewIndices[Entry.ParentIndex];
+        else
+            RootOffsets_.push_back(i);
+        
+        if (Entry.Listed)
+            ++NumListed_;
+        
+        Entry.Node->TransformIndex_ = i;
+    }
+    
+    RootOffsets_.push_back(Count);
+}
+
+void TransformHierarchy::updateBlock(u32 Begin, u32 End, const dim::matrix4f* BaseMatrix)
+{
+    for (u32 i = Begin; i < End; ++i)
+    {
+        SEntry& Entry = Entries_[i];
+        
+        const Transformation& Transform = Entry.Node->Transform_;
+        const u32 Revision = Transform.getRevision();
+        
+        /* The world matrix must be recomputed if this or any parent transformation has changed */
+        bool Dirty = (ForceUpdate_ || Entry.Revision != Revision);
+        
+        if (!Dirty && Entry.ParentIndex != TRANSFORM_INVALID_INDEX)
+            Dirty = Entries_[Entry.ParentIndex].Dirty;
+        
+        if (Dirty)
+        {
+            if (Entry.ParentIndex != TRANSFORM_INVALID_INDEX)
+                WorldMatrices_[i] = WorldMatrices_[Entry.ParentIndex] * Transform.getMatrix();
+            else
+                WorldMatrices_[i] = Transform.getMatrix();
+            
+            Entry.Revision = Revision;
+        }
+        
+        Entry.Dirty = Dirty;
+        
+        /* Setup the final world matrix for visible render nodes */
+        if (BaseMatrix && Entry.Listed && Entry.Node->getVisible())
+            Entry.Node->updateTransformationBase(*BaseMatrix, WorldMatrices_[i]);
+    }
+}
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+
+// ================================================================================
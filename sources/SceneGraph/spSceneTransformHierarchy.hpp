@@ -0,0 +1,159 @@
+/*
+ * Transform hierarchy header
+ * 
+ * This file is part of the "SoftPixel Engine" (Copyright (c) 2008 by Lukas Hermanns)
+ * See "SoftPixelEngine.hpp" for license information.
+ */
+
+#ifndef __SP_SCENE_TRANSFORM_HIERARCHY_H__
+#define __SP_SCENE_TRANSFORM_HIERARCHY_H__
+
+
+#include "Base/spStandard.hpp"
+#include "Base/spDimensionMatrix4.hpp"
+#include "Base/spThreadManager.hpp"
+
+#include <vector>
+
+
+namespace sp
+{
+namespace scene
+{
+
+
+class SceneNode;
+class RenderNode;
+
+/**
+The transform hierarchy caches the global world matrices of a list of render nodes and all their parents
+in one contiguous array. The nodes are stored in pre-order, i.e. each parent is stored before its children
+and the nodes of each root sub-tree are stored contiguously. Each frame only the world matrices of those nodes
+whose transformation has changed (see Transformation3D::getRevision) and of their children are recomputed.
+Independent root sub-trees are updated in parallel.
+\see SceneGraph::getTransformHierarchy
+\ingroup group_scenegraph
+\since Version 3.3
+*/
+class SP_EXPORT TransformHierarchy
+{
+    
+    public:
+        
+        TransformHierarchy();
+        ~TransformHierarchy();
+        
+        /* === Functions === */
+        
+        /**
+        Updates the world matrices of the specified render nodes and all their parents. Afterwards the final world matrix
+        of each visible render node is setup with "SceneNode::updateTransformationBase(BaseMatrix, WorldMatrix)".
+        The node layout is only rebuilt when the list of nodes or the parent of any node has changed.
+        \param[in] NodeList Specifies the render nodes whose transformations are to be updated. The order of this list does not matter.
+        \param[in] BaseMatrix Specifies the base matrix which is applied to each final world matrix.
+        */
+        void update(const std::vector<RenderNode*> &NodeList, const dim::matrix4f &BaseMatrix);
+        
+        /**
+        Updates only the cached world matrices of the specified render nodes and all their parents.
+        In contrast to "update" the final world matrices of the render nodes are not touched, e.g. to set them up
+        only for the visible nodes afterwards.
+        \see update
+        */
+        void updateWorldMatrices(const std::vector<RenderNode*> &NodeList);
+        
+        //! Removes all nodes from the hierarchy. The layout will be rebuilt with the next update.
+        void clear();
+        
+        /**
+        Returns a pointer to the cached global world matrix (without the base matrix) of the specified node
+        or null if the node is not part of this hierarchy.
+        */
+        const dim::matrix4f* getWorldMatrix(const SceneNode* Node) const;
+        
+        /**
+        Returns true if the world matrix of the specified node has been recomputed in the last update,
+        i.e. its transformation or the transformation of any parent has changed.
+        If the node is not part of this hierarchy the return value is always true.
+        */
+        bool hasChanged(const SceneNode* Node) const;
+        
+        /* === Inline functions === */
+        
+        /**
+        Sets the count of threads for the update.
+        \param[in] ThreadCount Specifies the count of threads. If 0 the count of processors is used. By default 0.
+        \note Only independent root sub-trees are distributed to the threads and each thread
+        gets at least a few thousand nodes, so small hierarchies are always updated in the calling thread.
+        */
+        inline void setThreadCount(u32 ThreadCount)
+        {
+            ThreadCount_ = ThreadCount;
+        }
+        inline u32 getThreadCount() const
+        {
+            return ThreadCount_;
+        }
+        
+        //! Returns the count of nodes (render nodes and their parents) in this hierarchy.
+        inline u32 getNodeCount() const
+        {
+            return Entries_.size();
+        }
+        
+        //! Returns the list of all cached world matrices in pre-order.
+        inline const std::vector<dim::matrix4f>& getWorldMatrixList() const
+        {
+            return WorldMatrices_;
+        }
+        
+    private:
+        
+        friend THREAD_PROC(TransformHierarchyThreadProc);
+        
+        /* === Structures === */
+        
+        struct SEntry
+        {
+            SceneNode* Node;
+            u32 ParentIndex;    //!< Entry index of the parent or TRANSFORM_INVALID_INDEX for root nodes.
+            u32 RootIndex;      //!< Entry index of the root node (only used while the layout is rebuilt).
+            u32 Revision;       //!< Transformation revision of the cached world matrix.
+            u32 Stamp;          //!< Stamp of the last layout check.
+            bool Listed;        //!< True if this node is in the node list, otherwise it's only a parent.
+            bool Dirty;         //!< True if the world matrix has been recomputed in the current update.
+        };
+        
+        /* === Functions === */
+        
+        bool checkLayout(const std::vector<RenderNode*> &NodeList);
+        void rebuildLayout(const std::vector<RenderNode*> &NodeList);
+        
+        void updateEntries(const std::vector<RenderNode*> &NodeList, const dim::matrix4f* BaseMatrix);
+        void updateBlock(u32 Begin, u32 End, const dim::matrix4f* BaseMatrix);
+        
+        /* === Members === */
+        
+        std::vector<SEntry> Entries_;
+        std::vector<dim::matrix4f> WorldMatrices_;
+        std::vector<u32> RootOffsets_;
+        
+        u32 NumListed_;
+        u32 Stamp_;
+        u32 ThreadCount_;
+        
+        bool ForceUpdate_;
+        
+};
+
+
+} // /namespace scene
+
+} // /namespace sp
+
+
+#endif
+
+
+
+// ================================================================================
@@ -0,0 +1,324 @@
+//
+// SoftPixel Engine - Collision Benchmarks
+//
+// Runs without any drawing on the dummy render system and writes one
+// JSON object per benchmark into the standard output (JSON lines).
+// Usage: TestCollisionBenchmarks [MaxNodeCount]
+//
+
+#include <SoftPixelEngine.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#if defined(SP_PLATFORM_WINDOWS)
+#   include <windows.h>
+#   include <psapi.h>
+#elif defined(SP_PLATFORM_LINUX) || defined(SP_PLATFORM_MACOSX)
+#   include <sys/resource.h>
+#endif
+
+using namespace sp;
+
+
+/* === Global members === */
+
+SoftPixelDevice* spDevice           = 0;
+scene::SceneGraph* spScene          = 0;
+
+const u32 RayCount                  = 100000;
+const u32 FrameCount                = 10;
+const s32 MeshSegments              = 180;   // Maximal sphere segments (~130k triangles)
+const f32 MeshRadius                = 100.0f;
+
+
+/* === Static functions === */
+
+//! Returns the peak memory usage (in bytes) of this process or 0 if not supported.
+static u64 GetPeakMemoryUsage()
+{
+    #if defined(SP_PLATFORM_WINDOWS)
+    
+    PROCESS_MEMORY_COUNTERS Counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+        return static_cast<u64>(Counters.PeakWorkingSetSize);
+    return 0;
+    
+    #elif defined(SP_PLATFORM_LINUX) || defined(SP_PLATFORM_MACOSX)
+    
+    struct rusage Usage;
+    if (getrusage(RUSAGE_SELF, &Usage) != 0)
+        return 0;
+    #   if defined(SP_PLATFORM_MACOSX)
+    return static_cast<u64>(Usage.ru_maxrss);
+    #   else
+    return static_cast<u64>(Usage.ru_maxrss) * 1024;
+    #   endif
+    
+    #else
+    
+    return 0;
+    
+    #endif
+}
+
+static f64 GetSeconds(u64 StartTime)
+{
+    return static_cast<f64>(io::Timer::microsecs() - StartTime) / 1000000.0;
+}
+
+static f64 GetRate(f64 Count, f64 Seconds)
+{
+    return Seconds > 0.0 ? Count / Seconds : 0.0;
+}
+
+static void PrintResult(const c8* Name, const c8* Fields)
+{
+    printf(
+        "{ \"benchmark\": \"%s\", %s, \"peak_memory_bytes\": %llu }\n",
+        Name, Fields, static_cast<unsigned long long>(GetPeakMemoryUsage())
+    );
+    fflush(stdout);
+}
+
+static void GenerateRays(std::vector<dim::line3df> &Lines, const dim::aabbox3df &Box)
+{
+    /* Lines from one random point outside the box to another one */
+    const dim::vector3df Center(Box.getCenter());
+    const f32 Radius = (Box.Max - Box.Min).getLength();
+    
+    Lines.resize(RayCount);
+    
+    for (u32 i = 0; i < RayCount; ++i)
+    {
+        Lines[i].Start  = Center + math::Randomizer::randVector().normalize() * Radius;
+        Lines[i].End    = Center + math::Randomizer::randVector().normalize() * Radius;
+    }
+}
+
+static bool BenchmarkMesh()
+{
+    scene::CollisionGraph* CollGraph = spDevice->createCollisionGraph();
+    scene::CollisionMaterial* WorldMaterial = CollGraph->createMaterial();
+    
+    scene::Mesh* MeshWorld = spScene->createMesh(
+        scene::MESH_SPHERE, scene::SMeshConstruct(MeshSegments, MeshRadius)
+    );
+    
+    /* Build kd-tree */
+    u64 StartTime = io::Timer::microsecs();
+    
+    scene::CollisionMesh* CollMesh = CollGraph->createMesh(
+        WorldMaterial, MeshWorld, scene::DEF_KDTREE_LEVEL, scene::KDTREECONCEPT_SAH
+    );
+    
+    const f64 BuildTime = GetSeconds(StartTime);
+    
+    if (!CollMesh || !CollMesh->getRootTreeNode())
+    {
+        io::Log::error("Building collision mesh failed");
+        return false;
+    }
+    
+    c8 Fields[512];
+    
+    sprintf(
+        Fields, "\"triangles\": %u, \"tree_depth\": %u, \"build_seconds\": %.6f, \"tree_builder_ms\": %llu",
+        MeshWorld->getTriangleCount(), CollMesh->getLinearTree().getDepth(), BuildTime,
+        static_cast<unsigned long long>(CollMesh->getBuildTime())
+    );
+    PrintResult("kdtree_build", Fields);
+    
+    /* Batched closest-hit and any-hit ray queries */
+    std::vector<dim::line3df> Lines;
+    GenerateRays(Lines, CollMesh->getLinearTree().getBox());
+    
+    std::vector<scene::SIntersectionContact> Contacts(RayCount);
+    bool* Results = new bool[RayCount];
+    
+    StartTime = io::Timer::microsecs();
+    CollGraph->findNearestIntersections(&Lines[0], RayCount, &Contacts[0]);
+    const f64 NearestTime = GetSeconds(StartTime);
+    
+    u32 NumHits = 0;
+    for (u32 i = 0; i < RayCount; ++i)
+    {
+        if (Contacts[i].Object)
+            ++NumHits;
+    }
+    
+    sprintf(
+        Fields, "\"rays\": %u, \"hits\": %u, \"threads\": %u, \"seconds\": %.6f, \"rays_per_second\": %.1f",
+        RayCount, NumHits, CollGraph->getRayQueryThreadCount(), NearestTime, GetRate(RayCount, NearestTime)
+    );
+    PrintResult("rays_nearest", Fields);
+    
+    for (u32 i = 0; i < RayCount; ++i)
+        Results[i] = false;
+    
+    StartTime = io::Timer::microsecs();
+    CollGraph->checkIntersections(&Lines[0], RayCount, Results);
+    const f64 AnyTime = GetSeconds(StartTime);
+    
+    NumHits = 0;
+    for (u32 i = 0; i < RayCount; ++i)
+    {
+        if (Results[i])
+            ++NumHits;
+    }
+    
+    delete [] Results;
+    
+    sprintf(
+        Fields, "\"rays\": %u, \"hits\": %u, \"threads\": %u, \"seconds\": %.6f, \"rays_per_second\": %.1f",
+        RayCount, NumHits, CollGraph->getRayQueryThreadCount(), AnyTime, GetRate(RayCount, AnyTime)
+    );
+    PrintResult("rays_any", Fields);
+    
+    /* Single ray queries without memory allocation */
+    scene::SIntersectionContact SingleContacts[4];
+    NumHits = 0;
+    
+    StartTime = io::Timer::microsecs();
+    
+    for (u32 i = 0; i < RayCount; ++i)
+    {
+        if (CollGraph->findIntersections(Lines[i], SingleContacts, 4) > 0)
+            ++NumHits;
+    }
+    
+    const f64 SingleTime = GetSeconds(StartTime);
+    
+    sprintf(
+        Fields, "\"rays\": %u, \"hits\": %u, \"threads\": 1, \"seconds\": %.6f, \"rays_per_second\": %.1f",
+        RayCount, NumHits, SingleTime, GetRate(RayCount, SingleTime)
+    );
+    PrintResult("rays_single", Fields);
+    
+    spDevice->deleteCollisionGraph(CollGraph);
+    spScene->deleteNode(MeshWorld);
+    
+    return true;
+}
+
+static void BenchmarkNodes(u32 NodeCount)
+{
+    scene::SceneGraph* NodeScene = spDevice->createSceneGraph();
+    scene::CollisionGraph* CollGraph = spDevice->createCollisionGraph();
+    
+    scene::CollisionMaterial* WorldMaterial = CollGraph->createMaterial();
+    scene::CollisionMaterial* ObjMaterial = CollGraph->createMaterial();
+    
+    ObjMaterial->addRivalMaterial(WorldMaterial);
+    ObjMaterial->addRivalMaterial(ObjMaterial);
+    
+    scene::Mesh* MeshWorld = NodeScene->createMesh(
+        scene::MESH_SPHERE, scene::SMeshConstruct(MeshSegments / 4, MeshRadius)
+    );
+    CollGraph->createMesh(WorldMaterial, MeshWorld, scene::DEF_KDTREE_LEVEL, scene::KDTREECONCEPT_SAH);
+    
+    /* Create spheres and capsules around the mesh surface (the spread grows with the node count) */
+    const f32 Spread = MeshRadius * 0.1f * std::pow(static_cast<f32>(NodeCount) / 1000.0f, 1.0f / 3.0f);
+    
+    std::vector<scene::CollisionNode*> Nodes(NodeCount);
+    
+    u64 StartTime = io::Timer::microsecs();
+    
+    for (u32 i = 0; i < NodeCount; ++i)
+    {
+        scene::SceneNode* Node = NodeScene->createNode();
+        
+        Node->setPosition(
+            math::Randomizer::randVector().normalize() * MeshRadius +
+            math::Randomizer::randVector() * Spread
+        );
+        
+        if (i % 2)
+            Nodes[i] = CollGraph->createCapsule(ObjMaterial, Node, 0.5f, 1.0f);
+        else
+            Nodes[i] = CollGraph->createSphere(ObjMaterial, Node, 0.5f);
+    }
+    
+    const f64 CreateTime = GetSeconds(StartTime);
+    
+    /*
+    Move all nodes in each frame (otherwise they would fall asleep). The previous positions are kept,
+    otherwise the nodes would not be resolved because they seem not to have moved.
+    */
+    f64 UpdateTime = 0.0;
+    u64 NumResolved = 0;
+    
+    for (u32 Frame = 0; Frame < FrameCount; ++Frame)
+    {
+        for (u32 i = 0; i < NodeCount; ++i)
+            Nodes[i]->setPosition(Nodes[i]->getPosition() + math::Randomizer::randVector() * 0.1f, false);
+        
+        StartTime = io::Timer::microsecs();
+        CollGraph->updateScene();
+        UpdateTime += GetSeconds(StartTime);
+        
+        NumResolved += CollGraph->getResolvedNodeCount();
+    }
+    
+    c8 Fields[512];
+    
+    sprintf(
+        Fields,
+        "\"nodes\": %u, \"frames\": %u, \"create_seconds\": %.6f, \"update_seconds\": %.6f, "
+        "\"seconds_per_frame\": %.6f, \"nodes_resolved\": %.0f, \"nodes_resolved_per_second\": %.1f",
+        NodeCount, FrameCount, CreateTime, UpdateTime, UpdateTime / FrameCount,
+        static_cast<f64>(NumResolved), GetRate(static_cast<f64>(NumResolved), UpdateTime)
+    );
+    PrintResult("nodes_resolve", Fields);
+    
+    spDevice->deleteCollisionGraph(CollGraph);
+    spDevice->deleteSceneGraph(NodeScene);
+}
+
+
+/* === Main function === */
+
+int main(int argc, char* argv[])
+{
+    u32 MaxNodeCount = 100000;
+    
+    if (argc > 1)
+        MaxNodeCount = static_cast<u32>(atoi(argv[1]));
+    
+    /* Keep the standard output free for the results */
+    io::Log::open("CollisionBenchmarks.log");
+    io::Log::setOutputContext(io::LOGCONTEXT_FILE);
+    
+    spDevice = createGraphicsDevice(
+        video::RENDERER_DUMMY, dim::size2di(640, 480), 32, "Tests: CollisionBenchmarks"
+    );
+    
+    if (!spDevice)
+    {
+        fprintf(stderr, "Creating graphics device failed\n");
+        return 1;
+    }
+    
+    spScene = spDevice->createSceneGraph();
+    
+    math::Randomizer::seedRandom(false);
+    
+    if (!BenchmarkMesh())
+    {
+        deleteDevice();
+        return 1;
+    }
+    
+    for (u32 NodeCount = 1000; NodeCount <= MaxNodeCount; NodeCount *= 10)
+        BenchmarkNodes(NodeCount);
+    
+    deleteDevice();
+    
+    return 0;
+}
+
+
+
+// ================================================================================
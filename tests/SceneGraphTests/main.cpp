@@ -172,6 +172,38 @@ int main()
     #ifdef USE_PORTAL_SCENE
     MainScene->connectSectors();
     MainScene->insertRenderNodes();
+    
+    /* Compute the PVS and check if it is the same after saving and loading it */
+    MainScene->computePVS();
+    
+    std::vector<bool> VisibilityMatrix;
+    
+    foreach (const scene::Sector* From, MainScene->getSectorList())
+    {
+        foreach (const scene::Sector* To, MainScene->getSectorList())
+            VisibilityMatrix.push_back(MainScene->isSectorVisible(From, To));
+    }
+    
+    if (!MainScene->savePVS("PortalBasedScene.pvs") || !MainScene->loadPVS("PortalBasedScene.pvs"))
+        io::Log::error("PVS round trip failed");
+    else
+    {
+        u32 i = 0, Mismatches = 0;
+        
+        foreach (const scene::Sector* From, MainScene->getSectorList())
+        {
+            foreach (const scene::Sector* To, MainScene->getSectorList())
+            {
+                if (VisibilityMatrix[i++] != MainScene->isSectorVisible(From, To))
+                    ++Mismatches;
+            }
+        }
+        
+        if (Mismatches > 0)
+            io::Log::error("Loaded PVS differs from the computed PVS in " + io::stringc(Mismatches) + " entries");
+        else
+            io::Log::message("PVS round trip succeeded");
+    }
     #endif
     
     SP_TESTS_MAIN_BEGIN